@@ -6,6 +6,7 @@
 // this dir
 #include "compare-util.h"              // compare
 #include "exc.h"                       // XBase
+#include "nonport.h"                   // getMilliseconds
 #include "objlist.h"                   // ObjList
 #include "sm-iostream.h"               // ostream
 #include "sm-macros.h"                 // TABLESIZE
@@ -16,7 +17,10 @@
 
 // libc++
 #include <algorithm>                   // std::sort
-#include <cstdlib>                     // std::rand
+#include <cstdint>                     // std::int64_t
+#include <cstdlib>                     // std::{rand, srand, getenv, atoi}
+#include <new>                         // std::bad_alloc
+#include <type_traits>                 // std::true_type
 #include <vector>                      // std::vector
 
 // libc
@@ -419,6 +423,429 @@ static void testSort()
 }
 
 
+// Element type that counts how it is copied and moved.
+template <bool noexceptMove>
+class Counted {
+public:      // class data
+  static int s_copies;
+  static int s_moves;
+
+public:      // data
+  int m_value;
+
+public:      // funcs
+  Counted() : m_value(0) {}
+  Counted(Counted const &obj) : m_value(obj.m_value) { s_copies++; }
+  Counted(Counted &&obj) noexcept(noexceptMove)
+    : m_value(obj.m_value) { s_moves++; }
+
+  Counted &operator=(Counted const &obj)
+    { m_value = obj.m_value; s_copies++; return *this; }
+};
+
+template <bool noexceptMove>
+int Counted<noexceptMove>::s_copies = 0;
+
+template <bool noexceptMove>
+int Counted<noexceptMove>::s_moves = 0;
+
+
+// Push 'n' elements, return the number of copies made while growing.
+template <bool noexceptMove>
+static int copiesWhileGrowing(int n)
+{
+  typedef Counted<noexceptMove> C;
+  C::s_copies = C::s_moves = 0;
+
+  ArrayStack<C> arr;
+  C c;
+  for (int i=0; i < n; i++) {
+    c.m_value = i;
+    arr.push(c);         // one copy assignment each
+  }
+  for (int i=0; i < n; i++) {
+    xassert(arr[i].m_value == i);
+  }
+
+  return C::s_copies - n;
+}
+
+
+// Trivially relocatable, but not trivially copyable.
+struct Relocatable {
+  int *m_ptr;
+
+  Relocatable() : m_ptr(new int(0)) {}
+  Relocatable(Relocatable const &obj) : m_ptr(new int(*obj.m_ptr)) {}
+  Relocatable &operator=(Relocatable const &obj)
+    { *m_ptr = *obj.m_ptr; return *this; }
+  ~Relocatable() { delete m_ptr; }
+};
+
+template <>
+struct IsTriviallyRelocatable<Relocatable> : std::true_type {};
+
+
+static void testGrowth()
+{
+  // Growing moves the existing elements when that cannot throw, and
+  // otherwise copies them.
+  xassert(copiesWhileGrowing<true>(1000) == 0);
+  xassert(Counted<true>::s_moves > 1000);
+  xassert(copiesWhileGrowing<false>(1000) > 1000);
+  xassert(Counted<false>::s_moves == 0);
+
+  // Strings survive growth and shrinking.
+  {
+    ArrayStack<string> arr;
+    for (int i=0; i < 1000; i++) {
+      arr.push(stringb("string number " << i));
+    }
+    arr.consolidate();
+    xassert(arr.allocatedSize() == 1000);
+    for (int i=0; i < 1000; i++) {
+      xassert(arr[i] == stringb("string number " << i));
+    }
+
+    ArrayStack<string> copy(arr);
+    arr.popMany(500);
+    arr.consolidate();
+    xassert(arr[499] == copy[499]);
+    copy = arr;
+    xassert(copy.length() == 500);
+  }
+
+  // Relocatable elements are moved with 'realloc', and truncated ones
+  // are destroyed, so nothing leaks.
+  {
+    GrowArray<Relocatable> arr(3);
+    for (int i=0; i < 100; i++) {
+      arr.ensureIndexDoubler(i);
+      *(arr[i].m_ptr) = i;
+    }
+    arr.setAllocatedSize(50);
+    for (int i=0; i < 50; i++) {
+      xassert(*(arr[i].m_ptr) == i);
+    }
+    arr.setAllocatedSize(0);
+    xassert(arr.getArray() == NULL);
+  }
+
+  // The growth factor is configurable.
+  {
+    GrowArray<int> arr(0);
+    arr.ensureIndexDoubler(4);
+    xassert(arr.allocatedSize() == 8);
+
+    GrowArray<int> arr2(0);
+    arr2.setGrowthPercent(150);
+    std::vector<int> sizes;
+    for (int i=0; i < 20; i++) {
+      arr2.ensureIndexDoubler(i);
+      if (sizes.empty() || sizes.back() != arr2.allocatedSize()) {
+        sizes.push_back(arr2.allocatedSize());
+      }
+    }
+    xassert((sizes == std::vector<int>{2, 3, 4, 6, 9, 13, 19, 28}));
+  }
+
+  // Large arrays grow by the full factor, rather than being clamped
+  // to the size type's maximum.
+  {
+    GrowArray<char> arr(11000000);
+    arr.ensureIndexDoubler(11000000);
+    xassert(arr.allocatedSize() == 22000000);
+
+    GrowArray<char> arr2(0);
+    arr2.setGrowthPercent(150);
+    arr2.ensureIndexDoubler(10);
+    xassert(arr2.allocatedSize() == 13);
+
+    // The factor is bounded so the growth computation cannot overflow.
+    arr2.setGrowthPercent(1000);
+    arr2.ensureIndexDoubler(13);
+    xassert(arr2.allocatedSize() == 130);
+    bool threw = false;
+    try {
+      arr2.setGrowthPercent(1001);
+    }
+    catch (XBase &) {
+      threw = true;
+    }
+    xassert(threw);
+    xassert(arr2.getGrowthPercent() == 1000);
+  }
+
+  // Growth near the limit of the size type stops at the limit.
+  {
+    ArrayStack<char, short> arr;
+    std::vector<short> sizes;
+    for (int i=0; i < 20000; i++) {
+      arr.push((char)i);
+      if (sizes.empty() || sizes.back() != arr.allocatedSize()) {
+        sizes.push_back(arr.allocatedSize());
+      }
+    }
+    xassert(sizes.size() >= 2);
+    xassert(sizes[sizes.size()-2] == 16384);
+    xassert(sizes.back() == 32767);
+  }
+
+  // A size whose byte count does not fit in 'ptrdiff_t' is rejected
+  // rather than wrapping around to a small allocation.
+  {
+    GrowArray64<int> arr(1);
+    std::int64_t const huge = (std::int64_t(1) << 62) + 1;
+    bool threw = false;
+    try {
+      arr.setAllocatedSize(huge);
+    }
+    catch (std::bad_alloc &) {
+      threw = true;
+    }
+    xassert(threw);
+    xassert(arr.allocatedSize() == 1);
+
+    threw = false;
+    try {
+      arr.ensureIndexDoubler(huge);
+    }
+    catch (std::bad_alloc &) {
+      threw = true;
+    }
+    xassert(threw);
+    xassert(arr.allocatedSize() == 1);
+  }
+}
+
+
+static void testMoveElement()
+{
+  ArrayStack<string> arr;
+  std::vector<string> vec;
+  for (int i=0; i < 10; i++) {
+    arr.push(stringb(i));
+    vec.push_back(stringb(i));
+  }
+
+  for (int iter=0; iter < 100; iter++) {
+    int oldIndex = std::rand() % 10;
+    int newIndex = std::rand() % 10;
+    arr.moveElement(oldIndex, newIndex);
+
+    string s = vec[oldIndex];
+    vec.erase(vec.begin() + oldIndex);
+    vec.insert(vec.begin() + newIndex, s);
+
+    xassert(arr.asVector() == vec);
+  }
+}
+
+
+// Exercise an ArrayStack with a size type other than 'int'.
+template <class SizeT>
+static void testSizeType()
+{
+  ArrayStack<int, SizeT> arr;
+  for (int i=0; i < 100; i++) {
+    arr.push(i);
+  }
+  xassert(arr.length() == 100);
+  xassert(arr.indexOf(42) == 42);
+  xassert(arr.indexOf(1000) == -1);
+
+  arr.moveElement(0, 99);
+  xassert(arr[99] == 0);
+  xassert(arr[0] == 1);
+
+  applyFilter(arr, isEven);
+  xassert(arr.length() == 50);
+
+  ArrayStack<int, SizeT> copy(arr);
+  xassert(copy == arr);
+  arr.pop();
+  xassert(copy != arr);
+
+  // The iterator can be named with the size type or the stack type.
+  int sum1 = 0;
+  for (ArrayStackIterNC<int, SizeT> iter(copy); !iter.isDone(); iter.adv()) {
+    sum1 += *(iter.data());
+  }
+  int sum2 = 0;
+  FOREACH_ARRAYSTACK_NC(int, copy, iter) {
+    sum2 += *(iter.data());
+  }
+  xassert(sum1 == sum2);
+}
+
+
+// With a small size type, growth stops at its maximum rather than
+// overflowing.
+static void testSizeTypeLimit()
+{
+  ArrayStack<int, signed char> arr;
+  for (int i=0; i < 127; i++) {
+    arr.push(i);
+  }
+  xassert(arr.length() == 127);
+  xassert(arr.allocatedSize() == 127);
+
+  try {
+    DIAG("This should throw:");
+    arr.push(127);
+    xfailure("should have failed");
+  }
+  catch (XBase &x) {
+    DIAG("as expected: " << x.why());
+  }
+}
+
+
+// Push more than 2^31 elements onto an ArrayStack64.  This allocates
+// 4 GB, so it only runs if ARRAY_TEST_BIG is set.
+static void testBigArray()
+{
+  if (!std::getenv("ARRAY_TEST_BIG")) {
+    return;
+  }
+
+  std::int64_t const n = (std::int64_t(1) << 31) + 10;
+  ArrayStack64<char> arr;
+  for (std::int64_t i=0; i < n; i++) {
+    arr.push((char)i);
+  }
+  xassert(arr.length() == n);
+  xassert(arr[n-1] == (char)(n-1));
+  xassert(arr.pop() == (char)(n-1));
+  DIAG("allocated size: " << arr.allocatedSize());
+}
+
+
+static void testSmallArrayStack()
+{
+  SmallArrayStack<string, 4> stk;
+  std::vector<string> vec;
+  xassert(stk.isEmbedded());
+
+  // Push past the embedded capacity, including an element of itself.
+  for (int i=0; i < 20; i++) {
+    if (i == 4) {
+      xassert(stk.isEmbedded());
+      stk.push(stk[0]);
+      vec.push_back(vec[0]);
+      continue;
+    }
+    stk.push(stringb("s" << i));
+    vec.push_back(stringb("s" << i));
+  }
+  xassert(!stk.isEmbedded());
+  xassert(stk.asVector() == vec);
+  xassert(stk.top() == "s19");
+  xassert(stk.nth(1) == "s18");
+  xassert(stk.indexOf("s7") == 7);
+  xassert(stk.indexOf("none") == -1);
+
+  // Copies and moves, from the heap and from the embedded array.
+  SmallArrayStack<string, 4> copy(stk);
+  xassert(copy == stk);
+  SmallArrayStack<string, 4> moved(std::move(copy));
+  xassert(moved == stk);
+  xassert(copy.isEmpty() && copy.isEmbedded());
+
+  SmallArrayStack<string, 4> small;
+  small.push("a");
+  small.push("b");
+  moved = small;
+  xassert(moved.asVector() == (std::vector<string>{"a", "b"}));
+  copy = std::move(small);
+  xassert(copy == moved);
+
+  // The FOREACH macro works with it.
+  int ct = 0;
+  FOREACH_ARRAYSTACK_NC(string, stk, iter) {
+    xassert(*(iter.data()) == vec[ct]);
+    ct++;
+  }
+  xassert(ct == 20);
+
+  // Pop and the alternate interface.
+  xassert(stk.pop() == "s19");
+  stk.pushAlt() = "alt";
+  xassert(stk.popAlt() == "alt");
+  stk.popMany(stk.length() - 3);
+  xassert(stk.length() == 3);
+
+  stk.moveElement(0, 2);
+  xassert((stk.asVector() == std::vector<string>{"s1", "s2", "s0"}));
+  stk.sort([](string const *a, string const *b) {
+             return compare(*a, *b);
+           });
+  xassert((stk.asVector() == std::vector<string>{"s0", "s1", "s2"}));
+
+  stk.clear();
+  xassert(stk.isEmpty());
+}
+
+
+// Run a workload resembling a parser or tree builder: many short-lived
+// stacks, most of them shallow.  Return the number of heap allocations
+// (or reallocations), inferred from changes in the allocated size.
+template <class Stack>
+static long stackWorkload(int iters, long &checksum)
+{
+  long allocs = 0;
+  for (int iter=0; iter < iters; iter++) {
+    // Depth is 1 to 4 most of the time, occasionally up to 64.
+    int r = std::rand();
+    int depth = (r % 8 == 0)? (r/8 % 64) + 1 : (r/8 % 4) + 1;
+
+    Stack stk;
+    int size = stk.allocatedSize();
+    for (int i=0; i < depth; i++) {
+      stk.push(i);
+      if (stk.allocatedSize() != size) {
+        size = stk.allocatedSize();
+        allocs++;
+      }
+    }
+    while (stk.isNotEmpty()) {
+      checksum += stk.pop();
+    }
+  }
+  return allocs;
+}
+
+
+// Compare ArrayStack and SmallArrayStack on 'stackWorkload'.  The
+// number of iterations comes from SMALL_ARRAY_STACK_PERF.
+static void testSmallArrayStackPerf()
+{
+  char const *itersStr = std::getenv("SMALL_ARRAY_STACK_PERF");
+  if (!itersStr) {
+    return;
+  }
+  int iters = std::atoi(itersStr);
+
+  long sums[2] = { 0, 0 };
+
+  std::srand(1);
+  long start = getMilliseconds();
+  long allocs = stackWorkload<ArrayStack<int> >(iters, sums[0]);
+  long ms = getMilliseconds() - start;
+  std::cout << "ArrayStack<int>:          " << allocs << " allocations, "
+            << ms << " ms\n";
+
+  std::srand(1);
+  start = getMilliseconds();
+  allocs = stackWorkload<SmallArrayStack<int, 8> >(iters, sums[1]);
+  ms = getMilliseconds() - start;
+  std::cout << "SmallArrayStack<int, 8>:  " << allocs << " allocations, "
+            << ms << " ms\n";
+
+  xassert(sums[0] == sums[1]);
+}
+
+
 // Called by unit-tests.cc.
 void test_array()
 {
@@ -439,6 +866,14 @@ void test_array()
   testArrayNegativeLength();
   testApplyFilter();
   testSort();
+  testGrowth();
+  testMoveElement();
+  testSizeType<long>();
+  testSizeType<std::int64_t>();
+  testSizeTypeLimit();
+  testBigArray();
+  testSmallArrayStack();
+  testSmallArrayStackPerf();
 }
 
 
@@ -2,8 +2,9 @@
 // Several array-like template classes, including growable arrays.
 
 // These classes predate the wide availability of the C++ standard
-// library.  Except for ArrayStackEmbed, none of these should be used in
-// new code, as the standard provides preferable substitutes.
+// library.  Except for ArrayStackEmbed and SmallArrayStack, none of
+// these should be used in new code, as the standard provides
+// preferable substitutes.
 
 #ifndef SMBASE_ARRAY_H
 #define SMBASE_ARRAY_H
@@ -16,20 +17,40 @@
 #include "xassert.h"                   // xassert
 
 // libc++
-#include <algorithm>                   // std::sort
+#include <algorithm>                   // std::{sort, rotate, copy, move, equal}
+#include <cstddef>                     // std::max_align_t
+#include <cstdint>                     // std::int64_t
+#include <cstdlib>                     // std::{malloc, realloc, free}
 #include <iterator>                    // std::random_access_iterator_tag
-#include <utility>                     // std::swap
+#include <limits>                      // std::numeric_limits
+#include <memory>                      // std::{uninitialized_default_construct, uninitialized_copy, destroy}
+#include <new>                         // std::{bad_alloc, align_val_t}
+#include <type_traits>                 // std::{integral_constant, is_trivially_copyable, remove_reference_t, ...}
+#include <utility>                     // std::{swap, move, move_if_noexcept, declval}
 #include <vector>                      // std::vector
 
 // libc
 #include <stddef.h>                    // size_t, ptrdiff_t
 
 
+// -------------------- Size types ----------------------
+// Array, GrowArray and ArrayStack (and ArrayQueue, in arrayqueue.h)
+// take an optional 'SizeT' parameter, the signed integer type of their
+// sizes and indices.  It defaults to 'int'.  For arrays that can hold
+// 2^31 or more elements, use 'std::int64_t', or the '...64' aliases.
+#define ARRAY_H_CHECK_SIZET(SizeT)                                 \
+  static_assert(std::is_integral<SizeT>::value &&                  \
+                std::is_signed<SizeT>::value,                      \
+                "SizeT must be a signed integer type")
+
+
 // -------------------- Array ----------------------
 // This is the same as C++'s built-in array, but automatically deallocates.
 // If you want bounds checking too, use GrowArray, below.
-template <class T>
+template <class T, class SizeT = int>
 class Array {
+  ARRAY_H_CHECK_SIZET(SizeT);
+
 private:     // data
   T *arr;
 
@@ -38,7 +59,7 @@ private:     // not allowed
   void operator=(Array&);
 
 public:
-  explicit Array(int len)
+  explicit Array(SizeT len)
     : arr(new T[(len>=0? len :
                   (xfailure("Array with negative length"), 0) )])
   {}
@@ -50,20 +71,38 @@ public:
     GENERIC_CATCH_END
   }
 
-  T const &operator[] (int i) const { return arr[i]; }
-  T &operator[] (int i) { return arr[i]; }
+  T const &operator[] (SizeT i) const { return arr[i]; }
+  T &operator[] (SizeT i) { return arr[i]; }
 
   T const *ptrC() const { return arr; }
   T *ptr() { return arr; }
 
   // convenience
-  void setAll(T val, int len) {
-    for (int i=0; i<len; i++) {
+  void setAll(T val, SizeT len) {
+    for (SizeT i=0; i<len; i++) {
       arr[i] = val;
     }
   }
 };
 
+template <class T>
+using Array64 = Array<T, std::int64_t>;
+
+
+// --------------- IsTriviallyRelocatable ----------------
+// True if a T can be moved to a new address by copying its bytes,
+// without running its move constructor and destructor.  GrowArray uses
+// this to grow with 'realloc'.  It holds for trivially copyable types,
+// and can be specialized to true for others that do not point into
+// themselves, for example:
+//
+//   template <>
+//   struct IsTriviallyRelocatable<MyClass> : std::true_type {};
+//
+template <class T>
+struct IsTriviallyRelocatable
+  : std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+
 
 // ------------------ GrowArray --------------------
 // This class implements an array of T's; it automatically expands
@@ -72,53 +111,92 @@ public:
 //
 // class T must have:
 //   T::T();           // default ctor for making arrays
-//   operator=(T&);    // assignment for copying to new storage
+//   T::T(T&&);        // move (or copy) ctor for moving to new storage
+//   T::T(T const&);   // copy ctor and assignment for copying the
+//   operator=(T&);    // .. array itself
 //   T::~T();          // dtor for when old array is cleared
-template <class T>
+//
+// When the array is resized, elements are moved to the new storage,
+// or copied if moving could throw and copying is possible.  If T is
+// trivially relocatable (see above), the storage is instead resized
+// with 'realloc', which often avoids copying at all.
+template <class T, class SizeT = int>
 class GrowArray {
+  ARRAY_H_CHECK_SIZET(SizeT);
+
+private:     // types
+  // True if storage is managed with malloc/realloc/free, rather than
+  // operator new and delete.
+  static constexpr bool useRealloc =
+    IsTriviallyRelocatable<T>::value &&
+    alignof(T) <= alignof(std::max_align_t);
+
+  typedef typename std::make_unsigned<SizeT>::type USizeT;
+
 private:     // data
   T *arr;                 // underlying array; NULL if sz==0
-  int sz;                 // # allocated entries in 'arr'
+  SizeT sz;               // # allocated entries in 'arr'
+
+  // Percentage by which 'ensureIndexDoubler' multiplies the size when
+  // it grows the array; in (100,1000].
+  int growthPercent;
 
 private:     // funcs
-  void bc(int i) const    // bounds-check an index
-    { xassert((unsigned)i < (unsigned)sz); }
-  void eidLoop(int index);
+  void bc(SizeT i) const  // bounds-check an index
+    { xassert((USizeT)i < (USizeT)sz); }
+  void eidLoop(SizeT index);
 
-  // make 'this' equal to 'obj'
-  void copyFrom(GrowArray<T> const &obj) {
-    setAllocatedSize(obj.allocatedSize()); // not terribly efficient, oh well
-    copyFrom_limit(obj, sz);
+  // Largest number of elements whose total size in bytes fits in
+  // 'ptrdiff_t', and in 'SizeT'.
+  static constexpr SizeT maxElements()
+  {
+    std::size_t const byteLimit =
+      (std::size_t)std::numeric_limits<std::ptrdiff_t>::max() / sizeof(T);
+    return (std::size_t)std::numeric_limits<SizeT>::max() < byteLimit?
+      std::numeric_limits<SizeT>::max() : (SizeT)byteLimit;
   }
 
+  // Get and release uninitialized storage for 'n' elements.  Throws
+  // 'std::bad_alloc' if 'n' exceeds 'maxElements()'.
+  static T *allocateStorage(SizeT n);
+  static void freeStorage(T *p);
+
+  // Construct [dest,dest+n) from [src,src+n), moving if that cannot
+  // throw.  If it throws, nothing is left constructed in 'dest'.
+  static void uninitializedMoveIfNoexcept(T *src, SizeT n, T *dest);
+
+  // make 'this' equal to 'obj'
+  void copyFrom(GrowArray const &obj);
+
 protected:   // funcs
-  void copyFrom_limit(GrowArray<T> const &obj, int limit);
+  void copyFrom_limit(GrowArray const &obj, SizeT limit);
 
 private:     // disallowed
   void operator=(GrowArray&);
   void operator==(GrowArray&);
 
 public:      // funcs
-  explicit GrowArray(int initSz);
-  GrowArray(GrowArray const &obj) : arr(0), sz(0) { copyFrom(obj); }
+  explicit GrowArray(SizeT initSz);
+  GrowArray(GrowArray const &obj)
+    : arr(0), sz(0), growthPercent(obj.growthPercent) { copyFrom(obj); }
   ~GrowArray();
 
   GrowArray& operator=(GrowArray const &obj) { copyFrom(obj); return *this; }
 
   // Allocated space, as number of elements in the array.
-  int allocatedSize() const { return sz; }
+  SizeT allocatedSize() const { return sz; }
 
   // element access
-  T const& operator[] (int i) const   { bc(i); return arr[i]; }
-  T      & operator[] (int i)         { bc(i); return arr[i]; }
+  T const& operator[] (SizeT i) const { bc(i); return arr[i]; }
+  T      & operator[] (SizeT i)       { bc(i); return arr[i]; }
 
   // set size, reallocating if old size is different; if the
   // array gets bigger, existing elements are preserved; if the
   // array gets smaller, elements are truncated
-  void setAllocatedSize(int newSz);
+  void setAllocatedSize(SizeT newSz);
 
   // make sure there are at least 'minSz' elements in the array;
-  void ensureAtLeast(int minSz)
+  void ensureAtLeast(SizeT minSz)
     { if (minSz > sz) { setAllocatedSize(minSz); } }
 
   // grab a read-only pointer to the raw array
@@ -129,24 +207,32 @@ public:      // funcs
   T *getArrayNC() { return arr; }     // ok, not all that dangerous..
 
   // make sure the given index is valid; if this requires growing,
-  // do so by doubling the size of the array (repeatedly, if
-  // necessary)
-  void ensureIndexDoubler(int index)
+  // do so by doubling the size of the array (or multiplying it by
+  // the growth factor; repeatedly, if necessary)
+  void ensureIndexDoubler(SizeT index)
     { if (sz-1 < index) { eidLoop(index); } }
 
+  // Set the factor by which 'ensureIndexDoubler' grows the array, as
+  // a percentage in (100,1000].  The default is 200.  A smaller factor
+  // wastes less space but copies elements more often.
+  void setGrowthPercent(int pct)
+    { xassert(pct > 100 && pct <= 1000); growthPercent = pct; }
+  int getGrowthPercent() const { return growthPercent; }
+
   // set an element, using the doubler if necessary
-  void setIndexDoubler(int index, T const &value)
+  void setIndexDoubler(SizeT index, T const &value)
     { ensureIndexDoubler(index); arr[index] = value; }
 
-  // swap my data with the data in another GrowArray object
-  void swapWith(GrowArray<T> &obj) {
+  // swap my data with the data in another GrowArray object; the
+  // growth factors stay put
+  void swapWith(GrowArray &obj) {
     T *tmp1 = obj.arr; obj.arr = this->arr; this->arr = tmp1;
-    int tmp2 = obj.sz; obj.sz = this->sz; this->sz = tmp2;
+    SizeT tmp2 = obj.sz; obj.sz = this->sz; this->sz = tmp2;
   }
 
   // set all elements to a single value
   void setAll(T val) {
-    for (int i=0; i<sz; i++) {
+    for (SizeT i=0; i<sz; i++) {
       arr[i] = val;
     }
   }
@@ -154,110 +240,249 @@ public:      // funcs
   // Move the item at 'oldIndex' so it occupies 'newIndex' instead,
   // shifting the intervening elements by one spot.  Both arguments
   // must be in [0,allocatedSize()-1].
-  void moveElement(int oldIndex, int newIndex);
+  void moveElement(SizeT oldIndex, SizeT newIndex);
 };
 
-
 template <class T>
-GrowArray<T>::GrowArray(int initSz)
+using GrowArray64 = GrowArray<T, std::int64_t>;
+
+
+template <class T, class SizeT>
+GrowArray<T,SizeT>::GrowArray(SizeT initSz)
+  : arr(NULL),
+    sz(0),
+    growthPercent(200)
+{
+  setAllocatedSize(initSz);
+}
+
+
+template <class T, class SizeT>
+GrowArray<T,SizeT>::~GrowArray()
 {
-  sz = initSz;
-  if (sz > 0) {
-    arr = new T[sz];
+  if (arr) {
+    std::destroy(arr, arr+sz);
+    freeStorage(arr);
+  }
+}
+
+
+template <class T, class SizeT>
+T *GrowArray<T,SizeT>::allocateStorage(SizeT n)
+{
+  // Otherwise the byte count below could wrap around.
+  if (n > maxElements()) {
+    throw std::bad_alloc();
+  }
+
+  void *p;
+  if constexpr (useRealloc) {
+    p = std::malloc(sizeof(T) * (size_t)n);
+    if (!p) {
+      throw std::bad_alloc();
+    }
   }
   else {
-    arr = NULL;
+    p = ::operator new(sizeof(T) * (size_t)n, std::align_val_t(alignof(T)));
   }
+  return static_cast<T*>(p);
 }
 
 
-template <class T>
-GrowArray<T>::~GrowArray()
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::freeStorage(T *p)
 {
-  if (arr) {
-    delete[] arr;
+  if constexpr (useRealloc) {
+    std::free(p);
+  }
+  else {
+    ::operator delete(p, std::align_val_t(alignof(T)));
   }
 }
 
 
-template <class T>
-void GrowArray<T>::copyFrom_limit(GrowArray<T> const &obj, int limit)
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::uninitializedMoveIfNoexcept(T *src, SizeT n,
+                                                     T *dest)
 {
-  for (int i=0; i<limit; i++) {
-    arr[i] = obj.arr[i];
+  SizeT i = 0;
+  try {
+    for (; i < n; i++) {
+      new (dest+i) T(std::move_if_noexcept(src[i]));
+    }
+  }
+  catch (...) {
+    std::destroy(dest, dest+i);
+    throw;
   }
 }
 
 
-template <class T>
-void GrowArray<T>::setAllocatedSize(int newSz)
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::copyFrom(GrowArray const &obj)
 {
-  if (newSz != sz) {
-    // keep track of old
-    int oldSz = sz;
-    T *oldArr = arr;
+  if (&obj == this) {
+    return;
+  }
 
-    // make new
-    sz = newSz;
-    if (sz > 0) {
-      arr = new T[sz];
+  if (obj.sz == sz) {
+    copyFrom_limit(obj, sz);
+    return;
+  }
+
+  // Copy-construct into fresh storage rather than resizing and then
+  // assigning over the result.
+  T *newArr = NULL;
+  if (obj.sz > 0) {
+    newArr = allocateStorage(obj.sz);
+    try {
+      std::uninitialized_copy(obj.arr, obj.arr+obj.sz, newArr);
     }
-    else {
+    catch (...) {
+      freeStorage(newArr);
+      throw;
+    }
+  }
+
+  if (arr) {
+    std::destroy(arr, arr+sz);
+    freeStorage(arr);
+  }
+  arr = newArr;
+  sz = obj.sz;
+}
+
+
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::copyFrom_limit(GrowArray const &obj, SizeT limit)
+{
+  std::copy(obj.arr, obj.arr+limit, arr);
+}
+
+
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::setAllocatedSize(SizeT newSz)
+{
+  xassert(newSz >= 0);
+  if (newSz == sz) {
+    return;
+  }
+  if (newSz > maxElements()) {
+    throw std::bad_alloc();
+  }
+
+  if constexpr (useRealloc) {
+    // Destroy truncated elements, then let 'realloc' move the rest.
+    if (newSz < sz) {
+      std::destroy(arr+newSz, arr+sz);
+      sz = newSz;
+    }
+
+    if (newSz == 0) {
+      std::free(arr);
       arr = NULL;
+      return;
     }
 
-    // copy elements in common
-    for (int i=0; i<sz && i<oldSz; i++) {
-      arr[i] = oldArr[i];
+    void *p = std::realloc(static_cast<void*>(arr), sizeof(T) * (size_t)newSz);
+    if (!p) {
+      throw std::bad_alloc();
     }
+    arr = static_cast<T*>(p);
+
+    // If this throws, 'sz' still describes the constructed prefix.
+    std::uninitialized_default_construct(arr+sz, arr+newSz);
+    sz = newSz;
+  }
 
-    // get rid of old
-    if (oldArr) {
-      delete[] oldArr;
+  else {
+    T *newArr = NULL;
+    if (newSz > 0) {
+      newArr = allocateStorage(newSz);
+
+      // Construct the new elements first, so that if that fails, the
+      // existing ones have not been moved.
+      SizeT common = newSz < sz? newSz : sz;
+      try {
+        std::uninitialized_default_construct(newArr+common, newArr+newSz);
+        try {
+          uninitializedMoveIfNoexcept(arr, common, newArr);
+        }
+        catch (...) {
+          std::destroy(newArr+common, newArr+newSz);
+          throw;
+        }
+      }
+      catch (...) {
+        freeStorage(newArr);
+        throw;
+      }
     }
+
+    if (arr) {
+      std::destroy(arr, arr+sz);
+      freeStorage(arr);
+    }
+    arr = newArr;
+    sz = newSz;
   }
 }
 
 
 // this used to be ensureIndexDoubler's implementation, but
 // I wanted the very first check to be inlined
-template <class T>
-void GrowArray<T>::eidLoop(int index)
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::eidLoop(SizeT index)
 {
   if (sz-1 >= index) {
     return;
   }
 
-  int newSz = sz;
+  // The size cannot exceed what SizeT can represent, nor what can be
+  // allocated.
+  xassert(index < std::numeric_limits<SizeT>::max());
+  SizeT const maxSz = maxElements();
+  if (index >= maxSz) {
+    throw std::bad_alloc();
+  }
+
+  SizeT newSz = sz;
   while (newSz-1 < index) {
-    #ifndef NDEBUG_NO_ASSERTIONS    // silence warning..
-      int prevSz = newSz;
-    #endif
     if (newSz == 0) {
       newSz = 1;
     }
-    newSz = newSz*2;
-    xassert(newSz > prevSz);        // otherwise overflow -> infinite loop
+
+    // Add 'growthPercent - 100' percent, but stop at 'maxSz' rather
+    // than overflowing.  The increase is computed as
+    // 'newSz/100*extra + newSz%100*extra/100', which is exact, and
+    // checked against the room left before multiplying.  Since
+    // 'extra' is at most 900, 'newSz%100*extra' fits in an 'int'.
+    int const extra = growthPercent - 100;
+    SizeT const room = maxSz - newSz;
+    SizeT const hundreds = newSz / 100;
+    SizeT const rest = newSz % 100 * extra / 100;
+    SizeT const increase =
+      (rest > room || hundreds > (room - rest) / extra)?
+        room : hundreds * extra + rest;
+    newSz += increase > 0? increase : 1;
   }
 
   setAllocatedSize(newSz);
 }
 
 
-template <class T>
-void GrowArray<T>::moveElement(int oldIndex, int newIndex)
+template <class T, class SizeT>
+void GrowArray<T,SizeT>::moveElement(SizeT oldIndex, SizeT newIndex)
 {
   this->bc(oldIndex);
   this->bc(newIndex);
 
-  while (oldIndex < newIndex) {
-    swap(this->arr[oldIndex], this->arr[oldIndex+1]);
-    oldIndex++;
+  // Shift the intervening elements with one rotation.
+  if (oldIndex < newIndex) {
+    std::rotate(arr+oldIndex, arr+oldIndex+1, arr+newIndex+1);
   }
-
-  while (oldIndex > newIndex) {
-    swap(this->arr[oldIndex], this->arr[oldIndex-1]);
-    oldIndex--;
+  else if (oldIndex > newIndex) {
+    std::rotate(arr+newIndex, arr+oldIndex, arr+oldIndex+1);
   }
 }
 
@@ -267,28 +492,31 @@ void GrowArray<T>::moveElement(int oldIndex, int newIndex)
 // it maintains a 'length', and elements 0 up to length-1 are
 // considered used, whereas length up to size-1 are unused.  The
 // expected use is as a stack, where "push" adds a new (used) element.
-template <class T>
-class ArrayStack : public GrowArray<T> {
+template <class T, class SizeT = int>
+class ArrayStack : public GrowArray<T,SizeT> {
+private:     // types
+  typedef typename std::make_unsigned<SizeT>::type USizeT;
+
 private:     // data
-  int len;               // # of elts in the stack
+  SizeT len;             // # of elts in the stack
 
 private:     // funcs
-  void bc(int i) const { xassert((unsigned)i < (unsigned)len); }
+  void bc(SizeT i) const { xassert((USizeT)i < (USizeT)len); }
 
 public:      // funcs
-  explicit ArrayStack(int initArraySize = 0)
-    : GrowArray<T>(initArraySize),
+  explicit ArrayStack(SizeT initArraySize = 0)
+    : GrowArray<T,SizeT>(initArraySize),
       len(0)
     {}
-  ArrayStack(ArrayStack<T> const &obj)
-    : GrowArray<T>(obj),
+  ArrayStack(ArrayStack<T,SizeT> const &obj)
+    : GrowArray<T,SizeT>(obj),
       len(obj.len)
     {}
   ~ArrayStack();
 
   // copies contents of 'obj', but the allocated size of 'this' will
   // only change when necessary
-  ArrayStack& operator=(ArrayStack<T> const &obj)
+  ArrayStack& operator=(ArrayStack<T,SizeT> const &obj)
   {
     this->ensureIndexDoubler(obj.length() - 1);
     this->copyFrom_limit(obj, obj.length());
@@ -298,9 +526,9 @@ public:      // funcs
 
   // element access; these declarations are necessary because
   // the uses of 'operator[]' below are not "dependent", hence
-  // they can't use declarations inherited from GrowArray<T>
-  T const& operator[] (int i) const { return GrowArray<T>::operator[](i); }
-  T      & operator[] (int i)       { return GrowArray<T>::operator[](i); }
+  // they can't use declarations inherited from GrowArray<T,SizeT>
+  T const& operator[] (SizeT i) const { return GrowArray<T,SizeT>::operator[](i); }
+  T      & operator[] (SizeT i)       { return GrowArray<T,SizeT>::operator[](i); }
 
   void push(T const &val)
     { this->setIndexDoubler(len++, val); }
@@ -310,13 +538,13 @@ public:      // funcs
     { return operator[](len-1); }
   T &top()
     { return operator[](len-1); }
-  T &nth(int which)
+  T &nth(SizeT which)
     { return operator[](len-1-which); }
 
   // alternate interface, where init/deinit is done explicitly
   // on returned references
   T &pushAlt()    // returns newly accessible item
-    { GrowArray<T>::ensureIndexDoubler(len++); return top(); }
+    { GrowArray<T,SizeT>::ensureIndexDoubler(len++); return top(); }
   T &popAlt()     // returns item popped
     { return operator[](--len); }
 
@@ -326,10 +554,10 @@ public:      // funcs
   // The new objects are uninitialized in that they could be newly added
   // and hence default-constructed but could also be left over from some
   // prior use.
-  T *ptrToPushedMultipleAlt(int numToPush);
+  T *ptrToPushedMultipleAlt(SizeT numToPush);
 
   // items stored
-  int length() const
+  SizeT length() const
     { return len; }
 
   bool isEmpty() const
@@ -338,9 +566,9 @@ public:      // funcs
     { return !isEmpty(); }
 
   // Return index of element 't' or -1 if not in the array.
-  int indexOf(T const &t) const;
+  SizeT indexOf(T const &t) const;
 
-  void popMany(int ct)
+  void popMany(SizeT ct)
     { len -= ct; xassert(len >= 0); }
   void empty()        // TODO: Rename this!  STL collision.
     { len = 0; }
@@ -349,19 +577,19 @@ public:      // funcs
 
   // useful when someone has used 'getDangerousWritableArray' to
   // fill the array's internal storage
-  void setLength(int L) { len = L; }
+  void setLength(SizeT L) { len = L; }
 
   // consolidate allocated space to match length
   void consolidate() { this->setAllocatedSize(length()); }
 
   // swap
-  void swapWith(ArrayStack<T> &obj) {
-    GrowArray<T>::swapWith(obj);
-    int tmp = obj.len; obj.len = this->len; this->len = tmp;
+  void swapWith(ArrayStack<T,SizeT> &obj) {
+    GrowArray<T,SizeT>::swapWith(obj);
+    SizeT tmp = obj.len; obj.len = this->len; this->len = tmp;
   }
 
   void sort(int (*compare)(T const *t1, T const *t2)) {
-    T *start = GrowArray<T>::getArrayNC();
+    T *start = GrowArray<T,SizeT>::getArrayNC();
     std::sort(start, start+len,
               [=](T const &a, T const &b) {
                 return compare(&a, &b) < 0;
@@ -369,30 +597,33 @@ public:      // funcs
 
     // This is unsafe since 'T' might not be bitwise copyable!  This
     // specifically is an issue when it is or contains std::string.
-    //qsort(GrowArray<T>::getArrayNC(), len, sizeof(T),
+    //qsort(GrowArray<T,SizeT>::getArrayNC(), len, sizeof(T),
     //      (int (*)(void const*, void const*))compare );
   }
 
   // Move the item at 'oldIndex' so it occupies 'newIndex' instead,
   // shifting the intervening elements by one spot.  Both arguments
   // must be in [0,length()-1].
-  void moveElement(int oldIndex, int newIndex);
+  void moveElement(SizeT oldIndex, SizeT newIndex);
 
   // Yield the same sequence of elements as a std::vector.
   std::vector<T> asVector() const;
 };
 
 template <class T>
-ArrayStack<T>::~ArrayStack()
+using ArrayStack64 = ArrayStack<T, std::int64_t>;
+
+template <class T, class SizeT>
+ArrayStack<T,SizeT>::~ArrayStack()
 {}
 
 
-template <class T>
-T *ArrayStack<T>::ptrToPushedMultipleAlt(int numToPush)
+template <class T, class SizeT>
+T *ArrayStack<T,SizeT>::ptrToPushedMultipleAlt(SizeT numToPush)
 {
   // 'ensureIndexDoubler' is slightly awkward as it wants the maximum
   // valid index rather than the length.
-  int oldLength = this->length();
+  SizeT oldLength = this->length();
   this->ensureIndexDoubler(oldLength + numToPush - 1);
 
   // Bump the length to include these new elements.
@@ -403,10 +634,10 @@ T *ArrayStack<T>::ptrToPushedMultipleAlt(int numToPush)
 }
 
 
-template <class T>
-int ArrayStack<T>::indexOf(T const &t) const
+template <class T, class SizeT>
+SizeT ArrayStack<T,SizeT>::indexOf(T const &t) const
 {
-  for (int i=0; i < this->length(); i++) {
+  for (SizeT i=0; i < this->length(); i++) {
     if (this->operator[](i) == t) {
       return i;
     }
@@ -415,24 +646,24 @@ int ArrayStack<T>::indexOf(T const &t) const
 }
 
 
-template <class T>
-void ArrayStack<T>::moveElement(int oldIndex, int newIndex)
+template <class T, class SizeT>
+void ArrayStack<T,SizeT>::moveElement(SizeT oldIndex, SizeT newIndex)
 {
   // GrowArray also checks bounds, but only against the allocated
   // size, not the ArrayStack 'len' field.
   this->bc(oldIndex);
   this->bc(newIndex);
 
-  this->GrowArray<T>::moveElement(oldIndex, newIndex);
+  this->GrowArray<T,SizeT>::moveElement(oldIndex, newIndex);
 }
 
 
-template <class T>
-std::vector<T> ArrayStack<T>::asVector() const
+template <class T, class SizeT>
+std::vector<T> ArrayStack<T,SizeT>::asVector() const
 {
   std::vector<T> vec;
   vec.reserve(this->length());
-  for (int i=0; i < this->length(); i++) {
+  for (SizeT i=0; i < this->length(); i++) {
     vec.push_back(this->operator[](i));
   }
   return vec;
@@ -440,13 +671,13 @@ std::vector<T> ArrayStack<T>::asVector() const
 
 
 // Compare two ArrayStacks elementwise for equality.
-template <class T>
-bool operator== (ArrayStack<T> const &a1, ArrayStack<T> const &a2)
+template <class T, class SizeT>
+bool operator== (ArrayStack<T,SizeT> const &a1, ArrayStack<T,SizeT> const &a2)
 {
   if (a1.length() != a2.length()) {
     return false;
   }
-  for (int i=0; i < a1.length(); i++) {
+  for (SizeT i=0; i < a1.length(); i++) {
     if (a1[i] != a2[i]) {
       return false;
     }
@@ -454,8 +685,8 @@ bool operator== (ArrayStack<T> const &a1, ArrayStack<T> const &a2)
   return true;
 }
 
-template <class T>
-bool operator!= (ArrayStack<T> const &a1, ArrayStack<T> const &a2)
+template <class T, class SizeT>
+bool operator!= (ArrayStack<T,SizeT> const &a1, ArrayStack<T,SizeT> const &a2)
 {
   return !operator==(a1, a2);
 }
@@ -474,17 +705,25 @@ inline string toString(ArrayStack<unsigned char> const &arr)
 
 
 // iterator over contents of an ArrayStack, to make it easier to
-// switch between it and SObjList as a representation
-template <class T>
+// switch between it and SObjList as a representation; as with
+// ArrayStack, the second argument is the size type, but it can
+// instead be the type of another stack with the same interface, like
+// SmallArrayStack
+template <class T, class SizeT = int>
 class ArrayStackIterNC {
   NO_OBJECT_COPIES(ArrayStackIterNC);   // for now
 
+private:     // types
+  typedef std::conditional_t<std::is_integral<SizeT>::value,
+                             ArrayStack<T,SizeT>, SizeT> Container;
+  typedef decltype(std::declval<Container&>().length()) IndexT;
+
 private:     // data
-  ArrayStack<T> /*const*/ &arr;   // array being accessed
-  int index;                      // current element
+  Container /*const*/ &arr;       // array being accessed
+  IndexT index;                   // current element
 
 public:      // funcs
-  explicit ArrayStackIterNC(ArrayStack<T> /*const*/ &a)
+  explicit ArrayStackIterNC(Container /*const*/ &a)
     : arr(a), index(0) {}
 
   // iterator actions
@@ -493,22 +732,23 @@ public:      // funcs
   T /*const*/ *data() const       { return &(arr[index]); }
 };
 
-#define FOREACH_ARRAYSTACK_NC(T, list, iter) \
-  for(ArrayStackIterNC< T > iter(list); !iter.isDone(); iter.adv())
+#define FOREACH_ARRAYSTACK_NC(T, list, iter)                          \
+  for(ArrayStackIterNC< T, std::remove_reference_t<decltype(list)> > \
+        iter(list); !iter.isDone(); iter.adv())
 
 
 // I want const polymorphism!
 
 
 // pop (and discard) a value off a stack at end of scope
-template <class T>
+template <class T, class SizeT = int>
 class ArrayStackPopper {
 private:
-  ArrayStack<T> &stk;
+  ArrayStack<T,SizeT> &stk;
 
 public:
-  explicit ArrayStackPopper(ArrayStack<T> &s) : stk(s) {}
-  ArrayStackPopper(ArrayStack<T> &s, T const &pushVal)
+  explicit ArrayStackPopper(ArrayStack<T,SizeT> &s) : stk(s) {}
+  ArrayStackPopper(ArrayStack<T,SizeT> &s, T const &pushVal)
     : stk(s) { stk.push(pushVal); }
   ~ArrayStackPopper()
     { stk.pop(); }
@@ -518,14 +758,14 @@ template <class T> class ObjArrayStackIterNC;
 
 
 // Remove all elements from 'arr' for which 'condition' is false.
-template <class T, class FUNCTYPE>
-void applyFilter(ArrayStack<T> &arr, FUNCTYPE condition)
+template <class T, class FUNCTYPE, class SizeT>
+void applyFilter(ArrayStack<T,SizeT> &arr, FUNCTYPE condition)
 {
   // Where to place the next element that satisfies the condition.
-  int destIndex = 0;
+  SizeT destIndex = 0;
 
   // Next element to test.
-  int srcIndex = 0;
+  SizeT srcIndex = 0;
 
   while (srcIndex < arr.length()) {
     if (condition(arr[srcIndex])) {
@@ -937,15 +1177,302 @@ void ArrayStackEmbed<T,n>::moveElement(int oldIndex, int newIndex)
   this->bc(oldIndex);
   this->bc(newIndex);
 
-  while (oldIndex < newIndex) {
-    swap(this->operator[](oldIndex), this->operator[](oldIndex+1));
-    oldIndex++;
+  if (oldIndex < newIndex) {
+    std::rotate(begin()+oldIndex, begin()+oldIndex+1, begin()+newIndex+1);
   }
+  else if (oldIndex > newIndex) {
+    std::rotate(begin()+newIndex, begin()+oldIndex, begin()+oldIndex+1);
+  }
+}
+
+
+// ------------------------- SmallArrayStack --------------------------
+// This is an ArrayStack that keeps up to 'n' elements in an array
+// embedded in the object, and only uses the heap once it grows beyond
+// that.  Unlike ArrayStackEmbed, the elements are always contiguous:
+// when the embedded array overflows, all of the elements move to the
+// heap, and they stay there.
+//
+// The interface follows ArrayStack.  As there, storage beyond
+// 'length()' holds default-constructed or previously used objects,
+// so class T must have a default ctor, and assignment for 'push'.
+template <class T, int n>
+class SmallArrayStack {
+  static_assert(n > 0, "the embedded array must not be empty");
+
+private:      // data
+  // embedded storage, used while 'arr == embed'
+  T embed[n];
+
+  // heap storage, used once 'arr' points at its array
+  GrowArray<T> heap;
+
+  // the elements: either 'embed' or the heap array
+  T *arr;
 
-  while (oldIndex > newIndex) {
-    swap(this->operator[](oldIndex), this->operator[](oldIndex-1));
-    oldIndex--;
+  // allocated size of 'arr'
+  int sz;
+
+  // number of elements in the stack
+  int len;
+
+private:      // funcs
+  void bc(int i) const    // bounds-check an index
+    { xassert((unsigned)i < (unsigned)len); }
+
+  // Grow 'arr' to hold at least 'minSz' elements.
+  void grow(int minSz);
+
+  // Become empty, using the embedded array.
+  void reset();
+
+public:       // funcs
+  SmallArrayStack()
+    : /*embed is default-init'd*/
+      heap(0),
+      arr(embed),
+      sz(n),
+      len(0)
+  {}
+
+  SmallArrayStack(SmallArrayStack const &obj);
+  SmallArrayStack(SmallArrayStack &&obj);
+  ~SmallArrayStack()
+  {}              // heap auto-deallocs its internal data
+
+  SmallArrayStack &operator=(SmallArrayStack const &obj);
+  SmallArrayStack &operator=(SmallArrayStack &&obj);
+
+  // element access
+  T const& operator[] (int i) const { bc(i); return arr[i]; }
+  T      & operator[] (int i)       { bc(i); return arr[i]; }
+
+  void push(T const &val);
+  void push(T &&val);
+  T pop()
+    { bc(len-1); return std::move(arr[--len]); }
+  T const &top() const
+    { return operator[](len-1); }
+  T &top()
+    { return operator[](len-1); }
+  T &nth(int which)
+    { return operator[](len-1-which); }
+
+  // alternate interface, as in ArrayStack
+  T &pushAlt()    // returns newly accessible item
+    { ensureAtLeast(len+1); return arr[len++]; }
+  T &popAlt()     // returns item popped
+    { bc(len-1); return arr[--len]; }
+
+  // items stored
+  int length() const
+    { return len; }
+
+  bool isEmpty() const
+    { return len==0; }
+  bool isNotEmpty() const
+    { return !isEmpty(); }
+
+  // Return index of element 't' or -1 if not in the array.
+  int indexOf(T const &t) const;
+
+  void popMany(int ct)
+    { len -= ct; xassert(len >= 0); }
+  void empty()
+    { len = 0; }
+  void clear()
+    { len = 0; }
+
+  // Allocated space, as number of elements; at least 'n'.
+  int allocatedSize() const
+    { return sz; }
+
+  // make sure there is room for 'minSz' elements without growing
+  void ensureAtLeast(int minSz)
+    { if (minSz > sz) { grow(minSz); } }
+
+  // True while the elements are in the embedded array.
+  bool isEmbedded() const
+    { return arr == embed; }
+
+  // grab a pointer to the elements; it is invalidated by growth
+  T const *getArray() const { return arr; }
+  T *getArrayNC() { return arr; }
+
+  // STL-style iteration, with the same caveat
+  T *begin() { return arr; }
+  T *end() { return arr+len; }
+  T const *begin() const { return arr; }
+  T const *end() const { return arr+len; }
+
+  void sort(int (*compare)(T const *t1, T const *t2)) {
+    std::sort(arr, arr+len,
+              [=](T const &a, T const &b) {
+                return compare(&a, &b) < 0;
+              });
+  }
+
+  // Move the item at 'oldIndex' so it occupies 'newIndex' instead,
+  // shifting the intervening elements by one spot.  Both arguments
+  // must be in [0,length()-1].
+  void moveElement(int oldIndex, int newIndex);
+
+  // Yield the same sequence of elements as a std::vector.
+  std::vector<T> asVector() const
+    { return std::vector<T>(arr, arr+len); }
+};
+
+
+template <class T, int n>
+SmallArrayStack<T,n>::SmallArrayStack(SmallArrayStack const &obj)
+  : SmallArrayStack()
+{
+  operator=(obj);
+}
+
+
+template <class T, int n>
+SmallArrayStack<T,n>::SmallArrayStack(SmallArrayStack &&obj)
+  : SmallArrayStack()
+{
+  operator=(std::move(obj));
+}
+
+
+template <class T, int n>
+SmallArrayStack<T,n> &SmallArrayStack<T,n>::operator=(
+  SmallArrayStack const &obj)
+{
+  if (this != &obj) {
+    ensureAtLeast(obj.len);
+    std::copy(obj.arr, obj.arr+obj.len, arr);
+    len = obj.len;
+  }
+  return *this;
+}
+
+
+template <class T, int n>
+SmallArrayStack<T,n> &SmallArrayStack<T,n>::operator=(
+  SmallArrayStack &&obj)
+{
+  if (this == &obj) {
+    // nothing to do
+  }
+  else if (!obj.isEmbedded()) {
+    // Take over its heap array.
+    heap.swapWith(obj.heap);
+    arr = heap.getArrayNC();
+    sz = heap.allocatedSize();
+    len = obj.len;
+    obj.reset();
   }
+  else {
+    ensureAtLeast(obj.len);
+    std::move(obj.arr, obj.arr+obj.len, arr);
+    len = obj.len;
+    obj.len = 0;
+  }
+  return *this;
+}
+
+
+template <class T, int n>
+void SmallArrayStack<T,n>::reset()
+{
+  heap.setAllocatedSize(0);
+  arr = embed;
+  sz = n;
+  len = 0;
+}
+
+
+template <class T, int n>
+void SmallArrayStack<T,n>::grow(int minSz)
+{
+  int newSz = sz*2 > minSz? sz*2 : minSz;
+  if (isEmbedded()) {
+    heap.setAllocatedSize(newSz);
+    std::move(embed, embed+len, heap.getArrayNC());
+  }
+  else {
+    heap.setAllocatedSize(newSz);
+  }
+  arr = heap.getArrayNC();
+  sz = newSz;
+}
+
+
+template <class T, int n>
+void SmallArrayStack<T,n>::push(T const &val)
+{
+  if (len < sz) {
+    arr[len++] = val;
+  }
+  else {
+    // 'val' might be an element, so copy it before growing.
+    T tmp(val);
+    grow(len+1);
+    arr[len++] = std::move(tmp);
+  }
+}
+
+
+template <class T, int n>
+void SmallArrayStack<T,n>::push(T &&val)
+{
+  if (len < sz) {
+    arr[len++] = std::move(val);
+  }
+  else {
+    T tmp(std::move(val));
+    grow(len+1);
+    arr[len++] = std::move(tmp);
+  }
+}
+
+
+template <class T, int n>
+int SmallArrayStack<T,n>::indexOf(T const &t) const
+{
+  for (int i=0; i < len; i++) {
+    if (arr[i] == t) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+template <class T, int n>
+void SmallArrayStack<T,n>::moveElement(int oldIndex, int newIndex)
+{
+  bc(oldIndex);
+  bc(newIndex);
+
+  if (oldIndex < newIndex) {
+    std::rotate(arr+oldIndex, arr+oldIndex+1, arr+newIndex+1);
+  }
+  else if (oldIndex > newIndex) {
+    std::rotate(arr+newIndex, arr+oldIndex, arr+oldIndex+1);
+  }
+}
+
+
+// Compare two SmallArrayStacks elementwise for equality.
+template <class T, int n>
+bool operator== (SmallArrayStack<T,n> const &a1,
+                 SmallArrayStack<T,n> const &a2)
+{
+  return a1.length() == a2.length() &&
+         std::equal(a1.begin(), a1.end(), a2.begin());
+}
+
+template <class T, int n>
+bool operator!= (SmallArrayStack<T,n> const &a1,
+                 SmallArrayStack<T,n> const &a2)
+{
+  return !operator==(a1, a2);
 }
 
 
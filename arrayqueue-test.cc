@@ -10,11 +10,12 @@
 
 static int maxLength = 0;
 
-// one round of testing
+// one round of testing, with 'Queue' being some ArrayQueue
+template <class Queue>
 static void round(int ops)
 {
   // implementation to test
-  ArrayQueue<int> arrayQueue;
+  Queue arrayQueue;
 
   // "trusted" implementation to compare with
   ObjList<int> listQueue;
@@ -69,7 +70,12 @@ static void round(int ops)
 void test_arrayqueue()
 {
   for (int i=0; i<20; i++) {
-    round(100);
+    round<ArrayQueue<int> >(100);
+  }
+
+  // 64-bit sizes and indices.
+  for (int i=0; i<5; i++) {
+    round<ArrayQueue64<int> >(100);
   }
 }
 
@@ -7,29 +7,40 @@
 
 #include "xassert.h"           // xassert
 
+#include <cstdint>             // std::int64_t
+#include <limits>              // std::numeric_limits
+#include <type_traits>         // std::{is_integral, is_signed}
+
 // needed operations on T:
 //   T()                       // default ctor
 //   operator=(T&)             // assignment
 //   bool operator==(T&)       // comparison
-
-template <class T>
+//
+// 'SizeT' is the signed integer type of sizes and indices; use
+// 'std::int64_t' (or ArrayQueue64) for queues that can hold 2^31 or
+// more elements.
+template <class T, class SizeT = int>
 class ArrayQueue {
+  static_assert(std::is_integral<SizeT>::value &&
+                std::is_signed<SizeT>::value,
+                "SizeT must be a signed integer type");
+
 private:     // data
   T *arr;                      // working storage
-  int arrSize;                 // allocated length of 'arr'
-  int head;                    // index of first element to dequeue
-  int tail;                    // index+1 of last element to dequeue
+  SizeT arrSize;               // allocated length of 'arr'
+  SizeT head;                  // index of first element to dequeue
+  SizeT tail;                  // index+1 of last element to dequeue
 
   // NOTE: If head == tail then the queue is empty.  If head > tail,
   // then the queue elements circularly wrap around the end of 'arr'.
   // At all times, 0 <= head,tail < arrSize.
 
 public:      // funcs
-  ArrayQueue(int initSize = 10);
+  ArrayQueue(SizeT initSize = 10);
   ~ArrayQueue();
 
   // test # of elements in queue
-  int length() const
+  SizeT length() const
     { return head<=tail? tail-head : arrSize-(head-tail); }
   bool isEmpty() const                  { return head==tail; }
   bool isNotEmpty() const               { return !isEmpty(); }
@@ -47,10 +58,10 @@ public:      // funcs
   //
   // as this interface is O(1), it is the intended method
   // of iterating over the elements in the queue
-  T const &eltC(int index) const;
-  T &elt(int index)                     { return const_cast<T&>(eltC(index)); }
-  T &operator[] (int index)             { return elt(index); }
-  T const &operator[] (int index) const { return eltC(index); }
+  T const &eltC(SizeT index) const;
+  T &elt(SizeT index)                   { return const_cast<T&>(eltC(index)); }
+  T &operator[] (SizeT index)           { return elt(index); }
+  T const &operator[] (SizeT index) const { return eltC(index); }
 
   // reverse the sequence of stored elements
   void reverse();
@@ -59,9 +70,12 @@ public:      // funcs
   bool contains(T const &t) const;
 };
 
-
 template <class T>
-ArrayQueue<T>::ArrayQueue(int initSize)
+using ArrayQueue64 = ArrayQueue<T, std::int64_t>;
+
+
+template <class T, class SizeT>
+ArrayQueue<T,SizeT>::ArrayQueue(SizeT initSize)
 {
   // initial size must be positive, since array growth is
   // simply by doubling the size
@@ -73,26 +87,27 @@ ArrayQueue<T>::ArrayQueue(int initSize)
 }
 
 
-template <class T>
-ArrayQueue<T>::~ArrayQueue()
+template <class T, class SizeT>
+ArrayQueue<T,SizeT>::~ArrayQueue()
 {
   delete[] arr;
 }
 
 
-template <class T>
-void ArrayQueue<T>::enqueue(T const &t)
+template <class T, class SizeT>
+void ArrayQueue<T,SizeT>::enqueue(T const &t)
 {
   if (length() == arrSize-1) {
     // must expand the queue
 
     // make new array
-    int newArrSize = arrSize * 2;
+    xassert(arrSize <= std::numeric_limits<SizeT>::max() / 2);
+    SizeT newArrSize = arrSize * 2;
     T *newArr = new T[newArrSize];
 
     // copy elements sequentially
-    int oldLength = length();
-    for (int i=0; i<oldLength; i++) {
+    SizeT oldLength = length();
+    for (SizeT i=0; i<oldLength; i++) {
       newArr[i] = eltC(i);
     }
 
@@ -116,8 +131,8 @@ void ArrayQueue<T>::enqueue(T const &t)
 }
 
 
-template <class T>
-T ArrayQueue<T>::dequeue()
+template <class T, class SizeT>
+T ArrayQueue<T,SizeT>::dequeue()
 {
   if (isEmpty()) {
     xfailure("attempt to dequeue an empty queue");
@@ -135,8 +150,8 @@ T ArrayQueue<T>::dequeue()
 }
 
 
-template <class T>
-T const &ArrayQueue<T>::eltC(int index) const
+template <class T, class SizeT>
+T const &ArrayQueue<T,SizeT>::eltC(SizeT index) const
 {
   xassert(0 <= index && index < length());
 
@@ -149,10 +164,10 @@ T const &ArrayQueue<T>::eltC(int index) const
 }
 
 
-template <class T>
-void ArrayQueue<T>::reverse()
+template <class T, class SizeT>
+void ArrayQueue<T,SizeT>::reverse()
 {
-  int i = 0, j = length()-1;
+  SizeT i = 0, j = length()-1;
   while (i < j) {
     // swap i,j elements
     T tmp = elt(i);
@@ -165,11 +180,11 @@ void ArrayQueue<T>::reverse()
 }
 
 
-template <class T>
-bool ArrayQueue<T>::contains(T const &t) const
+template <class T, class SizeT>
+bool ArrayQueue<T,SizeT>::contains(T const &t) const
 {
-  int len=length();
-  for (int i=0; i<len; i++) {
+  SizeT len=length();
+  for (SizeT i=0; i<len; i++) {
     if (t == eltC(i)) {
       return true;
     }
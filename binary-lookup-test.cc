@@ -0,0 +1,253 @@
+// binary-lookup-test.cc
+// Tests for `binary-lookup` module.
+
+// This file is in the public domain.
+
+#include "smbase/binary-lookup.h"      // module under test
+
+#include "smbase/nonport.h"            // getMilliseconds
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi, TABLESIZE
+#include "smbase/sm-random.h"          // sm_random
+#include "smbase/sm-test.h"            // DIAG, EXPECT_EQ
+#include "smbase/strcmp-compare.h"     // StrcmpCompare
+#include "smbase/string-util.h"        // stringInSortedArray
+#include "smbase/xassert.h"            // xassert
+
+#include <algorithm>                   // std::{lower_bound, sort}
+#include <cstdlib>                     // std::{getenv, atol}
+#include <cstring>                     // std::strcmp
+#include <iostream>                    // std::cout
+#include <vector>                      // std::vector
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+bool intLess(int a, int b)
+{
+  return a < b;
+}
+
+
+// Random sorted table of `n` values in [0,2n), with duplicates.
+std::vector<int> randomTable(int n)
+{
+  std::vector<int> vec;
+  smbase_loopi(n) {
+    vec.push_back(sm_random(2*n));
+  }
+  std::sort(vec.begin(), vec.end());
+  return vec;
+}
+
+
+// Compare all of the searches against `std::lower_bound` on tables of
+// many sizes.
+void testAgainstLowerBound()
+{
+  DIAG("---- testAgainstLowerBound ----");
+
+  for (int n=0; n < 300; n += (n < 40? 1 : 37)) {
+    std::vector<int> vec = randomTable(n);
+    int const *begin = vec.data();
+    int const *end = begin + n;
+
+    StaticSortedIndex<int> index(vec.begin(), vec.end());
+    EXPECT_EQ(index.size(), (std::size_t)n);
+
+    for (int value = -1; value <= 2*n; value++) {
+      int const *expect = std::lower_bound(begin, end, value);
+      std::size_t expectPos = expect - begin;
+
+      xassert(branchless_lower_bound(begin, end, value, intLess) == expect);
+      EXPECT_EQ(index.lowerBound(value), expectPos);
+
+      int const *found = binary_lookup(begin, end, value, intLess);
+      if (found != end) {
+        // The first of equal elements.
+        EXPECT_EQ(*found, value);
+        xassert(found == begin || found[-1] < value);
+        EXPECT_EQ(index.lookup(value), expectPos);
+        xassert(index.find(value) && *index.find(value) == value);
+        xassert(index.contains(value));
+      }
+      else {
+        EXPECT_EQ(index.lookup(value), (std::size_t)n);
+        xassert(index.find(value) == nullptr);
+        xassert(!index.contains(value));
+      }
+    }
+  }
+}
+
+
+// Table of entries searched by name, as done in gcc-options.cc.
+struct Entry {
+  char const *m_name;
+  int m_value;
+};
+
+struct EntryLess {
+  bool operator() (Entry const &a, char const *b) const
+    { return std::strcmp(a.m_name, b) < 0; }
+  bool operator() (char const *a, Entry const &b) const
+    { return std::strcmp(a, b.m_name) < 0; }
+};
+
+
+void testKeyType()
+{
+  DIAG("---- testKeyType ----");
+
+  static Entry const table[] = {
+    { "-E", 1 },
+    { "-M", 2 },
+    { "-MM", 3 },
+    { "-S", 4 },
+    { "-c", 5 },
+    { "-dumpversion", 6 },
+  };
+
+  StaticSortedIndex<Entry, EntryLess> index(table, table + TABLESIZE(table));
+
+  for (Entry const &e : table) {
+    Entry const *found = index.find(e.m_name);
+    xassert(found);
+    EXPECT_EQ(found->m_value, e.m_value);
+    EXPECT_EQ(index.lookup(e.m_name), (std::size_t)(&e - table));
+  }
+  xassert(!index.contains("-"));
+  xassert(!index.contains("-Mx"));
+  xassert(!index.contains("-z"));
+  EXPECT_EQ(index.lowerBound("-Mx"), (std::size_t)3);
+}
+
+
+// ------------------------------ Timing -------------------------------
+template <class Search>
+void timeSearch(char const *label, std::vector<int> const &queries,
+                Search search)
+{
+  long start = getMilliseconds();
+  long sum = 0;
+  for (int q : queries) {
+    sum += search(q);
+  }
+  long elapsed = getMilliseconds() - start;
+  std::cout << "  " << label << ": " << elapsed
+            << " ms (checksum " << sum << ")\n";
+}
+
+
+void perfIntTable(int n, int numQueries)
+{
+  std::cout << "table of " << n << " ints, "
+            << numQueries << " lookups:\n";
+
+  std::vector<int> vec = randomTable(n);
+  int const *begin = vec.data();
+  int const *end = begin + n;
+  StaticSortedIndex<int> index(vec.begin(), vec.end());
+
+  std::vector<int> queries;
+  smbase_loopi(numQueries) {
+    queries.push_back(sm_random(2*n));
+  }
+
+  timeSearch("binary_lookup         ", queries, [=](int q) {
+    return binary_lookup(begin, end, q, intLess) - begin;
+  });
+  timeSearch("branchless_lower_bound", queries, [=](int q) {
+    // Same result as 'binary_lookup'.
+    int const *p = branchless_lower_bound(begin, end, q, intLess);
+    return (p != end && !(q < *p))? p - begin : end - begin;
+  });
+  timeSearch("StaticSortedIndex     ", queries, [&index](int q) {
+    return (long)index.lookup(q);
+  });
+}
+
+
+void perfStringTable(int numQueries)
+{
+  static char const * const keywords[] = {
+    "alignas", "alignof", "asm", "auto", "bool", "break", "case",
+    "catch", "char", "class", "const", "const_cast", "constexpr",
+    "continue", "decltype", "default", "delete", "do", "double",
+    "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+    "false", "float", "for", "friend", "goto", "if", "inline", "int",
+    "long", "mutable", "namespace", "new", "noexcept", "nullptr",
+    "operator", "private", "protected", "public", "register",
+    "reinterpret_cast", "return", "short", "signed", "sizeof",
+    "static", "static_assert", "static_cast", "struct", "switch",
+    "template", "this", "thread_local", "throw", "true", "try",
+    "typedef", "typeid", "typename", "union", "unsigned", "using",
+    "virtual", "void", "volatile", "wchar_t", "while",
+  };
+  int const n = TABLESIZE(keywords);
+
+  std::cout << "table of " << n << " keywords, "
+            << numQueries << " lookups:\n";
+
+  StaticSortedIndex<char const *, StrcmpCompare>
+    index(keywords, keywords + n);
+
+  // Half keywords, half identifiers.
+  static char const * const others[] = {
+    "x", "foo", "i", "value", "result", "begin", "end", "n",
+  };
+  std::vector<char const *> queries;
+  smbase_loopi(numQueries) {
+    queries.push_back(i%2? keywords[sm_random(n)] :
+                           others[sm_random(TABLESIZE(others))]);
+  }
+
+  long start = getMilliseconds();
+  long sum = 0;
+  for (char const *q : queries) {
+    sum += stringInSortedArray(q, keywords, n);
+  }
+  std::cout << "  stringInSortedArray   : " << (getMilliseconds() - start)
+            << " ms (checksum " << sum << ")\n";
+
+  start = getMilliseconds();
+  sum = 0;
+  for (char const *q : queries) {
+    sum += index.contains(q);
+  }
+  std::cout << "  StaticSortedIndex     : " << (getMilliseconds() - start)
+            << " ms (checksum " << sum << ")\n";
+}
+
+
+// BINARY_LOOKUP_PERF is the number of lookups per table.
+void perfTest()
+{
+  char const *nStr = std::getenv("BINARY_LOOKUP_PERF");
+  if (!nStr) {
+    return;
+  }
+  int numQueries = (int)std::atol(nStr);
+
+  perfIntTable(1 << 10, numQueries);
+  perfIntTable(1 << 16, numQueries);
+  perfIntTable(1 << 22, numQueries);
+  perfStringTable(numQueries);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_binary_lookup()
+{
+  testAgainstLowerBound();
+  testKeyType();
+  perfTest();
+}
+
+
+// EOF
@@ -1,10 +1,16 @@
 // binary-lookup.h
-// binary_lookup function.
+// binary_lookup function, and StaticSortedIndex for tables searched often.
 
 #ifndef BINARY_LOOKUP_H
 #define BINARY_LOOKUP_H
 
-#include <algorithm>                   // std::lower_bound
+#include "bit-ops.h"                   // smbase::countTrailingZeroes64
+
+#include <algorithm>                   // std::{lower_bound, min}
+#include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::uint64_t
+#include <functional>                  // std::less
+#include <vector>                      // std::vector
 
 
 // Return the first element in '[begin,end)' that compares equal to
@@ -36,4 +42,217 @@ ForwardIterator binary_lookup(
 }
 
 
+
+// Return the first element in '[begin,end)' that is not less than
+// 'value', like 'std::lower_bound', but written so the loop body has
+// no data-dependent branch: each step is a conditional move, so there
+// are no mispredictions, and the loop always runs about log2(n) times.
+// This is faster than 'std::lower_bound' when the comparison is cheap
+// and the table fits in cache.
+template <class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator branchless_lower_bound(
+  RandomAccessIterator begin,
+  RandomAccessIterator end,
+  T const &value,
+  Compare lessThan)
+{
+  auto n = end - begin;
+  if (n == 0) {
+    return end;
+  }
+
+  // Invariant: the answer is in '[begin,begin+n]'.
+  while (n > 1) {
+    auto half = n / 2;
+    begin = lessThan(begin[half], value)? begin + half : begin;
+    n -= half;
+  }
+  return begin + (lessThan(*begin, value)? 1 : 0);
+}
+
+
+// A sorted table, built once and then searched many times, stored in
+// Eytzinger (breadth-first) order: the root of the implicit binary
+// search tree is at index 1, and the children of node 'k' are at '2k'
+// and '2k+1'.  The first few levels of the tree, which every search
+// visits, are thus packed together at the front and stay in cache, and
+// the nodes a search might visit four levels down are contiguous, so
+// one prefetch covers them.  For tables too large for the cache, this
+// is considerably faster than binary search over the sorted array,
+// which touches a new cache line at almost every step.
+//
+// Searches take values of any type 'Key' such that 'lessThan' can
+// compare 'T' and 'Key' in both orders.  Results are expressed as
+// positions in the sorted sequence the index was built from.
+template <class T, class Compare = std::less<T> >
+class StaticSortedIndex {
+private:     // data
+  // The elements in Eytzinger order, at [1,size()].  Element 0 is an
+  // unused copy of the first element (to avoid requiring a default
+  // constructor), or absent if the table is empty.
+  std::vector<T> m_eytz;
+
+  // For each Eytzinger index, the position of that element in the
+  // sorted sequence.  'm_rank[0]' is 'size()', the answer when every
+  // element is less than the value sought.
+  std::vector<std::size_t> m_rank;
+
+  // Number of elements.
+  std::size_t m_size;
+
+  Compare m_lessThan;
+
+private:     // funcs
+  // Assign sorted positions to the subtree rooted at 'k' by in-order
+  // traversal, starting at 'next'.  Return the next position.
+  std::size_t assignRanks(std::size_t k, std::size_t next);
+
+  // Return the Eytzinger index of the first element not less than
+  // 'value', or 0 if there is none.
+  template <class Key>
+  std::size_t eytzingerLowerBound(Key const &value) const;
+
+public:      // funcs
+  // Build the index from '[begin,end)', which must be sorted according
+  // to 'lessThan'.  Equivalent elements are allowed.
+  template <class ForwardIterator>
+  StaticSortedIndex(ForwardIterator begin, ForwardIterator end,
+                    Compare lessThan = Compare());
+
+  std::size_t size() const { return m_size; }
+
+  // Position of the first element not less than 'value', or 'size()'
+  // if there is none; that is, 'std::lower_bound'.
+  template <class Key>
+  std::size_t lowerBound(Key const &value) const;
+
+  // Position of the first element equal to 'value', or 'size()' if
+  // there is none; that is, 'binary_lookup'.
+  template <class Key>
+  std::size_t lookup(Key const &value) const;
+
+  // The first element equal to 'value', or nullptr.
+  template <class Key>
+  T const *find(Key const &value) const;
+
+  template <class Key>
+  bool contains(Key const &value) const { return find(value) != nullptr; }
+};
+
+
+template <class T, class Compare>
+template <class ForwardIterator>
+StaticSortedIndex<T, Compare>::StaticSortedIndex(
+  ForwardIterator begin, ForwardIterator end, Compare lessThan)
+  : m_eytz(),
+    m_rank(),
+    m_size(0),
+    m_lessThan(lessThan)
+{
+  std::vector<T> sorted(begin, end);
+  m_size = sorted.size();
+  if (m_size == 0) {
+    return;
+  }
+
+  m_rank.resize(m_size + 1);
+  m_rank[0] = m_size;
+  assignRanks(1, 0);
+
+  m_eytz.reserve(m_size + 1);
+  m_eytz.push_back(sorted[0]);
+  for (std::size_t k=1; k <= m_size; k++) {
+    m_eytz.push_back(sorted[m_rank[k]]);
+  }
+}
+
+
+template <class T, class Compare>
+std::size_t StaticSortedIndex<T, Compare>::assignRanks(
+  std::size_t k, std::size_t next)
+{
+  // The recursion depth is the height of the tree, log2(size()).
+  if (k <= m_size) {
+    next = assignRanks(2*k, next);
+    m_rank[k] = next++;
+    next = assignRanks(2*k+1, next);
+  }
+  return next;
+}
+
+
+template <class T, class Compare>
+template <class Key>
+std::size_t StaticSortedIndex<T, Compare>::eytzingerLowerBound(
+  Key const &value) const
+{
+  T const *eytz = m_eytz.data();
+  std::size_t const n = m_size;
+
+  std::size_t k = 1;
+  while (k <= n) {
+#if defined(__GNUC__)
+    // Fetch the start of the block holding the descendants of 'k' four
+    // levels down, which we will need in four iterations.
+    __builtin_prefetch(eytz + std::min(k*16, n));
+#endif
+    k = 2*k + (m_lessThan(eytz[k], value)? 1 : 0);
+  }
+
+  // The path to 'k' records a 1 for each step right (element less than
+  // 'value') and a 0 for each step left.  The answer is the last node
+  // where we went left, found by removing the trailing 1s and the 0.
+  // If we never went left, this yields 0.
+  return k >> (smbase::countTrailingZeroes64(~(std::uint64_t)k) + 1);
+}
+
+
+template <class T, class Compare>
+template <class Key>
+std::size_t StaticSortedIndex<T, Compare>::lowerBound(Key const &value) const
+{
+  if (m_size == 0) {
+    return 0;
+  }
+  return m_rank[eytzingerLowerBound(value)];
+}
+
+
+template <class T, class Compare>
+template <class Key>
+std::size_t StaticSortedIndex<T, Compare>::lookup(Key const &value) const
+{
+  if (m_size == 0) {
+    return 0;
+  }
+
+  // As in 'binary_lookup'.
+  std::size_t k = eytzingerLowerBound(value);
+  if (k != 0 && !m_lessThan(value, m_eytz[k])) {
+    return m_rank[k];
+  }
+  else {
+    return m_size;
+  }
+}
+
+
+template <class T, class Compare>
+template <class Key>
+T const *StaticSortedIndex<T, Compare>::find(Key const &value) const
+{
+  if (m_size == 0) {
+    return nullptr;
+  }
+
+  std::size_t k = eytzingerLowerBound(value);
+  if (k != 0 && !m_lessThan(value, m_eytz[k])) {
+    return &m_eytz[k];
+  }
+  else {
+    return nullptr;
+  }
+}
+
+
 #endif // BINARY_LOOKUP_H
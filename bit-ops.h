@@ -0,0 +1,70 @@
+// bit-ops.h
+// Population count and leading/trailing zero counts for 64-bit words.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_BIT_OPS_H
+#define SMBASE_BIT_OPS_H
+
+#include "sm-macros.h"                 // OPEN_NAMESPACE
+
+#include <cstdint>                     // std::uint64_t
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// These use the compiler builtins where available, since those compile
+// to single instructions on most targets.  The fallbacks are the usual
+// portable bit tricks.
+
+
+// Return the number of 1 bits in `w`.
+inline int popCount64(std::uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(w);
+#else
+  w = w - ((w >> 1) & 0x5555555555555555ULL);
+  w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+  w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+
+// Return the index of the lowest 1 bit in `w`, which must not be zero.
+inline int countTrailingZeroes64(std::uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(w);
+#else
+  // Isolate the lowest 1 bit, then count the 1s below it.
+  return popCount64((w & (0 - w)) - 1);
+#endif
+}
+
+
+// Return the number of 0 bits above the highest 1 bit in `w`, which
+// must not be zero.
+inline int countLeadingZeroes64(std::uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(w);
+#else
+  // Smear the highest 1 bit downward, then count the 0s above it.
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+  w |= w >> 32;
+  return 64 - popCount64(w);
+#endif
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_BIT_OPS_H
@@ -5,9 +5,144 @@
 
 #include "bflatten.h"                  // BFlatten
 #include "point.h"                     // point
-#include "sm-test.h"                   // verbose
+#include "sm-macros.h"                 // smbase_loopi
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // verbose, EXPECT_EQ
 #include "xassert.h"                   // xassert
 
+using namespace smbase;
+
+
+// Fill 'bits' with random contents.
+static void randomize(Bit2d &bits)
+{
+  for (int y=0; y < bits.Size().y; y++) {
+    for (int x=0; x < bits.Size().x; x++) {
+      bits.setto(point(x,y), sm_random(2));
+    }
+  }
+}
+
+
+// Compare the word-level operations to doing the same thing one bit
+// at a time.
+static void testBlit()
+{
+  smbase_loopi(200) {
+    Bit2d dest(point(1 + sm_random(150), 1 + sm_random(5)));
+    Bit2d src(point(1 + sm_random(150), 1 + sm_random(5)));
+    randomize(dest);
+    randomize(src);
+
+    // Random rectangle, which may stick out of either array.
+    point destPos(sm_random(170) - 10, sm_random(7) - 1);
+    point srcPos(sm_random(170) - 10, sm_random(7) - 1);
+    point rectSize(sm_random(160), sm_random(7));
+    Bit2d::BlitOp op = (Bit2d::BlitOp)sm_random(3);
+
+    Bit2d expect(dest);
+    for (int y=0; y < rectSize.y; y++) {
+      for (int x=0; x < rectSize.x; x++) {
+        point s = srcPos + point(x,y);
+        point d = destPos + point(x,y);
+        if (src.okpt(s) && dest.okpt(d)) {
+          int v = src.get(s);
+          switch (op) {
+            case Bit2d::BLIT_COPY: expect.setto(d, v); break;
+            case Bit2d::BLIT_OR:   expect.setto(d, expect.get(d) | v); break;
+            case Bit2d::BLIT_XOR:  expect.setto(d, expect.get(d) ^ v); break;
+          }
+        }
+      }
+    }
+
+    dest.blit(destPos, src, srcPos, rectSize, op);
+    xassert(dest == expect);
+
+    // Blit within one array, with overlap.
+    Bit2d self(dest);
+    Bit2d selfExpect(dest);
+    Bit2d orig(dest);
+    self.blit(destPos, self, srcPos, rectSize, op);
+    selfExpect.blit(destPos, orig, srcPos, rectSize, op);
+    xassert(self == selfExpect);
+
+    // Fill and count.
+    int count = 0;
+    for (int y=0; y < rectSize.y; y++) {
+      for (int x=0; x < rectSize.x; x++) {
+        point d = destPos + point(x,y);
+        if (dest.okpt(d)) {
+          count += dest.get(d);
+        }
+      }
+    }
+    EXPECT_EQ(dest.countRect(destPos, rectSize), count);
+
+    int val = sm_random(2);
+    expect = dest;
+    for (int y=0; y < rectSize.y; y++) {
+      for (int x=0; x < rectSize.x; x++) {
+        point d = destPos + point(x,y);
+        if (expect.okpt(d)) {
+          expect.setto(d, val);
+        }
+      }
+    }
+    dest.fillRect(destPos, rectSize, val);
+    xassert(dest == expect);
+
+    // Row scans.
+    point size = dest.Size();
+    int total = 0;
+    for (int y=0; y < size.y; y++) {
+      int next = -1;
+      for (int x = size.x-1; x >= 0; x--) {
+        if (dest.get(point(x,y))) {
+          next = x;
+          total++;
+        }
+        EXPECT_EQ(dest.findNextInRow(point(x,y)), next);
+      }
+      EXPECT_EQ(dest.findNextInRow(point(size.x,y)), -1);
+
+      int prev = -1;
+      for (int x=0; x < size.x; x++) {
+        if (dest.get(point(x,y))) {
+          prev = x;
+        }
+        EXPECT_EQ(dest.findPrevInRow(point(x,y)), prev);
+      }
+      EXPECT_EQ(dest.findPrevInRow(point(-1,y)), -1);
+    }
+    EXPECT_EQ(dest.count(), total);
+  }
+}
+
+
+// getBits and setBits at unaligned positions.
+static void testGetSetBits()
+{
+  Bit2d bits(point(200, 2));
+  bits.setall(0);
+
+  bits.setBits(point(3,1), 64, 0x8000000000000001ULL);
+  xassert(bits.get(point(3,1)) && bits.get(point(66,1)));
+  EXPECT_EQ(bits.count(), 2);
+  EXPECT_EQ(bits.getBits(point(3,1), 64), 0x8000000000000001ULL);
+  EXPECT_EQ(bits.getBits(point(2,1), 3), 0x2u);
+  EXPECT_EQ(bits.getBits(point(2,1), 0), 0u);
+
+  bits.setBits(point(60,1), 10, 0x3FF, Bit2d::BLIT_XOR);
+  EXPECT_EQ(bits.getBits(point(60,1), 10), 0x3BFu);
+
+  // Up to the right edge, which does not disturb the padding.
+  bits.setBits(point(136,0), 64, ~(uint64_t)0);
+  EXPECT_EQ(bits.count(), 1 + 9 + 64);
+  Bit2d copy(bits);
+  xassert(copy == bits);
+}
+
 
 // Called from unit-tests.cc.
 void test_bit2d()
@@ -94,6 +229,9 @@ void test_bit2d()
   // one concrete vector to make sure the above test is not
   // totally borked
   xassert(byteBitSwapLsbMsb(0xC7) == 0xE3);
+
+  testBlit();
+  testGetSetBits();
 }
 
 
@@ -4,6 +4,7 @@
 // See license.txt for copyright and terms of use.
 
 #include "smbase/bit2d.h"              // this module
+#include "smbase/bit-ops.h"            // smbase::{popCount64, countTrailingZeroes64, countLeadingZeroes64}
 #include "smbase/flatten.h"            // Flatten
 #include "smbase/sm-macros.h"          // smbase_loopi, ASSERT_TABLESIZE
 #include "smbase/xassert.h"            // xassert
@@ -148,6 +149,259 @@ unsigned char Bit2d::get8(point const &p) const
 }
 
 
+// ---------------------- word-at-a-time access ----------------------
+// Within a row, bit 'x' is bit 'x&7' of byte 'x>>3', so reading the
+// bytes as a little-endian integer yields the bits in order.
+
+// Mask with the low 'n' bits set, for 'n' in [0,64].
+static uint64_t lowBitsMask(int n)
+{
+  return n >= 64? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+}
+
+
+// Read 'n' bytes, in [0,8], as a little-endian integer.
+static uint64_t loadBytes(unsigned char const *p, int n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (n == 8) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    return w;
+  }
+#endif
+
+  uint64_t w = 0;
+  for (int i=0; i < n; i++) {
+    w |= (uint64_t)p[i] << (i*8);
+  }
+  return w;
+}
+
+
+// Write the low 'n' bytes of 'w', in [0,8], little-endian.
+static void storeBytes(unsigned char *p, int n, uint64_t w)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (n == 8) {
+    memcpy(p, &w, 8);
+    return;
+  }
+#endif
+
+  for (int i=0; i < n; i++) {
+    p[i] = (unsigned char)(w >> (i*8));
+  }
+}
+
+
+// Get 'n' bits, in [0,64], of 'row' starting at 'x'.  This only
+// touches the bytes that contain those bits.
+static uint64_t loadRowBits(unsigned char const *row, int x, int n)
+{
+  unsigned char const *p = row + (x>>3);
+  int shift = x & 7;
+  int nbytes = (shift + n + 7) >> 3;      // at most 9
+
+  uint64_t ret = loadBytes(p, nbytes < 8? nbytes : 8) >> shift;
+  if (nbytes > 8) {
+    // 'shift' is not 0 here, so the shift amount is in [57,63].
+    ret |= (uint64_t)p[8] << (64 - shift);
+  }
+  return ret & lowBitsMask(n);
+}
+
+
+// Combine 'src' into the bits of 'dest' selected by 'mask'.  'src'
+// has no bits outside 'mask'.
+static uint64_t combineBits(uint64_t dest, uint64_t src, uint64_t mask,
+                            Bit2d::BlitOp op)
+{
+  switch (op) {
+    case Bit2d::BLIT_COPY: return (dest & ~mask) | src;
+    case Bit2d::BLIT_OR:   return dest | src;
+    case Bit2d::BLIT_XOR:  return dest ^ src;
+  }
+  xfailure("bad BlitOp");
+}
+
+
+// Combine the low 'n' bits of 'val' into 'row' starting at 'x'.
+static void storeRowBits(unsigned char *row, int x, int n, uint64_t val,
+                         Bit2d::BlitOp op)
+{
+  unsigned char *p = row + (x>>3);
+  int shift = x & 7;
+  int nbytes = (shift + n + 7) >> 3;
+  uint64_t mask = lowBitsMask(n);
+  val &= mask;
+
+  int lowBytes = nbytes < 8? nbytes : 8;
+  storeBytes(p, lowBytes,
+    combineBits(loadBytes(p, lowBytes), val << shift, mask << shift, op));
+
+  if (nbytes > 8) {
+    p[8] = (unsigned char)
+      combineBits(p[8], val >> (64 - shift), mask >> (64 - shift), op);
+  }
+}
+
+
+uint64_t Bit2d::getBits(point const &p, int n) const
+{
+  xassert(0 <= n && n <= 64);
+  xassert(p.gtez() && p.y < size.y && p.x + n <= size.x);
+
+  return loadRowBits(rowptrc(p.y), p.x, n);
+}
+
+
+void Bit2d::setBits(point const &p, int n, uint64_t val, BlitOp op)
+{
+  xassert(0 <= n && n <= 64);
+  xassert(p.gtez() && p.y < size.y && p.x + n <= size.x);
+
+  storeRowBits(rowptr(p.y), p.x, n, val, op);
+}
+
+
+// Clip one dimension of a rectangle that starts at 'pos' in an array
+// of length 'len'; 'otherPos' is the start of the corresponding
+// rectangle in the other array, which moves in step.
+static void clipDimension(int &pos, int &otherPos, int &rectLen, int len)
+{
+  if (pos < 0) {
+    otherPos -= pos;
+    rectLen += pos;
+    pos = 0;
+  }
+  if (rectLen > len - pos) {
+    rectLen = len - pos;
+  }
+}
+
+
+bool Bit2d::clipRect(point &pos, point &rectSize) const
+{
+  point dummy(0,0);
+  clipDimension(pos.x, dummy.x, rectSize.x, size.x);
+  clipDimension(pos.y, dummy.y, rectSize.y, size.y);
+  return rectSize.x > 0 && rectSize.y > 0;
+}
+
+
+void Bit2d::blit(point const &origDestPos, Bit2d const &src,
+                 point const &origSrcPos, point const &origRectSize,
+                 BlitOp op)
+{
+  point destPos(origDestPos);
+  point srcPos(origSrcPos);
+  point rectSize(origRectSize);
+
+  // Clip against both arrays.
+  clipDimension(destPos.x, srcPos.x, rectSize.x, size.x);
+  clipDimension(destPos.y, srcPos.y, rectSize.y, size.y);
+  clipDimension(srcPos.x, destPos.x, rectSize.x, src.size.x);
+  clipDimension(srcPos.y, destPos.y, rectSize.y, src.size.y);
+  if (rectSize.x <= 0 || rectSize.y <= 0) {
+    return;
+  }
+
+  if (&src == this) {
+    // Copy the source out first so overlap does not matter.
+    Bit2d tmp(rectSize);
+    tmp.blit(point(0,0), *this, srcPos, rectSize, BLIT_COPY);
+    blit(destPos, tmp, point(0,0), rectSize, op);
+    return;
+  }
+
+  for (int y=0; y < rectSize.y; y++) {
+    unsigned char const *srcRow = src.rowptrc(srcPos.y + y);
+    unsigned char *destRow = rowptr(destPos.y + y);
+    for (int x=0; x < rectSize.x; x += 64) {
+      int n = rectSize.x - x < 64? rectSize.x - x : 64;
+      storeRowBits(destRow, destPos.x + x, n,
+                   loadRowBits(srcRow, srcPos.x + x, n), op);
+    }
+  }
+}
+
+
+void Bit2d::fillRect(point const &origPos, point const &origRectSize,
+                     int val)
+{
+  point pos(origPos);
+  point rectSize(origRectSize);
+  if (!clipRect(pos, rectSize)) {
+    return;
+  }
+
+  uint64_t bits = val? ~(uint64_t)0 : 0;
+  for (int y=0; y < rectSize.y; y++) {
+    unsigned char *row = rowptr(pos.y + y);
+    for (int x=0; x < rectSize.x; x += 64) {
+      int n = rectSize.x - x < 64? rectSize.x - x : 64;
+      storeRowBits(row, pos.x + x, n, bits, BLIT_COPY);
+    }
+  }
+}
+
+
+int Bit2d::countRect(point const &origPos, point const &origRectSize) const
+{
+  point pos(origPos);
+  point rectSize(origRectSize);
+  if (!clipRect(pos, rectSize)) {
+    return 0;
+  }
+
+  int ret = 0;
+  for (int y=0; y < rectSize.y; y++) {
+    unsigned char const *row = rowptrc(pos.y + y);
+    for (int x=0; x < rectSize.x; x += 64) {
+      int n = rectSize.x - x < 64? rectSize.x - x : 64;
+      ret += smbase::popCount64(loadRowBits(row, pos.x + x, n));
+    }
+  }
+  return ret;
+}
+
+
+int Bit2d::findNextInRow(point const &p) const
+{
+  xassert(0 <= p.y && p.y < size.y);
+  xassert(0 <= p.x && p.x <= size.x);
+
+  unsigned char const *row = rowptrc(p.y);
+  for (int x = p.x; x < size.x; x += 64) {
+    int n = size.x - x < 64? size.x - x : 64;
+    uint64_t bits = loadRowBits(row, x, n);
+    if (bits) {
+      return x + smbase::countTrailingZeroes64(bits);
+    }
+  }
+  return -1;
+}
+
+
+int Bit2d::findPrevInRow(point const &p) const
+{
+  xassert(0 <= p.y && p.y < size.y);
+  xassert(-1 <= p.x && p.x < size.x);
+
+  unsigned char const *row = rowptrc(p.y);
+  for (int end = p.x; end >= 0; end -= 64) {
+    // Examine [start,end].
+    int start = end >= 63? end-63 : 0;
+    uint64_t bits = loadRowBits(row, start, end-start+1);
+    if (bits) {
+      return start + 63 - smbase::countLeadingZeroes64(bits);
+    }
+  }
+  return -1;
+}
+
+
 // Count the number of digits required to represent a non-negative
 // integer in base 10.
 static int digits(int value)
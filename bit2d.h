@@ -11,8 +11,18 @@
 #include "smbase/flatten-fwd.h"        // Flatten [f]
 #include "smbase/point.h"              // point
 
+#include <stdint.h>                    // uint64_t
+
 
 class Bit2d {
+public:      // types
+  // How 'blit' and 'setBits' combine source bits with the destination.
+  enum BlitOp {
+    BLIT_COPY,          // replace destination bits
+    BLIT_OR,            // destination |= source
+    BLIT_XOR,           // destination ^= source
+  };
+
 private:     // data
   unsigned char *data;  // bits; [0..stride-1] is first row, etc.
   bool owning;          // when false, 'data' is not owned by this object
@@ -24,9 +34,16 @@ private:     // funcs
   unsigned char *byteptr(point const &p)               { return data + p.y * stride + (p.x>>3); }
   unsigned char const *byteptrc(point const &p) const  { return data + p.y * stride + (p.x>>3); }
 
+  unsigned char *rowptr(int y)                         { return data + y * stride; }
+  unsigned char const *rowptrc(int y) const            { return data + y * stride; }
+
   // this is the number of bytes allocated in 'data'
   int datasize() const                        { return size.y * stride; }
 
+  // Clip 'pos' and 'rectSize' so the rectangle lies within this array.
+  // Returns false if nothing is left.
+  bool clipRect(point &pos, point &rectSize) const;
+
 public:      // funcs
   // NOTE: does *not* clear the bitmap!  use 'setall' to do that
   Bit2d(point const &aSize);
@@ -72,6 +89,48 @@ public:      // funcs
   // zero.
   unsigned char get8(point const &p) const;
 
+  // Retrieve 'n' bits, in [0,64], starting at 'p' and going right,
+  // with the bit at 'p' being the least significant.  Unlike 'get8',
+  // 'p.x' need not be aligned, but 'p.x+n' must not exceed 'Size().x'.
+  uint64_t getBits(point const &p, int n) const;
+
+  // Combine the low 'n' bits of 'val' into the bits starting at 'p',
+  // with the same restrictions as 'getBits'.  Only the 'n' bits change.
+  void setBits(point const &p, int n, uint64_t val,
+               BlitOp op = BLIT_COPY);
+
+  // Combine the rectangle of 'src' with corner 'srcPos' and size
+  // 'rectSize' into this array at 'destPos'.  This works on up to 64
+  // bits at a time regardless of alignment, so it is the way to draw
+  // glyphs and other sprites.  The parts of the rectangle that fall
+  // outside either array are ignored.  'src' may be '*this', even if
+  // the rectangles overlap.
+  void blit(point const &destPos, Bit2d const &src,
+            point const &srcPos, point const &rectSize,
+            BlitOp op = BLIT_COPY);
+
+  // Blit all of 'src' with its corner at 'destPos'.
+  void blit(point const &destPos, Bit2d const &src,
+            BlitOp op = BLIT_COPY)
+    { blit(destPos, src, point(0,0), src.size, op); }
+
+  // Set all bits in a rectangle to 'val', clipping as with 'blit'.
+  void fillRect(point const &pos, point const &rectSize, int val);
+
+  // Number of 1 bits in a rectangle, clipped.
+  int countRect(point const &pos, point const &rectSize) const;
+
+  // Number of 1 bits in the whole array.
+  int count() const                  { return countRect(point(0,0), size); }
+
+  // Smallest 'x >= p.x' such that '(x,p.y)' is 1, or -1 if there is
+  // none.  'p.x' can be anything in [0,Size().x].
+  int findNextInRow(point const &p) const;
+
+  // Largest 'x <= p.x' such that '(x,p.y)' is 1, or -1 if there is
+  // none.  'p.x' can be anything in [-1,Size().x-1].
+  int findPrevInRow(point const &p) const;
+
   // debugging
   void print() const;
 
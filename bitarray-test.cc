@@ -3,12 +3,19 @@
 
 #include "bitarray.h"                  // module under test
 
+#include "bflatten.h"                  // StreamFlatten
 #include "exc.h"                       // smbase::xbase
 #include "sm-iostream.h"               // cout, endl
-#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // EXPECT_EQ
 #include "str.h"                       // string
 #include "xassert.h"                   // xassert
 
+#include <sstream>                     // std::{istringstream, ostringstream}
+#include <string>                      // std::string
+#include <vector>                      // std::vector
+
 #include <string.h>                    // strlen
 
 using namespace smbase;
@@ -126,6 +133,106 @@ void testAnyEvenOddBitPair(char const *s, bool expect)
 }
 
 
+// Compare the word-level queries and set operations to bit-at-a-time
+// computations on random arrays of random lengths.
+void testRandomWordOps()
+{
+  smbase_loopi(200) {
+    int len = sm_random(300);
+
+    // Vary the density so some arrays are sparse and some dense.
+    int density = sm_random(10) + 1;
+    std::vector<bool> v1(len), v2(len);
+    BitArray b1(len), b2(len);
+    for (int j=0; j<len; j++) {
+      v1[j] = sm_random(density) == 0;
+      v2[j] = sm_random(density) == 0;
+      b1.setTo(j, v1[j]);
+      b2.setTo(j, v2[j]);
+    }
+
+    int expectCount = 0;
+    bool expectAnyIntersection = false;
+    for (int j=0; j<len; j++) {
+      expectCount += v1[j];
+      expectAnyIntersection |= v1[j] && v2[j];
+    }
+    EXPECT_EQ(b1.count(), expectCount);
+    EXPECT_EQ(b1.isEmpty(), expectCount == 0);
+    EXPECT_EQ(b1.anyIntersection(b2), expectAnyIntersection);
+
+    // findNext and findPrev, from every starting point.
+    for (int j=0; j<=len; j++) {
+      int expectNext = -1;
+      for (int k=j; k<len; k++) {
+        if (v1[k]) {
+          expectNext = k;
+          break;
+        }
+      }
+      EXPECT_EQ(b1.findNext(j), expectNext);
+
+      int expectPrev = -1;
+      for (int k=j-1; k>=0; k--) {
+        if (v1[k]) {
+          expectPrev = k;
+          break;
+        }
+      }
+      EXPECT_EQ(b1.findPrev(j-1), expectPrev);
+    }
+
+    BitArray d = b1 - b2;
+    d.selfCheck();
+    for (int j=0; j<len; j++) {
+      EXPECT_EQ(d.test(j), (int)(v1[j] && !v2[j]));
+    }
+  }
+}
+
+
+// Check that the serialized form is still the bytes of the bits, low
+// bit first, as it was when the class stored bytes.
+void testXfer()
+{
+  BitArray b = stringToBitArray("1011000011");
+
+  std::ostringstream oss;
+  {
+    StreamFlatten flat(&oss);
+    b.xfer(flat);
+  }
+  std::string bytes = oss.str();
+  EXPECT_EQ(bytes.size(), 4+2);
+  EXPECT_EQ((int)(unsigned char)bytes[4], 0x0D);
+  EXPECT_EQ((int)(unsigned char)bytes[5], 0x03);
+
+  std::istringstream iss(bytes);
+  StreamFlatten flat(&iss);
+  BitArray b2(flat);
+  b2.xfer(flat);
+  b2.selfCheck();
+  xassert(b2 == b);
+
+  // Long enough to span several words.
+  BitArray big(1000);
+  for (int i=0; i<1000; i += 7) {
+    big.set(i);
+  }
+  std::ostringstream oss2;
+  {
+    StreamFlatten flat2(&oss2);
+    big.xfer(flat2);
+  }
+  EXPECT_EQ(oss2.str().size(), 4+125);
+  std::istringstream iss2(oss2.str());
+  StreamFlatten flat2(&iss2);
+  BitArray big2(flat2);
+  big2.xfer(flat2);
+  xassert(big2 == big);
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
@@ -186,6 +293,11 @@ void test_bitarray()
   testAnyEvenOddBitPair("1111", true);
   testAnyEvenOddBitPair("11110", true);
   testAnyEvenOddBitPair("01100", false);
+  testAnyEvenOddBitPair("00000000000000000000000000000000"
+                        "00000000000000000000000000000011", true);
+
+  testRandomWordOps();
+  testXfer();
 }
 
 
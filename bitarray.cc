@@ -2,10 +2,13 @@
 // code for bitarray.h
 
 #include "bitarray.h"     // this module
+#include "bit-ops.h"      // popCount64, countTrailingZeroes64, countLeadingZeroes64
 #include "flatten.h"      // Flatten
 
 #include <string.h>       // memset
 
+using namespace smbase;
+
 
 BitArray::BitArray(int n)
   : numBits(n)
@@ -16,18 +19,18 @@ BitArray::BitArray(int n)
 
 void BitArray::allocBits()
 {
-  bits = new unsigned char[allocdBytes()];
+  words = new Word[allocdWords()];
 }
 
 
 BitArray::~BitArray()
 {
-  delete[] bits;
+  delete[] words;
 }
 
 
 BitArray::BitArray(Flatten&)
-  : bits(NULL),
+  : words(NULL),
     numBits(0)
 {}
 
@@ -37,8 +40,20 @@ void BitArray::xfer(Flatten &flat)
 
   if (flat.reading()) {
     allocBits();
+    clearAll();
+  }
+
+  // Transfer one byte at a time, low byte of each word first, so the
+  // format does not depend on the word size or host byte order.
+  int allocdBytes = (numBits+7) / 8;
+  for (int i=0; i<allocdBytes; i++) {
+    int shift = (i & 7) * 8;
+    unsigned char b = (unsigned char)(words[i >> 3] >> shift);
+    flat.xferSimple(&b, 1);
+    if (flat.reading()) {
+      words[i >> 3] |= (Word)b << shift;
+    }
   }
-  flat.xferSimple(bits, allocdBytes());
 }
 
 
@@ -46,17 +61,17 @@ BitArray::BitArray(BitArray const &obj)
   : numBits(obj.numBits)
 {
   allocBits();
-  memcpy(bits, obj.bits, allocdBytes());
+  memcpy(words, obj.words, allocdWords() * sizeof(Word));
 }
 
 void BitArray::operator=(BitArray const &obj)
 {
   if (numBits != obj.numBits) {
-    delete[] bits;
+    delete[] words;
     numBits = obj.numBits;
     allocBits();
   }
-  memcpy(bits, obj.bits, allocdBytes());
+  memcpy(words, obj.words, allocdWords() * sizeof(Word));
 }
 
 
@@ -68,49 +83,123 @@ bool BitArray::operator== (BitArray const &obj) const
 
   // this relies on the invariant that the unused trailing
   // bits are always set to 0
-  return 0==memcmp(bits, obj.bits, allocdBytes());
+  return 0==memcmp(words, obj.words, allocdWords() * sizeof(Word));
+}
+
+
+BitArray::Word BitArray::lastWordMask() const
+{
+  if (numBits & 63) {
+    return bitMask(numBits) - 1;
+  }
+  else {
+    return ~(Word)0;
+  }
 }
 
 
 void BitArray::clearAll()
 {
-  memset(bits, 0, allocdBytes());
+  memset(words, 0, allocdWords() * sizeof(Word));
 }
 
 
 void BitArray::invert()
 {
-  int allocd = allocdBytes();
+  int allocd = allocdWords();
   for (int i=0; i<allocd; i++) {
-    bits[i] = ~(bits[i]);
+    words[i] = ~(words[i]);
   }
 
-  if (numBits & 7) {
-    // there are some trailing bits that I need to flip back
-    unsigned char mask = (1 << (numBits & 7)) - 1;     // bits to *not* flip
-    bits[allocd-1] ^= ~mask;
+  if (allocd) {
+    // there may be some trailing bits that I need to flip back
+    words[allocd-1] &= lastWordMask();
   }
 }
 
 
 void BitArray::selfCheck() const
 {
-  if (numBits & 7) {
-    // there are some trailing bits that I need to check
-    unsigned char mask = (1 << (numBits & 7)) - 1;     // bits to *not* check
-    unsigned char zero = bits[allocdBytes()-1] & ~mask;
-    xassert(zero == 0);
+  int allocd = allocdWords();
+  if (allocd) {
+    // check the trailing bits
+    xassert((words[allocd-1] & ~lastWordMask()) == 0);
+  }
+}
+
+
+int BitArray::count() const
+{
+  int allocd = allocdWords();
+  int ret = 0;
+  for (int i=0; i<allocd; i++) {
+    ret += popCount64(words[i]);
+  }
+  return ret;
+}
+
+
+int BitArray::findNext(int i) const
+{
+  xassert(0 <= i && i <= numBits);
+  if (i == numBits) {
+    return -1;
+  }
+
+  // look at the first word, ignoring the bits below 'i'
+  int w = i >> 6;
+  Word cur = words[w] & ~(bitMask(i) - 1);
+
+  // then skip whole empty words
+  int allocd = allocdWords();
+  while (cur == 0) {
+    if (++w == allocd) {
+      return -1;
+    }
+    cur = words[w];
+  }
+
+  return (w << 6) + countTrailingZeroes64(cur);
+}
+
+
+int BitArray::findPrev(int i) const
+{
+  xassert(-1 <= i && i < numBits);
+  if (i == -1) {
+    return -1;
+  }
+
+  // look at the first word, ignoring the bits above 'i'
+  int w = i >> 6;
+  Word cur = words[w];
+  if ((i & 63) != 63) {
+    cur &= (bitMask(i+1) - 1);
+  }
+
+  while (cur == 0) {
+    if (--w < 0) {
+      return -1;
+    }
+    cur = words[w];
   }
+
+  return (w << 6) + 63 - countLeadingZeroes64(cur);
 }
 
 
+// The loops below have no early exit and no dependence between words,
+// so the compiler can vectorize them.
+
 void BitArray::unionWith(BitArray const &obj)
 {
   xassert(numBits == obj.numBits);
 
-  int allocd = allocdBytes();
+  int allocd = allocdWords();
+  Word *dest = words;
+  Word const *src = obj.words;
   for (int i=0; i<allocd; i++) {
-    bits[i] |= obj.bits[i];
+    dest[i] |= src[i];
   }
 }
 
@@ -119,21 +208,70 @@ void BitArray::intersectWith(BitArray const &obj)
 {
   xassert(numBits == obj.numBits);
 
-  int allocd = allocdBytes();
+  int allocd = allocdWords();
+  Word *dest = words;
+  Word const *src = obj.words;
+  for (int i=0; i<allocd; i++) {
+    dest[i] &= src[i];
+  }
+}
+
+
+void BitArray::differenceWith(BitArray const &obj)
+{
+  xassert(numBits == obj.numBits);
+
+  int allocd = allocdWords();
+  Word *dest = words;
+  Word const *src = obj.words;
   for (int i=0; i<allocd; i++) {
-    bits[i] &= obj.bits[i];
+    dest[i] &= ~src[i];
   }
 }
 
 
+bool BitArray::anyIntersection(BitArray const &obj) const
+{
+  xassert(numBits == obj.numBits);
+
+  // check a block of words at a time, so the inner loop can be
+  // vectorized while large arrays can still stop early
+  int allocd = allocdWords();
+  for (int start=0; start<allocd; start+=16) {
+    int end = start+16 < allocd? start+16 : allocd;
+    Word acc = 0;
+    for (int i=start; i<end; i++) {
+      acc |= words[i] & obj.words[i];
+    }
+    if (acc) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool BitArray::isEmpty() const
+{
+  int allocd = allocdWords();
+  for (int i=0; i<allocd; i++) {
+    if (words[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
 // it's a little strange to export this function, since it is not
 // very general-purpose, but that is the price of encapsulation
 bool BitArray::anyEvenOddBitPair() const
 {
-  int allocd = allocdBytes();
+  // since 64 is even, no pair straddles two words
+  int allocd = allocdWords();
   for (int i=0; i<allocd; i++) {
-    unsigned char b = bits[i];
-    if (b & (b >> 1) & 0x55) {        // 01010101
+    Word w = words[i];
+    if (w & (w >> 1) & 0x5555555555555555ULL) {      // 0101...
       return true;
     }
   }
@@ -168,29 +306,9 @@ string toString(BitArray const &b)
 // ----------------------- BitArray::Iter ------------------------
 void BitArray::Iter::adv()
 {
-  curBit++;
-
-  while (curBit < arr.numBits) {
-    if ((curBit & 7) == 0) {
-      // beginning a new byte; is it entirely empty?
-      while (arr.bits[curBit >> 3] == 0) {
-        // yes, skip to next
-        curBit += 8;
-
-        if (curBit >= arr.numBits) {
-          return;     // done iterating
-        }
-      }
-    }
-
-    // this could be made a little faster by using the trick to scan
-    // for the first nonzero bit.. but since I am only going to scan
-    // within a single byte, it shouldn't make that much difference
-    if (arr.test(curBit)) {
-      return;         // found element
-    }
-
-    curBit++;
+  curBit = arr.findNext(curBit+1);
+  if (curBit < 0) {
+    curBit = arr.numBits;       // done iterating
   }
 }
 
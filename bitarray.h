@@ -7,25 +7,39 @@
 #include "xassert.h"      // xassert
 #include "str.h"          // string
 
+#include <stdint.h>       // uint64_t
+
 class Flatten;            // flatten.h
 
 class BitArray {
+public:     // types
+  // unit of storage; bit 'i' is bit 'i%64' of word 'i/64'
+  typedef uint64_t Word;
+
 private:    // data
-  unsigned char *bits;
+  Word *words;
   int numBits;              // # of bits in the array
 
-  // invariant: the bits in the last allocated byte that are beyond
+  // invariant: the bits in the last allocated word that are beyond
   // 'numBits' (if any) are always 0
 
 private:    // funcs
   void bc(int i) const { xassert((unsigned)i < (unsigned)numBits); }
-  int allocdBytes() const { return (numBits+7) / 8; }
+  int allocdWords() const { return (numBits+63) >> 6; }
   void allocBits();
 
+  static Word bitMask(int i) { return (Word)1 << (i & 63); }
+
+  // mask of the bits in the last word that are within 'numBits';
+  // all 1s if 'numBits' is a multiple of 64
+  Word lastWordMask() const;
+
 public:     // funcs
   BitArray(int n);          // create with given # of bits, initially zeroed
   ~BitArray();
 
+  // The serialized form is the bits packed 8 per byte, low bit first,
+  // which is what this class stored before it switched to words.
   BitArray(Flatten&);
   void xfer(Flatten &flat);
 
@@ -40,13 +54,13 @@ public:     // funcs
 
   // test a bit, return 0 or 1
   int test(int i) const
-    { bc(i); return ((bits[i >> 3]) >> (i & 7)) & 1; }
+    { bc(i); return (int)((words[i >> 6] >> (i & 63)) & 1); }
 
   // set a bit to a specific value
   void set(int i)
-    { bc(i); bits[i >> 3] |= (1 << (i & 7)); }
+    { bc(i); words[i >> 6] |= bitMask(i); }
   void reset(int i)
-    { bc(i); bits[i >> 3] &= ~(1 << (i & 7)); }
+    { bc(i); words[i >> 6] &= ~bitMask(i); }
 
   // set a bit to an arbitrary value
   void setTo(int i, int val) {
@@ -64,12 +78,33 @@ public:     // funcs
   // invert the bits
   void invert();
 
+  // number of bits that are set
+  int count() const;
+
+  // index of the first set bit at or after 'i', or -1 if there is
+  // none; 'i' can be anything in [0,length()]
+  int findNext(int i) const;
+
+  // index of the last set bit at or before 'i', or -1 if there is
+  // none; 'i' can be anything in [-1,length()-1]
+  int findPrev(int i) const;
+
   // bitwise OR ('obj' must be same length)
   void unionWith(BitArray const &obj);
 
   // bitwise AND
   void intersectWith(BitArray const &obj);
 
+  // bitwise AND with the complement of 'obj'
+  void differenceWith(BitArray const &obj);
+
+  // true if some bit is set in both 'this' and 'obj'; this is the
+  // same as !(*this & obj).isEmpty(), but does not build the result
+  bool anyIntersection(BitArray const &obj) const;
+
+  // true if no bits are set
+  bool isEmpty() const;
+
   // true if there is any pair of bits 2n,2n+1 where both are set
   bool anyEvenOddBitPair() const;
 
@@ -105,6 +140,17 @@ public:     // funcs
     return ret;
   }
 
+  BitArray& operator-= (BitArray const &obj) {
+    differenceWith(obj);
+    return *this;
+  }
+
+  BitArray operator- (BitArray const &obj) const {
+    BitArray ret(*this);
+    ret.differenceWith(obj);
+    return ret;
+  }
+
 public:     // types
   class Iter {
   private:    // data
@@ -0,0 +1,344 @@
+// compressed-bitmap-test.cc
+// Tests for compressed-bitmap.
+
+// This file is in the public domain.
+
+#include "compressed-bitmap.h"         // module under test
+
+#include "bflatten.h"                  // StreamFlatten
+#include "exc.h"                       // EXN_CONTEXT_EXPR, XFormat
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // EXPECT_EQ, DIAG
+#include "xassert.h"                   // xassert
+
+#include <algorithm>                   // std::{lower_bound, upper_bound}
+#include <cstdint>                     // std::{int64_t, uint32_t, uint64_t}
+#include <cstdlib>                     // std::getenv
+#include <set>                         // std::set
+#include <sstream>                     // std::{istringstream, ostringstream}
+#include <string>                      // std::string
+#include <vector>                      // std::vector
+
+using namespace smbase;
+
+typedef CompressedBitmap::Value Value;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Check that `b` has exactly the members of `ref`, using every query.
+void checkSame(CompressedBitmap const &b, std::set<Value> const &ref)
+{
+  b.selfCheck();
+  EXPECT_EQ(b.count(), ref.size());
+  EXPECT_EQ(b.isEmpty(), ref.empty());
+
+  // Iteration.
+  std::vector<Value> members;
+  for (CompressedBitmap::Iter iter(b); !iter.isDone(); iter.adv()) {
+    members.push_back(iter.data());
+  }
+  xassert(members == std::vector<Value>(ref.begin(), ref.end()));
+
+  // Rank and select are not cheap for bitmap containers, so for large
+  // sets, only check a sample of the members.
+  std::size_t stride = members.size() / 1000 + 1;
+  for (std::size_t k=0; k < members.size(); k += stride) {
+    Value v = members[k];
+    xassert(b.test(v));
+    EXPECT_EQ(b.rank(v), k+1);
+    EXPECT_EQ(b.select(k), v);
+  }
+
+  // Probes near members and at random places.
+  auto probe = [&](Value v) {
+    EXN_CONTEXT_EXPR(v);
+
+    EXPECT_EQ(b.test(v), (int)ref.count(v));
+
+    auto next = std::lower_bound(members.begin(), members.end(), v);
+    EXPECT_EQ(b.findNext(v),
+              next == members.end()? (std::int64_t)-1 : (std::int64_t)*next);
+
+    auto after = std::upper_bound(members.begin(), members.end(), v);
+    EXPECT_EQ(b.findPrev(v),
+              after == members.begin()? (std::int64_t)-1 :
+                                        (std::int64_t)after[-1]);
+    EXPECT_EQ(b.rank(v), (std::uint64_t)(after - members.begin()));
+  };
+  for (std::size_t k=0; k < members.size(); k += stride) {
+    probe(members[k]-1);
+    probe(members[k]+1);
+  }
+  smbase_loopi(100) {
+    probe(((Value)sm_random(0x10000) << 16) | (Value)sm_random(0x10000));
+  }
+  probe(0);
+  probe(0xFFFFFFFF);
+}
+
+
+// Insert and remove random values drawn from `[0,range)` offset by
+// `base`, comparing against `std::set`.
+void testRandomOps(Value base, int range, int iters)
+{
+  EXN_CONTEXT_EXPR(range);
+
+  CompressedBitmap b;
+  std::set<Value> ref;
+
+  smbase_loopi(iters) {
+    Value v = base + (Value)sm_random(range);
+    if (sm_random(3) == 0) {
+      b.reset(v);
+      ref.erase(v);
+    }
+    else {
+      b.set(v);
+      ref.insert(v);
+    }
+  }
+  checkSame(b, ref);
+
+  // Optimizing does not change the contents.
+  CompressedBitmap opt(b);
+  opt.optimize();
+  checkSame(opt, ref);
+  xassert(opt == b);
+
+  // Modifying an optimized set works.
+  smbase_loopi(100) {
+    Value v = base + (Value)sm_random(range);
+    opt.setTo(v, sm_random(2));
+    b.setTo(v, opt.test(v));
+  }
+  xassert(opt == b);
+  opt.selfCheck();
+}
+
+
+// Build a set with random members from several chunks, some sparse,
+// some dense, and some made of runs.
+CompressedBitmap randomSet(std::set<Value> &ref)
+{
+  CompressedBitmap b;
+  int chunks = sm_random(5);
+  for (int c=0; c < chunks; c++) {
+    Value base = (Value)sm_random(8) << 16;
+    switch (sm_random(3)) {
+      case 0:
+        smbase_loopi(sm_random(200)) {
+          Value v = base + (Value)sm_random(0x10000);
+          b.set(v);
+          ref.insert(v);
+        }
+        break;
+
+      case 1:
+        // Enough to make a bitmap container.
+        smbase_loopi(5000 + sm_random(1000)) {
+          Value v = base + (Value)sm_random(0x10000);
+          b.set(v);
+          ref.insert(v);
+        }
+        break;
+
+      case 2: {
+        Value start = base + (Value)sm_random(0x8000);
+        Value len = (Value)sm_random(2000);
+        for (Value v = start; v < start+len; v++) {
+          b.set(v);
+          ref.insert(v);
+        }
+        break;
+      }
+    }
+  }
+
+  if (sm_random(2)) {
+    b.optimize();
+  }
+  return b;
+}
+
+
+void testSetOps()
+{
+  smbase_loopi(6) {
+    std::set<Value> ra, rb;
+    CompressedBitmap a = randomSet(ra);
+    CompressedBitmap b = randomSet(rb);
+
+    std::set<Value> runion(ra);
+    runion.insert(rb.begin(), rb.end());
+
+    std::set<Value> rinter, rdiff;
+    bool anyCommon = false;
+    for (Value v : ra) {
+      if (rb.count(v)) {
+        rinter.insert(v);
+        anyCommon = true;
+      }
+      else {
+        rdiff.insert(v);
+      }
+    }
+
+    checkSame(a | b, runion);
+    checkSame(a & b, rinter);
+    checkSame(a - b, rdiff);
+    EXPECT_EQ(a.anyIntersection(b), anyCommon);
+    EXPECT_EQ(b.anyIntersection(a), anyCommon);
+
+    CompressedBitmap c(a);
+    c |= b;
+    c -= a;
+    c &= b;
+    xassert(c == (b - a));
+
+    // Combining a set with itself, so both operands share storage.
+    CompressedBitmap d(a);
+    d &= d;
+    checkSame(d, ra);
+    EXPECT_EQ(d.anyIntersection(d), !ra.empty());
+    d -= d;
+    xassert(d.isEmpty());
+  }
+}
+
+
+void testRuns()
+{
+  // One long run spanning several chunks.
+  CompressedBitmap b;
+  std::set<Value> ref;
+  for (Value v = 130000; v < 200100; v++) {
+    b.set(v);
+    ref.insert(v);
+  }
+  std::size_t before = b.memoryUsage();
+  b.optimize();
+  checkSame(b, ref);
+  EXPECT_EQ(b.numContainers(), 3);
+  DIAG("run memory: before=" << before <<
+       " after=" << b.memoryUsage());
+  xassert(b.memoryUsage() * 50 < before);
+
+  // Punch a hole, which converts one container back.
+  b.reset(200000);
+  ref.erase(200000);
+  checkSame(b, ref);
+}
+
+
+void testSparse()
+{
+  // A few thousand members spread over most of the 32-bit range takes
+  // far less than the half gigabyte `BitArray` would need.
+  CompressedBitmap b;
+  std::set<Value> ref;
+  smbase_loopi(3000) {
+    Value v = (Value)i * 1000003u;
+    b.set(v);
+    ref.insert(v);
+  }
+  checkSame(b, ref);
+  DIAG("sparse memory: " << b.memoryUsage());
+  xassert(b.memoryUsage() < 3000 * 100);
+
+  // Removing everything leaves no containers.
+  for (Value v : ref) {
+    b.reset(v);
+  }
+  xassert(b.isEmpty());
+  EXPECT_EQ(b.numContainers(), 0);
+  b.selfCheck();
+}
+
+
+CompressedBitmap roundTrip(CompressedBitmap &b)
+{
+  std::ostringstream oss;
+  {
+    StreamFlatten flat(&oss);
+    b.xfer(flat);
+  }
+
+  std::istringstream iss(oss.str());
+  StreamFlatten flat(&iss);
+  CompressedBitmap ret(flat);
+  ret.xfer(flat);
+  return ret;
+}
+
+
+void testXfer()
+{
+  smbase_loopi(4) {
+    std::set<Value> ref;
+    CompressedBitmap b = randomSet(ref);
+    CompressedBitmap b2 = roundTrip(b);
+    checkSame(b2, ref);
+    xassert(b2 == b);
+  }
+
+  // The encoding is big-endian and independent of the host.
+  CompressedBitmap b;
+  b.set(0x00030102);
+  std::ostringstream oss;
+  {
+    StreamFlatten flat(&oss);
+    b.xfer(flat);
+  }
+  std::string bytes = oss.str();
+  EXPECT_EQ(bytes, std::string(
+    "\x00\x00\x00\x01"             // one container
+    "\x00\x03"                     // its key
+    "\x00"                         // array kind
+    "\x00\x00\x00\x01"             // one member
+    "\x01\x02",                    // the member's low bits
+    4+2+1+4+2));
+
+  // Malformed input is rejected.
+  bytes[6] = 7;
+  std::istringstream iss(bytes);
+  StreamFlatten flat(&iss);
+  CompressedBitmap bad(flat);
+  try {
+    bad.xfer(flat);
+    xfailure("should have failed");
+  }
+  catch (XFormat &x) {
+    DIAG("as expected: " << x.getMessage());
+  }
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_compressed_bitmap()
+{
+  testRandomOps(0, 100, 200);
+  testRandomOps(0, 0x10000, 1000);
+  testRandomOps(0x12340000, 0x10000, 2000);
+  testRandomOps(0xFFFF0000, 0x10000, 6000);
+
+  // Enough operations to fill bitmap containers and empty them again.
+  if (std::getenv("COMPRESSED_BITMAP_TEST_BIG")) {
+    testRandomOps(0x12340000, 0x10000, 20000);
+    testRandomOps(0xFFFF0000, 0x10000, 60000);
+  }
+  testRandomOps(1000000, 1000, 800);
+  testRandomOps(0, 0x7FFFFFFF, 2000);
+  testSetOps();
+  testRuns();
+  testSparse();
+  testXfer();
+}
+
+
+// EOF
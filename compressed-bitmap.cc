@@ -0,0 +1,1197 @@
+// compressed-bitmap.cc
+// Code for compressed-bitmap.h.
+
+// This file is in the public domain.
+
+#include "compressed-bitmap.h"         // this module
+
+#include "bit-ops.h"                   // popCount64, countTrailingZeroes64, countLeadingZeroes64
+#include "exc.h"                       // xformat, xformatsb, XAssert
+#include "flatten.h"                   // Flatten, serializeIntNBO, deserializeIntNBO
+#include "sm-macros.h"                 // OPEN_NAMESPACE, STATICDEF
+#include "str.h"                       // stringb
+#include "xassert.h"                   // xassert, xassertPrecondition
+
+#include <algorithm>                   // std::{lower_bound, set_union, set_intersection, set_difference}
+#include <iterator>                    // std::back_inserter
+#include <utility>                     // std::move
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Bit mask for value `v` within its word.
+static inline std::uint64_t bitOf(unsigned v)
+{
+  return (std::uint64_t)1 << (v & 63);
+}
+
+
+// Set the bits for [first,last] in `words`.
+static void setRange(std::uint64_t *words, unsigned first, unsigned last)
+{
+  unsigned fw = first >> 6;
+  unsigned lw = last >> 6;
+  std::uint64_t firstMask = ~(bitOf(first) - 1);
+  std::uint64_t lastMask = (last & 63) == 63? ~(std::uint64_t)0 :
+                                              bitOf(last+1) - 1;
+  if (fw == lw) {
+    words[fw] |= firstMask & lastMask;
+  }
+  else {
+    words[fw] |= firstMask;
+    for (unsigned w = fw+1; w < lw; w++) {
+      words[w] = ~(std::uint64_t)0;
+    }
+    words[lw] |= lastMask;
+  }
+}
+
+
+// Transfer `n` 16-bit values in network byte order.
+static void xferShorts(Flatten &flat, std::vector<std::uint16_t> &vec,
+                       std::size_t n)
+{
+  std::vector<unsigned char> bytes(n*2);
+  if (flat.writing()) {
+    for (std::size_t i=0; i < n; i++) {
+      serializeIntNBO(bytes.data() + i*2, vec[i]);
+    }
+  }
+
+  if (n) {
+    flat.xferSimple(bytes.data(), n*2);
+  }
+
+  if (flat.reading()) {
+    vec.resize(n);
+    for (std::size_t i=0; i < n; i++) {
+      deserializeIntNBO(bytes.data() + i*2, vec[i]);
+    }
+  }
+}
+
+
+// ------------------------------ Container ----------------------------
+CompressedBitmap::Container::Container()
+  : m_kind(K_ARRAY),
+    m_cardinality(0),
+    m_shorts(),
+    m_words()
+{}
+
+
+std::size_t CompressedBitmap::Container::findRun(std::uint16_t v) const
+{
+  // Binary search on the run ends.
+  std::size_t lo = 0;
+  std::size_t hi = numRuns();
+  while (lo < hi) {
+    std::size_t mid = (lo + hi) / 2;
+    if (m_shorts[mid*2 + 1] < v) {
+      lo = mid+1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+void CompressedBitmap::Container::setFromArray(
+  std::vector<std::uint16_t> &&arr)
+{
+  m_cardinality = (std::uint32_t)arr.size();
+  if (m_cardinality <= ARRAY_MAX) {
+    m_kind = K_ARRAY;
+    m_shorts = std::move(arr);
+    m_shorts.shrink_to_fit();
+    m_words.clear();
+    m_words.shrink_to_fit();
+  }
+  else {
+    std::vector<std::uint64_t> words(NUM_WORDS, 0);
+    for (std::uint16_t v : arr) {
+      words[v >> 6] |= bitOf(v);
+    }
+    m_kind = K_BITMAP;
+    m_words = std::move(words);
+    m_shorts.clear();
+    m_shorts.shrink_to_fit();
+  }
+}
+
+
+void CompressedBitmap::Container::setFromWords(
+  std::vector<std::uint64_t> &&words)
+{
+  std::uint32_t card = 0;
+  for (std::uint64_t w : words) {
+    card += popCount64(w);
+  }
+
+  if (card <= ARRAY_MAX) {
+    std::vector<std::uint16_t> arr;
+    arr.reserve(card);
+    for (unsigned i=0; i < NUM_WORDS; i++) {
+      std::uint64_t w = words[i];
+      while (w) {
+        arr.push_back((std::uint16_t)(i*64 + countTrailingZeroes64(w)));
+        w &= w-1;
+      }
+    }
+    setFromArray(std::move(arr));
+  }
+  else {
+    m_kind = K_BITMAP;
+    m_cardinality = card;
+    m_words = std::move(words);
+    m_shorts.clear();
+    m_shorts.shrink_to_fit();
+  }
+}
+
+
+void CompressedBitmap::Container::expandRuns()
+{
+  if (m_kind != K_RUN) {
+    return;
+  }
+
+  if (m_cardinality <= ARRAY_MAX) {
+    std::vector<std::uint16_t> arr;
+    getArray(arr);
+    setFromArray(std::move(arr));
+  }
+  else {
+    std::vector<std::uint64_t> words;
+    getWords(words);
+    setFromWords(std::move(words));
+  }
+}
+
+
+void CompressedBitmap::Container::getArray(
+  std::vector<std::uint16_t> &arr) const
+{
+  arr.clear();
+  arr.reserve(m_cardinality);
+
+  switch (m_kind) {
+    case K_ARRAY:
+      arr = m_shorts;
+      break;
+
+    case K_BITMAP:
+      for (unsigned i=0; i < NUM_WORDS; i++) {
+        std::uint64_t w = m_words[i];
+        while (w) {
+          arr.push_back((std::uint16_t)(i*64 + countTrailingZeroes64(w)));
+          w &= w-1;
+        }
+      }
+      break;
+
+    case K_RUN:
+      for (std::size_t r=0; r < numRuns(); r++) {
+        for (unsigned v = m_shorts[r*2]; v <= m_shorts[r*2+1]; v++) {
+          arr.push_back((std::uint16_t)v);
+        }
+      }
+      break;
+  }
+}
+
+
+void CompressedBitmap::Container::getWords(
+  std::vector<std::uint64_t> &words) const
+{
+  if (m_kind == K_BITMAP) {
+    words = m_words;
+    return;
+  }
+
+  words.assign(NUM_WORDS, 0);
+  if (m_kind == K_ARRAY) {
+    for (std::uint16_t v : m_shorts) {
+      words[v >> 6] |= bitOf(v);
+    }
+  }
+  else {
+    for (std::size_t r=0; r < numRuns(); r++) {
+      setRange(words.data(), m_shorts[r*2], m_shorts[r*2+1]);
+    }
+  }
+}
+
+
+void CompressedBitmap::Container::takeWords(
+  std::vector<std::uint64_t> &words)
+{
+  if (m_kind == K_BITMAP) {
+    words.swap(m_words);
+    m_words.clear();
+  }
+  else {
+    getWords(words);
+  }
+}
+
+
+STATICDEF std::uint64_t const *CompressedBitmap::Container::wordsOf(
+  Container const &c, std::vector<std::uint64_t> &temp)
+{
+  if (c.m_kind == K_BITMAP) {
+    return c.m_words.data();
+  }
+  c.getWords(temp);
+  return temp.data();
+}
+
+
+bool CompressedBitmap::Container::contains(std::uint16_t v) const
+{
+  switch (m_kind) {
+    case K_ARRAY:
+      return std::binary_search(m_shorts.begin(), m_shorts.end(), v);
+
+    case K_BITMAP:
+      return (m_words[v >> 6] & bitOf(v)) != 0;
+
+    case K_RUN: {
+      std::size_t r = findRun(v);
+      return r < numRuns() && m_shorts[r*2] <= v;
+    }
+  }
+
+  return false;      // not reached
+}
+
+
+bool CompressedBitmap::Container::add(std::uint16_t v)
+{
+  if (contains(v)) {
+    return false;
+  }
+  expandRuns();
+
+  if (m_kind == K_ARRAY) {
+    if (m_cardinality < ARRAY_MAX) {
+      m_shorts.insert(
+        std::lower_bound(m_shorts.begin(), m_shorts.end(), v), v);
+      m_cardinality++;
+      return true;
+    }
+
+    // Adding this member makes the array too large.
+    std::vector<std::uint64_t> words;
+    getWords(words);
+    words[v >> 6] |= bitOf(v);
+    setFromWords(std::move(words));
+    return true;
+  }
+
+  m_words[v >> 6] |= bitOf(v);
+  m_cardinality++;
+  return true;
+}
+
+
+bool CompressedBitmap::Container::remove(std::uint16_t v)
+{
+  if (!contains(v)) {
+    return false;
+  }
+  expandRuns();
+
+  if (m_kind == K_ARRAY) {
+    m_shorts.erase(
+      std::lower_bound(m_shorts.begin(), m_shorts.end(), v));
+    m_cardinality--;
+  }
+  else {
+    m_words[v >> 6] &= ~bitOf(v);
+    m_cardinality--;
+    if (m_cardinality <= ARRAY_MAX) {
+      std::vector<std::uint64_t> words(std::move(m_words));
+      setFromWords(std::move(words));
+    }
+  }
+  return true;
+}
+
+
+int CompressedBitmap::Container::nextAtOrAfter(std::uint32_t v) const
+{
+  if (v >= 65536) {
+    return -1;
+  }
+
+  switch (m_kind) {
+    case K_ARRAY: {
+      auto it = std::lower_bound(m_shorts.begin(), m_shorts.end(),
+                                 (std::uint16_t)v);
+      return it == m_shorts.end()? -1 : *it;
+    }
+
+    case K_BITMAP: {
+      unsigned w = v >> 6;
+      std::uint64_t cur = m_words[w] & ~(bitOf(v) - 1);
+      while (cur == 0) {
+        if (++w == NUM_WORDS) {
+          return -1;
+        }
+        cur = m_words[w];
+      }
+      return (int)(w*64 + countTrailingZeroes64(cur));
+    }
+
+    case K_RUN: {
+      std::size_t r = findRun((std::uint16_t)v);
+      if (r == numRuns()) {
+        return -1;
+      }
+      return m_shorts[r*2] <= v? (int)v : m_shorts[r*2];
+    }
+  }
+
+  return -1;         // not reached
+}
+
+
+int CompressedBitmap::Container::prevAtOrBefore(int v) const
+{
+  if (v < 0) {
+    return -1;
+  }
+
+  switch (m_kind) {
+    case K_ARRAY: {
+      auto it = std::upper_bound(m_shorts.begin(), m_shorts.end(),
+                                 (std::uint16_t)v);
+      return it == m_shorts.begin()? -1 : *(it-1);
+    }
+
+    case K_BITMAP: {
+      int w = v >> 6;
+      std::uint64_t cur = m_words[w];
+      if ((v & 63) != 63) {
+        cur &= bitOf(v+1) - 1;
+      }
+      while (cur == 0) {
+        if (--w < 0) {
+          return -1;
+        }
+        cur = m_words[w];
+      }
+      return w*64 + 63 - countLeadingZeroes64(cur);
+    }
+
+    case K_RUN: {
+      // The first run that ends at or after `v`.
+      std::size_t r = findRun((std::uint16_t)v);
+      if (r < numRuns() && m_shorts[r*2] <= v) {
+        return v;
+      }
+      return r == 0? -1 : m_shorts[r*2 - 1];
+    }
+  }
+
+  return -1;         // not reached
+}
+
+
+std::uint32_t CompressedBitmap::Container::rank(std::uint16_t v) const
+{
+  switch (m_kind) {
+    case K_ARRAY:
+      return (std::uint32_t)(
+        std::upper_bound(m_shorts.begin(), m_shorts.end(), v) -
+        m_shorts.begin());
+
+    case K_BITMAP: {
+      std::uint32_t ret = 0;
+      unsigned w = v >> 6;
+      for (unsigned i=0; i < w; i++) {
+        ret += popCount64(m_words[i]);
+      }
+      std::uint64_t last = m_words[w];
+      if ((v & 63) != 63) {
+        last &= bitOf(v+1) - 1;
+      }
+      return ret + popCount64(last);
+    }
+
+    case K_RUN: {
+      std::uint32_t ret = 0;
+      for (std::size_t r=0; r < numRuns(); r++) {
+        unsigned first = m_shorts[r*2];
+        unsigned last = m_shorts[r*2+1];
+        if (first > v) {
+          break;
+        }
+        ret += (last < v? last : v) - first + 1;
+      }
+      return ret;
+    }
+  }
+
+  return 0;          // not reached
+}
+
+
+std::uint16_t CompressedBitmap::Container::select(std::uint32_t k) const
+{
+  xassertPrecondition(k < m_cardinality);
+
+  switch (m_kind) {
+    case K_ARRAY:
+      return m_shorts[k];
+
+    case K_BITMAP:
+      for (unsigned i=0; i < NUM_WORDS; i++) {
+        std::uint64_t w = m_words[i];
+        std::uint32_t c = popCount64(w);
+        if (k < c) {
+          // Clear the `k` lowest bits, then take the next one.
+          for (std::uint32_t j=0; j < k; j++) {
+            w &= w-1;
+          }
+          return (std::uint16_t)(i*64 + countTrailingZeroes64(w));
+        }
+        k -= c;
+      }
+      break;
+
+    case K_RUN:
+      for (std::size_t r=0; r < numRuns(); r++) {
+        std::uint32_t len = m_shorts[r*2+1] - m_shorts[r*2] + 1;
+        if (k < len) {
+          return (std::uint16_t)(m_shorts[r*2] + k);
+        }
+        k -= len;
+      }
+      break;
+  }
+
+  xfailure("select: not reached");
+}
+
+
+void CompressedBitmap::Container::unionWith(Container const &obj)
+{
+  if (m_kind == K_ARRAY && obj.m_kind == K_ARRAY &&
+      m_cardinality + obj.m_cardinality <= ARRAY_MAX) {
+    std::vector<std::uint16_t> arr;
+    arr.reserve(m_cardinality + obj.m_cardinality);
+    std::set_union(m_shorts.begin(), m_shorts.end(),
+                   obj.m_shorts.begin(), obj.m_shorts.end(),
+                   std::back_inserter(arr));
+    setFromArray(std::move(arr));
+    return;
+  }
+
+  std::vector<std::uint64_t> words;
+  takeWords(words);
+  if (obj.m_kind == K_BITMAP) {
+    for (unsigned i=0; i < NUM_WORDS; i++) {
+      words[i] |= obj.m_words[i];
+    }
+  }
+  else if (obj.m_kind == K_ARRAY) {
+    for (std::uint16_t v : obj.m_shorts) {
+      words[v >> 6] |= bitOf(v);
+    }
+  }
+  else {
+    for (std::size_t r=0; r < obj.numRuns(); r++) {
+      setRange(words.data(), obj.m_shorts[r*2], obj.m_shorts[r*2+1]);
+    }
+  }
+  setFromWords(std::move(words));
+}
+
+
+void CompressedBitmap::Container::intersectWith(Container const &obj)
+{
+  // When either side is an array, the result is a subset of it, and
+  // we can test each of its members against the other side.
+  if (m_kind == K_ARRAY || obj.m_kind == K_ARRAY) {
+    Container const &arrSide = m_kind == K_ARRAY? *this : obj;
+    Container const &other = m_kind == K_ARRAY? obj : *this;
+
+    std::vector<std::uint16_t> arr;
+    if (other.m_kind == K_ARRAY) {
+      std::set_intersection(arrSide.m_shorts.begin(), arrSide.m_shorts.end(),
+                            other.m_shorts.begin(), other.m_shorts.end(),
+                            std::back_inserter(arr));
+    }
+    else {
+      for (std::uint16_t v : arrSide.m_shorts) {
+        if (other.contains(v)) {
+          arr.push_back(v);
+        }
+      }
+    }
+    setFromArray(std::move(arr));
+    return;
+  }
+
+  // Combine into our own words, building a temporary only for a run
+  // container.  Get the other side's words first, so a failure to
+  // allocate them leaves this container intact.
+  std::vector<std::uint64_t> objTemp, words;
+  std::uint64_t const *objWords = wordsOf(obj, objTemp);
+  takeWords(words);
+  for (unsigned i=0; i < NUM_WORDS; i++) {
+    words[i] &= objWords[i];
+  }
+  setFromWords(std::move(words));
+}
+
+
+void CompressedBitmap::Container::differenceWith(Container const &obj)
+{
+  if (m_kind == K_ARRAY) {
+    std::vector<std::uint16_t> arr;
+    if (obj.m_kind == K_ARRAY) {
+      std::set_difference(m_shorts.begin(), m_shorts.end(),
+                          obj.m_shorts.begin(), obj.m_shorts.end(),
+                          std::back_inserter(arr));
+    }
+    else {
+      for (std::uint16_t v : m_shorts) {
+        if (!obj.contains(v)) {
+          arr.push_back(v);
+        }
+      }
+    }
+    setFromArray(std::move(arr));
+    return;
+  }
+
+  std::vector<std::uint64_t> objTemp, words;
+  if (obj.m_kind == K_ARRAY) {
+    takeWords(words);
+    for (std::uint16_t v : obj.m_shorts) {
+      words[v >> 6] &= ~bitOf(v);
+    }
+  }
+  else {
+    std::uint64_t const *objWords = wordsOf(obj, objTemp);
+    takeWords(words);
+    for (unsigned i=0; i < NUM_WORDS; i++) {
+      words[i] &= ~objWords[i];
+    }
+  }
+  setFromWords(std::move(words));
+}
+
+
+bool CompressedBitmap::Container::intersects(Container const &obj) const
+{
+  if (m_kind == K_ARRAY || obj.m_kind == K_ARRAY) {
+    Container const &arrSide = m_kind == K_ARRAY? *this : obj;
+    Container const &other = m_kind == K_ARRAY? obj : *this;
+    for (std::uint16_t v : arrSide.m_shorts) {
+      if (other.contains(v)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<std::uint64_t> temp, objTemp;
+  std::uint64_t const *words = wordsOf(*this, temp);
+  std::uint64_t const *objWords = wordsOf(obj, objTemp);
+  std::uint64_t acc = 0;
+  for (unsigned i=0; i < NUM_WORDS; i++) {
+    acc |= words[i] & objWords[i];
+  }
+  return acc != 0;
+}
+
+
+bool CompressedBitmap::Container::equals(Container const &obj) const
+{
+  if (m_cardinality != obj.m_cardinality) {
+    return false;
+  }
+
+  // Runs are maximal and arrays sorted, so equal sets of the same kind
+  // have equal representations.
+  if (m_kind == obj.m_kind) {
+    return m_kind == K_BITMAP? m_words == obj.m_words :
+                               m_shorts == obj.m_shorts;
+  }
+
+  std::vector<std::uint64_t> words, objWords;
+  getWords(words);
+  obj.getWords(objWords);
+  return words == objWords;
+}
+
+
+void CompressedBitmap::Container::optimize()
+{
+  // Count the runs.
+  std::size_t runs = 0;
+  if (m_kind == K_RUN) {
+    runs = numRuns();
+  }
+  else if (m_kind == K_ARRAY) {
+    for (std::size_t i=0; i < m_shorts.size(); i++) {
+      if (i == 0 || m_shorts[i] != m_shorts[i-1]+1) {
+        runs++;
+      }
+    }
+  }
+  else {
+    // A run starts at each 1 bit whose predecessor is 0.
+    std::uint64_t prevTop = 0;
+    for (unsigned i=0; i < NUM_WORDS; i++) {
+      std::uint64_t w = m_words[i];
+      runs += popCount64(w & ~((w << 1) | prevTop));
+      prevTop = w >> 63;
+    }
+  }
+
+  // Compare sizes in bytes.
+  std::size_t runBytes = runs * 4;
+  std::size_t otherBytes = m_cardinality <= ARRAY_MAX?
+                             m_cardinality * 2 : NUM_WORDS * 8;
+
+  if (runBytes < otherBytes) {
+    if (m_kind != K_RUN) {
+      std::vector<std::uint16_t> arr;
+      getArray(arr);
+
+      std::vector<std::uint16_t> pairs;
+      pairs.reserve(runs * 2);
+      for (std::size_t i=0; i < arr.size(); i++) {
+        if (i == 0 || arr[i] != arr[i-1]+1) {
+          pairs.push_back(arr[i]);
+          pairs.push_back(arr[i]);
+        }
+        else {
+          pairs.back() = arr[i];
+        }
+      }
+
+      m_kind = K_RUN;
+      m_shorts = std::move(pairs);
+      m_words.clear();
+      m_words.shrink_to_fit();
+    }
+  }
+  else {
+    expandRuns();
+  }
+}
+
+
+std::size_t CompressedBitmap::Container::memoryUsage() const
+{
+  return m_shorts.capacity() * sizeof(std::uint16_t) +
+         m_words.capacity() * sizeof(std::uint64_t);
+}
+
+
+void CompressedBitmap::Container::xfer(Flatten &flat)
+{
+  char kind = (char)m_kind;
+  flat.xferChar(kind);
+  flat.xfer_uint32_t(m_cardinality);
+
+  if (flat.reading()) {
+    if (kind != K_ARRAY && kind != K_BITMAP && kind != K_RUN) {
+      xformatsb("CompressedBitmap: invalid container kind " << (int)kind);
+    }
+    if (m_cardinality == 0 || m_cardinality > 65536) {
+      xformatsb("CompressedBitmap: invalid cardinality " <<
+                m_cardinality);
+    }
+    m_kind = (Kind)kind;
+  }
+
+  switch (m_kind) {
+    case K_ARRAY:
+      xferShorts(flat, m_shorts, m_cardinality);
+      break;
+
+    case K_BITMAP:
+      m_words.resize(NUM_WORDS);
+      for (std::uint64_t &w : m_words) {
+        flat.xfer_uint64_t(w);
+      }
+      break;
+
+    case K_RUN: {
+      std::uint32_t runs = (std::uint32_t)numRuns();
+      flat.xfer_uint32_t(runs);
+      if (runs > 32768) {
+        xformatsb("CompressedBitmap: invalid run count " << runs);
+      }
+      xferShorts(flat, m_shorts, runs*2);
+      break;
+    }
+  }
+
+  if (flat.reading()) {
+    // Reject data that would violate the invariants rather than
+    // letting it cause trouble later.
+    try {
+      selfCheck();
+    }
+    catch (XAssert &x) {
+      xformatsb("CompressedBitmap: malformed container: " << x.cond());
+    }
+  }
+}
+
+
+void CompressedBitmap::Container::selfCheck() const
+{
+  switch (m_kind) {
+    case K_ARRAY:
+      xassert(m_words.empty());
+      xassert(m_shorts.size() == m_cardinality);
+      xassert(m_cardinality <= ARRAY_MAX);
+      for (std::size_t i=1; i < m_shorts.size(); i++) {
+        xassert(m_shorts[i-1] < m_shorts[i]);
+      }
+      break;
+
+    case K_BITMAP: {
+      xassert(m_shorts.empty());
+      xassert(m_words.size() == NUM_WORDS);
+      std::uint32_t card = 0;
+      for (std::uint64_t w : m_words) {
+        card += popCount64(w);
+      }
+      xassert(card == m_cardinality);
+      xassert(m_cardinality > ARRAY_MAX);
+      break;
+    }
+
+    case K_RUN: {
+      xassert(m_words.empty());
+      xassert(m_shorts.size() % 2 == 0);
+      std::uint32_t card = 0;
+      for (std::size_t r=0; r < numRuns(); r++) {
+        unsigned first = m_shorts[r*2];
+        unsigned last = m_shorts[r*2+1];
+        xassert(first <= last);
+        if (r > 0) {
+          // Runs are maximal, so there is a gap between them.
+          xassert(m_shorts[r*2-1] + 1u < first);
+        }
+        card += last - first + 1;
+      }
+      xassert(card == m_cardinality);
+      break;
+    }
+  }
+}
+
+
+// -------------------------- CompressedBitmap -------------------------
+CompressedBitmap::CompressedBitmap()
+  : m_keys(),
+    m_containers()
+{}
+
+
+CompressedBitmap::~CompressedBitmap()
+{}
+
+
+CompressedBitmap::CompressedBitmap(CompressedBitmap const &obj)
+  : DMEMB(m_keys),
+    DMEMB(m_containers)
+{}
+
+
+CompressedBitmap::CompressedBitmap(CompressedBitmap &&obj)
+  : MDMEMB(m_keys),
+    MDMEMB(m_containers)
+{}
+
+
+CompressedBitmap &CompressedBitmap::operator=(CompressedBitmap const &obj)
+{
+  if (this != &obj) {
+    CMEMB(m_keys);
+    CMEMB(m_containers);
+  }
+  return *this;
+}
+
+
+CompressedBitmap &CompressedBitmap::operator=(CompressedBitmap &&obj)
+{
+  if (this != &obj) {
+    MCMEMB(m_keys);
+    MCMEMB(m_containers);
+  }
+  return *this;
+}
+
+
+CompressedBitmap::CompressedBitmap(Flatten &)
+  : m_keys(),
+    m_containers()
+{}
+
+
+void CompressedBitmap::xfer(Flatten &flat)
+{
+  std::uint32_t n = (std::uint32_t)m_keys.size();
+  flat.xfer_uint32_t(n);
+
+  if (flat.reading()) {
+    if (n > 65536) {
+      xformatsb("CompressedBitmap: invalid container count " << n);
+    }
+    m_keys.resize(n);
+    m_containers.resize(n);
+  }
+
+  xferShorts(flat, m_keys, n);
+  for (Container &c : m_containers) {
+    c.xfer(flat);
+  }
+
+  if (flat.reading()) {
+    for (std::size_t i=1; i < m_keys.size(); i++) {
+      if (!( m_keys[i-1] < m_keys[i] )) {
+        xformat("CompressedBitmap: keys are not in increasing order");
+      }
+    }
+  }
+}
+
+
+bool CompressedBitmap::operator==(CompressedBitmap const &obj) const
+{
+  if (m_keys != obj.m_keys) {
+    return false;
+  }
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    if (!m_containers[i].equals(obj.m_containers[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+std::size_t CompressedBitmap::findKey(std::uint16_t key) const
+{
+  return std::lower_bound(m_keys.begin(), m_keys.end(), key) -
+         m_keys.begin();
+}
+
+
+void CompressedBitmap::removeEmptyContainers()
+{
+  std::size_t dest = 0;
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    if (m_containers[i].m_cardinality != 0) {
+      if (dest != i) {
+        m_keys[dest] = m_keys[i];
+        m_containers[dest] = std::move(m_containers[i]);
+      }
+      dest++;
+    }
+  }
+  m_keys.resize(dest);
+  m_containers.resize(dest);
+}
+
+
+int CompressedBitmap::test(Value v) const
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::size_t i = findKey(key);
+  return hasKeyAt(i, key) && m_containers[i].contains((std::uint16_t)v);
+}
+
+
+void CompressedBitmap::set(Value v)
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::size_t i = findKey(key);
+  if (!hasKeyAt(i, key)) {
+    m_keys.insert(m_keys.begin() + i, key);
+    m_containers.insert(m_containers.begin() + i, Container());
+  }
+  m_containers[i].add((std::uint16_t)v);
+}
+
+
+void CompressedBitmap::reset(Value v)
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::size_t i = findKey(key);
+  if (hasKeyAt(i, key)) {
+    Container &c = m_containers[i];
+    if (c.remove((std::uint16_t)v) && c.m_cardinality == 0) {
+      m_keys.erase(m_keys.begin() + i);
+      m_containers.erase(m_containers.begin() + i);
+    }
+  }
+}
+
+
+void CompressedBitmap::clearAll()
+{
+  m_keys.clear();
+  m_containers.clear();
+}
+
+
+std::uint64_t CompressedBitmap::count() const
+{
+  std::uint64_t ret = 0;
+  for (Container const &c : m_containers) {
+    ret += c.m_cardinality;
+  }
+  return ret;
+}
+
+
+std::int64_t CompressedBitmap::findNext(Value v) const
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::size_t i = findKey(key);
+  if (hasKeyAt(i, key)) {
+    int low = m_containers[i].nextAtOrAfter(v & 0xFFFF);
+    if (low >= 0) {
+      return ((std::int64_t)key << 16) | low;
+    }
+    i++;
+  }
+
+  if (i < m_keys.size()) {
+    // Every stored container is non-empty.
+    return ((std::int64_t)m_keys[i] << 16) |
+           m_containers[i].nextAtOrAfter(0);
+  }
+  return -1;
+}
+
+
+std::int64_t CompressedBitmap::findPrev(Value v) const
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::size_t i = findKey(key);
+  if (hasKeyAt(i, key)) {
+    int low = m_containers[i].prevAtOrBefore(v & 0xFFFF);
+    if (low >= 0) {
+      return ((std::int64_t)key << 16) | low;
+    }
+  }
+
+  // `i` is now the first container that cannot have the answer.
+  if (i > 0) {
+    i--;
+    return ((std::int64_t)m_keys[i] << 16) |
+           m_containers[i].prevAtOrBefore(65535);
+  }
+  return -1;
+}
+
+
+std::uint64_t CompressedBitmap::rank(Value v) const
+{
+  std::uint16_t key = (std::uint16_t)(v >> 16);
+  std::uint64_t ret = 0;
+  for (std::size_t i=0; i < m_keys.size() && m_keys[i] <= key; i++) {
+    if (m_keys[i] < key) {
+      ret += m_containers[i].m_cardinality;
+    }
+    else {
+      ret += m_containers[i].rank((std::uint16_t)v);
+    }
+  }
+  return ret;
+}
+
+
+CompressedBitmap::Value CompressedBitmap::select(std::uint64_t k) const
+{
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    Container const &c = m_containers[i];
+    if (k < c.m_cardinality) {
+      return ((Value)m_keys[i] << 16) | c.select((std::uint32_t)k);
+    }
+    k -= c.m_cardinality;
+  }
+
+  xfailurePrecondition("select: k is not less than count()");
+}
+
+
+void CompressedBitmap::unionWith(CompressedBitmap const &obj)
+{
+  // Merge the two key sequences.
+  std::vector<std::uint16_t> keys;
+  std::vector<Container> containers;
+  keys.reserve(m_keys.size() + obj.m_keys.size());
+  containers.reserve(m_keys.size() + obj.m_keys.size());
+
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < m_keys.size() || j < obj.m_keys.size()) {
+    if (j == obj.m_keys.size() ||
+        (i < m_keys.size() && m_keys[i] < obj.m_keys[j])) {
+      keys.push_back(m_keys[i]);
+      containers.push_back(std::move(m_containers[i]));
+      i++;
+    }
+    else if (i == m_keys.size() || obj.m_keys[j] < m_keys[i]) {
+      keys.push_back(obj.m_keys[j]);
+      containers.push_back(obj.m_containers[j]);
+      j++;
+    }
+    else {
+      keys.push_back(m_keys[i]);
+      containers.push_back(std::move(m_containers[i]));
+      containers.back().unionWith(obj.m_containers[j]);
+      i++;
+      j++;
+    }
+  }
+
+  m_keys = std::move(keys);
+  m_containers = std::move(containers);
+}
+
+
+void CompressedBitmap::intersectWith(CompressedBitmap const &obj)
+{
+  std::size_t j = 0;
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    while (j < obj.m_keys.size() && obj.m_keys[j] < m_keys[i]) {
+      j++;
+    }
+    if (j < obj.m_keys.size() && obj.m_keys[j] == m_keys[i]) {
+      m_containers[i].intersectWith(obj.m_containers[j]);
+    }
+    else {
+      m_containers[i] = Container();
+    }
+  }
+  removeEmptyContainers();
+}
+
+
+void CompressedBitmap::differenceWith(CompressedBitmap const &obj)
+{
+  std::size_t j = 0;
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    while (j < obj.m_keys.size() && obj.m_keys[j] < m_keys[i]) {
+      j++;
+    }
+    if (j < obj.m_keys.size() && obj.m_keys[j] == m_keys[i]) {
+      m_containers[i].differenceWith(obj.m_containers[j]);
+    }
+  }
+  removeEmptyContainers();
+}
+
+
+bool CompressedBitmap::anyIntersection(CompressedBitmap const &obj) const
+{
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < m_keys.size() && j < obj.m_keys.size()) {
+    if (m_keys[i] < obj.m_keys[j]) {
+      i++;
+    }
+    else if (obj.m_keys[j] < m_keys[i]) {
+      j++;
+    }
+    else {
+      if (m_containers[i].intersects(obj.m_containers[j])) {
+        return true;
+      }
+      i++;
+      j++;
+    }
+  }
+  return false;
+}
+
+
+void CompressedBitmap::optimize()
+{
+  for (Container &c : m_containers) {
+    c.optimize();
+  }
+}
+
+
+std::size_t CompressedBitmap::memoryUsage() const
+{
+  std::size_t ret = m_keys.capacity() * sizeof(std::uint16_t) +
+                    m_containers.capacity() * sizeof(Container);
+  for (Container const &c : m_containers) {
+    ret += c.memoryUsage();
+  }
+  return ret;
+}
+
+
+void CompressedBitmap::selfCheck() const
+{
+  xassert(m_keys.size() == m_containers.size());
+  for (std::size_t i=0; i < m_keys.size(); i++) {
+    if (i > 0) {
+      xassert(m_keys[i-1] < m_keys[i]);
+    }
+    xassert(m_containers[i].m_cardinality > 0);
+    m_containers[i].selfCheck();
+  }
+}
+
+
+// ------------------------------- Iter --------------------------------
+CompressedBitmap::Iter::Iter(CompressedBitmap const &set)
+  : m_set(set),
+    m_containerIndex(0),
+    m_low(0)
+{
+  if (!isDone()) {
+    m_low = m_set.m_containers[0].nextAtOrAfter(0);
+  }
+}
+
+
+CompressedBitmap::Value CompressedBitmap::Iter::data() const
+{
+  xassertPrecondition(!isDone());
+  return ((Value)m_set.m_keys[m_containerIndex] << 16) | (Value)m_low;
+}
+
+
+void CompressedBitmap::Iter::adv()
+{
+  xassertPrecondition(!isDone());
+
+  m_low = m_set.m_containers[m_containerIndex].nextAtOrAfter(m_low+1);
+  if (m_low < 0) {
+    m_containerIndex++;
+    if (!isDone()) {
+      m_low = m_set.m_containers[m_containerIndex].nextAtOrAfter(0);
+    }
+  }
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+// EOF
@@ -0,0 +1,299 @@
+// compressed-bitmap.h
+// `CompressedBitmap`, a compressed set of 32-bit unsigned integers.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_COMPRESSED_BITMAP_H
+#define SMBASE_COMPRESSED_BITMAP_H
+
+#include "flatten-fwd.h"               // Flatten [n]
+#include "sm-macros.h"                 // OPEN_NAMESPACE
+
+#include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::{int64_t, uint16_t, uint32_t, uint64_t}
+#include <vector>                      // std::vector
+
+
+OPEN_NAMESPACE(smbase)
+
+
+/* Set of 32-bit unsigned integers that is stored compactly when the
+   members are sparse or clustered.  This is a variant of the "Roaring"
+   bitmap (Lemire et al., https://roaringbitmap.org/).
+
+   The value space is divided into chunks of 2**16 values that share
+   their high 16 bits.  Only non-empty chunks are stored, each in one of
+   three kinds of container:
+
+     * array: the sorted low 16 bits of each member, used when the
+       chunk has at most `ARRAY_MAX` members;
+
+     * bitmap: one bit for each of the 2**16 values, used when the
+       chunk has more members than that; and
+
+     * run: the sorted maximal ranges of members, used when `optimize`
+       finds that to be smaller than the alternatives.
+
+   Consequently, a set of a few thousand values drawn from a universe
+   of hundreds of millions takes a few bytes per member, whereas
+   `BitArray` would need tens of megabytes.
+
+   The interface follows `BitArray` (bitarray.h) so callers can switch
+   between them, except that there is no fixed length, and counts are
+   64-bit since there can be 2**32 members.
+*/
+class CompressedBitmap {
+public:      // types
+  // A potential member of the set.
+  typedef std::uint32_t Value;
+
+  // Largest number of members stored in an array container.
+  enum { ARRAY_MAX = 4096 };
+
+private:     // types
+  // The members within one chunk, identified by their low 16 bits.
+  class Container {
+  public:      // types
+    enum Kind : unsigned char {
+      K_ARRAY,
+      K_BITMAP,
+      K_RUN,
+    };
+
+    // Number of words in a bitmap container.
+    enum { NUM_WORDS = 65536 / 64 };
+
+  public:      // data
+    // Which representation is in use.
+    Kind m_kind;
+
+    // Number of members.  This is in [1,65536] for a container stored
+    // in a `CompressedBitmap`.
+    std::uint32_t m_cardinality;
+
+    // For K_ARRAY, the members in increasing order.  For K_RUN, a
+    // sequence of pairs (first,last) of maximal runs of members, in
+    // increasing order.  Otherwise empty.
+    std::vector<std::uint16_t> m_shorts;
+
+    // For K_BITMAP, `NUM_WORDS` words, where member `v` is bit `v%64` of
+    // word `v/64`.  Otherwise empty.
+    std::vector<std::uint64_t> m_words;
+
+  private:     // methods
+    // Number of runs in the K_RUN representation.
+    std::size_t numRuns() const { return m_shorts.size() / 2; }
+
+    // Index of the run containing `v`, or of the first run after it.
+    std::size_t findRun(std::uint16_t v) const;
+
+    // Replace the contents with the members in `arr` or `words`,
+    // choosing between an array or bitmap.
+    void setFromArray(std::vector<std::uint16_t> &&arr);
+    void setFromWords(std::vector<std::uint64_t> &&words);
+
+    // Convert a run container to an array or bitmap so it can be
+    // modified a member at a time.
+    void expandRuns();
+
+    // Move the members into `words` as a bitmap, taking `m_words`
+    // rather than copying it when this is a bitmap container.  The
+    // caller must then store a result with `setFromWords`.
+    void takeWords(std::vector<std::uint64_t> &words);
+
+    // The `NUM_WORDS` words of `c`.  Those of a bitmap container are
+    // used directly; others are built in `temp`.
+    static std::uint64_t const *wordsOf(Container const &c,
+                                        std::vector<std::uint64_t> &temp);
+
+  public:      // methods
+    Container();
+
+    // Get the members as an array or a bitmap, regardless of the
+    // current representation.
+    void getArray(std::vector<std::uint16_t> &arr) const;
+    void getWords(std::vector<std::uint64_t> &words) const;
+
+    bool contains(std::uint16_t v) const;
+
+    // Add or remove `v`, returning true if that changed the set.
+    bool add(std::uint16_t v);
+    bool remove(std::uint16_t v);
+
+    // Least member `>= v`, or -1 if none.  `v` is in [0,65536].
+    int nextAtOrAfter(std::uint32_t v) const;
+
+    // Greatest member `<= v`, or -1 if none.  `v` is in [-1,65535].
+    int prevAtOrBefore(int v) const;
+
+    // Number of members `<= v`.
+    std::uint32_t rank(std::uint16_t v) const;
+
+    // The member with `k` members below it.  Requires
+    // `k < m_cardinality`.
+    std::uint16_t select(std::uint32_t k) const;
+
+    // Set operations.  These leave the result in an array or bitmap.
+    void unionWith(Container const &obj);
+    void intersectWith(Container const &obj);
+    void differenceWith(Container const &obj);
+    bool intersects(Container const &obj) const;
+
+    bool equals(Container const &obj) const;
+
+    // Switch to whichever representation is smallest.
+    void optimize();
+
+    // Bytes of heap storage used.
+    std::size_t memoryUsage() const;
+
+    void xfer(Flatten &flat);
+
+    void selfCheck() const;
+  };
+
+private:     // data
+  // High 16 bits of the values in each stored chunk, in increasing
+  // order.
+  std::vector<std::uint16_t> m_keys;
+
+  // Members of the chunk whose key is at the same index in `m_keys`.
+  // Each is non-empty.
+  std::vector<Container> m_containers;
+
+private:     // methods
+  // Index of the container for `key`, or of where it would be inserted.
+  std::size_t findKey(std::uint16_t key) const;
+
+  // True if `m_containers[i]` exists and has key `key`.
+  bool hasKeyAt(std::size_t i, std::uint16_t key) const
+    { return i < m_keys.size() && m_keys[i] == key; }
+
+  // Remove the containers that have become empty.
+  void removeEmptyContainers();
+
+public:      // methods
+  // Empty set.
+  CompressedBitmap();
+  ~CompressedBitmap();
+
+  CompressedBitmap(CompressedBitmap const &obj);
+  CompressedBitmap(CompressedBitmap &&obj);
+  CompressedBitmap &operator=(CompressedBitmap const &obj);
+  CompressedBitmap &operator=(CompressedBitmap &&obj);
+
+  // Serialization.  As with `BitArray`, construct with the `Flatten`
+  // and then call `xfer`.
+  explicit CompressedBitmap(Flatten &flat);
+  void xfer(Flatten &flat);
+
+  bool operator==(CompressedBitmap const &obj) const;
+  bool operator!=(CompressedBitmap const &obj) const
+    { return !operator==(obj); }
+
+  // Test membership of `v`, returning 0 or 1.
+  int test(Value v) const;
+
+  // Add or remove `v`.
+  void set(Value v);
+  void reset(Value v);
+
+  // Add `v` if `val` is true, otherwise remove it.
+  void setTo(Value v, int val)
+    { if (val) { set(v); } else { reset(v); } }
+
+  // Remove all members.
+  void clearAll();
+
+  // Number of members.
+  std::uint64_t count() const;
+
+  // True if there are no members.
+  bool isEmpty() const
+    { return m_keys.empty(); }
+
+  // Least member `>= v`, or -1 if there is none.
+  std::int64_t findNext(Value v) const;
+
+  // Greatest member `<= v`, or -1 if there is none.
+  std::int64_t findPrev(Value v) const;
+
+  // Number of members `<= v`.
+  std::uint64_t rank(Value v) const;
+
+  // The member with `k` members below it.  Requires `k < count()`.
+  Value select(std::uint64_t k) const;
+
+  // Set union, intersection and difference, in place.
+  void unionWith(CompressedBitmap const &obj);
+  void intersectWith(CompressedBitmap const &obj);
+  void differenceWith(CompressedBitmap const &obj);
+
+  // True if some value is a member of both sets.
+  bool anyIntersection(CompressedBitmap const &obj) const;
+
+  // Convert each chunk to its smallest representation, including run
+  // containers.  This is worth calling after building a set that has
+  // long runs of consecutive members.  Adding or removing a single
+  // member converts a run container back to an array or bitmap.
+  void optimize();
+
+  // Approximate number of bytes of heap storage used.
+  std::size_t memoryUsage() const;
+
+  // Number of non-empty chunks.
+  std::size_t numContainers() const
+    { return m_keys.size(); }
+
+  // Assert invariants.
+  void selfCheck() const;
+
+  // Operators.
+  CompressedBitmap &operator|=(CompressedBitmap const &obj)
+    { unionWith(obj); return *this; }
+  CompressedBitmap &operator&=(CompressedBitmap const &obj)
+    { intersectWith(obj); return *this; }
+  CompressedBitmap &operator-=(CompressedBitmap const &obj)
+    { differenceWith(obj); return *this; }
+
+  CompressedBitmap operator|(CompressedBitmap const &obj) const
+    { CompressedBitmap ret(*this); ret.unionWith(obj); return ret; }
+  CompressedBitmap operator&(CompressedBitmap const &obj) const
+    { CompressedBitmap ret(*this); ret.intersectWith(obj); return ret; }
+  CompressedBitmap operator-(CompressedBitmap const &obj) const
+    { CompressedBitmap ret(*this); ret.differenceWith(obj); return ret; }
+
+public:      // types
+  // Iterate over the members in increasing order.  The set must not be
+  // modified during iteration.
+  class Iter {
+  private:     // data
+    // Set being iterated over.
+    CompressedBitmap const &m_set;
+
+    // Index of the current container.  This equals the number of
+    // containers when iteration is done.
+    std::size_t m_containerIndex;
+
+    // Low 16 bits of the current member.
+    int m_low;
+
+  public:      // methods
+    explicit Iter(CompressedBitmap const &set);
+
+    bool isDone() const
+      { return m_containerIndex >= m_set.m_keys.size(); }
+
+    // Current member.  Requires `!isDone()`.
+    Value data() const;
+
+    void adv();
+  };
+  friend class Iter;
+};
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_COMPRESSED_BITMAP_H
@@ -0,0 +1,391 @@
+// concurrent-object-pool-ops.h
+// Operations for `concurrent-object-pool` module.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_CONCURRENT_OBJECT_POOL_OPS_H
+#define SMBASE_CONCURRENT_OBJECT_POOL_OPS_H
+
+#include "concurrent-object-pool.h"    // interface for this module
+
+#include "smbase/div-up.h"             // round_up
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/xassert.h"            // xassert, xassertPrecondition
+
+#include <utility>                     // std::swap
+
+
+OPEN_NAMESPACE(smbase)
+
+
+template <class T>
+ConcurrentObjectPool<T>::ConcurrentObjectPool(int rackSize,
+                                              int magazineSize)
+  : m_magazineSize(magazineSize),
+    m_objectsPerRack(0),
+    m_rackBytes(0),
+    m_ownersOffset(0),
+    m_objectsOffset(0),
+    m_caches(),
+    m_overflowCache(),
+    m_overflowMutex(),
+    m_fullDepot(),
+    m_emptyDepot(),
+    m_magazineChunks(),
+    m_numMagazines(0),
+    m_racks(nullptr),
+    m_numRacks(0),
+    m_growMutex()
+{
+  xassertPrecondition(rackSize > 0);
+  xassertPrecondition(magazineSize > 0);
+
+  typedef std::atomic<std::uint16_t> Owner;
+  m_ownersOffset = round_up(sizeof(RackHeader), alignof(Owner));
+
+  // Size of a rack with room for exactly `rackSize` objects.
+  std::size_t minBytes =
+    round_up(m_ownersOffset + rackSize * sizeof(Owner), alignof(T)) +
+    rackSize * sizeof(T);
+
+  m_rackBytes = alignof(T) > alignof(RackHeader)? alignof(T) : alignof(RackHeader);
+  while (m_rackBytes < minBytes) {
+    m_rackBytes *= 2;
+  }
+
+  // Use all of the space in the rack.
+  m_objectsPerRack = (int)
+    ((m_rackBytes - m_ownersOffset - (alignof(T)-1)) /
+     (sizeof(Owner) + sizeof(T)));
+  xassert(m_objectsPerRack >= rackSize);
+  m_objectsOffset = round_up(m_ownersOffset + m_objectsPerRack * sizeof(Owner),
+                             alignof(T));
+  xassert(m_objectsOffset + m_objectsPerRack * sizeof(T) <= m_rackBytes);
+}
+
+
+template <class T>
+ConcurrentObjectPool<T>::~ConcurrentObjectPool()
+{
+  GENERIC_CATCH_BEGIN
+
+  while (m_racks) {
+    RackHeader *rack = m_racks;
+    m_racks = rack->m_next;
+
+    unsigned char *base = reinterpret_cast<unsigned char*>(rack);
+    T *objects = reinterpret_cast<T*>(base + m_objectsOffset);
+    for (int i=0; i < m_objectsPerRack; i++) {
+      objects[i].~T();
+    }
+    ::operator delete(base, std::align_val_t(m_rackBytes));
+  }
+
+  for (std::atomic<Magazine*> &chunk : m_magazineChunks) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+
+  GENERIC_CATCH_END
+}
+
+
+template <class T>
+typename ConcurrentObjectPool<T>::Magazine *
+ConcurrentObjectPool<T>::magazineAt(std::uint32_t index) const
+{
+  Magazine *chunk =
+    m_magazineChunks[index / MAGAZINE_CHUNK_SIZE].load(std::memory_order_acquire);
+  return chunk + index % MAGAZINE_CHUNK_SIZE;
+}
+
+
+template <class T>
+typename ConcurrentObjectPool<T>::Magazine *
+ConcurrentObjectPool<T>::newMagazineLocked()
+{
+  std::uint32_t index = m_numMagazines.load(std::memory_order_relaxed);
+  std::uint32_t chunkIndex = index / MAGAZINE_CHUNK_SIZE;
+  if (chunkIndex >= MAX_MAGAZINE_CHUNKS) {
+    xfailure("ConcurrentObjectPool: too many magazines");
+  }
+
+  Magazine *chunk =
+    m_magazineChunks[chunkIndex].load(std::memory_order_relaxed);
+  if (!chunk) {
+    chunk = new Magazine[MAGAZINE_CHUNK_SIZE];
+    for (int i=0; i < MAGAZINE_CHUNK_SIZE; i++) {
+      chunk[i].m_index = chunkIndex * MAGAZINE_CHUNK_SIZE + i;
+    }
+    m_magazineChunks[chunkIndex].store(chunk, std::memory_order_release);
+  }
+
+  m_numMagazines.store(index+1, std::memory_order_relaxed);
+  return chunk + index % MAGAZINE_CHUNK_SIZE;
+}
+
+
+template <class T>
+typename ConcurrentObjectPool<T>::Magazine *
+ConcurrentObjectPool<T>::newMagazine()
+{
+  std::lock_guard<std::mutex> guard(m_growMutex);
+  return newMagazineLocked();
+}
+
+
+template <class T>
+void ConcurrentObjectPool<T>::pushDepot(Depot &depot, Magazine *mag)
+{
+  std::uint64_t oldHead = depot.m_head.load(std::memory_order_relaxed);
+  std::uint64_t newHead;
+  do {
+    mag->m_nextInDepot.store((std::uint32_t)oldHead,
+                             std::memory_order_relaxed);
+    newHead = (((oldHead >> 32) + 1) << 32) | (mag->m_index + 1);
+  } while (!depot.m_head.compare_exchange_weak(
+             oldHead, newHead,
+             std::memory_order_release, std::memory_order_relaxed));
+
+  depot.m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+template <class T>
+typename ConcurrentObjectPool<T>::Magazine *
+ConcurrentObjectPool<T>::popDepot(Depot &depot)
+{
+  std::uint64_t oldHead = depot.m_head.load(std::memory_order_acquire);
+  while (std::uint32_t top = (std::uint32_t)oldHead) {
+    // `mag` may be popped and reused by another thread while we look
+    // at it, in which case the CAS fails, since the head's counter
+    // will have changed.
+    Magazine *mag = magazineAt(top - 1);
+    std::uint32_t next = mag->m_nextInDepot.load(std::memory_order_relaxed);
+    std::uint64_t newHead = (((oldHead >> 32) + 1) << 32) | next;
+    if (depot.m_head.compare_exchange_weak(
+          oldHead, newHead,
+          std::memory_order_acquire, std::memory_order_acquire)) {
+      depot.m_count.fetch_sub(1, std::memory_order_relaxed);
+      return mag;
+    }
+  }
+  return nullptr;
+}
+
+
+template <class T>
+typename ConcurrentObjectPool<T>::Magazine *
+ConcurrentObjectPool<T>::grow()
+{
+  std::lock_guard<std::mutex> guard(m_growMutex);
+
+  unsigned char *base = static_cast<unsigned char*>(
+    ::operator new(m_rackBytes, std::align_val_t(m_rackBytes)));
+  RackHeader *rack = new (base) RackHeader;
+  rack->m_next = m_racks;
+  m_racks = rack;
+
+  typedef std::atomic<std::uint16_t> Owner;
+  Owner *owners = reinterpret_cast<Owner*>(base + m_ownersOffset);
+  T *objects = reinterpret_cast<T*>(base + m_objectsOffset);
+  for (int i=0; i < m_objectsPerRack; i++) {
+    new (owners+i) Owner(0);
+    new (objects+i) T();
+  }
+
+  // Distribute the objects into magazines, keeping the first.  The
+  // objects are pushed in reverse so they are allocated in order.
+  Magazine *first = nullptr;
+  for (int end = m_objectsPerRack; end > 0; end -= m_magazineSize) {
+    Magazine *mag = newMagazineLocked();
+    int begin = end > m_magazineSize? end - m_magazineSize : 0;
+    for (int i = end-1; i >= begin; i--) {
+      mag->push(objects+i);
+    }
+
+    if (begin == 0) {
+      first = mag;
+    }
+    else {
+      pushDepot(m_fullDepot, mag);
+    }
+  }
+
+  m_numRacks.fetch_add(1, std::memory_order_relaxed);
+  return first;
+}
+
+
+template <class T>
+std::atomic<std::uint16_t> &ConcurrentObjectPool<T>::ownerOf(T *obj) const
+{
+  std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(obj);
+  unsigned char *base =
+    reinterpret_cast<unsigned char*>(addr & ~(std::uintptr_t)(m_rackBytes-1));
+  std::size_t index =
+    (reinterpret_cast<unsigned char*>(obj) - (base + m_objectsOffset)) /
+    sizeof(T);
+  return reinterpret_cast<std::atomic<std::uint16_t>*>
+           (base + m_ownersOffset)[index];
+}
+
+
+template <class T>
+void ConcurrentObjectPool<T>::refill(Cache &cache)
+{
+  if (cache.m_previous && cache.m_previous->m_count > 0) {
+    std::swap(cache.m_loaded, cache.m_previous);
+    return;
+  }
+
+  Magazine *full = popDepot(m_fullDepot);
+  if (!full) {
+    full = grow();
+  }
+
+  // Both magazines are empty (or missing); give one back.
+  if (cache.m_previous) {
+    pushDepot(m_emptyDepot, cache.m_previous);
+  }
+  cache.m_previous = cache.m_loaded;
+  cache.m_loaded = full;
+}
+
+
+template <class T>
+void ConcurrentObjectPool<T>::makeRoom(Cache &cache)
+{
+  if (cache.m_previous && cache.m_previous->m_count < m_magazineSize) {
+    std::swap(cache.m_loaded, cache.m_previous);
+    return;
+  }
+
+  Magazine *empty = popDepot(m_emptyDepot);
+  if (!empty) {
+    empty = newMagazine();
+  }
+
+  // Both magazines are full (or missing); give one back.
+  if (cache.m_previous) {
+    pushDepot(m_fullDepot, cache.m_previous);
+  }
+  cache.m_previous = cache.m_loaded;
+  cache.m_loaded = empty;
+}
+
+
+template <class T>
+T *ConcurrentObjectPool<T>::allocFrom(Cache &cache, int owner)
+{
+  if (!cache.m_loaded || cache.m_loaded->m_count == 0) {
+    refill(cache);
+  }
+
+  T *ret = cache.m_loaded->pop();
+  ownerOf(ret).store((std::uint16_t)owner, std::memory_order_relaxed);
+
+  #ifndef NDEBUG
+    ret->nextInFreeList = NULL;        // paranoia
+  #endif
+
+  return ret;
+}
+
+
+template <class T>
+void ConcurrentObjectPool<T>::deallocTo(Cache &cache, int owner, T *obj)
+{
+  if (ownerOf(obj).load(std::memory_order_relaxed) != owner) {
+    // Only this thread writes the counter, so it need not be an atomic
+    // increment.
+    cache.m_crossThreadFrees.store(
+      cache.m_crossThreadFrees.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  }
+
+  if (!cache.m_loaded || cache.m_loaded->m_count == m_magazineSize) {
+    makeRoom(cache);
+  }
+  cache.m_loaded->push(obj);
+}
+
+
+template <class T>
+long ConcurrentObjectPool<T>::numCrossThreadFrees() const
+{
+  long ret = m_overflowCache.m_crossThreadFrees.load(std::memory_order_relaxed);
+  for (Cache const &cache : m_caches) {
+    ret += cache.m_crossThreadFrees.load(std::memory_order_relaxed);
+  }
+  return ret;
+}
+
+
+template <class T>
+long ConcurrentObjectPool<T>::freeObjectsInPool() const
+{
+  long ret = 0;
+
+  auto countCache = [&ret](Cache const &cache) {
+    if (cache.m_loaded) {
+      ret += cache.m_loaded->m_count;
+    }
+    if (cache.m_previous) {
+      ret += cache.m_previous->m_count;
+    }
+  };
+  for (Cache const &cache : m_caches) {
+    countCache(cache);
+  }
+  countCache(m_overflowCache);
+
+  std::uint32_t top = (std::uint32_t)m_fullDepot.m_head.load();
+  while (top) {
+    Magazine const *mag = magazineAt(top-1);
+    ret += mag->m_count;
+    top = mag->m_nextInDepot.load();
+  }
+
+  return ret;
+}
+
+
+template <class T>
+void ConcurrentObjectPool<T>::selfCheck() const
+{
+  // Every magazine's count matches its list.
+  std::uint32_t numMags = m_numMagazines.load();
+  for (std::uint32_t i=0; i < numMags; i++) {
+    Magazine const *mag = magazineAt(i);
+    xassert(0 <= mag->m_count && mag->m_count <= m_magazineSize);
+    int ct = 0;
+    for (T const *p = mag->m_head; p; p = p->nextInFreeList) {
+      ct++;
+    }
+    xassert(ct == mag->m_count);
+  }
+
+  // The depots have the right magazines and counts.
+  auto checkDepot = [this](Depot const &depot, bool full) {
+    int ct = 0;
+    std::uint32_t top = (std::uint32_t)depot.m_head.load();
+    while (top) {
+      Magazine const *mag = magazineAt(top-1);
+      xassert(full? mag->m_count == m_magazineSize : mag->m_count == 0);
+      ct++;
+      top = mag->m_nextInDepot.load();
+    }
+    xassert(ct == depot.m_count.load());
+  };
+  checkDepot(m_fullDepot, true);
+  checkDepot(m_emptyDepot, false);
+
+  // Free objects cannot exceed the total.
+  xassert(freeObjectsInPool() <= numObjects());
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_CONCURRENT_OBJECT_POOL_OPS_H
@@ -0,0 +1,262 @@
+// concurrent-object-pool-test.cc
+// Tests for `concurrent-object-pool` module.
+
+// This file is in the public domain.
+
+#include "smbase/concurrent-object-pool-ops.h"  // module under test
+
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "smbase/sm-random.h"          // sm_random
+#include "smbase/sm-test.h"            // DIAG, EXPECT_EQ, VPVAL
+#include "smbase/xassert.h"            // xassert
+
+#include <atomic>                      // std::atomic
+#include <thread>                      // std::thread
+#include <vector>                      // std::vector
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Class we're going to make a pool of.
+class Foo {
+public:
+  union {
+    Foo *nextInFreeList;               // for ConcurrentObjectPool
+    int x;
+  };
+  int y;
+  int z;
+
+  // Number of times `deinit` has been called, across all objects.
+  static std::atomic<long> s_deinits;
+
+public:
+  Foo() : nextInFreeList(nullptr), y(0), z(0) {}
+
+  void establishInvariant(int index)
+  {
+    x = index;
+    y = x+1;
+    z = y+1;
+  }
+
+  void checkInvariant(int index) const
+  {
+    xassert(x == index);
+    xassert(y == x+1);
+    xassert(z == y+1);
+  }
+
+  void deinit()
+  {
+    s_deinits.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+std::atomic<long> Foo::s_deinits(0);
+
+
+typedef ConcurrentObjectPool<Foo> Pool;
+
+
+// Allocate and deallocate at random on one thread, as in
+// objpool-test.cc.
+void testSingleThread()
+{
+  DIAG("---- testSingleThread ----");
+
+  enum { BIG=1000, ITERS=20000 };
+
+  Pool pool(30, 8 /*magazineSize*/);
+  long deinits = Foo::s_deinits;
+
+  std::vector<Foo*> allocated(BIG, nullptr);
+  int numAllocated = 0;
+  smbase_loopi(ITERS) {
+    int index = sm_random(BIG);
+    Foo *&f = allocated[index];
+
+    if (f) {
+      f->checkInvariant(index);
+      pool.dealloc(f);
+      f = nullptr;
+      numAllocated--;
+    }
+    else {
+      f = pool.alloc();
+      f->establishInvariant(index);
+      numAllocated++;
+    }
+
+    if (i % 1000 == 0) {
+      pool.selfCheck();
+      EXPECT_EQ(pool.freeObjectsInPool() + numAllocated,
+                pool.numObjects());
+    }
+  }
+
+  for (int index=0; index < BIG; index++) {
+    if (Foo *f = allocated[index]) {
+      f->checkInvariant(index);
+      pool.dealloc(f);
+    }
+  }
+  pool.selfCheck();
+  EXPECT_EQ(pool.freeObjectsInPool(), pool.numObjects());
+
+  // Every object was freed by the thread that allocated it.
+  EXPECT_EQ(pool.numCrossThreadFrees(), 0);
+  xassert(Foo::s_deinits - deinits > ITERS/4);
+
+  // Racks fill their (power of 2) size, so they may hold more than
+  // asked for.
+  xassert(pool.objectsPerRack() >= 30);
+  xassert(pool.numRacks() >= (BIG/2) / pool.objectsPerRack());
+
+  VPVAL(pool.numRacks());
+  VPVAL(pool.objectsPerRack());
+  VPVAL(pool.numMagazines());
+  VPVAL(pool.numFullInDepot());
+  VPVAL(pool.numEmptyInDepot());
+}
+
+
+// Objects allocated by one thread are reused, not leaked, after being
+// freed by another, and racks are only added when needed.
+void testRackGrowth()
+{
+  DIAG("---- testRackGrowth ----");
+
+  Pool pool(100, 16);
+  EXPECT_EQ(pool.numRacks(), 0);
+
+  Foo *f = pool.alloc();
+  EXPECT_EQ(pool.numRacks(), 1);
+  pool.deallocNoDeinit(f);
+
+  // Allocating the whole rack does not need another.
+  int n = pool.objectsPerRack();
+  std::vector<Foo*> objs;
+  smbase_loopi(n) {
+    objs.push_back(pool.alloc());
+  }
+  EXPECT_EQ(pool.numRacks(), 1);
+  EXPECT_EQ(pool.freeObjectsInPool(), 0);
+
+  // One more does.
+  objs.push_back(pool.alloc());
+  EXPECT_EQ(pool.numRacks(), 2);
+
+  // Free them all on another thread.
+  std::thread thr([&pool, &objs]() {
+    for (Foo *obj : objs) {
+      pool.deallocNoDeinit(obj);
+    }
+  });
+  thr.join();
+  EXPECT_EQ(pool.numCrossThreadFrees(), (long)objs.size());
+  pool.selfCheck();
+
+  // They come back here through the depot, except for what is left in
+  // the other thread's two magazines.
+  smbase_loopi((int)objs.size() - 2*16) {
+    objs[i] = pool.alloc();
+  }
+  EXPECT_EQ(pool.numRacks(), 2);
+  pool.selfCheck();
+}
+
+
+// Several producer threads allocate objects and hand them to consumer
+// threads, which check and free them.
+void testProducerConsumer()
+{
+  DIAG("---- testProducerConsumer ----");
+
+  enum { PAIRS=4, PER_THREAD=20000, BATCH=50 };
+
+  Pool pool(64, 16);
+
+  // Each producer fills a batch and publishes it through `m_batch`.
+  struct Channel {
+    std::atomic<Foo**> m_batch{nullptr};
+  };
+  std::vector<Channel> channels(PAIRS);
+
+  std::vector<std::thread> threads;
+  for (int p=0; p < PAIRS; p++) {
+    Channel &ch = channels[p];
+
+    threads.emplace_back([&pool, &ch, p]() {
+      for (int sent=0; sent < PER_THREAD; sent += BATCH) {
+        Foo **batch = new Foo*[BATCH];
+        for (int j=0; j < BATCH; j++) {
+          batch[j] = pool.alloc();
+          batch[j]->establishInvariant(p*PER_THREAD + sent + j);
+        }
+
+        // Also do some thread-local churn.
+        Foo *tmp = pool.alloc();
+        pool.dealloc(tmp);
+
+        Foo **expected = nullptr;
+        while (!ch.m_batch.compare_exchange_weak(
+                 expected, batch, std::memory_order_release)) {
+          expected = nullptr;
+          std::this_thread::yield();
+        }
+      }
+    });
+
+    threads.emplace_back([&pool, &ch, p]() {
+      int received = 0;
+      while (received < PER_THREAD) {
+        Foo **batch = ch.m_batch.exchange(nullptr, std::memory_order_acquire);
+        if (!batch) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (int j=0; j < BATCH; j++) {
+          batch[j]->checkInvariant(p*PER_THREAD + received + j);
+          pool.dealloc(batch[j]);
+        }
+        delete[] batch;
+        received += BATCH;
+      }
+    });
+  }
+
+  for (std::thread &thr : threads) {
+    thr.join();
+  }
+
+  // Every object came back.
+  pool.selfCheck();
+  EXPECT_EQ(pool.freeObjectsInPool(), pool.numObjects());
+  EXPECT_EQ(pool.numCrossThreadFrees(), (long)PAIRS * PER_THREAD);
+
+  // Freed objects were recycled rather than causing growth.
+  xassert(pool.numObjects() < (long)PAIRS * PER_THREAD / 4);
+
+  VPVAL(pool.numRacks());
+  VPVAL(pool.numMagazines());
+  VPVAL(pool.numCrossThreadFrees());
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_concurrent_object_pool()
+{
+  testSingleThread();
+  testRackGrowth();
+  testProducerConsumer();
+}
+
+
+// EOF
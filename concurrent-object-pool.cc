@@ -0,0 +1,98 @@
+// concurrent-object-pool.cc
+// Code for `concurrent-object-pool` module.
+
+// This file is in the public domain.
+
+#include "concurrent-object-pool.h"    // this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, OPEN_ANONYMOUS_NAMESPACE
+
+#include <mutex>                       // std::{mutex, lock_guard}
+#include <vector>                      // std::vector
+
+
+OPEN_NAMESPACE(smbase)
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Process-wide record of which thread slots are in use.
+struct SlotRegistry {
+  // Protects the other members.
+  std::mutex m_mutex;
+
+  // Slots that were used by threads that have exited.
+  std::vector<int> m_freeSlots;
+
+  // Number of slots that have ever been handed out.
+  int m_numSlots = 0;
+};
+
+
+// Get the registry.  It is never destroyed, since threads can exit
+// during static destruction.
+SlotRegistry &slotRegistry()
+{
+  static SlotRegistry *registry = new SlotRegistry;
+  return *registry;
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Pools used by the thread after its slot is released, by other
+// thread-exit destructors, treat it as having no slot.
+struct ConcurrentObjectPoolBase::SlotReleaser {
+  int m_slot;
+
+  explicit SlotReleaser(int slot) : m_slot(slot) {}
+
+  ~SlotReleaser();
+};
+
+
+thread_local int ConcurrentObjectPoolBase::s_threadSlot = -2;
+
+
+ConcurrentObjectPoolBase::SlotReleaser::~SlotReleaser()
+{
+  ConcurrentObjectPoolBase::s_threadSlot = -1;
+
+  SlotRegistry &registry = slotRegistry();
+  std::lock_guard<std::mutex> guard(registry.m_mutex);
+  registry.m_freeSlots.push_back(m_slot);
+}
+
+
+STATICDEF int ConcurrentObjectPoolBase::assignThreadSlot()
+{
+  int slot = -1;
+  {
+    SlotRegistry &registry = slotRegistry();
+    std::lock_guard<std::mutex> guard(registry.m_mutex);
+    if (!registry.m_freeSlots.empty()) {
+      slot = registry.m_freeSlots.back();
+      registry.m_freeSlots.pop_back();
+    }
+    else if (registry.m_numSlots < MAX_THREAD_SLOTS) {
+      slot = registry.m_numSlots++;
+    }
+  }
+
+  if (slot >= 0) {
+    // Arrange for the slot to be released at thread exit.
+    static thread_local SlotReleaser releaser(slot);
+    (void)releaser;
+  }
+
+  s_threadSlot = slot;
+  return slot;
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+// EOF
@@ -0,0 +1,358 @@
+// concurrent-object-pool.h
+// ConcurrentObjectPool, a thread-safe variant of ObjectPool with
+// per-thread caches of free objects.
+
+// This file is in the public domain.
+
+// Design:
+//
+// Free objects are grouped into "magazines" of up to `magazineSize`
+// objects each, linked through `nextInFreeList` as in ObjectPool.
+// Each thread has two magazines, "loaded" and "previous", and `alloc`
+// and `dealloc` normally just pop from or push onto the loaded one
+// without any synchronization.  When the loaded magazine is empty (on
+// `alloc`) or full (on `dealloc`), the thread swaps it with the
+// previous one if that helps, and otherwise exchanges a magazine with
+// the global depot, which holds stacks of full and empty magazines.
+// This is the scheme of Bonwick and Adams, "Magazines and Vmem"
+// (USENIX 2001).
+//
+// The depot stacks are lock-free (Treiber stacks).  Their heads hold a
+// magazine index and a counter that changes with every update, which
+// prevents the ABA problem.  Magazines are never freed before the pool
+// is, so it is safe to read a magazine that another thread has just
+// popped.
+//
+// Only growth, which allocates a rack of objects or a chunk of
+// magazines, takes a lock.
+//
+// A rack is a block aligned to its own (power of 2) size, so the rack
+// containing an object can be found by masking its address.  Besides
+// the objects, the rack records which thread most recently allocated
+// each object, so frees from other threads can be counted.
+//
+// Threads are identified by small "slot" numbers, which are reused
+// after threads exit.  A thread that reuses a slot also inherits the
+// cached magazines.  Beyond MAX_THREAD_SLOTS concurrent threads, the
+// extra threads share one cache protected by a mutex.
+
+#ifndef SMBASE_CONCURRENT_OBJECT_POOL_H
+#define SMBASE_CONCURRENT_OBJECT_POOL_H
+
+#include "smbase/exc.h"                // GENERIC_CATCH_{BEGIN,END}
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, NO_OBJECT_COPIES, NULLABLE
+#include "smbase/xassert.h"            // xassert, xassertPrecondition
+
+#include <atomic>                      // std::atomic
+#include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::{uint16_t, uint32_t, uint64_t, uintptr_t}
+#include <mutex>                       // std::{mutex, lock_guard}
+#include <new>                         // std::align_val_t, placement new
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Parts of ConcurrentObjectPool that do not depend on the object type.
+class ConcurrentObjectPoolBase {
+public:      // types
+  enum {
+    // Maximum number of threads that get their own cache.
+    MAX_THREAD_SLOTS = 256,
+  };
+
+private:     // types
+  // Releases a thread's slot when the thread exits.
+  struct SlotReleaser;
+
+private:     // data
+  // Slot number of the calling thread, or -1 if it has none, or -2 if
+  // one has not been assigned yet.
+  static thread_local int s_threadSlot;
+
+private:     // funcs
+  // Assign a slot to the calling thread, and return it.
+  static int assignThreadSlot();
+
+public:      // funcs
+  // Return the calling thread's slot number, in [0,MAX_THREAD_SLOTS),
+  // or -1 if all slots are in use.
+  static int threadSlot()
+  {
+    int slot = s_threadSlot;
+    if (slot == -2) {
+      slot = assignThreadSlot();
+    }
+    return slot;
+  }
+};
+
+
+// The class T must have the same members that ObjectPool requires:
+//
+//   // a link in the free list; it is ok for T to re-use this
+//   // member while the object is not free in the pool
+//   T *nextInFreeList;
+//
+//   // object is done being used for now
+//   void deinit();
+//
+//   // objects are default-constructed when the pool grows
+//   T::T();
+template <class T>
+class ConcurrentObjectPool : public ConcurrentObjectPoolBase {
+  NO_OBJECT_COPIES(ConcurrentObjectPool);
+
+private:     // types
+  // A group of free objects.
+  struct Magazine {
+    // Free objects, linked by `nextInFreeList`.
+    T * NULLABLE m_head;
+
+    // Number of objects in the list.
+    int m_count;
+
+    // Index of this magazine, for `magazineAt`.
+    std::uint32_t m_index;
+
+    // While in a depot stack, one plus the index of the next magazine
+    // in the stack, or 0 at the bottom.
+    std::atomic<std::uint32_t> m_nextInDepot;
+
+    Magazine()
+      : m_head(nullptr),
+        m_count(0),
+        m_index(0),
+        m_nextInDepot(0)
+    {}
+
+    void push(T *obj)
+    {
+      obj->nextInFreeList = m_head;
+      m_head = obj;
+      m_count++;
+    }
+
+    T *pop()
+    {
+      T *ret = m_head;
+      m_head = ret->nextInFreeList;
+      m_count--;
+      return ret;
+    }
+  };
+
+  // Lock-free stack of magazines.
+  struct Depot {
+    // Low 32 bits: one plus the index of the top magazine, or 0 if
+    // the stack is empty.  High 32 bits: number of updates, mod 2^32.
+    std::atomic<std::uint64_t> m_head;
+
+    // Number of magazines in the stack, for statistics.
+    std::atomic<int> m_count;
+
+    Depot() : m_head(0), m_count(0) {}
+  };
+
+  // Per-thread state.  Only the thread with the corresponding slot
+  // uses `m_loaded` and `m_previous`.  It is aligned to avoid false
+  // sharing between threads.
+  struct alignas(64) Cache {
+    // Magazine that `alloc` and `dealloc` use.
+    Magazine * NULLABLE m_loaded;
+
+    // Another magazine, which is full or empty.
+    Magazine * NULLABLE m_previous;
+
+    // Number of objects freed by this thread that were allocated by
+    // another.  Written only by the owning thread.
+    std::atomic<long> m_crossThreadFrees;
+
+    Cache()
+      : m_loaded(nullptr),
+        m_previous(nullptr),
+        m_crossThreadFrees(0)
+    {}
+  };
+
+  // Header at the start of each rack.  It is followed by an array of
+  // owner slots, one per object, and then the objects.
+  struct RackHeader {
+    // Next rack in the list of all racks.
+    RackHeader * NULLABLE m_next;
+  };
+
+  enum {
+    // Magazines are allocated in chunks of this many.
+    MAGAZINE_CHUNK_SIZE = 256,
+
+    // Maximum number of chunks.
+    MAX_MAGAZINE_CHUNKS = 4096,
+
+    // Owner recorded for objects allocated by threads without slots.
+    OVERFLOW_OWNER = MAX_THREAD_SLOTS + 1,
+  };
+
+private:     // data
+  // Maximum number of objects in a magazine.
+  int const m_magazineSize;
+
+  // Number of objects in each rack.  This is at least the `rackSize`
+  // passed to the constructor, and includes any that fit in the space
+  // left by rounding the rack size up to a power of 2.
+  int m_objectsPerRack;
+
+  // Size and alignment of each rack.
+  std::size_t m_rackBytes;
+
+  // Offsets of the owner array and the objects in a rack.
+  std::size_t m_ownersOffset;
+  std::size_t m_objectsOffset;
+
+  // Per-thread caches, indexed by slot.
+  Cache m_caches[MAX_THREAD_SLOTS];
+
+  // Cache shared by threads without slots, and its lock.
+  Cache m_overflowCache;
+  std::mutex m_overflowMutex;
+
+  // Magazines that are full, and ones that are empty.
+  Depot m_fullDepot;
+  Depot m_emptyDepot;
+
+  // Chunks of magazines.  Once set, an element does not change until
+  // the pool is destroyed.
+  std::atomic<Magazine*> m_magazineChunks[MAX_MAGAZINE_CHUNKS];
+
+  // Number of magazines made so far.
+  std::atomic<std::uint32_t> m_numMagazines;
+
+  // List of all racks.  Protected by `m_growMutex`.
+  RackHeader * NULLABLE m_racks;
+
+  // Number of racks.
+  std::atomic<int> m_numRacks;
+
+  // Held while adding racks or magazines.
+  std::mutex m_growMutex;
+
+private:     // funcs
+  // Magazine with `index`, which must have been made.
+  Magazine *magazineAt(std::uint32_t index) const;
+
+  // Make a new magazine.  `m_growMutex` must be held.
+  Magazine *newMagazineLocked();
+
+  // Make a new, empty magazine.
+  Magazine *newMagazine();
+
+  void pushDepot(Depot &depot, Magazine *mag);
+  Magazine * NULLABLE popDepot(Depot &depot);
+
+  // Add a rack, putting its objects into magazines, and return one of
+  // those magazines, which is full.  The others go into the depot.
+  Magazine *grow();
+
+  // Owner slot entry for `obj`.
+  std::atomic<std::uint16_t> &ownerOf(T *obj) const;
+
+  // Implementation of `alloc` and `deallocNoDeinit` using `cache`,
+  // for a thread whose owner number is `owner`.
+  T *allocFrom(Cache &cache, int owner);
+  void deallocTo(Cache &cache, int owner, T *obj);
+
+  // Make `cache.m_loaded` non-empty, or non-full.
+  void refill(Cache &cache);
+  void makeRoom(Cache &cache);
+
+public:      // funcs
+  // Each rack has room for at least `rackSize` objects, and each
+  // magazine holds at most `magazineSize`.
+  explicit ConcurrentObjectPool(int rackSize, int magazineSize = 64);
+
+  // Destroys all of the objects.  No other thread may be using the
+  // pool, and objects allocated from it must not be used afterward.
+  ~ConcurrentObjectPool();
+
+  // Yield a pointer to an object ready to be used, as with
+  // ObjectPool::alloc.  Objects do not move once allocated.
+  inline T *alloc();
+
+  // Return an object to the pool, after calling `obj->deinit()`.  The
+  // object can have been allocated by any thread.
+  inline void dealloc(T *obj);
+
+  // Same as `dealloc`, but without calling `deinit`.
+  inline void deallocNoDeinit(T *obj);
+
+  // ---- Statistics.  Values are approximate if other threads are
+  // using the pool concurrently.
+
+  // Number of racks, and the objects in them.
+  int numRacks() const { return m_numRacks.load(std::memory_order_relaxed); }
+  long numObjects() const { return (long)numRacks() * m_objectsPerRack; }
+  int objectsPerRack() const { return m_objectsPerRack; }
+
+  // Number of magazines made.
+  int numMagazines() const
+    { return (int)m_numMagazines.load(std::memory_order_relaxed); }
+
+  // Number of full and empty magazines in the depot.
+  int numFullInDepot() const
+    { return m_fullDepot.m_count.load(std::memory_order_relaxed); }
+  int numEmptyInDepot() const
+    { return m_emptyDepot.m_count.load(std::memory_order_relaxed); }
+
+  // Number of objects freed by a thread other than the one that
+  // allocated them.
+  long numCrossThreadFrees() const;
+
+  // Number of free objects in the pool.  No other thread may be using
+  // the pool.
+  long freeObjectsInPool() const;
+
+  // Check invariants.  No other thread may be using the pool.
+  void selfCheck() const;
+};
+
+
+// ---------------------------- inline code ----------------------------
+template <class T>
+inline T *ConcurrentObjectPool<T>::alloc()
+{
+  int slot = threadSlot();
+  if (slot >= 0) {
+    return allocFrom(m_caches[slot], slot+1);
+  }
+
+  std::lock_guard<std::mutex> guard(m_overflowMutex);
+  return allocFrom(m_overflowCache, OVERFLOW_OWNER);
+}
+
+
+template <class T>
+inline void ConcurrentObjectPool<T>::deallocNoDeinit(T *obj)
+{
+  int slot = threadSlot();
+  if (slot >= 0) {
+    deallocTo(m_caches[slot], slot+1, obj);
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(m_overflowMutex);
+  deallocTo(m_overflowCache, OVERFLOW_OWNER, obj);
+}
+
+
+template <class T>
+inline void ConcurrentObjectPool<T>::dealloc(T *obj)
+{
+  obj->deinit();
+  deallocNoDeinit(obj);
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_CONCURRENT_OBJECT_POOL_H
@@ -0,0 +1,162 @@
+// crc-file-test.cc
+// Tests for crc-file.
+
+// This file is in the public domain.
+
+#include "crc-file.h"                  // module under test
+
+#include "crc.h"                       // crc32
+#include "exc.h"                       // EXN_CONTEXT_EXPR, XMessage
+#include "sm-file-util.h"              // SMFileUtil
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // DIAG, EXPECT_EQ
+#include "syserr.h"                    // XSysError
+#include "xassert.h"                   // xassert, xfailure
+
+#include <cstdint>                     // std::{uint32_t, uint64_t}
+#include <vector>                      // std::vector
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+void testOneFile(std::size_t size)
+{
+  EXN_CONTEXT_EXPR(size);
+
+  std::vector<unsigned char> bytes(size);
+  for (unsigned char &b : bytes) {
+    b = (unsigned char)sm_random(256);
+  }
+
+  SMFileUtil sfu;
+  string fname = "test.dir/crc-file.bin";
+  sfu.writeFile(fname, bytes);
+  std::uint32_t expect = crc32(bytes.data(), bytes.size());
+
+  for (std::size_t chunkSize : {1, 7, 64, 1000, 65536}) {
+    if (chunkSize == 1 && size > 1000) {
+      // One-byte chunks are covered by the small files, and are slow.
+      continue;
+    }
+
+    for (unsigned numThreads : {0, 1, 3}) {
+      std::uint64_t lastReported = 0;
+      int calls = 0;
+      CRC32FileOptions options;
+      options.setChunkSize(chunkSize)
+             .setNumThreads(numThreads)
+             .setProgress([&](std::uint64_t done, std::uint64_t total) {
+               EXPECT_EQ(total, size);
+               xassert(done <= total);
+               xassert(calls == 0 || done > lastReported);
+               lastReported = done;
+               calls++;
+             });
+
+      EXPECT_EQ(crc32File(fname, options), expect);
+      EXPECT_EQ(lastReported, size);
+      xassert(calls >= 1);
+    }
+  }
+
+  sfu.removeFile(fname);
+}
+
+
+void testMissingFile()
+{
+  try {
+    crc32File("test.dir/nonexistent-crc-file.bin");
+    xfailure("should have failed");
+  }
+  catch (XSysError &x) {
+    EXPECT_EQ(x.reason, XSysError::R_FILE_NOT_FOUND);
+  }
+}
+
+
+// An exception thrown by the progress callback reaches the caller.
+void testThrowingProgress()
+{
+  SMFileUtil sfu;
+  string fname = "test.dir/crc-file.bin";
+  sfu.writeFile(fname, std::vector<unsigned char>(10000, 'x'));
+
+  // Thrown by the callback.
+  struct ProgressStop {};
+
+  for (unsigned numThreads : {1, 3}) {
+    EXN_CONTEXT_EXPR(numThreads);
+
+    int calls = 0;
+    CRC32FileOptions options;
+    options.setChunkSize(100)
+           .setNumThreads(numThreads)
+           .setProgress([&](std::uint64_t, std::uint64_t) {
+             calls++;
+             throw ProgressStop();
+           });
+
+    try {
+      crc32File(fname, options);
+      xfailure("should have failed");
+    }
+    catch (ProgressStop &) {
+      EXPECT_EQ(calls, 1);
+    }
+  }
+
+  sfu.removeFile(fname);
+}
+
+
+// Truncating the file after the first chunk makes the next read come
+// up short.
+void testShrinkingFile()
+{
+  SMFileUtil sfu;
+  string fname = "test.dir/crc-file.bin";
+  sfu.writeFile(fname, std::vector<unsigned char>(100000, 'x'));
+
+  CRC32FileOptions options;
+  options.setChunkSize(1000)
+         .setNumThreads(1)
+         .setProgress([&](std::uint64_t done, std::uint64_t) {
+           if (done == 1000) {
+             sfu.writeFile(fname, std::vector<unsigned char>(10, 'x'));
+           }
+         });
+
+  try {
+    crc32File(fname, options);
+    xfailure("should have failed");
+  }
+  catch (XMessage &x) {
+    DIAG("expected: " << x.what());
+  }
+
+  sfu.removeFile(fname);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_crc_file()
+{
+  testOneFile(0);
+  testOneFile(1);
+  testOneFile(999);
+  testOneFile(200000);
+  testMissingFile();
+  testThrowingProgress();
+  testShrinkingFile();
+}
+
+
+// EOF
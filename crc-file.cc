@@ -0,0 +1,316 @@
+// crc-file.cc
+// Code for crc-file.h.
+
+// This file is in the public domain.
+
+#include "smbase/crc-file.h"           // this module
+
+#include "smbase/crc.h"                // crc32, CRC32Context
+#include "smbase/exc.h"                // smbase::xmessage
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, OPEN_ANONYMOUS_NAMESPACE
+#include "smbase/sm-platform.h"        // PLATFORM_IS_WINDOWS
+#include "smbase/stringb.h"            // stringb
+#include "smbase/syserr.h"             // smbase::xsyserror
+#include "smbase/xassert.h"            // xassertPrecondition
+
+#include <algorithm>                   // std::min
+#include <atomic>                      // std::atomic
+#include <condition_variable>          // std::condition_variable
+#include <exception>                   // std::{exception_ptr, current_exception, rethrow_exception}
+#include <mutex>                       // std::{mutex, lock_guard, unique_lock}
+#include <thread>                      // std::thread
+#include <vector>                      // std::vector
+
+#if PLATFORM_IS_WINDOWS
+#  include <stdio.h>                   // FILE, fopen, _fseeki64, _ftelli64, fread
+#else
+#  include <errno.h>                   // errno, EINTR
+#  include <fcntl.h>                   // open
+#  include <sys/stat.h>                // fstat
+#  include <unistd.h>                  // pread, close
+#endif
+
+
+OPEN_NAMESPACE(smbase)
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Read-only access to a file at arbitrary offsets, usable from several
+// threads at once.
+class PositionedReader {
+private:     // data
+  // Name of the file, for error messages.
+  std::string m_fname;
+
+#if PLATFORM_IS_WINDOWS
+  // Windows has no `pread`, so reads are serialized on one handle.
+  FILE *m_fp;
+  std::mutex m_mutex;
+#else
+  int m_fd;
+#endif
+
+  // Size of the file when it was opened.
+  std::uint64_t m_size;
+
+public:      // methods
+  explicit PositionedReader(std::string const &fname);
+  ~PositionedReader();
+
+  std::uint64_t size() const { return m_size; }
+
+  // Read exactly `len` bytes at `offset` into `buf`.
+  void readAt(std::uint64_t offset, unsigned char *buf, std::size_t len);
+
+  // Complain that the file ended early.
+  void xshrank() const NORETURN;
+};
+
+
+void PositionedReader::xshrank() const
+{
+  xmessage(stringb("crc32File: " << m_fname <<
+                   " got shorter while being read"));
+}
+
+
+#if PLATFORM_IS_WINDOWS
+
+PositionedReader::PositionedReader(std::string const &fname)
+  : m_fname(fname),
+    m_fp(fopen(fname.c_str(), "rb")),
+    m_mutex(),
+    m_size(0)
+{
+  if (!m_fp) {
+    xsyserror("fopen", fname);
+  }
+  if (_fseeki64(m_fp, 0, SEEK_END) != 0) {
+    fclose(m_fp);
+    xsyserror("fseek", fname);
+  }
+  m_size = _ftelli64(m_fp);
+}
+
+
+PositionedReader::~PositionedReader()
+{
+  fclose(m_fp);
+}
+
+
+void PositionedReader::readAt(std::uint64_t offset, unsigned char *buf,
+                              std::size_t len)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  if (_fseeki64(m_fp, offset, SEEK_SET) != 0) {
+    xsyserror("fseek", m_fname);
+  }
+  if (fread(buf, 1, len, m_fp) != len) {
+    if (ferror(m_fp)) {
+      xsyserror("read", m_fname);
+    }
+    xshrank();
+  }
+}
+
+#else // !PLATFORM_IS_WINDOWS
+
+PositionedReader::PositionedReader(std::string const &fname)
+  : m_fname(fname),
+    m_fd(open(fname.c_str(), O_RDONLY)),
+    m_size(0)
+{
+  if (m_fd < 0) {
+    xsyserror("open", fname);
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) < 0) {
+    int e = errno;
+    close(m_fd);
+    errno = e;
+    xsyserror("fstat", fname);
+  }
+  m_size = st.st_size;
+}
+
+
+PositionedReader::~PositionedReader()
+{
+  close(m_fd);
+}
+
+
+void PositionedReader::readAt(std::uint64_t offset, unsigned char *buf,
+                              std::size_t len)
+{
+  while (len > 0) {
+    ssize_t n = pread(m_fd, buf, len, (off_t)offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      xsyserror("pread", m_fname);
+    }
+    if (n == 0) {
+      xshrank();
+    }
+
+    buf += n;
+    offset += n;
+    len -= n;
+  }
+}
+
+#endif // !PLATFORM_IS_WINDOWS
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+std::uint32_t crc32File(std::string const &fname,
+                        CRC32FileOptions const &options)
+{
+  xassertPrecondition(options.m_chunkSize > 0);
+
+  PositionedReader reader(fname);
+  std::uint64_t const totalBytes = reader.size();
+  std::size_t const chunkSize = options.m_chunkSize;
+  std::uint64_t const numChunks = (totalBytes + chunkSize - 1) / chunkSize;
+
+  unsigned numThreads = options.m_numThreads;
+  if (numThreads == 0) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+  if (numThreads > numChunks) {
+    numThreads = (unsigned)numChunks;
+  }
+  if (numThreads == 0) {
+    numThreads = 1;
+  }
+
+  // CRC of each chunk, merged at the end.
+  std::vector<std::uint32_t> chunkCRCs(numChunks);
+
+  // Index of the next chunk to claim.
+  std::atomic<std::uint64_t> nextChunk(0);
+
+  // Set to make the workers stop early.
+  std::atomic<bool> stop(false);
+
+  // State shared with the calling thread, protected by `mutex`.
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::uint64_t chunksDone = 0;
+  std::uint64_t bytesDone = 0;
+  std::exception_ptr error;
+
+  auto worker = [&](bool reportProgress) {
+    std::vector<unsigned char> buf(
+      (std::size_t)std::min<std::uint64_t>(chunkSize, totalBytes));
+
+    while (!stop) {
+      std::uint64_t i = nextChunk++;
+      if (i >= numChunks) {
+        break;
+      }
+      std::uint64_t offset = i * chunkSize;
+      std::size_t len =
+        (std::size_t)std::min<std::uint64_t>(chunkSize, totalBytes - offset);
+
+      try {
+        reader.readAt(offset, buf.data(), len);
+        chunkCRCs[i] = crc32(buf.data(), len);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        stop = true;
+        changed.notify_all();
+        return;
+      }
+
+      std::uint64_t newBytesDone;
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        chunksDone++;
+        newBytesDone = (bytesDone += len);
+      }
+      changed.notify_all();
+
+      if (reportProgress && options.m_progress &&
+          newBytesDone < totalBytes) {
+        options.m_progress(newBytesDone, totalBytes);
+      }
+    }
+  };
+
+  if (numThreads == 1) {
+    // Everything happens on this thread, so exceptions propagate
+    // normally.
+    worker(true /*reportProgress*/);
+  }
+  else {
+    std::vector<std::thread> threads;
+    try {
+      for (unsigned t=0; t < numThreads; t++) {
+        threads.emplace_back(worker, false /*reportProgress*/);
+      }
+
+      // Report progress until the workers are done or one fails.
+      std::unique_lock<std::mutex> lock(mutex);
+      std::uint64_t reported = 0;
+      while (chunksDone < numChunks && !error) {
+        changed.wait(lock);
+        if (options.m_progress && bytesDone != reported &&
+            bytesDone < totalBytes) {
+          reported = bytesDone;
+          lock.unlock();
+          options.m_progress(reported, totalBytes);
+          lock.lock();
+        }
+      }
+    }
+    catch (...) {
+      // Thread creation or the progress callback failed.
+      stop = true;
+      for (std::thread &t : threads) {
+        t.join();
+      }
+      throw;
+    }
+
+    for (std::thread &t : threads) {
+      t.join();
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  // Merge the chunk CRCs in file order.
+  CRC32Context ctx;
+  for (std::uint64_t i=0; i < numChunks; i++) {
+    std::uint64_t offset = i * chunkSize;
+    ctx.combine(chunkCRCs[i],
+      (std::size_t)std::min<std::uint64_t>(chunkSize, totalBytes - offset));
+  }
+
+  if (options.m_progress) {
+    options.m_progress(totalBytes, totalBytes);
+  }
+
+  return ctx.get();
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+// EOF
@@ -0,0 +1,80 @@
+// crc-file.h
+// `crc32File`, computing the CRC of a file with multiple threads.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_CRC_FILE_H
+#define SMBASE_CRC_FILE_H
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+
+#include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::{uint32_t, uint64_t}
+#include <functional>                  // std::function
+#include <string>                      // std::string
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Options for `crc32File`.
+class CRC32FileOptions {
+public:      // types
+  // Signature of a progress callback.  It receives the number of bytes
+  // whose CRC has been computed so far and the size of the file.
+  typedef std::function<void (std::uint64_t bytesDone,
+                              std::uint64_t totalBytes)> ProgressFunc;
+
+public:      // data
+  // Number of bytes read and hashed as a unit.  This must be positive.
+  // Initially 8 MiB.
+  std::size_t m_chunkSize;
+
+  // Number of worker threads.  Zero means to use
+  // `std::thread::hardware_concurrency()`.  With one thread, all work
+  // happens on the calling thread.  Initially 0.
+  unsigned m_numThreads;
+
+  // If set, called on the calling thread as chunks finish, and once
+  // more at the end with `bytesDone == totalBytes`.  Initially empty.
+  ProgressFunc m_progress;
+
+public:      // methods
+  CRC32FileOptions()
+    : m_chunkSize(8 << 20),
+      m_numThreads(0),
+      m_progress()
+  {}
+
+  // Chainable setters.
+  CRC32FileOptions &setChunkSize(std::size_t n)
+    { m_chunkSize = n; return *this; }
+  CRC32FileOptions &setNumThreads(unsigned n)
+    { m_numThreads = n; return *this; }
+  CRC32FileOptions &setProgress(ProgressFunc f)
+    { m_progress = f; return *this; }
+};
+
+
+/* Return `crc32` (crc.h) of the contents of `fname`.
+
+   The file is read in chunks of `options.m_chunkSize` bytes using
+   positioned reads, so threads do not contend for a file offset.  Each
+   worker thread holds one chunk at a time, so memory use is bounded by
+   `m_numThreads * m_chunkSize` regardless of the file size.  The
+   per-chunk CRCs are merged with `crc32_combine`, giving the same
+   result as a sequential pass.
+
+   Throws `XSysError` if the file cannot be opened or read, and
+   `XMessage` if it gets shorter while being read.  An exception thrown
+   by the progress callback propagates after the workers have stopped.
+*/
+std::uint32_t crc32File(
+  std::string const &fname,
+  CRC32FileOptions const &options = CRC32FileOptions());
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_CRC_FILE_H
@@ -3,15 +3,23 @@
 
 #include "crc.h"                       // module under test
 
-#include "sm-test.h"                   // tprintf
+#include "nonport.h"                   // getMilliseconds
+#include "sm-macros.h"                 // smbase_loopi
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // tprintf, EXPECT_EQ
+#include "xassert.h"                   // xassert
+
+#include <vector>                      // std::vector
 
 #include <assert.h>                    // assert
 #include <errno.h>                     // errno
 #include <stdint.h>                    // uint32_t
 #include <stdio.h>                     // FILE, etc.
-#include <stdlib.h>                    // malloc, exit
+#include <stdlib.h>                    // malloc, exit, getenv, atoi
 #include <string.h>                    // strerror
 
+using namespace smbase;
+
 
 static int errors=0;
 
@@ -27,6 +35,121 @@ static void testCrc(unsigned char const *data, int length, uint32_t crc)
 }
 
 
+// Compute the CRC one bit at a time, straight from the definition.
+static uint32_t bitwiseCrc(uint32_t crc, unsigned char const *data,
+                           size_t length)
+{
+  for (size_t i=0; i < length; i++) {
+    crc ^= (uint32_t)data[i] << 24;
+    for (int j=0; j < 8; j++) {
+      crc = (crc & 0x80000000u)? (crc << 1) ^ 0x04C11DB7u : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+
+static std::vector<unsigned char> randomBytes(size_t n)
+{
+  std::vector<unsigned char> ret(n);
+  for (size_t i=0; i < n; i++) {
+    ret[i] = (unsigned char)sm_random(256);
+  }
+  return ret;
+}
+
+
+// Compare all the ways of computing the CRC on random data.
+static void testRandom()
+{
+  tprintf("crc32_using_clmul: %d\n", (int)crc32_using_clmul());
+
+  std::vector<unsigned char> buf = randomBytes(2000);
+
+  // Every length up to 300 (covering the transitions between the
+  // 16- and 64-byte paths) at every alignment mod 16.
+  for (size_t len=0; len <= 300; len++) {
+    size_t offset = len % 16;
+    unsigned char const *p = buf.data() + offset;
+    uint32_t start = (len & 1)? CRC32_INITIAL : (uint32_t)sm_random(1 << 30);
+
+    uint32_t expect = bitwiseCrc(start, p, len);
+    EXPECT_EQ(crc32_update(start, p, len), expect);
+    EXPECT_EQ(crc32_update_tables(start, p, len), expect);
+  }
+  EXPECT_EQ(crc32(buf.data(), buf.size()),
+            bitwiseCrc(CRC32_INITIAL, buf.data(), buf.size()));
+
+  // Feed the data in random pieces.
+  smbase_loopi(20) {
+    CRC32Context ctx;
+    size_t pos = 0;
+    while (pos < buf.size()) {
+      size_t n = sm_random(300);
+      if (n > buf.size() - pos) {
+        n = buf.size() - pos;
+      }
+      ctx.update(buf.data() + pos, n);
+      pos += n;
+    }
+    EXPECT_EQ(ctx.get(), crc32(buf.data(), buf.size()));
+  }
+}
+
+
+// Split data at random places, compute the CRCs of the pieces, and
+// combine them.
+static void testCombine()
+{
+  std::vector<unsigned char> buf = randomBytes(5000);
+  uint32_t expect = crc32(buf.data(), buf.size());
+
+  smbase_loopi(50) {
+    size_t split = sm_random((int)buf.size() + 1);
+    uint32_t a = crc32(buf.data(), split);
+    uint32_t b = crc32(buf.data() + split, buf.size() - split);
+    EXPECT_EQ(crc32_combine(a, b, buf.size() - split), expect);
+
+    CRC32Context ctx;
+    ctx.update(buf.data(), split);
+    ctx.combine(b, buf.size() - split);
+    EXPECT_EQ(ctx.get(), expect);
+  }
+
+  // Appending nothing changes nothing.
+  EXPECT_EQ(crc32_combine(expect, crc32(NULL, 0), 0), expect);
+}
+
+
+// Compare speeds, if CRC_PERF is set to a number of megabytes.
+static void perfTest()
+{
+  char const *mbStr = getenv("CRC_PERF");
+  if (!mbStr) {
+    return;
+  }
+  size_t len = (size_t)atoi(mbStr) << 20;
+  std::vector<unsigned char> buf = randomBytes(len);
+
+  long start = getMilliseconds();
+  uint32_t bytewise = bitwiseCrc(CRC32_INITIAL, buf.data(), len);
+  long bitMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  uint32_t tables = crc32_update_tables(CRC32_INITIAL, buf.data(), len);
+  long tableMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  uint32_t best = crc32(buf.data(), len);
+  long bestMs = getMilliseconds() - start;
+
+  xassert(bytewise == tables && tables == best);
+  printf("crc32 of %d MB: bitwise %ld ms, tables %ld ms, crc32 %ld ms "
+         "(clmul=%d)\n",
+         atoi(mbStr), bitMs, tableMs, bestMs, (int)crc32_using_clmul());
+}
+
+
 // Called from unit-tests.cc.
 void test_crc()
 {
@@ -100,6 +223,10 @@ void test_crc()
   testCrc(pkt_data3, 44, 0xbf671ed0);
   testCrc(pkt_data4, 44, 0xacba602a);
 
+  testRandom();
+  testCombine();
+  perfTest();
+
   if (errors) {
     exit(2);
   }
@@ -3,7 +3,20 @@
 
 #include "crc.h"                       // this module
 
-#include <stdint.h>                    // uint32_t
+#include <stddef.h>                    // size_t
+#include <stdint.h>                    // uint32_t, uint64_t
+
+// Carry-less multiplication is available on x86 with GCC and Clang,
+// which let us compile it into a function that is only called once
+// CPUID says the instructions exist.
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+  #define CRC_HAVE_CLMUL 1
+  #include <immintrin.h>               // _mm_clmulepi64_si128, etc.
+  #include <type_traits>               // std::integral_constant
+#else
+  #define CRC_HAVE_CLMUL 0
+#endif
 
 // originally was:
 /* crc32h.c -- package to compute 32-bit CRC one byte at a time using   */
@@ -42,43 +55,294 @@
 
 #define POLYNOMIAL 0x04c11db7L
 
-static uint32_t crc_table[256];
-
-void gen_crc_table()
- /* generate the table of CRC remainders for all possible bytes */
- { int i, j;  uint32_t crc_accum;
-   for ( i = 0;  i < 256;  i++ )
-       { crc_accum = ( (uint32_t) i << 24 );
-         for ( j = 0;  j < 8;  j++ )
-              { if ( crc_accum & 0x80000000L )
-                   crc_accum =
-                     ( crc_accum << 1 ) ^ POLYNOMIAL;
-                else
-                   crc_accum =
-                     ( crc_accum << 1 ); }
-         crc_table[i] = crc_accum; }
-   return; }
-
-uint32_t update_crc(uint32_t crc_accum, char const *data_blk_ptr,
-                                        int data_blk_size)
- /* update the CRC on the data block one byte at a time */
- { int i, j;
-   for ( j = 0;  j < data_blk_size;  j++ )
-       { i = ( (int) ( crc_accum >> 24) ^ *data_blk_ptr++ ) & 0xff;
-         crc_accum = ( crc_accum << 8 ) ^ crc_table[i]; }
-   return crc_accum; }
 
+// SM: Rather than generating one table lazily, generate 16 of them at
+// compile time.  'table[k][b]' is the CRC, starting from 0, of byte 'b'
+// followed by 'k' zero bytes.  That allows processing 16 bytes with 16
+// independent lookups ("slicing-by-16").
+struct CRCTables {
+  uint32_t table[16][256];
+};
 
-// SM: block-level application
-static int made_table = 0;
-uint32_t crc32(unsigned char const *data, int length)
+static constexpr CRCTables makeCRCTables()
+{
+  CRCTables ret{};
+
+  // this is what 'gen_crc_table' originally did
+  for (int i=0; i < 256; i++) {
+    uint32_t crc_accum = (uint32_t)i << 24;
+    for (int j=0; j < 8; j++) {
+      if (crc_accum & 0x80000000u) {
+        crc_accum = (crc_accum << 1) ^ POLYNOMIAL;
+      }
+      else {
+        crc_accum = (crc_accum << 1);
+      }
+    }
+    ret.table[0][i] = crc_accum;
+  }
+
+  // each further table appends one zero byte
+  for (int k=1; k < 16; k++) {
+    for (int i=0; i < 256; i++) {
+      uint32_t prev = ret.table[k-1][i];
+      ret.table[k][i] = (prev << 8) ^ ret.table[0][prev >> 24];
+    }
+  }
+
+  return ret;
+}
+
+static constexpr CRCTables crcTables = makeCRCTables();
+
+
+// Update the CRC on the data block one byte at a time.
+static inline uint32_t update_crc_bytes(uint32_t crc,
+  unsigned char const *data, size_t length)
+{
+  uint32_t const *t0 = crcTables.table[0];
+  for (size_t j=0; j < length; j++) {
+    crc = (crc << 8) ^ t0[((crc >> 24) ^ data[j]) & 0xff];
+  }
+  return crc;
+}
+
+
+uint32_t crc32_update_tables(uint32_t crc, unsigned char const *data,
+                             size_t length)
+{
+  uint32_t const (*t)[256] = crcTables.table;
+
+  while (length >= 16) {
+    // The CRC so far is combined with the first four bytes, which the
+    // most significant bit first convention makes a big-endian load.
+    uint32_t c = crc ^ (((uint32_t)data[0] << 24) |
+                        ((uint32_t)data[1] << 16) |
+                        ((uint32_t)data[2] << 8) |
+                        ((uint32_t)data[3]));
+    crc = t[15][c >> 24] ^
+          t[14][(c >> 16) & 0xff] ^
+          t[13][(c >> 8) & 0xff] ^
+          t[12][c & 0xff] ^
+          t[11][data[4]] ^
+          t[10][data[5]] ^
+          t[9][data[6]] ^
+          t[8][data[7]] ^
+          t[7][data[8]] ^
+          t[6][data[9]] ^
+          t[5][data[10]] ^
+          t[4][data[11]] ^
+          t[3][data[12]] ^
+          t[2][data[13]] ^
+          t[1][data[14]] ^
+          t[0][data[15]];
+    data += 16;
+    length -= 16;
+  }
+
+  return update_crc_bytes(crc, data, length);
+}
+
+
+// ------------------------- polynomial arithmetic -------------------------
+// The CRC of a message M (as a polynomial with the first bit as the
+// highest coefficient) starting from state S is
+//
+//   (S * x^(8*len) + M * x^32) mod P
+//
+// where P is x^32 plus POLYNOMIAL.  These helpers work with residues
+// mod P represented as 32-bit integers, bit i being the coefficient of
+// x^i.
+
+// Return 'a * b mod P'.
+static uint32_t mulModP(uint32_t a, uint32_t b)
+{
+  uint64_t prod = 0;
+  for (int i=0; i < 32; i++) {
+    if (b & ((uint32_t)1 << i)) {
+      prod ^= (uint64_t)a << i;
+    }
+  }
+
+  for (int i=63; i >= 32; i--) {
+    if (prod & ((uint64_t)1 << i)) {
+      prod ^= ((uint64_t)1 << i) | ((uint64_t)POLYNOMIAL << (i-32));
+    }
+  }
+  return (uint32_t)prod;
+}
+
+
+// Return 'x^(8*n) mod P'.
+static uint32_t xPow8nModP(size_t n)
+{
+  uint32_t ret = 1;
+  uint32_t base = 0x100;               // x^8
+  while (n) {
+    if (n & 1) {
+      ret = mulModP(ret, base);
+    }
+    base = mulModP(base, base);
+    n >>= 1;
+  }
+  return ret;
+}
+
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t length2)
+{
+  // 'crc2' includes the contribution of the initial value, which must
+  // be replaced with that of 'crc1'.
+  return crc2 ^ mulModP(crc1 ^ CRC32_INITIAL, xPow8nModP(length2));
+}
+
+
+// ------------------------ carry-less multiplication ------------------------
+#if CRC_HAVE_CLMUL
+
+// Return 'x^n mod P'.
+static constexpr uint32_t xPowModP(int n)
 {
-  if (!made_table) {
-    gen_crc_table();
-    made_table = 1;
+  uint64_t r = 1;
+  for (int i=0; i < n; i++) {
+    r <<= 1;
+    if (r & ((uint64_t)1 << 32)) {
+      r ^= ((uint64_t)1 << 32) | POLYNOMIAL;
+    }
+  }
+  return (uint32_t)r;
+}
+
+
+// Constants for multiplying a 128-bit value by x^d: the high half holds
+// x^(d+64) mod P and the low half x^d mod P.
+#define FOLD_CONSTANTS(d) \
+  _mm_set_epi64x(std::integral_constant<uint32_t, xPowModP((d)+64)>::value, \
+                 std::integral_constant<uint32_t, xPowModP(d)>::value)
+
+
+#define CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+// Load 16 bytes as a polynomial, the first bit being coefficient 127.
+CLMUL_TARGET
+static inline __m128i loadBlock(unsigned char const *p)
+{
+  __m128i const reverse =
+    _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  return _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)p), reverse);
+}
+
+
+// Return a value congruent to 'v * x^d' mod P, where 'k' is
+// FOLD_CONSTANTS(d).  Each 64-bit half is multiplied by a 32-bit
+// residue, so the result fits in 128 bits.
+CLMUL_TARGET
+static inline __m128i fold(__m128i v, __m128i k)
+{
+  return _mm_xor_si128(_mm_clmulepi64_si128(v, k, 0x11),
+                       _mm_clmulepi64_si128(v, k, 0x00));
+}
+
+
+// Requires 'length >= 64'.
+//
+// This is the folding technique from Gopal et al., "Fast CRC
+// Computation for Generic Polynomials Using PCLMULQDQ Instruction",
+// Intel, 2009, except that the final 128-bit remainder is finished
+// with the tables rather than by Barrett reduction.
+CLMUL_TARGET
+static uint32_t crc32_update_clmul(uint32_t crc, unsigned char const *data,
+                                   size_t length)
+{
+  __m128i const k512 = FOLD_CONSTANTS(512);
+  __m128i const k384 = FOLD_CONSTANTS(384);
+  __m128i const k256 = FOLD_CONSTANTS(256);
+  __m128i const k128 = FOLD_CONSTANTS(128);
+
+  // Since S * x^(8*len) is S placed over the first 32 bits of the
+  // message, fold the incoming CRC into the first block and continue
+  // from a state of 0.
+  __m128i x0 = _mm_xor_si128(loadBlock(data),
+                             _mm_set_epi32((int)crc, 0, 0, 0));
+  __m128i x1 = loadBlock(data+16);
+  __m128i x2 = loadBlock(data+32);
+  __m128i x3 = loadBlock(data+48);
+  data += 64;
+  length -= 64;
+
+  // Four independent lanes, each advancing by 512 bits per step.
+  while (length >= 64) {
+    x0 = _mm_xor_si128(fold(x0, k512), loadBlock(data));
+    x1 = _mm_xor_si128(fold(x1, k512), loadBlock(data+16));
+    x2 = _mm_xor_si128(fold(x2, k512), loadBlock(data+32));
+    x3 = _mm_xor_si128(fold(x3, k512), loadBlock(data+48));
+    data += 64;
+    length -= 64;
+  }
+
+  // Merge the lanes.
+  __m128i x = _mm_xor_si128(
+    _mm_xor_si128(fold(x0, k384), fold(x1, k256)),
+    _mm_xor_si128(fold(x2, k128), x3));
+
+  // Remaining whole blocks.
+  while (length >= 16) {
+    x = _mm_xor_si128(fold(x, k128), loadBlock(data));
+    data += 16;
+    length -= 16;
   }
 
-  return update_crc(0xFFFFFFFF, (char*)data, length);
+  // 'x' is congruent to everything so far, so its CRC from state 0 is
+  // the CRC of everything so far.
+  __m128i const reverse =
+    _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  unsigned char remainder[16];
+  _mm_storeu_si128((__m128i*)remainder, _mm_shuffle_epi8(x, reverse));
+  crc = crc32_update_tables(0, remainder, 16);
+
+  return update_crc_bytes(crc, data, length);
+}
+
+
+static bool detectClmul()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") &&
+         __builtin_cpu_supports("ssse3");
+}
+
+#endif // CRC_HAVE_CLMUL
+
+
+bool crc32_using_clmul()
+{
+#if CRC_HAVE_CLMUL
+  // C++11 makes this initialization thread-safe.
+  static bool const ret = detectClmul();
+  return ret;
+#else
+  return false;
+#endif
+}
+
+
+uint32_t crc32_update(uint32_t crc, unsigned char const *data,
+                      size_t length)
+{
+#if CRC_HAVE_CLMUL
+  if (length >= 64 && crc32_using_clmul()) {
+    return crc32_update_clmul(crc, data, length);
+  }
+#endif
+
+  return crc32_update_tables(crc, data, length);
+}
+
+
+// SM: block-level application
+uint32_t crc32(unsigned char const *data, size_t length)
+{
+  return crc32_update(CRC32_INITIAL, data, length);
 }
 
 
@@ -4,11 +4,69 @@
 #ifndef SMBASE_CRC_H
 #define SMBASE_CRC_H
 
+#include <stddef.h>                    // size_t
 #include <stdint.h>                    // uint32_t
 
+// The CRC computed here uses the Autodin/Ethernet polynomial 0x04C11DB7,
+// processed most significant bit first, with an initial value of
+// 0xFFFFFFFF and no final inversion.  (This combination is sometimes
+// called "CRC-32/MPEG-2".)
+
+// Initial accumulator value, i.e., the CRC of zero bytes.
+enum { CRC32_INITIAL = 0xFFFFFFFFu };
+
 // Return the CRC32, as defined in this module, of the 'length' bytes
 // pointed to by 'data'.
-uint32_t crc32(unsigned char const *data, int length);
+uint32_t crc32(unsigned char const *data, size_t length);
 
-#endif // SMBASE_CRC_H
+// Continue a CRC computation: given 'crc', the CRC of some prefix, return
+// the CRC of that prefix followed by 'data'.  Starting from
+// CRC32_INITIAL yields 'crc32'.
+//
+// This uses carry-less multiplication instructions if the CPU has them,
+// and otherwise processes 16 bytes per step with table lookups.  Both
+// give the same result.
+uint32_t crc32_update(uint32_t crc, unsigned char const *data,
+                      size_t length);
+
+// Given 'crc1', the CRC of some data A, and 'crc2', the CRC of data B,
+// which is 'length2' bytes long, return the CRC of A followed by B.
+// This takes time logarithmic in 'length2', so it can be used to merge
+// the CRCs of chunks computed independently.
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t length2);
+
+// The table-driven implementation used by 'crc32_update' when the CPU
+// lacks carry-less multiplication.  This is exposed for testing.
+uint32_t crc32_update_tables(uint32_t crc, unsigned char const *data,
+                             size_t length);
+
+// True if 'crc32_update' is using carry-less multiplication.
+bool crc32_using_clmul();
+
+
+// Accumulate a CRC over data supplied in pieces.
+class CRC32Context {
+private:     // data
+  // CRC of the data seen so far.
+  uint32_t m_crc;
 
+public:      // funcs
+  CRC32Context() : m_crc(CRC32_INITIAL) {}
+
+  // Append 'length' bytes at 'data' to the data seen so far.
+  void update(void const *data, size_t length)
+    { m_crc = crc32_update(m_crc, (unsigned char const*)data, length); }
+
+  // Append the data whose CRC is 'crc2' and whose length is 'length2'.
+  void combine(uint32_t crc2, size_t length2)
+    { m_crc = crc32_combine(m_crc, crc2, length2); }
+
+  // CRC of all the data seen so far; the same as 'crc32' of all of it.
+  uint32_t get() const { return m_crc; }
+
+  // Start over with no data.
+  void reset() { m_crc = CRC32_INITIAL; }
+};
+
+
+#endif // SMBASE_CRC_H
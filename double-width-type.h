@@ -36,6 +36,19 @@ struct DoubleWidthType<uint32_t> {
   typedef uint64_t DWT;
 };
 
+// GCC and Clang provide a 128-bit integer type on 64-bit targets, but
+// it is not standard, so clients that want a 64-bit `T` have to check
+// `SMBASE_HAVE_UINT128` first.
+#if defined(__SIZEOF_INT128__)
+  #define SMBASE_HAVE_UINT128 1
+
+template <>
+struct DoubleWidthType<uint64_t> {
+  // `__extension__` suppresses the `-Wpedantic` complaint.
+  __extension__ typedef unsigned __int128 DWT;
+};
+#endif
+
 
 CLOSE_NAMESPACE(smbase)
 
@@ -0,0 +1,25 @@
+// flat-hash-map-fwd.h
+// Forwards for `flat-hash-map` module.
+
+#ifndef SMBASE_FLAT_HASH_MAP_FWD_H
+#define SMBASE_FLAT_HASH_MAP_FWD_H
+
+#include <functional>                  // std::{hash, equal_to}
+
+namespace smbase {
+  template <typename KEY, typename ENTRY, typename KEY_OF,
+            typename HASH, typename EQ>
+  class FlatHashTable;
+
+  template <typename KEY, typename VALUE,
+            typename HASH = std::hash<KEY>,
+            typename EQ = std::equal_to<KEY> >
+  class FlatHashMap;
+
+  template <typename KEY,
+            typename HASH = std::hash<KEY>,
+            typename EQ = std::equal_to<KEY> >
+  class FlatHashSet;
+}
+
+#endif // SMBASE_FLAT_HASH_MAP_FWD_H
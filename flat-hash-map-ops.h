@@ -0,0 +1,615 @@
+// flat-hash-map-ops.h
+// Operations for `flat-hash-map` module.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_FLAT_HASH_MAP_OPS_H
+#define SMBASE_FLAT_HASH_MAP_OPS_H
+
+#include "flat-hash-map.h"             // interface for this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/xassert.h"            // xassert, xassertPrecondition, xfailure
+
+#include <limits>                      // std::numeric_limits
+#include <new>                         // placement new
+#include <utility>                     // std::{forward, move, swap}
+
+
+OPEN_NAMESPACE(smbase)
+
+
+#define FHT_TEMPLATE                                         \
+  template <typename KEY, typename ENTRY, typename KEY_OF,   \
+            typename HASH, typename EQ>
+#define FHT FlatHashTable<KEY, ENTRY, KEY_OF, HASH, EQ>
+
+
+// --------------------------- FlatHashTable ---------------------------
+FHT_TEMPLATE
+inline auto FHT::nextOccupied(size_type i) const -> size_type
+{
+  while (i < m_capacity && m_dists[i] == 0) {
+    ++i;
+  }
+  return i;
+}
+
+
+FHT_TEMPLATE
+inline auto FHT::homeIndex(std::size_t h) const -> size_type
+{
+  // Fibonacci hashing: multiply by 2^64 / phi and keep the high bits,
+  // which depend on all bits of `h`.
+  std::uint64_t product = (std::uint64_t)h * 0x9E3779B97F4A7C15ull;
+  return (size_type)(product >> (64 - m_capacityBits));
+}
+
+
+FHT_TEMPLATE
+template <typename Q>
+inline auto FHT::findIndex(Q const &key) const -> size_type
+{
+  if (m_size == 0) {
+    return m_capacity;
+  }
+
+  size_type const mask = m_capacity - 1;
+  size_type i = homeIndex(m_hash(key));
+  for (Dist d = 1; ; ++d) {
+    Dist const resident = m_dists[i];
+    if (resident < d) {
+      // Either empty, or a resident closer to its home than `key`
+      // would be, which Robin Hood insertion would not allow.
+      return m_capacity;
+    }
+    if (resident == d && m_eq(KEY_OF::get(m_slots[i].m_entry), key)) {
+      return i;
+    }
+    i = (i+1) & mask;
+  }
+}
+
+
+FHT_TEMPLATE
+auto FHT::insertAbsent(ENTRY &&entry) -> size_type
+{
+  size_type const mask = m_capacity - 1;
+  size_type i = homeIndex(m_hash(KEY_OF::get(entry)));
+
+  // Entry looking for a home; it changes when a resident is displaced.
+  ENTRY carried(std::move(entry));
+  Dist d = 1;
+
+  // Slot of the original `entry`, once known.
+  size_type result = m_capacity;
+
+  while (true) {
+    if (m_dists[i] == 0) {
+      ::new (&m_slots[i].m_entry) ENTRY(std::move(carried));
+      m_dists[i] = d;
+      ++m_size;
+      return result == m_capacity? i : result;
+    }
+
+    if (m_dists[i] < d) {
+      // The resident is closer to its home; displace it.
+      using std::swap;
+      swap(carried, m_slots[i].m_entry);
+      swap(d, m_dists[i]);
+      if (result == m_capacity) {
+        result = i;
+      }
+    }
+
+    i = (i+1) & mask;
+    if (d == std::numeric_limits<Dist>::max()) {
+      xfailure("FlatHashTable: probe sequence too long; "
+               "the hash function is degenerate");
+    }
+    ++d;
+  }
+}
+
+
+FHT_TEMPLATE
+template <typename... ARGS>
+auto FHT::emplaceIndex(ARGS &&... args) -> std::pair<size_type, bool>
+{
+  ENTRY entry(std::forward<ARGS>(args)...);
+
+  size_type i = findIndex(KEY_OF::get(entry));
+  if (i != m_capacity) {
+    return std::make_pair(i, false);
+  }
+
+  growForInsert();
+  return std::make_pair(insertAbsent(std::move(entry)), true);
+}
+
+
+FHT_TEMPLATE
+inline void FHT::growForInsert()
+{
+  // Keep the load factor at most 7/8.
+  if ((m_size+1) * 8 > m_capacity * 7) {
+    rehash(m_capacity == 0? 8 : m_capacity * 2);
+  }
+}
+
+
+FHT_TEMPLATE
+void FHT::rehash(size_type newCapacity)
+{
+  xassert(newCapacity >= capacityFor(m_size));
+
+  std::unique_ptr<Slot[]> oldSlots(std::move(m_slots));
+  std::unique_ptr<Dist[]> oldDists(std::move(m_dists));
+  size_type oldCapacity = m_capacity;
+
+  m_slots.reset(new Slot[newCapacity]);
+  m_dists.reset(new Dist[newCapacity]());
+  m_capacity = newCapacity;
+  m_capacityBits = 0;
+  while (((size_type)1 << m_capacityBits) < newCapacity) {
+    ++m_capacityBits;
+  }
+  m_size = 0;
+
+  for (size_type i=0; i < oldCapacity; i++) {
+    if (oldDists[i] != 0) {
+      ENTRY &e = oldSlots[i].m_entry;
+      insertAbsent(std::move(e));
+      e.~ENTRY();
+    }
+  }
+}
+
+
+FHT_TEMPLATE
+void FHT::eraseIndex(size_type i)
+{
+  size_type const mask = m_capacity - 1;
+
+  m_slots[i].m_entry.~ENTRY();
+
+  // Shift back the following entries that are not in their home slot.
+  size_type j = (i+1) & mask;
+  while (m_dists[j] > 1) {
+    ENTRY &e = m_slots[j].m_entry;
+    ::new (&m_slots[i].m_entry) ENTRY(std::move(e));
+    e.~ENTRY();
+    m_dists[i] = m_dists[j] - 1;
+    i = j;
+    j = (j+1) & mask;
+  }
+
+  m_dists[i] = 0;
+  --m_size;
+}
+
+
+FHT_TEMPLATE
+inline auto FHT::capacityFor(size_type n) -> size_type
+{
+  if (n == 0) {
+    return 0;
+  }
+  size_type cap = 8;
+  while (n * 8 > cap * 7) {
+    cap *= 2;
+  }
+  return cap;
+}
+
+
+FHT_TEMPLATE
+void FHT::destroyAll()
+{
+  for (size_type i=0; i < m_capacity; i++) {
+    if (m_dists[i] != 0) {
+      m_slots[i].m_entry.~ENTRY();
+      m_dists[i] = 0;
+    }
+  }
+  m_size = 0;
+}
+
+
+FHT_TEMPLATE
+inline FHT::FlatHashTable(HASH const &hash, EQ const &eq)
+  : m_slots(),
+    m_dists(),
+    m_capacity(0),
+    m_capacityBits(0),
+    m_size(0),
+    m_hash(hash),
+    m_eq(eq)
+{}
+
+
+FHT_TEMPLATE
+FHT::FlatHashTable(FlatHashTable const &obj)
+  : m_slots(),
+    m_dists(),
+    m_capacity(0),
+    m_capacityBits(0),
+    m_size(0),
+    DMEMB(m_hash),
+    DMEMB(m_eq)
+{
+  if (obj.m_capacity == 0) {
+    return;
+  }
+
+  // Same capacity and functors, so every entry can go in the same slot.
+  m_slots.reset(new Slot[obj.m_capacity]);
+  m_dists.reset(new Dist[obj.m_capacity]());
+  m_capacity = obj.m_capacity;
+  m_capacityBits = obj.m_capacityBits;
+
+  try {
+    for (size_type i=0; i < m_capacity; i++) {
+      if (obj.m_dists[i] != 0) {
+        ::new (&m_slots[i].m_entry) ENTRY(obj.m_slots[i].m_entry);
+        m_dists[i] = obj.m_dists[i];
+        ++m_size;
+      }
+    }
+  }
+  catch (...) {
+    destroyAll();
+    throw;
+  }
+}
+
+
+FHT_TEMPLATE
+FHT::FlatHashTable(FlatHashTable &&obj)
+  : MDMEMB(m_slots),
+    MDMEMB(m_dists),
+    DMEMB(m_capacity),
+    DMEMB(m_capacityBits),
+    DMEMB(m_size),
+    DMEMB(m_hash),
+    DMEMB(m_eq)
+{
+  obj.m_capacity = 0;
+  obj.m_capacityBits = 0;
+  obj.m_size = 0;
+}
+
+
+FHT_TEMPLATE
+FHT::~FlatHashTable()
+{
+  destroyAll();
+}
+
+
+FHT_TEMPLATE
+auto FHT::operator=(FlatHashTable const &obj) -> FlatHashTable &
+{
+  if (this != &obj) {
+    FlatHashTable tmp(obj);
+    swap(tmp);
+  }
+  return *this;
+}
+
+
+FHT_TEMPLATE
+auto FHT::operator=(FlatHashTable &&obj) -> FlatHashTable &
+{
+  if (this != &obj) {
+    FlatHashTable tmp(std::move(obj));
+    swap(tmp);
+  }
+  return *this;
+}
+
+
+FHT_TEMPLATE
+void FHT::swap(FlatHashTable &obj)
+{
+  using std::swap;
+  swap(m_slots, obj.m_slots);
+  swap(m_dists, obj.m_dists);
+  swap(m_capacity, obj.m_capacity);
+  swap(m_capacityBits, obj.m_capacityBits);
+  swap(m_size, obj.m_size);
+  swap(m_hash, obj.m_hash);
+  swap(m_eq, obj.m_eq);
+}
+
+
+FHT_TEMPLATE
+void FHT::selfCheck() const
+{
+  xassert((m_capacity & (m_capacity-1)) == 0);
+  xassert(m_capacity == 0 || ((size_type)1 << m_capacityBits) == m_capacity);
+  xassert(m_size * 8 <= m_capacity * 7);
+
+  size_type const mask = m_capacity - 1;
+  size_type ct = 0;
+  for (size_type i=0; i < m_capacity; i++) {
+    Dist d = m_dists[i];
+    if (d == 0) {
+      continue;
+    }
+    ct++;
+
+    // The recorded distance is right.
+    KEY const &key = KEY_OF::get(m_slots[i].m_entry);
+    size_type home = homeIndex(m_hash(key));
+    xassert(((i - home) & mask) + 1 == d);
+
+    // Robin Hood: the predecessor is no closer to its home than one
+    // less than our distance, else we would have displaced it.
+    Dist prev = m_dists[(i-1) & mask];
+    xassert(d == 1 || prev + 1 >= d);
+
+    // It can be found.
+    xassert(findIndex(key) == i);
+  }
+  xassert(ct == m_size);
+}
+
+
+FHT_TEMPLATE
+void FHT::reserve(size_type n)
+{
+  size_type cap = capacityFor(n);
+  if (cap > m_capacity) {
+    rehash(cap);
+  }
+}
+
+
+FHT_TEMPLATE
+inline void FHT::clear()
+{
+  destroyAll();
+}
+
+
+FHT_TEMPLATE
+void FHT::clearAndShrink()
+{
+  FlatHashTable tmp(m_hash, m_eq);
+  swap(tmp);
+}
+
+
+FHT_TEMPLATE
+inline auto FHT::erase(KEY const &key) -> size_type
+{
+  size_type i = findIndex(key);
+  if (i == m_capacity) {
+    return 0;
+  }
+  eraseIndex(i);
+  return 1;
+}
+
+
+FHT_TEMPLATE
+template <typename Q, typename H, typename E, typename, typename>
+inline auto FHT::erase(Q const &key) -> size_type
+{
+  size_type i = findIndex(key);
+  if (i == m_capacity) {
+    return 0;
+  }
+  eraseIndex(i);
+  return 1;
+}
+
+
+FHT_TEMPLATE
+double FHT::averageProbeLength() const
+{
+  if (m_size == 0) {
+    return 0;
+  }
+
+  double total = 0;
+  for (size_type i=0; i < m_capacity; i++) {
+    total += m_dists[i];
+  }
+  return total / m_size;
+}
+
+
+#undef FHT
+#undef FHT_TEMPLATE
+
+
+// ---------------------------- FlatHashMap ----------------------------
+#define FHM_TEMPLATE \
+  template <typename KEY, typename VALUE, typename HASH, typename EQ>
+#define FHM FlatHashMap<KEY, VALUE, HASH, EQ>
+
+
+FHM_TEMPLATE
+inline auto FHM::insert(value_type const &entry) -> std::pair<iterator, bool>
+{
+  return emplace(entry);
+}
+
+
+FHM_TEMPLATE
+inline auto FHM::insert(value_type &&entry) -> std::pair<iterator, bool>
+{
+  return emplace(std::move(entry));
+}
+
+
+FHM_TEMPLATE
+template <typename... ARGS>
+inline auto FHM::emplace(ARGS &&... args) -> std::pair<iterator, bool>
+{
+  auto res = this->emplaceIndex(std::forward<ARGS>(args)...);
+  return std::make_pair(iterator(this, res.first), res.second);
+}
+
+
+FHM_TEMPLATE
+template <typename V>
+bool FHM::insertOrAssign(KEY const &key, V &&value)
+{
+  if (VALUE *v = getOrNull(key)) {
+    *v = std::forward<V>(value);
+    return false;
+  }
+  this->growForInsert();
+  this->insertAbsent(value_type(key, std::forward<V>(value)));
+  return true;
+}
+
+
+FHM_TEMPLATE
+template <typename V>
+bool FHM::insertOrAssign(KEY &&key, V &&value)
+{
+  if (VALUE *v = getOrNull(key)) {
+    *v = std::forward<V>(value);
+    return false;
+  }
+  this->growForInsert();
+  this->insertAbsent(value_type(std::move(key), std::forward<V>(value)));
+  return true;
+}
+
+
+FHM_TEMPLATE
+VALUE &FHM::operator[](KEY const &key)
+{
+  if (VALUE *v = getOrNull(key)) {
+    return *v;
+  }
+  this->growForInsert();
+  return this->slotEntry(
+    this->insertAbsent(value_type(key, VALUE()))).second;
+}
+
+
+FHM_TEMPLATE
+VALUE &FHM::operator[](KEY &&key)
+{
+  if (VALUE *v = getOrNull(key)) {
+    return *v;
+  }
+  this->growForInsert();
+  return this->slotEntry(
+    this->insertAbsent(value_type(std::move(key), VALUE()))).second;
+}
+
+
+FHM_TEMPLATE
+inline VALUE &FHM::valueAtKey(KEY const &key)
+{
+  VALUE *v = getOrNull(key);
+  xassertPrecondition(v);
+  return *v;
+}
+
+
+FHM_TEMPLATE
+inline VALUE const &FHM::valueAtKey(KEY const &key) const
+{
+  VALUE const *v = getOrNull(key);
+  xassertPrecondition(v);
+  return *v;
+}
+
+
+FHM_TEMPLATE
+template <typename Q, typename H, typename E, typename, typename>
+inline VALUE &FHM::valueAtKey(Q const &key)
+{
+  VALUE *v = getOrNull(key);
+  xassertPrecondition(v);
+  return *v;
+}
+
+
+FHM_TEMPLATE
+template <typename Q, typename H, typename E, typename, typename>
+inline VALUE const &FHM::valueAtKey(Q const &key) const
+{
+  VALUE const *v = getOrNull(key);
+  xassertPrecondition(v);
+  return *v;
+}
+
+
+FHM_TEMPLATE
+inline VALUE *FHM::getOrNull(KEY const &key)
+{
+  auto i = this->findIndex(key);
+  return i == this->m_capacity? nullptr : &( this->slotEntry(i).second );
+}
+
+
+FHM_TEMPLATE
+inline VALUE const *FHM::getOrNull(KEY const &key) const
+{
+  auto i = this->findIndex(key);
+  return i == this->m_capacity? nullptr : &( this->slotEntry(i).second );
+}
+
+
+FHM_TEMPLATE
+template <typename Q, typename H, typename E, typename, typename>
+inline VALUE *FHM::getOrNull(Q const &key)
+{
+  auto i = this->findIndex(key);
+  return i == this->m_capacity? nullptr : &( this->slotEntry(i).second );
+}
+
+
+FHM_TEMPLATE
+template <typename Q, typename H, typename E, typename, typename>
+inline VALUE const *FHM::getOrNull(Q const &key) const
+{
+  auto i = this->findIndex(key);
+  return i == this->m_capacity? nullptr : &( this->slotEntry(i).second );
+}
+
+
+#undef FHM
+#undef FHM_TEMPLATE
+
+
+// ---------------------------- FlatHashSet ----------------------------
+template <typename KEY, typename HASH, typename EQ>
+inline auto FlatHashSet<KEY, HASH, EQ>::insert(KEY const &key)
+  -> std::pair<const_iterator, bool>
+{
+  return emplace(key);
+}
+
+
+template <typename KEY, typename HASH, typename EQ>
+inline auto FlatHashSet<KEY, HASH, EQ>::insert(KEY &&key)
+  -> std::pair<const_iterator, bool>
+{
+  return emplace(std::move(key));
+}
+
+
+template <typename KEY, typename HASH, typename EQ>
+template <typename... ARGS>
+inline auto FlatHashSet<KEY, HASH, EQ>::emplace(ARGS &&... args)
+  -> std::pair<const_iterator, bool>
+{
+  auto res = this->emplaceIndex(std::forward<ARGS>(args)...);
+  return std::make_pair(const_iterator(this, res.first), res.second);
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_FLAT_HASH_MAP_OPS_H
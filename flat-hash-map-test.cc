@@ -0,0 +1,319 @@
+// flat-hash-map-test.cc
+// Tests for `flat-hash-map` module.
+
+// This file is in the public domain.
+
+#include "smbase/flat-hash-map-ops.h"  // module under test
+
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "smbase/sm-random.h"          // sm_random
+#include "smbase/sm-test.h"            // EXPECT_EQ
+#include "smbase/stringb.h"            // stringb
+#include "smbase/thashtbl.h"           // THashTable
+#include "smbase/xassert.h"            // xassert
+
+#include <map>                         // std::map
+#include <memory>                      // std::unique_ptr
+#include <set>                         // std::set
+#include <string>                      // std::string
+#include <string_view>                 // std::string_view
+#include <utility>                     // std::move
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Hash with many collisions, to exercise long probe sequences.
+struct BadIntHash {
+  std::size_t operator()(int x) const { return (std::size_t)(x % 7); }
+};
+
+
+// Hash with state, which must be copied into the table.
+struct SeededIntHash {
+  std::size_t m_seed;
+
+  explicit SeededIntHash(std::size_t seed = 0) : m_seed(seed) {}
+
+  std::size_t operator()(int x) const { return m_seed ^ (std::size_t)x; }
+};
+
+
+// Randomly insert and erase, comparing against std::map.
+template <typename MAP>
+void testRandomMap(MAP &m, int range, int iters)
+{
+  std::map<int, int> ref;
+
+  smbase_loopi(iters) {
+    int key = sm_random(range);
+    switch (sm_random(4)) {
+      case 0:
+        EXPECT_EQ(m.insert({key, i}).second, ref.insert({key, i}).second);
+        break;
+
+      case 1:
+        EXPECT_EQ(m.insertOrAssign(key, i), ref.count(key) == 0);
+        ref[key] = i;
+        break;
+
+      case 2:
+        EXPECT_EQ(m.erase(key), ref.erase(key));
+        break;
+
+      case 3:
+        EXPECT_EQ(m.contains(key), ref.count(key) == 1);
+        if (ref.count(key)) {
+          EXPECT_EQ(m.valueAtKey(key), ref[key]);
+        }
+        else {
+          xassert(m.find(key) == m.end());
+          xassert(m.getOrNull(key) == nullptr);
+        }
+        break;
+    }
+
+    EXPECT_EQ(m.size(), ref.size());
+    if (i % 128 == 0) {
+      m.selfCheck();
+    }
+  }
+  m.selfCheck();
+
+  // Iteration visits each entry once.
+  std::map<int, int> seen;
+  for (auto const &kv : m) {
+    xassert(seen.insert(kv).second);
+  }
+  xassert(seen == ref);
+}
+
+
+void testIntMaps()
+{
+  {
+    FlatHashMap<int, int> m;
+    testRandomMap(m, 1000, 20000);
+  }
+  {
+    FlatHashMap<int, int> m;
+    testRandomMap(m, 100000, 20000);
+  }
+  {
+    FlatHashMap<int, int, BadIntHash> m;
+    testRandomMap(m, 300, 5000);
+  }
+  {
+    FlatHashMap<int, int, SeededIntHash> m(SeededIntHash(12345));
+    EXPECT_EQ(m.hash_function().m_seed, 12345u);
+    testRandomMap(m, 1000, 5000);
+  }
+}
+
+
+void testCapacity()
+{
+  FlatHashMap<int, int> m;
+  EXPECT_EQ(m.capacity(), 0u);
+  xassert(m.empty());
+  xassert(!m.contains(3));
+  EXPECT_EQ(m.averageProbeLength(), 0.0);
+
+  m.reserve(100);
+  std::size_t cap = m.capacity();
+  EXPECT_EQ(cap, 128u);
+  smbase_loopi(100) {
+    m[i] = i*i;
+  }
+  EXPECT_EQ(m.capacity(), cap);
+  xassert(m.averageProbeLength() >= 1.0);
+  DIAG("average probe length: " << m.averageProbeLength());
+
+  m[100] = 0;
+  m[101] = 0;
+  m[102] = 0;
+  EXPECT_EQ(m.capacity(), 128u);
+  smbase_loopi(20) {
+    m[200+i] = 0;
+  }
+  EXPECT_EQ(m.capacity(), 256u);
+
+  m.clear();
+  xassert(m.empty());
+  EXPECT_EQ(m.capacity(), 256u);
+  m.clearAndShrink();
+  EXPECT_EQ(m.capacity(), 0u);
+}
+
+
+void testStringKeys()
+{
+  typedef FlatHashMap<std::string, std::string,
+                      TransparentStringHash,
+                      TransparentStringEqual> StrMap;
+  StrMap m;
+
+  smbase_loopi(200) {
+    m[stringb("key" << i)] = stringb("value" << i);
+  }
+  m.selfCheck();
+  EXPECT_EQ(m.size(), 200u);
+
+  // Heterogeneous lookup.
+  std::string_view sv("key17");
+  xassert(m.contains(sv));
+  EXPECT_EQ(m.valueAtKey(sv), std::string("value17"));
+  xassert(m.contains("key199"));
+  xassert(!m.contains("key200"));
+  xassert(m.find("key5") != m.end());
+  EXPECT_EQ(m.find("key5")->second, std::string("value5"));
+  EXPECT_EQ(m.count(std::string_view("nope")), 0u);
+  EXPECT_EQ(m.erase(std::string_view("key0")), 1u);
+  EXPECT_EQ(m.erase("key0"), 0u);
+
+  // Copy and move.
+  StrMap m2(m);
+  m2.selfCheck();
+  EXPECT_EQ(m2.size(), 199u);
+  m2["key1"] = "changed";
+  EXPECT_EQ(m.valueAtKey("key1"), std::string("value1"));
+
+  StrMap m3(std::move(m2));
+  EXPECT_EQ(m3.valueAtKey("key1"), std::string("changed"));
+  EXPECT_EQ(m2.size(), 0u);
+  m2 = m3;
+  EXPECT_EQ(m2.size(), 199u);
+  swap(m2, m);
+  EXPECT_EQ(m.valueAtKey("key1"), std::string("changed"));
+
+  // Const access.
+  StrMap const &cm = m;
+  EXPECT_EQ(*cm.getOrNull("key2"), std::string("value2"));
+  std::size_t ct = 0;
+  for (auto it = cm.begin(); it != cm.end(); ++it) {
+    ct++;
+  }
+  EXPECT_EQ(ct, 199u);
+}
+
+
+void testMoveOnlyValues()
+{
+  FlatHashMap<int, std::unique_ptr<int> > m;
+  smbase_loopi(100) {
+    m.emplace(i, std::unique_ptr<int>(new int(i)));
+  }
+  smbase_loopi(50) {
+    m.erase(i*2);
+  }
+  m.selfCheck();
+  EXPECT_EQ(m.size(), 50u);
+  for (auto const &kv : m) {
+    EXPECT_EQ(*kv.second, kv.first);
+    xassert(kv.first % 2 == 1);
+  }
+}
+
+
+void testSet()
+{
+  FlatHashSet<int> s;
+  std::set<int> ref;
+  smbase_loopi(5000) {
+    int key = sm_random(500);
+    if (sm_random(2)) {
+      EXPECT_EQ(s.insert(key).second, ref.insert(key).second);
+    }
+    else {
+      EXPECT_EQ(s.erase(key), ref.erase(key));
+    }
+  }
+  s.selfCheck();
+
+  std::set<int> seen;
+  for (int x : s) {
+    xassert(seen.insert(x).second);
+  }
+  xassert(seen == ref);
+
+  FlatHashSet<std::string, TransparentStringHash, TransparentStringEqual> ss;
+  ss.insert("a");
+  ss.emplace("b");
+  xassert(ss.contains("a"));
+  xassert(ss.find(std::string_view("b")) != ss.end());
+  xassert(!ss.contains("c"));
+}
+
+
+// For testing THashTable, which is built on the function-pointer
+// adapters.
+struct Item {
+  int m_key;
+};
+
+int const *itemKey(Item *item)
+{
+  return &item->m_key;
+}
+
+unsigned intPtrHash(int const *k)
+{
+  return (unsigned)*k;
+}
+
+bool intPtrEqual(int const *a, int const *b)
+{
+  return *a == *b;
+}
+
+void testTHashTable()
+{
+  THashTable<int, Item> table(itemKey, intPtrHash, intPtrEqual);
+  Item items[50];
+  smbase_loopi(50) {
+    items[i].m_key = i*3;
+    table.add(&items[i].m_key, &items[i]);
+  }
+  table.selfCheck();
+  EXPECT_EQ(table.getNumEntries(), 50);
+
+  int k = 27;
+  xassert(table.get(&k) == &items[9]);
+  k = 28;
+  xassert(table.get(&k) == NULL);
+
+  k = 27;
+  xassert(table.remove(&k) == &items[9]);
+  xassert(table.get(&k) == NULL);
+  EXPECT_EQ(table.getNumEntries(), 49);
+
+  int ct = 0;
+  for (THashTableIter<int, Item> iter(table); !iter.isDone(); iter.adv()) {
+    xassert(iter.data()->m_key % 3 == 0);
+    ct++;
+  }
+  EXPECT_EQ(ct, 49);
+
+  table.empty();
+  EXPECT_EQ(table.getNumEntries(), 0);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_flat_hash_map()
+{
+  testIntMaps();
+  testCapacity();
+  testStringKeys();
+  testMoveOnlyValues();
+  testSet();
+  testTHashTable();
+}
+
+
+// EOF
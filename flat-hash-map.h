@@ -0,0 +1,458 @@
+// flat-hash-map.h
+// `FlatHashMap` and `FlatHashSet`, open-addressing hash tables.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_FLAT_HASH_MAP_H
+#define SMBASE_FLAT_HASH_MAP_H
+
+#include "flat-hash-map-fwd.h"         // fwds for this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/string-hash.h"        // stringHashSeeded
+
+#include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::uint16_t
+#include <memory>                      // std::unique_ptr
+#include <string_view>                 // std::string_view
+#include <utility>                     // std::pair
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Template parameters for heterogeneous lookup methods, which are
+// only enabled when both functors are transparent.
+#define FLAT_HASH_TABLE_LOOKUP_TPARAMS            \
+  typename Q,                                     \
+  typename H = HASH,                              \
+  typename E = EQ,                                \
+  typename = typename H::is_transparent,          \
+  typename = typename E::is_transparent
+
+
+/* Core of `FlatHashMap` and `FlatHashSet`.
+
+   Entries are stored inline in a single array of slots whose size is
+   a power of two.  Collisions are resolved by linear probing with
+   Robin Hood displacement: an entry being inserted takes the slot of
+   any resident that is closer to its own home slot.  That keeps probe
+   sequences short and lets an unsuccessful lookup stop as soon as it
+   meets such a resident.  Removal shifts the following entries back
+   one slot, so there are no tombstones.
+
+   A parallel array records, for each slot, one plus the distance of
+   its entry from the entry's home slot, or 0 if the slot is empty.
+   Since two equal keys have the same home, a lookup only calls `EQ`
+   on residents whose distance matches its own.
+
+   `HASH` and `EQ` are function objects, so calls to them can be
+   inlined; they may carry state, which is copied from the constructor
+   arguments.  The hash result is scrambled before use, so a hash whose
+   low bits are poor, like `std::hash` of a pointer, is fine.  If both
+   have a nested `is_transparent` type, the lookup methods accept any
+   type they can be called with (e.g., `std::string_view` to look up
+   `std::string` keys).
+
+   `KEY_OF` has a static `get` method that maps an `ENTRY` to its key.
+
+   Any insertion can move every entry, invalidating all iterators,
+   pointers and references.  Removal can move entries too.
+
+   Iteration proceeds in slot order, which depends on the hash values
+   and the history of the table.
+*/
+template <typename KEY, typename ENTRY, typename KEY_OF,
+          typename HASH, typename EQ>
+class FlatHashTable {
+public:      // types
+  using key_type = KEY;
+  using value_type = ENTRY;
+  using size_type = std::size_t;
+  using hasher = HASH;
+  using key_equal = EQ;
+
+  // Iterator over the occupied slots.  `ENTRY_REF` is the type of a
+  // reference to an entry, and `TABLE` is the (maybe const) table.
+  template <typename ENTRY_REF, typename TABLE>
+  class IteratorT {
+  private:     // data
+    // Table we are iterating over.
+    TABLE *m_table;
+
+    // Current slot, which is occupied, or the capacity at the end.
+    size_type m_index;
+
+  public:      // methods
+    IteratorT(TABLE *table, size_type index)
+      : m_table(table),
+        m_index(index)
+    {}
+
+    // Allow conversion from iterator to const_iterator.
+    template <typename R2, typename T2>
+    IteratorT(IteratorT<R2, T2> const &obj)
+      : m_table(obj.getTable()),
+        m_index(obj.getIndex())
+    {}
+
+    TABLE *getTable() const { return m_table; }
+    size_type getIndex() const { return m_index; }
+
+    bool operator==(IteratorT const &obj) const
+      { return m_index == obj.m_index; }
+    bool operator!=(IteratorT const &obj) const
+      { return m_index != obj.m_index; }
+
+    ENTRY_REF operator*() const
+      { return m_table->slotEntry(m_index); }
+    auto operator->() const
+      { return &( m_table->slotEntry(m_index) ); }
+
+    IteratorT &operator++()
+      { m_index = m_table->nextOccupied(m_index+1); return *this; }
+  };
+
+  using iterator = IteratorT<ENTRY &, FlatHashTable>;
+  using const_iterator = IteratorT<ENTRY const &, FlatHashTable const>;
+
+protected:   // types
+  // Storage for one entry, constructed only while occupied.
+  union Slot {
+    ENTRY m_entry;
+
+    Slot() {}
+    ~Slot() {}
+  };
+
+  // Type of the per-slot distance record.
+  using Dist = std::uint16_t;
+
+protected:   // data
+  // Slots, or null if `m_capacity` is 0.
+  std::unique_ptr<Slot[]> m_slots;
+
+  // For each slot, 0 if empty, otherwise one plus its entry's distance
+  // from its home slot.
+  std::unique_ptr<Dist[]> m_dists;
+
+  // Number of slots; 0 or a power of 2.
+  size_type m_capacity;
+
+  // log2(m_capacity), or 0 when there are no slots.
+  int m_capacityBits;
+
+  // Number of occupied slots.
+  size_type m_size;
+
+  // Functors.
+  HASH m_hash;
+  EQ m_eq;
+
+protected:   // methods
+  // Entry in occupied slot `i`.
+  ENTRY &slotEntry(size_type i) { return m_slots[i].m_entry; }
+  ENTRY const &slotEntry(size_type i) const { return m_slots[i].m_entry; }
+
+  // First occupied slot at or after `i`, or `m_capacity` if none.
+  size_type nextOccupied(size_type i) const;
+
+  // Home slot for a key whose `HASH` is `h`.
+  size_type homeIndex(std::size_t h) const;
+
+  // Slot holding `key`, or `m_capacity` if it is absent.
+  template <typename Q>
+  size_type findIndex(Q const &key) const;
+
+  // Insert `entry`, whose key is absent, without checking the load.
+  // Return the slot where it lands.
+  size_type insertAbsent(ENTRY &&entry);
+
+  // Construct an entry from `args` and insert it if its key is not
+  // already present.  Return the slot holding the key, and true if it
+  // was inserted.
+  template <typename... ARGS>
+  std::pair<size_type, bool> emplaceIndex(ARGS &&... args);
+
+  // Make room for at least one more entry.
+  void growForInsert();
+
+  // Move all entries into a table with `newCapacity` slots.
+  void rehash(size_type newCapacity);
+
+  // Destroy the entry in slot `i` and close the gap.
+  void eraseIndex(size_type i);
+
+  // Smallest capacity that can hold `n` entries within the maximum
+  // load factor.
+  static size_type capacityFor(size_type n);
+
+  // Destroy all entries, keeping the slots.
+  void destroyAll();
+
+public:      // methods
+  explicit FlatHashTable(HASH const &hash = HASH(), EQ const &eq = EQ());
+  FlatHashTable(FlatHashTable const &obj);
+  FlatHashTable(FlatHashTable &&obj);
+  ~FlatHashTable();
+
+  FlatHashTable &operator=(FlatHashTable const &obj);
+  FlatHashTable &operator=(FlatHashTable &&obj);
+
+  void swap(FlatHashTable &obj);
+
+  // Check invariants, throwing an exception if one is violated.  This
+  // takes time linear in the capacity.
+  void selfCheck() const;
+
+  // ---------------------------- Iterators ----------------------------
+  iterator begin() { return iterator(this, nextOccupied(0)); }
+  iterator end() { return iterator(this, m_capacity); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cbegin() const
+    { return const_iterator(this, nextOccupied(0)); }
+  const_iterator cend() const { return const_iterator(this, m_capacity); }
+
+  // ---------------------------- Capacity -----------------------------
+  bool empty() const { return m_size == 0; }
+  size_type size() const { return m_size; }
+
+  // Number of slots.  The table grows when it would be more than 7/8
+  // full.
+  size_type capacity() const { return m_capacity; }
+
+  // Make room for `n` entries so that inserting up to that many does
+  // not rehash.
+  void reserve(size_type n);
+
+  // HASH and EQ.
+  HASH const &hash_function() const { return m_hash; }
+  EQ const &key_eq() const { return m_eq; }
+
+  // ---------------------------- Modifiers ----------------------------
+  // Remove all entries.  This keeps the allocated slots.
+  void clear();
+
+  // Remove all entries and free the slots.
+  void clearAndShrink();
+
+  // Remove the entry with `key` if present, returning the number
+  // removed (0 or 1).
+  size_type erase(KEY const &key);
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  size_type erase(Q const &key);
+
+  // ----------------------------- Lookup ------------------------------
+  // Return an iterator to the entry with `key`, or `end()` if none.
+  iterator find(KEY const &key)
+    { return iterator(this, findIndex(key)); }
+  const_iterator find(KEY const &key) const
+    { return const_iterator(this, findIndex(key)); }
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  iterator find(Q const &key)
+    { return iterator(this, findIndex(key)); }
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  const_iterator find(Q const &key) const
+    { return const_iterator(this, findIndex(key)); }
+
+  // True if `key` is present.
+  bool contains(KEY const &key) const
+    { return findIndex(key) != m_capacity; }
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  bool contains(Q const &key) const
+    { return findIndex(key) != m_capacity; }
+
+  // Number of entries with `key`, 0 or 1.
+  size_type count(KEY const &key) const
+    { return contains(key)? 1 : 0; }
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  size_type count(Q const &key) const
+    { return contains(key)? 1 : 0; }
+
+  // Average number of slots examined by a successful lookup, averaged
+  // over all entries.  Returns 0 for an empty table.
+  double averageProbeLength() const;
+};
+
+
+// `KEY_OF` for `FlatHashMap`.
+struct FlatHashMapKeyOf {
+  template <typename KEY, typename VALUE>
+  static KEY const &get(std::pair<KEY, VALUE> const &entry)
+    { return entry.first; }
+};
+
+
+// `KEY_OF` for `FlatHashSet`.
+struct FlatHashSetKeyOf {
+  template <typename KEY>
+  static KEY const &get(KEY const &entry) { return entry; }
+};
+
+
+// Map from `KEY` to `VALUE`, stored as `std::pair<KEY, VALUE>`.
+//
+// Unlike `std::unordered_map`, the key in an entry is not `const`, so
+// that entries can be moved cheaply when the table is reorganized.
+// Modifying it through an iterator breaks the table.
+template <typename KEY, typename VALUE, typename HASH, typename EQ>
+class FlatHashMap
+  : public FlatHashTable<KEY, std::pair<KEY, VALUE>,
+                         FlatHashMapKeyOf, HASH, EQ> {
+public:      // types
+  using Base = FlatHashTable<KEY, std::pair<KEY, VALUE>,
+                             FlatHashMapKeyOf, HASH, EQ>;
+  using mapped_type = VALUE;
+  using typename Base::value_type;
+  using typename Base::iterator;
+  using typename Base::const_iterator;
+
+public:      // methods
+  using Base::Base;
+
+  // Insert `entry` if its key is absent.  Return an iterator to the
+  // entry with that key, and true if it was inserted.
+  std::pair<iterator, bool> insert(value_type const &entry);
+  std::pair<iterator, bool> insert(value_type &&entry);
+
+  // Construct an entry from `args` and insert it if its key is absent.
+  template <typename... ARGS>
+  std::pair<iterator, bool> emplace(ARGS &&... args);
+
+  // Map `key` to `value`, replacing any existing value.  Return true if
+  // the key was newly inserted.
+  template <typename V>
+  bool insertOrAssign(KEY const &key, V &&value);
+  template <typename V>
+  bool insertOrAssign(KEY &&key, V &&value);
+
+  // Return the value for `key`, inserting a value-initialized one if
+  // it is absent.
+  VALUE &operator[](KEY const &key);
+  VALUE &operator[](KEY &&key);
+
+  // Return the value for `key`, which must be present.
+  VALUE &valueAtKey(KEY const &key);
+  VALUE const &valueAtKey(KEY const &key) const;
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  VALUE &valueAtKey(Q const &key);
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  VALUE const &valueAtKey(Q const &key) const;
+
+  // Return a pointer to the value for `key`, or null if it is absent.
+  VALUE *getOrNull(KEY const &key);
+  VALUE const *getOrNull(KEY const &key) const;
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  VALUE *getOrNull(Q const &key);
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  VALUE const *getOrNull(Q const &key) const;
+
+  friend void swap(FlatHashMap &a, FlatHashMap &b) { a.swap(b); }
+};
+
+
+// Set of `KEY`.  Entries cannot be modified through iterators.
+template <typename KEY, typename HASH, typename EQ>
+class FlatHashSet
+  : public FlatHashTable<KEY, KEY, FlatHashSetKeyOf, HASH, EQ> {
+public:      // types
+  using Base = FlatHashTable<KEY, KEY, FlatHashSetKeyOf, HASH, EQ>;
+  using typename Base::value_type;
+  using typename Base::const_iterator;
+  using iterator = const_iterator;
+
+public:      // methods
+  using Base::Base;
+
+  // Only const iteration is allowed.
+  const_iterator begin() const { return Base::cbegin(); }
+  const_iterator end() const { return Base::cend(); }
+
+  const_iterator find(KEY const &key) const
+    { return Base::find(key); }
+  template <FLAT_HASH_TABLE_LOOKUP_TPARAMS>
+  const_iterator find(Q const &key) const
+    { return Base::find(key); }
+
+  // Insert `key` if absent.  Return an iterator to the entry with that
+  // key, and true if it was inserted.
+  std::pair<const_iterator, bool> insert(KEY const &key);
+  std::pair<const_iterator, bool> insert(KEY &&key);
+
+  // Construct a key from `args` and insert it if absent.
+  template <typename... ARGS>
+  std::pair<const_iterator, bool> emplace(ARGS &&... args);
+
+  friend void swap(FlatHashSet &a, FlatHashSet &b) { a.swap(b); }
+};
+
+
+// ------------------------- Hash functors -------------------------
+// Transparent hash for string keys, so that a table with
+// `std::string` keys can be searched with a `std::string_view` or a
+// `char const *` without building a temporary string.
+struct TransparentStringHash {
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view s) const
+    { return stringHashSeeded(s.data(), s.size()); }
+};
+
+
+// Transparent equality to go with `TransparentStringHash`.
+struct TransparentStringEqual {
+  using is_transparent = void;
+
+  bool operator()(std::string_view a, std::string_view b) const
+    { return a == b; }
+};
+
+
+// Adapter that lets a table keyed by `KEY const *` use one of the
+// function-pointer hash functions accepted by `HashTable` and its
+// typed wrappers.
+template <typename KEY>
+class FunctionPointerHash {
+public:      // types
+  typedef unsigned (*HashFn)(KEY const *key);
+
+private:     // data
+  HashFn m_hashFn;
+
+public:      // methods
+  explicit FunctionPointerHash(HashFn hashFn = nullptr)
+    : m_hashFn(hashFn)
+  {}
+
+  std::size_t operator()(KEY const *key) const
+    { return m_hashFn(key); }
+};
+
+
+// Adapter for a function-pointer key equality function.
+template <typename KEY>
+class FunctionPointerEqual {
+public:      // types
+  typedef bool (*EqualKeyFn)(KEY const *key1, KEY const *key2);
+
+private:     // data
+  EqualKeyFn m_equalFn;
+
+public:      // methods
+  explicit FunctionPointerEqual(EqualKeyFn equalFn = nullptr)
+    : m_equalFn(equalFn)
+  {}
+
+  bool operator()(KEY const *key1, KEY const *key2) const
+    { return m_equalFn(key1, key2); }
+};
+
+
+// The methods declared above are defined in `flat-hash-map-ops.h`.
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_FLAT_HASH_MAP_H
@@ -3,16 +3,31 @@
 
 #include "functional-set.h"            // module under test
 
-#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
-#include "sm-test.h"                   // DIAG, verbose
+#include "exc.h"                       // smbase::XAssert
+#include "nonport.h"                   // getMilliseconds
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "sm-random.h"                 // smbase::sm_random
+#include "sm-test.h"                   // DIAG, verbose, EXPECT_EQ
 #include "xassert.h"                   // xassert
 
+#include <algorithm>                   // std::set_{union, intersection, difference}
+#include <cstdlib>                     // std::{getenv, atoi}
+#include <functional>                  // std::hash
 #include <iostream>                    // std::cout
+#include <iterator>                    // std::back_inserter
+#include <set>                         // std::set
+#include <string>                      // std::string
+
+using smbase::sm_random;
 
 
 OPEN_ANONYMOUS_NAMESPACE
 
 
+// Number of calls to 'FSEInteger::fseHash'.
+int fseIntegerHashCalls = 0;
+
+
 class FSEInteger : public FSElement {
 public:      // data
   int const m_i;
@@ -38,6 +53,76 @@ public:      // methods
   {
     os << m_i;
   }
+
+  std::size_t fseHash() const override
+  {
+    fseIntegerHashCalls++;
+    return (std::size_t)m_i;
+  }
+};
+
+
+// Like FSEInteger, but with string values.
+class FSEName : public FSElement {
+public:      // data
+  std::string const m_name;
+
+public:      // methods
+  explicit FSEName(std::string const &name)
+    : m_name(name)
+  {}
+
+  char const *fseKind() const override
+  {
+    return "FSEName";
+  }
+
+  StrongOrdering compareTo(FSElement const &obj_) const override
+  {
+    FSELEMENT_COMPARETO_PRELUDE(FSEName);
+
+    return strongOrder(m_name, obj.m_name);
+  }
+
+  void print(std::ostream &os) const override
+  {
+    os << m_name;
+  }
+
+  std::size_t fseHash() const override
+  {
+    return std::hash<std::string>()(m_name);
+  }
+};
+
+
+// An element that does not override 'fseHash', so it can only be used
+// without hash-consing.
+class FSEUnhashed : public FSElement {
+public:      // data
+  int const m_i;
+
+public:      // methods
+  explicit FSEUnhashed(int i)
+    : m_i(i)
+  {}
+
+  char const *fseKind() const override
+  {
+    return "FSEUnhashed";
+  }
+
+  StrongOrdering compareTo(FSElement const &obj_) const override
+  {
+    FSELEMENT_COMPARETO_PRELUDE(FSEUnhashed);
+
+    return strongOrder(m_i, obj.m_i);
+  }
+
+  void print(std::ostream &os) const override
+  {
+    os << m_i;
+  }
 };
 
 
@@ -88,6 +173,371 @@ static void testBasics()
 }
 
 
+// Build a set of FSEIntegers from 'ints'.
+static RCPtr<FunctionalSet> setFromInts(FunctionalSetManager &fsm,
+                                        std::set<int> const &ints)
+{
+  std::vector<RCPtr<FSElement> > vec;
+  for (int i : ints) {
+    vec.push_back(rcptr(new FSEInteger(i)));
+  }
+  return fsm.setFromVector(vec);
+}
+
+
+// Check that 'set' has the elements 'ints'.
+static void checkSetEquals(FunctionalSet const &set,
+                           std::set<int> const &ints)
+{
+  set.checkInvariants();
+  EXPECT_EQ(set.size(), ints.size());
+
+  FunctionalSet::size_type index = 0;
+  for (int i : ints) {
+    FSEInteger const *elt = dynamic_cast<FSEInteger const *>(set.at(index));
+    xassert(elt);
+    EXPECT_EQ(elt->m_i, i);
+    ++index;
+  }
+}
+
+
+static std::set<int> randomInts(int maxSize, int range)
+{
+  std::set<int> ret;
+  for (int n = sm_random(maxSize+1); n > 0; n--) {
+    ret.insert(sm_random(range));
+  }
+  return ret;
+}
+
+
+// Compare the set operations to those on std::set, for sets of a
+// variety of sizes and degrees of overlap.
+static void testRandomOperations(bool hashCons)
+{
+  DIAG("testRandomOperations(" << hashCons << ")");
+
+  FunctionalSetManager fsm(hashCons);
+  EXPECT_EQ(fsm.hashConsing(), hashCons);
+
+  smbase_loopi(300) {
+    int range = 1 + sm_random(i < 150? 50 : 2000);
+    std::set<int> aInts = randomInts(i < 150? 30 : 500, range);
+    std::set<int> bInts = randomInts(sm_random(2)? 10 : 500, range);
+
+    RCPtr<FunctionalSet> a = setFromInts(fsm, aInts);
+    RCPtr<FunctionalSet> b = setFromInts(fsm, bInts);
+    checkSetEquals(*a, aInts);
+    checkSetEquals(*b, bInts);
+
+    std::set<int> expect;
+    std::set_union(aInts.begin(), aInts.end(), bInts.begin(), bInts.end(),
+                   std::inserter(expect, expect.end()));
+    RCPtr<FunctionalSet> u = fsm.unionSet(a, b);
+    checkSetEquals(*u, expect);
+
+    expect.clear();
+    std::set_intersection(aInts.begin(), aInts.end(),
+                          bInts.begin(), bInts.end(),
+                          std::inserter(expect, expect.end()));
+    RCPtr<FunctionalSet> n = fsm.intersection(a, b);
+    checkSetEquals(*n, expect);
+
+    expect.clear();
+    std::set_difference(aInts.begin(), aInts.end(),
+                        bInts.begin(), bInts.end(),
+                        std::inserter(expect, expect.end()));
+    RCPtr<FunctionalSet> d = fsm.difference(a, b);
+    checkSetEquals(*d, expect);
+
+    // Membership.
+    smbase_loopj(10) {
+      int x = sm_random(range);
+      FSEInteger elt(x);
+      EXPECT_EQ(u->contains(&elt), aInts.count(x) || bInts.count(x));
+    }
+
+    // Sets built in different ways are equal, and hash alike.  With
+    // hash-consing, they are the same object.
+    RCPtr<FunctionalSet> u2 =
+      fsm.unionSet(fsm.difference(u, b), fsm.intersection(b, u));
+    RCPtr<FunctionalSet> n2 = fsm.intersection(b, a);
+    xassert(*u2 == *u);
+    xassert(*n2 == *n);
+    EXPECT_EQ(u2->fseHash(), u->fseHash());
+    EXPECT_EQ(n2->fseHash(), n->fseHash());
+    if (hashCons) {
+      xassert(u2 == u);
+      xassert(n2 == n);
+    }
+
+    // Compare as elements.
+    xassert(a->compareTo(*b) ==
+            (aInts < bInts? StrongOrdering::less :
+             aInts > bInts? StrongOrdering::greater :
+                            StrongOrdering::equal));
+  }
+
+  fsm.checkInvariants();
+  if (!hashCons) {
+    EXPECT_EQ(fsm.numSets(), (FunctionalSet::size_type)0);
+  }
+}
+
+
+// Add and then remove elements one at a time, in order, which keeps
+// pushing the trees out of balance in the same direction.
+static void testIncremental()
+{
+  DIAG("testIncremental");
+
+  FunctionalSetManager fsm;
+  RCPtr<FunctionalSet> set = fsm.emptySet();
+  std::set<int> ints;
+  for (int i=0; i < 300; i++) {
+    set = fsm.unionSet(set, fsm.singleton(rcptr(new FSEInteger(i))));
+    ints.insert(i);
+    checkSetEquals(*set, ints);
+  }
+  for (int i=299; i >= 0; i -= 2) {
+    set = fsm.difference(set, fsm.singleton(rcptr(new FSEInteger(i))));
+    ints.erase(i);
+    checkSetEquals(*set, ints);
+  }
+  for (int i=0; i < 300; i += 2) {
+    set = fsm.difference(set, fsm.singleton(rcptr(new FSEInteger(i))));
+    ints.erase(i);
+    checkSetEquals(*set, ints);
+  }
+  xassert(set == fsm.emptySet());
+}
+
+
+// When an operation does not change its first operand, it returns it
+// rather than a copy.
+static void testSharing()
+{
+  DIAG("testSharing");
+
+  // Turn off hash-consing so it does not hide whether a new set was
+  // made.
+  FunctionalSetManager fsm(false /*hashCons*/);
+
+  std::set<int> evens, odds;
+  for (int i=0; i < 1000; i += 2) {
+    evens.insert(i);
+    odds.insert(i+1);
+  }
+  RCPtr<FunctionalSet> a = setFromInts(fsm, evens);
+  RCPtr<FunctionalSet> b = setFromInts(fsm, odds);
+
+  RCPtr<FunctionalSet> evenSubset =
+    setFromInts(fsm, std::set<int>{ 0, 10, 200, 998 });
+  xassert(fsm.unionSet(a, evenSubset) == a);
+  xassert(fsm.unionSet(a, fsm.emptySet()) == a);
+  xassert(fsm.unionSet(fsm.emptySet(), a) == a);
+  xassert(fsm.intersection(a, a) == a);
+  xassert(fsm.difference(a, b) == a);
+  xassert(fsm.difference(a, evenSubset) != a);
+  xassert(fsm.difference(a, a) == fsm.emptySet());
+  xassert(fsm.intersection(a, b) == fsm.emptySet());
+
+  // The intersection with a superset is the same set.
+  RCPtr<FunctionalSet> all = fsm.unionSet(a, b);
+  checkSetEquals(*all, [&]() {
+    std::set<int> s(evens);
+    s.insert(odds.begin(), odds.end());
+    return s;
+  }());
+  xassert(fsm.intersection(a, all) == a);
+
+  // Without hash-consing, an equal set built separately is a distinct
+  // object, but still compares equal.
+  RCPtr<FunctionalSet> a2 = setFromInts(fsm, evens);
+  xassert(a2 != a);
+  xassert(*a2 == *a);
+  EXPECT_EQ(a2->fseHash(), a->fseHash());
+}
+
+
+// Elements are only hashed when hash-consing, and only once.
+static void testHashCalls()
+{
+  DIAG("testHashCalls");
+
+  std::set<int> evens, odds;
+  for (int i=0; i < 1000; i += 2) {
+    evens.insert(i);
+  }
+  odds = std::set<int>{ 1, 501, 997 };
+
+  {
+    FunctionalSetManager fsm(false /*hashCons*/);
+    fseIntegerHashCalls = 0;
+    RCPtr<FunctionalSet> a = setFromInts(fsm, evens);
+    RCPtr<FunctionalSet> b = setFromInts(fsm, odds);
+    RCPtr<FunctionalSet> u = fsm.unionSet(a, b);
+    fsm.difference(u, b);
+    fsm.intersection(u, a);
+    EXPECT_EQ(fseIntegerHashCalls, 0);
+  }
+
+  {
+    FunctionalSetManager fsm(true /*hashCons*/);
+    fseIntegerHashCalls = 0;
+    RCPtr<FunctionalSet> a = setFromInts(fsm, evens);
+    EXPECT_EQ(fseIntegerHashCalls, 500);
+    RCPtr<FunctionalSet> b = setFromInts(fsm, odds);
+    EXPECT_EQ(fseIntegerHashCalls, 503);
+
+    // The union is made of nodes rebuilt around elements of 'a' and
+    // 'b', whose hashes are already known.
+    RCPtr<FunctionalSet> u = fsm.unionSet(a, b);
+    EXPECT_EQ(fseIntegerHashCalls, 503);
+    xassert(fsm.difference(u, b) == a);
+    xassert(fsm.intersection(u, b) == b);
+    EXPECT_EQ(fseIntegerHashCalls, 503);
+
+    std::set<int> all(evens);
+    all.insert(odds.begin(), odds.end());
+    xassert(setFromInts(fsm, all) == u);
+  }
+}
+
+
+// Elements without a hash work when not hash-consing, and are rejected
+// with a clear message otherwise.
+static void testUnhashed()
+{
+  DIAG("testUnhashed");
+
+  {
+    FunctionalSetManager fsm(false /*hashCons*/);
+    RCPtr<FunctionalSet> a = fsm.emptySet();
+    smbase_loopi(100) {
+      a = fsm.unionSet(a, fsm.singleton(rcptr(new FSEUnhashed(i*2))));
+    }
+    RCPtr<FunctionalSet> b = fsm.singleton(rcptr(new FSEUnhashed(10)));
+    EXPECT_EQ(a->size(), (FunctionalSet::size_type)100);
+    EXPECT_EQ(fsm.intersection(a, b)->size(), (FunctionalSet::size_type)1);
+    EXPECT_EQ(fsm.difference(a, b)->size(), (FunctionalSet::size_type)99);
+    fsm.checkInvariants();
+  }
+
+  {
+    FunctionalSetManager fsm(true /*hashCons*/);
+    bool threw = false;
+    try {
+      fsm.singleton(rcptr(new FSEUnhashed(1)));
+    }
+    catch (smbase::XAssert &x) {
+      DIAG("as expected: " << x.why());
+      threw = true;
+    }
+    xassert(threw);
+  }
+}
+
+
+// Sets of sets, and of elements other than FSEInteger.
+static void testNesting()
+{
+  DIAG("testNesting");
+
+  FunctionalSetManager fsm;
+
+  RCPtr<FunctionalSet> ab = fsm.unionSet(
+    fsm.singleton(rcptr(new FSEName("a"))),
+    fsm.singleton(rcptr(new FSEName("b"))));
+  RCPtr<FunctionalSet> ba = fsm.unionSet(
+    fsm.singleton(rcptr(new FSEName("b"))),
+    fsm.singleton(rcptr(new FSEName("a"))));
+  xassert(ab == ba);
+  EXPECT_EQ(ab->toString(), std::string("{ a, b }"));
+
+  RCPtr<FunctionalSet> c = fsm.singleton(rcptr(new FSEName("c")));
+  RCPtr<FunctionalSet> setOfSets1 = fsm.unionSet(
+    fsm.singleton(ab), fsm.singleton(c));
+  RCPtr<FunctionalSet> setOfSets2 = fsm.unionSet(
+    fsm.singleton(c), fsm.singleton(ba));
+  xassert(setOfSets1 == setOfSets2);
+  EXPECT_EQ(setOfSets1->size(), (FunctionalSet::size_type)2);
+  EXPECT_EQ(setOfSets1->toString(), std::string("{ { a, b }, { c } }"));
+
+  fsm.checkInvariants();
+}
+
+
+// Merge-based union, which is how 'unionSet' used to work.
+static RCPtr<FunctionalSet> flatUnion(FunctionalSetManager &fsm,
+                                      RCPtr<FunctionalSet> a,
+                                      RCPtr<FunctionalSet> b)
+{
+  std::vector<RCPtr<FSElement> > avec;
+  std::vector<RCPtr<FSElement> > bvec;
+  a->getElements(avec);
+  b->getElements(bvec);
+
+  std::vector<RCPtr<FSElement> > vec;
+  std::set_union(avec.begin(), avec.end(), bvec.begin(), bvec.end(),
+    std::back_inserter(vec),
+    [](RCPtr<FSElement> const &x, RCPtr<FSElement> const &y) {
+      return *x < *y;
+    });
+  return fsm.setFromVector(vec);
+}
+
+
+// Time adding a few elements at a time to a large set.
+// FUNCTIONAL_SET_PERF is the size of the large set.
+static void perfTest()
+{
+  char const *nStr = std::getenv("FUNCTIONAL_SET_PERF");
+  if (!nStr) {
+    return;
+  }
+  int n = std::atoi(nStr);
+
+  FunctionalSetManager fsm;
+  std::set<int> ints;
+  for (int i=0; i < n; i++) {
+    ints.insert(i*2);
+  }
+  RCPtr<FunctionalSet> big = setFromInts(fsm, ints);
+
+  // Small sets of odd numbers.
+  std::vector<RCPtr<FunctionalSet> > smalls;
+  smbase_loopi(1000) {
+    std::set<int> s;
+    smbase_loopj(10) {
+      s.insert(sm_random(n)*2 + 1);
+    }
+    smalls.push_back(setFromInts(fsm, s));
+  }
+
+  long start = getMilliseconds();
+  FunctionalSet::size_type total = 0;
+  for (auto const &s : smalls) {
+    total += fsm.unionSet(big, s)->size();
+  }
+  long splitMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  FunctionalSet::size_type flatTotal = 0;
+  for (auto const &s : smalls) {
+    flatTotal += flatUnion(fsm, big, s)->size();
+  }
+  long flatMs = getMilliseconds() - start;
+  xassert(total == flatTotal);
+
+  std::cout << "1000 unions of a " << n << "-element set with a "
+            << "10-element set:\n"
+            << "  split-based: " << splitMs << " ms\n"
+            << "  merge-based: " << flatMs << " ms\n";
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
@@ -95,6 +545,14 @@ CLOSE_ANONYMOUS_NAMESPACE
 void test_functional_set()
 {
   testBasics();
+  testRandomOperations(true /*hashCons*/);
+  testRandomOperations(false /*hashCons*/);
+  testIncremental();
+  testSharing();
+  testHashCalls();
+  testUnhashed();
+  testNesting();
+  perfTest();
 }
 
 
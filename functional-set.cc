@@ -3,8 +3,10 @@
 
 #include "functional-set.h"            // this module
 
-#include "xassert.h"                   // xassert
+#include "stringb.h"                   // stringbc
+#include "xassert.h"                   // xassert, xfailure_stringbc
 
+#include <cstdint>                     // std::uint64_t
 #include <iostream>                    // std::ostream
 #include <sstream>                     // std::ostringstream
 
@@ -16,6 +18,13 @@ StrongOrdering FSElement::compareKinds(FSElement const &obj) const
 }
 
 
+std::size_t FSElement::fseHash() const
+{
+  xfailure_stringbc("FSElement kind " << fseKind() <<
+                    " must override fseHash to be used with hash-consing.");
+}
+
+
 std::string FSElement::toString() const
 {
   std::ostringstream oss;
@@ -25,6 +34,18 @@ std::string FSElement::toString() const
 
 
 // ------------------------- FunctionalSet -----------------------------
+// Scramble an element hash before adding it to a set hash, so that
+// sets with different elements are unlikely to have the same sum.
+// This is the finalizer of SplitMix64.
+static std::size_t mixElementHash(std::size_t h)
+{
+  std::uint64_t z = h;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return (std::size_t)(z ^ (z >> 31));
+}
+
+
 FunctionalSet::FunctionalSet(RCPtr<FunctionalSet> left,
                              RCPtr<FSElement> middle,
                              RCPtr<FunctionalSet> right)
@@ -33,7 +54,11 @@ FunctionalSet::FunctionalSet(RCPtr<FunctionalSet> left,
     m_right(right),
     m_size((left  ? left->size()  : 0) +
            (middle? 1             : 0) +
-           (right ? right->size() : 0))
+           (right ? right->size() : 0)),
+    m_hash(0),
+    m_hashed(false),
+    m_middleHash(0),
+    m_middleHashed(false)
 {
   checkSizes();
 }
@@ -47,7 +72,7 @@ FSElement const *FunctionalSet::at(size_type index) const
 {
   xassert(0 <= index && index < size());
 
-  size_type middleIndex = leftSizeForTotal(m_size);
+  size_type middleIndex = sizeOf(m_left);
 
   if (index < middleIndex) {
     xassert(m_left);
@@ -144,12 +169,16 @@ void FunctionalSet::checkBounds(
 
 void FunctionalSet::checkSizes() const
 {
-  if (m_left) {
-    xassert(m_left->size() == leftSizeForTotal(m_size));
-  }
-  if (m_right) {
-    xassert(m_right->size() == rightSizeForTotal(m_size));
+  // Only the empty set lacks a middle element, and it has no subtrees.
+  if (!m_middle) {
+    xassert(!m_left && !m_right);
   }
+
+  // Subtrees are NULL rather than empty.
+  xassert(!m_left || !m_left->empty());
+  xassert(!m_right || !m_right->empty());
+
+  xassert(isBalanced(sizeOf(m_left), sizeOf(m_right)));
 }
 
 
@@ -159,35 +188,92 @@ char const *FunctionalSet::fseKind() const
 }
 
 
-StrongOrdering FunctionalSet::compareTo(FSElement const &obj_) const
+std::size_t FunctionalSet::fseHash() const
 {
-  FSELEMENT_COMPARETO_PRELUDE(FunctionalSet);
+  if (!m_hashed) {
+    // Subtrees shared with sets hashed earlier already have their
+    // sums, so this only visits the nodes built since then.
+    std::size_t h = 0;
+    if (m_left) {
+      h += m_left->fseHash();
+    }
+    if (m_middle) {
+      if (!m_middleHashed) {
+        m_middleHash = mixElementHash(m_middle->fseHash());
+        m_middleHashed = true;
+      }
+      h += m_middleHash;
+    }
+    if (m_right) {
+      h += m_right->fseHash();
+    }
+    m_hash = h;
+    m_hashed = true;
+  }
+  return m_hash;
+}
 
-  // For now, use the naive algorithm: get all elements, then compare
-  // them in order.
 
-  std::vector<RCPtr<FSElement> > avec;
-  std::vector<RCPtr<FSElement> > bvec;
+// Iterate over the elements of a set in order, without first copying
+// them into a vector.
+class FunctionalSetIter {
+private:     // data
+  // Nodes whose middle element and right subtree remain to be visited,
+  // innermost last.
+  std::vector<FunctionalSet const *> m_stack;
+
+private:     // methods
+  // Push 't' and its chain of left children.
+  void pushLeftSpine(FunctionalSet const * /*nullable*/ t)
+  {
+    for (; t; t = t->m_left) {
+      m_stack.push_back(t);
+    }
+  }
 
-  this->getElements(avec);
-  obj.getElements(bvec);
+public:      // methods
+  explicit FunctionalSetIter(FunctionalSet const &set)
+  {
+    if (!set.empty()) {
+      pushLeftSpine(&set);
+    }
+  }
 
-  size_type ai = 0;
-  size_type bi = 0;
-  while (ai < avec.size() && bi < bvec.size()) {
-    StrongOrdering ord = avec[ai]->compareTo(*(bvec[bi]));
+  bool isDone() const { return m_stack.empty(); }
+
+  FSElement const &data() const { return *(m_stack.back()->m_middle); }
+
+  void adv()
+  {
+    FunctionalSet const *t = m_stack.back();
+    m_stack.pop_back();
+    pushLeftSpine(t->m_right);
+  }
+};
+
+
+StrongOrdering FunctionalSet::compareTo(FSElement const &obj_) const
+{
+  FSELEMENT_COMPARETO_PRELUDE(FunctionalSet);
+
+  if (this == &obj) {
+    return StrongOrdering::equal;
+  }
+
+  FunctionalSetIter a(*this);
+  FunctionalSetIter b(obj);
+  for (; !a.isDone() && !b.isDone(); a.adv(), b.adv()) {
+    StrongOrdering ord = a.data().compareTo(b.data());
     if (ord != StrongOrdering::equal) {
       return ord;
     }
-    ++ai;
-    ++bi;
   }
 
-  if (bi < bvec.size()) {
+  if (!b.isDone()) {
     // 'a' (meaning 'this') ended first, so it is less.
     return StrongOrdering::less;
   }
-  else if (ai < avec.size()) {
+  else if (!a.isDone()) {
     return StrongOrdering::greater;
   }
   else {
@@ -233,186 +319,398 @@ void FunctionalSet::printElements(std::ostream &os) const
 }
 
 
-// ---------------------- FunctionalSetManager -------------------------
-FunctionalSetManager::FunctionalSetManager()
-  : m_sets()
-{}
+// ------------------- FunctionalSet tree algorithms -------------------
+// These follow Adams, and Haskell's Data.Set.  Whenever the result of
+// an operation is equal to one of its operands, the operand itself is
+// returned, so unchanged subtrees are shared rather than rebuilt.
+
+FunctionalSet::Tree FunctionalSet::node(
+  FunctionalSet *l, Elt const &x, FunctionalSet *r)
+{
+  Tree ret(new FunctionalSet(Tree(l), RCPtr<FSElement>(x.m_elt), Tree(r)));
+  ret->m_middleHash = x.m_mixedHash;
+  ret->m_middleHashed = x.m_hashed;
+  return ret;
+}
 
 
-FunctionalSetManager::~FunctionalSetManager()
-{}
+FunctionalSet::Tree FunctionalSet::balance(
+  FunctionalSet *l, Elt const &x, FunctionalSet *r)
+{
+  size_type sl = sizeOf(l);
+  size_type sr = sizeOf(r);
 
+  if (sl + sr <= 1) {
+    return node(l, x, r);
+  }
 
-RCPtr<FunctionalSet> FunctionalSetManager::setFromVector(
-  std::vector<RCPtr<FSElement> > const &vec)
+  if (sr > DELTA*sl) {
+    // Right is too big; rotate left.
+    FunctionalSet *rl = r->m_left;
+    FunctionalSet *rr = r->m_right;
+    if (sizeOf(rl) < RATIO*sizeOf(rr)) {
+      // Single rotation.
+      Tree newLeft = node(l, x, rl);
+      return node(newLeft, middleElt(r), rr);
+    }
+    else {
+      // Double rotation.
+      Tree newLeft = node(l, x, rl->m_left);
+      Tree newRight = node(rl->m_right, middleElt(r), rr);
+      return node(newLeft, middleElt(rl), newRight);
+    }
+  }
+
+  if (sl > DELTA*sr) {
+    // Left is too big; rotate right.
+    FunctionalSet *ll = l->m_left;
+    FunctionalSet *lr = l->m_right;
+    if (sizeOf(lr) < RATIO*sizeOf(ll)) {
+      Tree newRight = node(lr, x, r);
+      return node(ll, middleElt(l), newRight);
+    }
+    else {
+      Tree newLeft = node(ll, middleElt(l), lr->m_left);
+      Tree newRight = node(lr->m_right, x, r);
+      return node(newLeft, middleElt(lr), newRight);
+    }
+  }
+
+  return node(l, x, r);
+}
+
+
+FunctionalSet::Tree FunctionalSet::insertMin(Elt const &x, FunctionalSet *t)
 {
-  return setFromVectorRange(vec, 0, vec.size());
+  if (!t) {
+    return node(NULL, x, NULL);
+  }
+  Tree newLeft = insertMin(x, t->m_left);
+  return balance(newLeft, middleElt(t), t->m_right);
 }
 
 
-RCPtr<FunctionalSet> FunctionalSetManager::nullableSetFromVectorRange(
-  std::vector<RCPtr<FSElement> > const &vec,
-  std::size_t start, std::size_t end)
+FunctionalSet::Tree FunctionalSet::insertMax(Elt const &x, FunctionalSet *t)
 {
-  if (start == end) {
-    return RCPtr<FunctionalSet>(NULL);
+  if (!t) {
+    return node(NULL, x, NULL);
+  }
+  Tree newRight = insertMax(x, t->m_right);
+  return balance(t->m_left, middleElt(t), newRight);
+}
+
+
+FunctionalSet::Tree FunctionalSet::deleteFindMin(
+  FunctionalSet *t, FunctionalSet *&from)
+{
+  if (!t->m_left) {
+    from = t;
+    return t->m_right;
+  }
+  Tree newLeft = deleteFindMin(t->m_left, from);
+  return balance(newLeft, middleElt(t), t->m_right);
+}
+
+
+FunctionalSet::Tree FunctionalSet::deleteFindMax(
+  FunctionalSet *t, FunctionalSet *&from)
+{
+  if (!t->m_right) {
+    from = t;
+    return t->m_left;
+  }
+  Tree newRight = deleteFindMax(t->m_right, from);
+  return balance(t->m_left, middleElt(t), newRight);
+}
+
+
+FunctionalSet::Tree FunctionalSet::link(
+  FunctionalSet *l, Elt const &x, FunctionalSet *r)
+{
+  if (!l) {
+    return insertMin(x, r);
+  }
+  if (!r) {
+    return insertMax(x, l);
+  }
+
+  if (DELTA*l->m_size < r->m_size) {
+    Tree newLeft = link(l, x, r->m_left);
+    return balance(newLeft, middleElt(r), r->m_right);
+  }
+  if (DELTA*r->m_size < l->m_size) {
+    Tree newRight = link(l->m_right, x, r);
+    return balance(l->m_left, middleElt(l), newRight);
+  }
+  return node(l, x, r);
+}
+
+
+FunctionalSet::Tree FunctionalSet::merge(FunctionalSet *l, FunctionalSet *r)
+{
+  if (!l) {
+    return Tree(r);
+  }
+  if (!r) {
+    return Tree(l);
+  }
+
+  if (DELTA*l->m_size < r->m_size) {
+    Tree newLeft = merge(l, r->m_left);
+    return balance(newLeft, middleElt(r), r->m_right);
+  }
+  if (DELTA*r->m_size < l->m_size) {
+    Tree newRight = merge(l->m_right, r);
+    return balance(l->m_left, middleElt(l), newRight);
+  }
+
+  // The sizes are comparable, so take the new root from the bigger
+  // side.  'from' stays alive because it is part of 'l' or 'r'.
+  FunctionalSet *from = NULL;
+  if (l->m_size > r->m_size) {
+    Tree newLeft = deleteFindMax(l, from);
+    return balance(newLeft, middleElt(from), r);
   }
   else {
-    return setFromVectorRange(vec, start, end);
+    Tree newRight = deleteFindMin(r, from);
+    return balance(l, middleElt(from), newRight);
   }
 }
 
 
-RCPtr<FunctionalSet> FunctionalSetManager::setFromVectorRange(
+void FunctionalSet::split(FunctionalSet *t, FSElement const *x,
+                          Tree &less, bool &found, Tree &greater)
+{
+  if (!t) {
+    less.reset();
+    found = false;
+    greater.reset();
+    return;
+  }
+
+  StrongOrdering ord = x->compareTo(*(t->m_middle));
+  if (ord == StrongOrdering::less) {
+    Tree leftGreater;
+    split(t->m_left, x, less, found, leftGreater);
+    greater = link(leftGreater, middleElt(t), t->m_right);
+  }
+  else if (ord == StrongOrdering::greater) {
+    Tree rightLess;
+    split(t->m_right, x, rightLess, found, greater);
+    less = link(t->m_left, middleElt(t), rightLess);
+  }
+  else {
+    less = t->m_left;
+    found = true;
+    greater = t->m_right;
+  }
+}
+
+
+FunctionalSet::Tree FunctionalSet::unionTrees(
+  FunctionalSet *a, FunctionalSet *b)
+{
+  if (!b || a == b) {
+    return Tree(a);
+  }
+  if (!a) {
+    return Tree(b);
+  }
+
+  // Where 'a' and 'b' share an element, keep the one from 'a'.
+  Tree bLess, bGreater;
+  bool found;
+  split(b, a->m_middle, bLess, found, bGreater);
+
+  Tree newLeft = unionTrees(a->m_left, bLess);
+  Tree newRight = unionTrees(a->m_right, bGreater);
+  if (newLeft == a->m_left && newRight == a->m_right) {
+    return Tree(a);
+  }
+  return link(newLeft, middleElt(a), newRight);
+}
+
+
+FunctionalSet::Tree FunctionalSet::intersectTrees(
+  FunctionalSet *a, FunctionalSet *b)
+{
+  if (!a || !b) {
+    return Tree();
+  }
+  if (a == b) {
+    return Tree(a);
+  }
+
+  Tree bLess, bGreater;
+  bool found;
+  split(b, a->m_middle, bLess, found, bGreater);
+
+  Tree newLeft = intersectTrees(a->m_left, bLess);
+  Tree newRight = intersectTrees(a->m_right, bGreater);
+  if (found) {
+    if (newLeft == a->m_left && newRight == a->m_right) {
+      return Tree(a);
+    }
+    return link(newLeft, middleElt(a), newRight);
+  }
+  else {
+    return merge(newLeft, newRight);
+  }
+}
+
+
+FunctionalSet::Tree FunctionalSet::differenceTrees(
+  FunctionalSet *a, FunctionalSet *b)
+{
+  if (!a || a == b) {
+    return Tree();
+  }
+  if (!b) {
+    return Tree(a);
+  }
+
+  Tree aLess, aGreater;
+  bool found;
+  split(a, b->m_middle, aLess, found, aGreater);
+
+  Tree newLeft = differenceTrees(aLess, b->m_left);
+  Tree newRight = differenceTrees(aGreater, b->m_right);
+  if (sizeOf(newLeft) + sizeOf(newRight) == a->m_size) {
+    // Nothing was removed.
+    return Tree(a);
+  }
+  return merge(newLeft, newRight);
+}
+
+
+FunctionalSet::Tree FunctionalSet::buildTree(
   std::vector<RCPtr<FSElement> > const &vec,
   std::size_t start, std::size_t end)
 {
-  // Candidate new set for insertion.
-  RCPtr<FunctionalSet> newSet;
+  if (start == end) {
+    return Tree();
+  }
+
+  std::size_t mid = start + leftSizeForTotal(end-start);
+  Tree left = buildTree(vec, start, mid);
+  Tree right = buildTree(vec, mid+1, end);
+  return node(left, Elt(vec[mid]), right);
+}
+
+
+// ---------------------- FunctionalSetManager -------------------------
+bool RCPtrFunctionalSetEqual::operator() (
+  RCPtr<FunctionalSet> const &a, RCPtr<FunctionalSet> const &b) const
+{
+  return a == b ||
+         (a->size() == b->size() &&
+          a->fseHash() == b->fseHash() &&
+          a->compareTo(*b) == StrongOrdering::equal);
+}
+
+
+// Convert a set to the tree representation, where empty is NULL.
+static FunctionalSet *asTree(FunctionalSet *set)
+{
+  return set->empty()? NULL : set;
+}
+
 
-  // Build the candidate set.
-  size_type n = end-start;
-  if (n == 0) {
-    newSet = new FunctionalSet(
+FunctionalSetManager::FunctionalSetManager(bool hashCons)
+  : m_hashCons(hashCons),
+    m_sets(),
+    m_emptySet(new FunctionalSet(
       RCPtr<FunctionalSet>(NULL),      // left
       RCPtr<FSElement>(NULL),          // middle
       RCPtr<FunctionalSet>(NULL)       // right
-    );
+    ))
+{}
+
+
+FunctionalSetManager::~FunctionalSetManager()
+{}
+
+
+RCPtr<FunctionalSet> FunctionalSetManager::intern(RCPtr<FunctionalSet> s)
+{
+  if (s->empty()) {
+    return m_emptySet;
   }
-  else {
-    size_type leftSize = FunctionalSet::leftSizeForTotal(n);
-    size_type rightSize = FunctionalSet::rightSizeForTotal(n);
-    newSet = new FunctionalSet(
-      nullableSetFromVectorRange(vec, 0, leftSize),
-      vec[start+leftSize],
-      nullableSetFromVectorRange(vec, leftSize+1, leftSize+1+rightSize)
-    );
+  if (!m_hashCons) {
+    return s;
   }
 
   // See if we already have it.
-  auto it = m_sets.insert(newSet);
-  if (!it.second) {
-    // Use the existing value instead.
-    newSet = *(it.first);
+  auto it = m_sets.insert(s);
+  return *(it.first);
+}
+
+
+RCPtr<FunctionalSet> FunctionalSetManager::finish(RCPtr<FunctionalSet> tree)
+{
+  if (!tree) {
+    return m_emptySet;
   }
+  return intern(tree);
+}
+
 
-  return newSet;
+RCPtr<FunctionalSet> FunctionalSetManager::setFromVector(
+  std::vector<RCPtr<FSElement> > const &vec)
+{
+  return setFromVectorRange(vec, 0, vec.size());
+}
+
+
+RCPtr<FunctionalSet> FunctionalSetManager::setFromVectorRange(
+  std::vector<RCPtr<FSElement> > const &vec,
+  std::size_t start, std::size_t end)
+{
+  xassert(start <= end && end <= vec.size());
+  return finish(FunctionalSet::buildTree(vec, start, end));
 }
 
 
 RCPtr<FunctionalSet> FunctionalSetManager::emptySet()
 {
-  std::vector<RCPtr<FSElement> > vec;
-  return setFromVector(vec);
+  return m_emptySet;
 }
 
 
 RCPtr<FunctionalSet> FunctionalSetManager::singleton(RCPtr<FSElement> elt)
 {
-  std::vector<RCPtr<FSElement> > vec;
-  vec.push_back(elt);
-  return setFromVector(vec);
+  return finish(FunctionalSet::node(NULL, FunctionalSet::Elt(elt), NULL));
 }
 
 
 RCPtr<FunctionalSet> FunctionalSetManager::unionSet(
   RCPtr<FunctionalSet> a, RCPtr<FunctionalSet> b)
 {
-  std::vector<RCPtr<FSElement> > avec;
-  std::vector<RCPtr<FSElement> > bvec;
-
-  a->getElements(avec);
-  b->getElements(bvec);
-
-  // Construct 'vec' by merging 'avec' and 'bvec'.
-  std::vector<RCPtr<FSElement> > vec;
-
-  size_type ai = 0;
-  size_type bi = 0;
-  while (ai < avec.size() && bi < bvec.size()) {
-    StrongOrdering ord = avec[ai]->compareTo(*(bvec[bi]));
-    if (ord == StrongOrdering::less) {
-      // Take the element from 'a'.
-      vec.push_back(avec[ai]);
-      ++ai;
-    }
-    else if (ord == StrongOrdering::greater) {
-      // Take from 'b'.
-      vec.push_back(bvec[bi]);
-      ++bi;
-    }
-    else {
-      // Take from either (they are equal) and advance both.
-      vec.push_back(avec[ai]);
-      ++ai;
-      ++bi;
-    }
-  }
-
-  // Append whatever was left over.
-  while (ai < avec.size()) {
-    vec.push_back(avec[ai++]);
-  }
-  while (bi < bvec.size()) {
-    vec.push_back(bvec[bi++]);
-  }
-
-  return setFromVector(vec);
+  return finish(FunctionalSet::unionTrees(asTree(a), asTree(b)));
 }
 
 
 RCPtr<FunctionalSet> FunctionalSetManager::intersection(
   RCPtr<FunctionalSet> a, RCPtr<FunctionalSet> b)
 {
-  std::vector<RCPtr<FSElement> > avec;
-  std::vector<RCPtr<FSElement> > bvec;
-
-  a->getElements(avec);
-  b->getElements(bvec);
-
-  // Construct 'vec' by merging 'avec' and 'bvec'.
-  std::vector<RCPtr<FSElement> > vec;
-
-  size_type ai = 0;
-  size_type bi = 0;
-  while (ai < avec.size() && bi < bvec.size()) {
-    StrongOrdering ord = avec[ai]->compareTo(*(bvec[bi]));
-    if (ord == StrongOrdering::less) {
-      // Skip element from 'a'.
-      ++ai;
-    }
-    else if (ord == StrongOrdering::greater) {
-      // Skip from 'b'.
-      ++bi;
-    }
-    else {
-      // Take from either (they are equal) and advance both.
-      vec.push_back(avec[ai]);
-      ++ai;
-      ++bi;
-    }
-  }
+  return finish(FunctionalSet::intersectTrees(asTree(a), asTree(b)));
+}
 
-  // Ignore whatever was left over.
 
-  return setFromVector(vec);
+RCPtr<FunctionalSet> FunctionalSetManager::difference(
+  RCPtr<FunctionalSet> a, RCPtr<FunctionalSet> b)
+{
+  return finish(FunctionalSet::differenceTrees(asTree(a), asTree(b)));
 }
 
 
 void FunctionalSetManager::checkInvariants() const
 {
-  // Each iteration is linear in the size of its respective set (both
-  // the comparison and 'checkInvariants' are linear), so the entire
-  // procedure is worst-case quadratic.
+  m_emptySet->checkInvariants();
+  xassert(m_emptySet->empty());
 
-  RCPtr<FunctionalSet> prev(NULL);
   for (auto p : m_sets) {
-    // Make sure the order is right.
-    if (prev) {
-      xassert(prev->compareTo(*p) == StrongOrdering::less);
-    }
-    prev = p;
-
+    xassert(!p->empty());
     p->checkInvariants();
   }
 }
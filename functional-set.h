@@ -10,8 +10,8 @@
 
 #include <cstddef>                     // std::size_t
 #include <iosfwd>                      // std::ostream
-#include <set>                         // std::set
 #include <string>                      // std::string
+#include <unordered_set>               // std::unordered_set
 #include <vector>                      // std::vector
 
 
@@ -46,6 +46,14 @@ public:      // methods
   // Render the value as a string.
   virtual void print(std::ostream &os) const = 0;
 
+  // Return a hash of the value.  Elements that compare as equal must
+  // have the same hash.  This is only called when a
+  // FunctionalSetManager is hash-consing, and FunctionalSet remembers
+  // the result for each element it holds.  Element classes that are
+  // only used without hash-consing need not override it; the default
+  // fails an assertion.
+  virtual std::size_t fseHash() const;
+
   // Capture the result of 'print(ostream)'.
   std::string toString() const;
 };
@@ -80,32 +88,61 @@ inline std::ostream& operator<< (std::ostream &os, FSElement const &obj)
 // lexicographic on the sorted element sequences (what 'getElements'
 // returns).
 //
+// The tree is weight-balanced, as in Adams' "Implementing Sets
+// Efficiently in a Functional Language": neither subtree of a node has
+// more than DELTA times as many elements as the other.  This allows
+// union, intersection and difference to work by splitting one tree
+// around the root of the other and joining the results, which takes
+// O(m log(n/m+1)) time for sets of sizes m <= n, and leaves subtrees
+// that are not affected shared between the operands and the result.
+//
 class FunctionalSet : public FSElement {
   // Set objects should not be copied since they are immutable, so
   // clients can simply copy pointers (with reference counting as
   // needed).
   NO_OBJECT_COPIES(FunctionalSet);
 
+  // The manager uses the tree algorithms below, and the iterator in
+  // the implementation walks the tree directly.
+  friend class FunctionalSetManager;
+  friend class FunctionalSetIter;
+
 public:      // types
   // Type for element count and indices.
   typedef std::size_t size_type;
 
+  // Balance parameters.  A node is balanced if its subtrees have at
+  // most one element between them, or neither has more than DELTA
+  // times as many elements as the other.  RATIO decides between a
+  // single and a double rotation when restoring balance.  These are
+  // the values used by Haskell's Data.Set, shown to be correct by
+  // Straka.
+  enum { DELTA = 3, RATIO = 2 };
+
+private:     // types
+  // A subtree, or NULL for an empty one.  Within the tree, empty
+  // subtrees are always NULL; only a top-level set can be a node with
+  // a NULL 'm_middle'.
+  typedef RCPtr<FunctionalSet> Tree;
+
+  // An element to put in a new node, along with its mixed hash if the
+  // node it came from already had it, so that rebuilding a node around
+  // an element does not hash it again.
+  struct Elt {
+    FSElement *m_elt;
+    std::size_t m_mixedHash;
+    bool m_hashed;
+
+    Elt(FSElement *elt, std::size_t mixedHash = 0, bool hashed = false)
+      : m_elt(elt), m_mixedHash(mixedHash), m_hashed(hashed) {}
+  };
+
 private:     // data
   // All elements in the set less than 'm_middle', or NULL if there are
   // no elements to the left.
   RCPtr<FunctionalSet> m_left;
 
-  // Middle element of the set.  If there are N elements in the set, and
-  // N >= 1, then 'm_left' contains floor(N/2) elements, 'm_right'
-  // contains floor((N-1)/2) elements, and 'm_middle' is the element at
-  // index floor(N/2).
-  //
-  //
-  //                            left          middle right
-  // Example with N=5 elements: floor(5/2)==2   1    floor(4/2)==2
-  // Example with N=4 elements: floor(4/2)==2   1    floor(3/2)==1
-  //
-  // This is NULL iff the set is empty.
+  // Middle element of the set.  This is NULL iff the set is empty.
   RCPtr<FSElement> m_middle;
 
   // All elements in the set greater than 'm_middle', or NULL if there
@@ -115,12 +152,77 @@ private:     // data
   // Number of elements in this set.
   size_type m_size;
 
+  // The hashes are computed on demand, by 'fseHash()', so they cost
+  // nothing unless a hash-consing FunctionalSetManager asks for them.
+  //
+  // Hash of the elements: the sum of a mix of each one's 'fseHash()'.
+  // Since addition is commutative and associative, this depends only
+  // on the elements, not the shape of the tree.  Valid if 'm_hashed'.
+  mutable std::size_t m_hash;
+  mutable bool m_hashed;
+
+  // Mixed hash of 'm_middle'.  Valid if 'm_middleHashed'.
+  mutable std::size_t m_middleHash;
+  mutable bool m_middleHashed;
+
 private:     // methods
   // Check that all elements are strictly between 'lowBound' and
   // 'highBound', although either can be NULL, which imposes no limit.
   void checkBounds(FSElement const * /*nullable*/ lowBound,
                    FSElement const * /*nullable*/ highBound) const;
 
+  // ---- Tree algorithms.  These work on subtrees, where NULL is empty.
+  static size_type sizeOf(FunctionalSet const * /*nullable*/ t)
+    { return t? t->m_size : 0; }
+
+  // True if subtrees of the given sizes can be siblings.
+  static bool isBalanced(size_type leftSize, size_type rightSize)
+    { return leftSize + rightSize <= 1 ||
+             (leftSize <= DELTA*rightSize && rightSize <= DELTA*leftSize); }
+
+  // Make a node from parts that are balanced with respect to each other.
+  static Tree node(FunctionalSet *l, Elt const &x, FunctionalSet *r);
+
+  // The middle element of non-empty 't', with its hash if known.
+  static Elt middleElt(FunctionalSet const *t)
+    { return Elt(t->m_middle, t->m_middleHash, t->m_middleHashed); }
+
+  // Make a node from parts where one side may have become too big, by
+  // at most one element or one level of 'link' or 'merge', relative to
+  // the other; a single or double rotation restores balance.
+  static Tree balance(FunctionalSet *l, Elt const &x, FunctionalSet *r);
+
+  // Add 'x', which is less (resp. greater) than every element of 't'.
+  static Tree insertMin(Elt const &x, FunctionalSet *t);
+  static Tree insertMax(Elt const &x, FunctionalSet *t);
+
+  // Remove the least (resp. greatest) element of non-empty 't', and
+  // set 'from' to the node of 't' that held it.
+  static Tree deleteFindMin(FunctionalSet *t, FunctionalSet *&from);
+  static Tree deleteFindMax(FunctionalSet *t, FunctionalSet *&from);
+
+  // Join 'l', 'x' and 'r', where everything in 'l' is less than 'x',
+  // which is less than everything in 'r', for any sizes of 'l' and 'r'.
+  static Tree link(FunctionalSet *l, Elt const &x, FunctionalSet *r);
+
+  // Join 'l' and 'r', where everything in 'l' is less than everything
+  // in 'r'.
+  static Tree merge(FunctionalSet *l, FunctionalSet *r);
+
+  // Divide 't' into the elements less than 'x' and those greater, and
+  // say whether 'x' itself is present.
+  static void split(FunctionalSet *t, FSElement const *x,
+                    Tree &less, bool &found, Tree &greater);
+
+  static Tree unionTrees(FunctionalSet *a, FunctionalSet *b);
+  static Tree intersectTrees(FunctionalSet *a, FunctionalSet *b);
+  static Tree differenceTrees(FunctionalSet *a, FunctionalSet *b);
+
+  // Build a perfectly balanced tree from '[start,end)' of 'vec', which
+  // is strictly sorted, in linear time.
+  static Tree buildTree(std::vector<RCPtr<FSElement> > const &vec,
+                        std::size_t start, std::size_t end);
+
 public:      // methods
   // Normally, FunctionalSetManager takes care of creating these in
   // order to ensure the same sets are represented by the same objects,
@@ -152,19 +254,21 @@ public:      // methods
   // Check object invariants.  Throw if there is a problem.
   void checkInvariants() const;
 
-  // Check just the size-related invariants.
+  // Check just the size and balance invariants of this node.
   void checkSizes() const;
 
   // FSElement methods.
   char const *fseKind() const override;
   StrongOrdering compareTo(FSElement const &obj) const override;
   void print(std::ostream &os) const override;
+  std::size_t fseHash() const override;
 
   // Print the elements, separated by commas, without enclosing braces.
   void printElements(std::ostream &os) const;
 
-  // Return the number of elements expected on each side, given 'n',
-  // the total number of elements.
+  // Return the number of elements on each side of a perfectly balanced
+  // tree, as built from a vector, given 'n', the total number of
+  // elements.
   static size_type leftSizeForTotal(size_type n)
     { return n/2; }
   static size_type rightSizeForTotal(size_type n)
@@ -181,9 +285,29 @@ public:      // methods
 };
 
 
-// Manage a collection of FunctionalSet objects, where each is a
-// unique representative of a particular set, and provide the interface
-// for creating such sets.
+// Hash and equality classes for RCPtr<FunctionalSet>, using the set
+// contents.
+class RCPtrFunctionalSetHash {
+public:      // methods
+  std::size_t operator() (RCPtr<FunctionalSet> const &a) const
+    { return a->fseHash(); }
+};
+
+class RCPtrFunctionalSetEqual {
+public:      // methods
+  bool operator() (RCPtr<FunctionalSet> const &a,
+                   RCPtr<FunctionalSet> const &b) const;
+};
+
+
+// Provide the interface for creating sets, and, if hash-consing is
+// enabled, ensure that every set it returns is the unique
+// representative of its contents, so two such sets are equal iff they
+// are the same object.
+//
+// Only the sets returned to the client are made unique, not their
+// subtrees.  Making a set unique takes one hash table lookup, plus a
+// linear-time comparison if an equal set already exists.
 //
 // When this class is destroyed, it will decrement the reference counts
 // for all managed sets, but if a client still has outstanding
@@ -197,24 +321,39 @@ public:      // types
   typedef FunctionalSet::size_type size_type;
 
 private:     // data
-  // All known sets.
-  std::set<RCPtr<FunctionalSet>, RCPtrFunctionalSetCompare> m_sets;
+  // True if sets are made unique.
+  bool m_hashCons;
 
-  // The empty set.
-  //RCPtr<FunctionalSet> m_emptySet;
+  // All sets returned so far, if 'm_hashCons'.
+  std::unordered_set<RCPtr<FunctionalSet>,
+                     RCPtrFunctionalSetHash,
+                     RCPtrFunctionalSetEqual> m_sets;
+
+  // The empty set.  This is unique even without hash-consing.
+  RCPtr<FunctionalSet> m_emptySet;
 
 private:     // methods
-  // Like 'setFromVectorRange', but return NULL for the empty set.
-  RCPtr<FunctionalSet> nullableSetFromVectorRange(
-    std::vector<RCPtr<FSElement> > const &vec,
-    std::size_t start, std::size_t end);
+  // Turn a tree into a set to return: NULL becomes the empty set, and
+  // the result is made unique if 'm_hashCons'.
+  RCPtr<FunctionalSet> finish(RCPtr<FunctionalSet> tree);
 
 public:      // methods
-  FunctionalSetManager();
+  explicit FunctionalSetManager(bool hashCons = true);
   ~FunctionalSetManager();
 
+  // True if sets are made unique.
+  bool hashConsing() const { return m_hashCons; }
+
+  // Number of distinct sets retained for hash-consing.
+  size_type numSets() const { return m_sets.size(); }
+
+  // If hash-consing, return the unique set equal to 's', adding 's' if
+  // there is none.  Otherwise return 's', except that all empty sets
+  // map to 'emptySet()'.
+  RCPtr<FunctionalSet> intern(RCPtr<FunctionalSet> s);
+
   // Build a set out of the elements in 'vec', which must already be
-  // strictly sorted.
+  // strictly sorted.  This takes linear time.
   RCPtr<FunctionalSet> setFromVector(
     std::vector<RCPtr<FSElement> > const &vec);
 
@@ -238,8 +377,12 @@ public:      // methods
   RCPtr<FunctionalSet> intersection(RCPtr<FunctionalSet> a,
                                     RCPtr<FunctionalSet> b);
 
+  // Elements of 'a' that are not in 'b'.
+  RCPtr<FunctionalSet> difference(RCPtr<FunctionalSet> a,
+                                  RCPtr<FunctionalSet> b);
+
   // Check object invariants.  Throw if there is a problem.  This checks
-  // invariants for all known sets.
+  // invariants for all known sets, in time linear in their total size.
   void checkInvariants() const;
 };
 
@@ -0,0 +1,160 @@
+// hashtbl-test.cc
+// Tests for hashtbl.
+
+#include "hashtbl.h"                   // module under test
+
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "sm-random.h"                 // sm_random
+#include "sm-test.h"                   // EXPECT_EQ, tout
+#include "xassert.h"                   // xassert
+
+#include <map>                         // std::map
+#include <sstream>                     // std::ostringstream
+#include <string>                      // std::string
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Stored data; the key is 'm_key'.
+struct Entry {
+  int m_key;
+};
+
+void const *entryKey(void *data)
+{
+  return &( ((Entry*)data)->m_key );
+}
+
+bool intKeysEqual(void const *k1, void const *k2)
+{
+  return *(int const*)k1 == *(int const*)k2;
+}
+
+unsigned intHash(void const *key)
+{
+  return (unsigned)*(int const*)key;
+}
+
+// Hash whose low bits are poorly distributed.
+unsigned lcprngIntHash(void const *key)
+{
+  return lcprngTwoSteps((unsigned)*(int const*)key);
+}
+
+// A terrible hash function, to exercise long probe sequences.
+unsigned badIntHash(void const *key)
+{
+  return (unsigned)(*(int const*)key % 7);
+}
+
+
+// Randomly add and remove entries, comparing against std::map.
+void testRandom(HashTable::HashFn hashFn, float loadFactor, int range)
+{
+  HashTable table(entryKey, hashFn, intKeysEqual);
+  table.setMaxLoadFactor(loadFactor);
+  std::map<int, Entry*> ref;
+
+  smbase_loopi(3000) {
+    int key = sm_random(range);
+    auto it = ref.find(key);
+    if (it == ref.end()) {
+      xassert(table.get(&key) == NULL);
+      Entry *e = new Entry{key};
+      table.add(&key, e);
+      ref[key] = e;
+    }
+    else if (sm_random(2)) {
+      xassert(table.get(&key) == it->second);
+      xassert(table.remove(&key) == it->second);
+      delete it->second;
+      ref.erase(it);
+    }
+
+    if (i % 100 == 0) {
+      table.selfCheck();
+    }
+    xassert(table.getNumEntries() == (int)ref.size());
+    xassert(table.getNumEntries() <= table.getTableSize() * loadFactor);
+  }
+  table.selfCheck();
+
+  for (auto const &kv : ref) {
+    xassert(table.get(&kv.first) == kv.second);
+  }
+
+  // Iteration visits everything once.
+  int ct = 0;
+  for (HashTableIter iter(table); !iter.isDone(); iter.adv()) {
+    Entry *e = (Entry*)iter.data();
+    xassert(ref.at(e->m_key) == e);
+    ct++;
+  }
+  EXPECT_EQ(ct, (int)ref.size());
+
+  for (auto const &kv : ref) {
+    delete kv.second;
+  }
+}
+
+
+void testSizing()
+{
+  HashTable table(HashTable::identityKeyFn, HashTable::lcprngHashFn,
+                  HashTable::pointerEqualKeyFn);
+  EXPECT_EQ(table.getTableSize(), 32);
+  EXPECT_EQ(table.getMaxLoadFactor(), 0.75f);
+
+  // Clamping.
+  table.setMaxLoadFactor(2.0f);
+  EXPECT_EQ(table.getMaxLoadFactor(), 0.95f);
+  table.setMaxLoadFactor(0.9f);
+
+  // Pointer keys, which are all multiples of 8.
+  static double data[100];
+  smbase_loopi(100) {
+    table.add(&data[i], &data[i]);
+  }
+  table.selfCheck();
+  EXPECT_EQ(table.getTableSize(), 128);
+
+  std::ostringstream oss;
+  table.printStats(oss);
+  std::string stats = oss.str();
+  tout << stats;
+  xassert(stats.find("numEntries: 100") != std::string::npos);
+  xassert(stats.find("probe length histogram:") != std::string::npos);
+  xassert(stats.find("  1: ") != std::string::npos);
+
+  // Removing most entries shrinks the table.
+  smbase_loopi(95) {
+    xassert(table.remove(&data[i]) == &data[i]);
+  }
+  table.selfCheck();
+  xassert(table.getTableSize() < 128);
+
+  table.empty();
+  EXPECT_EQ(table.getNumEntries(), 0);
+  EXPECT_EQ(table.getTableSize(), 32);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_hashtbl()
+{
+  testRandom(intHash, 0.75f, 1000);
+  testRandom(intHash, 0.95f, 200);
+  testRandom(intHash, 0.25f, 5000);
+  testRandom(badIntHash, 0.75f, 300);
+  testRandom(lcprngIntHash, 0.5f, 100000);
+  testSizing();
+}
+
+
+// EOF
@@ -8,23 +8,20 @@
 #include "xassert.h"                   // xassert
 
 #include <iostream>                    // std::ostream
+#include <utility>                     // std::swap
+#include <vector>                      // std::vector
 
 #include <string.h>                    // memset
 
 
-unsigned HashTable::hashFunction(void const *key) const
-{
-  return coreHashFn(key) % (unsigned)tableSize;
-}
-
-
 HashTable::HashTable(GetKeyFn gk, HashFn hf, EqualKeyFn ek, int initSize)
   : getKey(gk),
     coreHashFn(hf),
     equalKeys(ek),
-    enableShrink(true)
+    enableShrink(true),
+    maxLoadFactor(0.75f)
 {
-  makeTable(initSize);
+  makeTable(roundTableSize(initSize));
 }
 
 HashTable::~HashTable()
@@ -33,43 +30,105 @@ HashTable::~HashTable()
 }
 
 
+STATICDEF int HashTable::roundTableSize(int size)
+{
+  int ret = 4;
+  while (ret <= size/2) {
+    ret *= 2;
+  }
+  return ret;
+}
+
+
 void HashTable::makeTable(int size)
 {
-  hashTable = new void*[size];
+  xassert(size >= 4 && (size & (size-1)) == 0);
+
+  hashTable = new Slot[size];
   tableSize = size;
-  memset(hashTable, 0, sizeof(void*) * tableSize);
+  tableSizeBits = 0;
+  while ((1 << tableSizeBits) < size) {
+    tableSizeBits++;
+  }
+  memset(hashTable, 0, sizeof(Slot) * tableSize);
   numEntries = 0;
 }
 
 
-inline int HashTable::getEntry(void const *key) const
+void HashTable::setMaxLoadFactor(float f)
+{
+  maxLoadFactor = f < 0.25f? 0.25f :
+                  f > 0.95f? 0.95f :
+                             f;
+}
+
+
+bool HashTable::needToGrow() const
 {
-  int index = hashFunction(key);
-  int originalIndex = index;
-  for(;;) {
-    if (hashTable[index] == NULL) {
+  return (double)(numEntries+1) > (double)tableSize * maxLoadFactor;
+}
+
+
+inline int HashTable::findEntry(void const *key, unsigned hash) const
+{
+  int index = homeIndex(hash);
+  for (int dist = 0; ; dist++) {
+    Slot const &slot = hashTable[index];
+    if (slot.data == NULL) {
       // unmapped
-      return index;
+      return -1;
     }
-    if (equalKeys(key, getKey(hashTable[index]))) {
+
+    // compare the stored hash first to avoid most 'equalKeys' calls
+    if (slot.hash == hash && equalKeys(key, getKey(slot.data))) {
       // mapped here
       return index;
     }
 
-    // this entry is mapped, but not with this key, i.e.
-    // we have a collision -- so just go to the next entry,
-    // wrapping as necessary
-    index = nextIndex(index);
+    // if 'key' were present, insertion would have placed it before any
+    // entry that is closer to its home than 'key' is to its own
+    if (probeDistance(index) < dist) {
+      return -1;
+    }
 
-    // detect infinite looping
-    xassert(index != originalIndex);
+    // collision, so go to the next entry, wrapping as necessary; the
+    // load factor limit ensures there is an empty slot somewhere
+    index = nextIndex(index);
   }
 }
 
 
 void *HashTable::get(void const *key) const
 {
-  return hashTable[getEntry(key)];
+  int index = findEntry(key, coreHashFn(key));
+  return index < 0? NULL : hashTable[index].data;
+}
+
+
+void HashTable::insertEntry(void *data, unsigned hash)
+{
+  int index = homeIndex(hash);
+  int dist = 0;
+  for (;;) {
+    Slot &slot = hashTable[index];
+    if (slot.data == NULL) {
+      slot.data = data;
+      slot.hash = hash;
+      return;
+    }
+
+    // the entry here is closer to its home, so give it our place and
+    // carry it along instead
+    int residentDist = probeDistance(index);
+    if (residentDist < dist) {
+      std::swap(slot.data, data);
+      std::swap(slot.hash, hash);
+      dist = residentDist;
+    }
+
+    index = nextIndex(index);
+    dist++;
+  }
 }
 
 
@@ -77,11 +136,10 @@ void HashTable::resizeTable(int newSize)
 {
   // Make sure newSize is not the result of an overflowed computation, and
   // that we're not going to resizeTable again right away in the add() call.
-  xassert(newSize >= numEntries);
-  xassert(newSize/3*2 >= numEntries-1);
+  xassert(newSize > numEntries);
 
   // save old stuff
-  void **oldTable = hashTable;
+  Slot *oldTable = hashTable;
   int oldSize = tableSize;
   int oldEntries = numEntries;
 
@@ -91,23 +149,10 @@ void HashTable::resizeTable(int newSize)
   // set this now, rather than incrementing it with each add
   numEntries = oldEntries;
 
-  // move entries to the new table
+  // move entries to the new table, reusing the stored hashes
   for (int i=0; i<oldSize; i++) {
-    if (oldTable[i] != NULL) {
-      // This function is worth optimizing; it accounts for 12% of qualcc
-      // runtime.  This simple inlining reduces resizeTable()'s impact from
-      // 12% to 2%.
-      if (0) {
-        // original code:
-        add(getKey(oldTable[i]), oldTable[i]);
-      }
-      else {
-        // inlined version:
-        int newIndex = getEntry(getKey(oldTable[i]));
-        xassertdb(hashTable[newIndex] == NULL);    // must not be a mapping yet
-        hashTable[newIndex] = oldTable[i];
-      }
-
+    if (oldTable[i].data != NULL) {
+      insertEntry(oldTable[i].data, oldTable[i].hash);
       oldEntries--;
     }
   }
@@ -120,64 +165,49 @@ void HashTable::resizeTable(int newSize)
 
 void HashTable::add(void const *key, void *value)
 {
-  if (numEntries+1 > tableSize*2/3) {
+  xassert(value != NULL);
+
+  if (needToGrow()) {
     // We're over the usage threshold; increase table size.
-    //
-    // Note: Resizing by numEntries*4 instead of tableSize*2 gives 42% speedup
-    // in total time used by resizeTable(), at the expense of more memory used.
-    resizeTable(tableSize * 2 + 1);
+    xassert(tableSize < (1 << 30));    // avoid overflow
+    resizeTable(tableSize * 2);
   }
-  // make sure above didn't fail due to integer overflow
-  xassert(numEntries+1 < tableSize);
 
-  int index = getEntry(key);
-  xassert(hashTable[index] == NULL);    // must not be a mapping yet
+  unsigned hash = coreHashFn(key);
+  xassertdb(findEntry(key, hash) < 0);    // must not be a mapping yet
 
-  hashTable[index] = value;
+  insertEntry(value, hash);
   numEntries++;
 }
 
 
 void *HashTable::remove(void const *key)
 {
-  if (enableShrink                &&
-      numEntries-1 < tableSize/5  &&
-      tableSize > defaultSize) {
+  if (enableShrink                                      &&
+      (double)(numEntries-1) < tableSize * maxLoadFactor / 4 &&
+      tableSize > roundTableSize(defaultSize)) {
     // we're below threshold; reduce table size
     resizeTable(tableSize / 2);
   }
 
-  int index = getEntry(key);
-  xassert(hashTable[index] != NULL);    // must be a mapping to remove
+  int index = findEntry(key, coreHashFn(key));
+  xassert(index >= 0);    // must be a mapping to remove
 
-  // remove this entry
-  void *retval = hashTable[index];
-  hashTable[index] = NULL;
+  void *retval = hashTable[index].data;
   numEntries--;
 
-  // now, if we ever inserted something and it collided with this one,
-  // leaving things like this would prevent us from finding that other
-  // mapping because the search stops as soon as a NULL entry is
-  // discovered; so we must examine all entries that could have
-  // collided, and re-insert them
-  int originalIndex = index;
-  for(;;) {
-    index = nextIndex(index);
-    xassert(index != originalIndex);    // prevent infinite loops
-
-    if (hashTable[index] == NULL) {
-      // we've reached the end of the list of possible colliders
+  // Shift back the entries that follow, until reaching one that is
+  // already in its home slot (or an empty slot).  This preserves the
+  // invariant that there are no gaps between an entry and its home.
+  for (;;) {
+    int next = nextIndex(index);
+    if (hashTable[next].data == NULL || probeDistance(next) == 0) {
       break;
     }
-
-    // remove this one
-    void *data = hashTable[index];
-    hashTable[index] = NULL;
-    numEntries--;
-
-    // add it back
-    add(getKey(data), data);
+    hashTable[index] = hashTable[next];
+    index = next;
   }
+  hashTable[index].data = NULL;
 
   return retval;
 }
@@ -186,7 +216,7 @@ void *HashTable::remove(void const *key)
 void HashTable::empty(int initSize)
 {
   delete[] hashTable;
-  makeTable(initSize);
+  makeTable(roundTableSize(initSize));
 }
 
 
@@ -194,40 +224,71 @@ void HashTable::printStats(std::ostream &os) const
 {
   PVALTO(os, tableSize);
   PVALTO(os, numEntries);
+  PVALTO(os, maxLoadFactor);
+
+  // histogram of the probes needed to find each entry
+  std::vector<int> histogram;
+  long totalProbes = 0;
+  for (int i=0; i<tableSize; i++) {
+    if (hashTable[i].data != NULL) {
+      int probes = probeDistance(i) + 1;
+      if ((int)histogram.size() <= probes) {
+        histogram.resize(probes+1, 0);
+      }
+      histogram[probes]++;
+      totalProbes += probes;
+    }
+  }
+
+  if (numEntries > 0) {
+    os << "average probes: " << (double)totalProbes / numEntries
+       << std::endl;
+  }
+  os << "probe length histogram:" << std::endl;
+  for (int probes=1; probes < (int)histogram.size(); probes++) {
+    if (histogram[probes]) {
+      os << "  " << probes << ": " << histogram[probes] << std::endl;
+    }
+  }
 }
 
 
 void HashTable::selfCheck() const
 {
+  xassert(tableSize == (1 << tableSizeBits));
+
   int ct=0;
   for (int i=0; i<tableSize; i++) {
-    if (hashTable[i] != NULL) {
+    if (hashTable[i].data != NULL) {
       checkEntry(i);
       ct++;
     }
   }
 
   xassert(ct == numEntries);
+  xassert(numEntries < tableSize);
 }
 
 void HashTable::checkEntry(int entry) const
 {
-  int index = getEntry(getKey(hashTable[entry]));
-  int originalIndex = index;
-  for(;;) {
-    if (index == entry) {
-      // the entry lives where it will be found, so that's good
-      return;
-    }
-    if (hashTable[index] == NULL) {
-      // the search for this entry would stop before finding it,
-      // so that's bad!
-      xfailure("checkEntry: entry in wrong slot");
-    }
+  Slot const &slot = hashTable[entry];
+  void const *key = getKey(slot.data);
+
+  // the stored hash must be current
+  xassert(slot.hash == coreHashFn(key));
+
+  // every slot from the home to here must be occupied, and the Robin
+  // Hood ordering must hold relative to the previous slot
+  int prev = (entry - 1) & (tableSize-1);
+  int dist = probeDistance(entry);
+  if (dist > 0) {
+    xassert(hashTable[prev].data != NULL);
+    xassert(probeDistance(prev) >= dist-1);
+  }
 
-    // collision; keep looking
-    index = nextIndex(index);
-    xassert(index != originalIndex);
+  // and lookup must find it
+  if (findEntry(key, slot.hash) != entry) {
+    xfailure("checkEntry: entry in wrong slot");
   }
 }
 
@@ -254,7 +315,7 @@ void HashTableIter::adv()
 void HashTableIter::moveToSth()
 {
   while (index < table.tableSize &&
-         table.hashTable[index] == NULL) {
+         table.hashTable[index].data == NULL) {
     index++;
   }
 
@@ -267,7 +328,7 @@ void HashTableIter::moveToSth()
 void *HashTableIter::data() const
 {
   xassert(!isDone());
-  return table.hashTable[index];
+  return table.hashTable[index].data;
 }
 
 
@@ -29,58 +29,101 @@ public:     // types
 
   // constants
   enum {
+    // initial size; since sizes are powers of 2, this is rounded to 32
     defaultSize = 33
   };
 
+private:    // types
+  // One slot of the table.
+  struct Slot {
+    // stored pointer, or NULL if the slot is empty
+    void *data;
+
+    // 'coreHashFn' of the key of 'data', if it is not NULL; storing it
+    // lets lookups skip most non-matching slots without calling
+    // 'equalKeys', and lets resizing skip rehashing
+    unsigned hash;
+  };
+
 private:    // data
   // maps
   GetKeyFn getKey;
   HashFn coreHashFn;
   EqualKeyFn equalKeys;
 
-  // array of pointers to data, indexed by the hash value,
-  // with collisions resolved by moving to adjacent entries;
-  // some entries are NULL, meaning that hash value has no mapping
-  void **hashTable;
-
-  // Why use linear hashing instead of double hashing?  To support
-  // deletion.  Since every probe sequence that goes through index k
-  // will have a tail of k+1,k+2,... (mod tableSize) I can easily find
-  // and re-insert all the elements whose position might have depended
-  // on the presence of a now-deleted element.  Excessive clustering
-  // is (hopefully) avoided through load factor control.
-
-  // number of slots in the hash table
+  // array of 'tableSize' slots.  Each entry is stored at or after its
+  // "home" slot (derived from its hash), wrapping around, with no empty
+  // slots in between.
+  //
+  // This uses linear probing with the Robin Hood discipline: during
+  // insertion, an entry that is farther from its home displaces one
+  // that is closer to its own.  That keeps the variance of probe
+  // lengths low, and means a lookup can stop as soon as it sees an
+  // entry closer to home than the key being sought would be.  Removal
+  // shifts the following entries back by one slot rather than
+  // reinserting them.
+  Slot *hashTable;
+
+  // number of slots in the hash table; always a power of 2
   int tableSize;
 
+  // log2(tableSize)
+  int tableSizeBits;
+
   // number of mapped (non-NULL) entries
   int numEntries;
 
   // when false, we never make the table smaller (default: true)
   bool enableShrink;
 
+  // maximum ratio of 'numEntries' to 'tableSize' before the table
+  // grows (default: 0.75)
+  float maxLoadFactor;
+
 private:    // funcs
   // disallowed
   HashTable(HashTable&);
   void operator=(HashTable&);
   void operator==(HashTable&);
 
+  // home slot for a given core hash value; always in [0,tableSize-1].
+  // This uses the high bits of the product with a large odd constant
+  // ("Fibonacci hashing") since the low bits of some hash functions,
+  // like 'lcprngHashFn', are poorly distributed.
+  int homeIndex(unsigned hash) const
+    { return (int)((hash * 2654435769u) >> (32 - tableSizeBits)); }
+
   // hash fn for the current table size; always in [0,tableSize-1]
-  unsigned hashFunction(void const *key) const;
+  unsigned hashFunction(void const *key) const
+    { return homeIndex(coreHashFn(key)); }
 
   // given a collision at 'index', return the next index to try
-  int nextIndex(int index) const { return (index+1) % tableSize; }
+  int nextIndex(int index) const { return (index+1) & (tableSize-1); }
+
+  // number of slots between the home of the entry in 'index' and
+  // 'index'
+  int probeDistance(int index) const
+    { return (index - homeIndex(hashTable[index].hash)) & (tableSize-1); }
+
+  // largest power of 2 that is at most 'size', but at least 4
+  static int roundTableSize(int size);
 
   // resize the table, transferring all the entries to their
   // new positions
   void resizeTable(int newSize);
 
-  // return the index of the entry corresponding to 'data' if it
-  // is mapped, or a pointer to the entry that should be filled
-  // with its mapping, if unmapped
-  int getEntry(void const *key) const;
+  // true if adding one more entry would exceed 'maxLoadFactor'
+  bool needToGrow() const;
+
+  // return the index of the entry for 'key', whose core hash is 'hash',
+  // or -1 if it is not mapped
+  int findEntry(void const *key, unsigned hash) const;
 
-  // make a new table with the given size
+  // store 'data', whose core hash is 'hash', in the table; its key must
+  // not already be mapped, and there must be room
+  void insertEntry(void *data, unsigned hash);
+
+  // make a new table with the given size, which must be a power of 2
   void makeTable(int size);
 
   // check a single entry for integrity
@@ -116,10 +159,19 @@ public:     // funcs
   // disable this to avoid any allocation in certain situations
   void setEnableShrink(bool en) { enableShrink = en; }
 
+  // set the maximum load factor, which is clamped to [0.25, 0.95];
+  // this takes effect on the next insertion
+  void setMaxLoadFactor(float f);
+  float getMaxLoadFactor() const { return maxLoadFactor; }
+
+  // number of slots, for testing
+  int getTableSize() const { return tableSize; }
+
   // allow external access to an accessor function
   void const *callGetKeyFn(void *data) { return getKey(data); }
 
-  // Print testing/performance stats to `os`.
+  // Print testing/performance stats to `os`, including a histogram of
+  // the number of probes needed to find each entry.
   void printStats(std::ostream &os) const;
 
   // check the data structure's invariants, and throw an exception
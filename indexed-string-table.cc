@@ -8,7 +8,7 @@
 #include "overflow.h"                  // convertNumber
 #include "sm-macros.h"                 // OPEN_NAMESPACE
 #include "sm-unique-ptr.h"             // smbase::UniquePtr
-#include "string-hash.h"               // smbase::stringHash
+#include "string-hash.h"               // smbase::stringHashSeeded
 #include "xassert.h"                   // xassertPrecondition
 
 #include <cstring>                     // std::memcpy
@@ -45,7 +45,7 @@ STATICDEF unsigned IndexedStringTable::hashSS(void const *dataSS)
   StoredString const *ss = static_cast<StoredString const *>(dataSS);
 
   std::string_view sv = ss->getStringView();
-  return stringHash(sv.data(), sv.size());
+  return (unsigned)stringHashSeeded(sv.data(), sv.size());
 }
 
 
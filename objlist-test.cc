@@ -6,6 +6,7 @@
 #include "breaker.h"                   // breaker
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
 #include "sm-test.h"                   // dummy_printf
+#include "unrolled-voidlist.h"         // smbase::UnrolledVoidList
 
 #include <stdlib.h>                    // rand()
 #include <stdio.h>                     // printf()
@@ -54,10 +55,11 @@ int intDiff(Integer const *left, Integer const *right, void*)
 
 
 // assumes we're using ptrvaldiff as the comparison fn
-void verifySorted(ObjList<Integer> const &list)
+template <class VL>
+void verifySorted(ObjList<Integer, VL> const &list)
 {
   int prev = 0;
-  ObjListIter<Integer> iter(list);
+  ObjListIter<Integer, VL> iter(list);
   for (; !iter.isDone(); iter.adv()) {
     int current = iter.data()->i;
     xassert(prev <= current);
@@ -79,14 +81,15 @@ void print(ObjList<Integer> const &list)
 #define PRINT(lst) print(lst); printf("\n") /* user ; */
 
 
+template <class VL>
 void testSorting()
 {
   enum { ITERS=100, ITEMS=20 };
 
   smbase_loopi(ITERS) {
     // construct a list
-    ObjList<Integer> list1;
-    ObjList<Integer> list2;
+    ObjList<Integer, VL> list1;
+    ObjList<Integer, VL> list2;
     int items = rand()%ITEMS;
     smbase_loopj(items) {
       int it = rand()%ITEMS;
@@ -112,8 +115,8 @@ void testSorting()
     verifySorted(list2);
 
     // verify equality
-    ObjListIter<Integer> iter1(list1);
-    ObjListIter<Integer> iter2(list2);
+    ObjListIter<Integer, VL> iter1(list1);
+    ObjListIter<Integer, VL> iter2(list2);
     for (; !iter1.isDone(); iter1.adv(), iter2.adv()) {
       xassert(iter1.data()->i == iter2.data()->i);
     }
@@ -214,7 +217,8 @@ void test_objlist()
 
   // this hits most of the remaining code
   // (a decent code coverage tool for C++ would be nice!)
-  testSorting();
+  testSorting<VoidList>();
+  testSorting<smbase::UnrolledVoidList>();
 
   printf("Integer ctorcount=%d dtorcount=%d\n",
          Integer::ctorcount, Integer::dtorcount);
@@ -13,23 +13,26 @@
 
 // forward declarations of template classes, so we can befriend them in ObjList
 // (not required by Borland C++ 4.5, but GNU wants it...)
-template <class T> class ObjListIter;
-template <class T> class ObjListMutator;
-template <class T> class ObjListIterNC;
+template <class T, class VL = VoidList> class ObjListIter;
+template <class T, class VL = VoidList> class ObjListMutator;
+template <class T, class VL = VoidList> class ObjListIterNC;
 
 
 // the list is considered to own all of the items; it is an error to insert
 // an item into more than one such list, or to insert an item more than once
 // into any such list
-template <class T>
+//
+// 'VL' is the underlying list of void*, either VoidList or
+// UnrolledVoidList (unrolled-voidlist.h); they have the same interface
+template <class T, class VL = VoidList>
 class ObjList {
 private:
-  friend class ObjListIter<T>;
-  friend class ObjListMutator<T>;
-  friend class ObjListIterNC<T>;
+  friend class ObjListIter<T, VL>;
+  friend class ObjListMutator<T, VL>;
+  friend class ObjListIterNC<T, VL>;
 
 protected:
-  VoidList list;                        // list itself
+  VL list;                              // list itself
 
 private:
   // this is an owner list; these are not allowed
@@ -131,8 +134,8 @@ public:
 };
 
 
-template <class T>
-void ObjList<T>::deleteAll()
+template <class T, class VL>
+void ObjList<T, VL>::deleteAll()
 {
   while (!list.isEmpty()) {
     deleteAt(0);
@@ -144,15 +147,15 @@ void ObjList<T>::deleteAll()
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists, and only one such iterator should exist for
 //       any given list
-template <class T>
+template <class T, class VL>
 class ObjListMutator {
-  friend class ObjListIter<T>;
+  friend class ObjListIter<T, VL>;
 
 protected:
-  VoidListMutator mut;       // underlying mutator
+  typename VL::Mutator mut;  // underlying mutator
 
 public:
-  ObjListMutator(ObjList<T> &lst)     : mut(lst.list) { reset(); }
+  ObjListMutator(ObjList<T, VL> &lst)     : mut(lst.list) { reset(); }
   ~ObjListMutator()                    {}
 
   void reset()                          { mut.reset(); }
@@ -203,24 +206,24 @@ public:
 // for traversing the list without modifying it (neither nodes nor structure)
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists
-template <class T>
+template <class T, class VL>
 class ObjListIter {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  ObjListIter(ObjList<T> const &list) : iter(list.list) {}
-  ObjListIter(ObjList<T> const &list, int pos) : iter(list.list, pos) {}
+  ObjListIter(ObjList<T, VL> const &list) : iter(list.list) {}
+  ObjListIter(ObjList<T, VL> const &list, int pos) : iter(list.list, pos) {}
   ~ObjListIter()                       {}
 
-  void reset(ObjList<T> const &list)   { iter.reset(list.list); }
+  void reset(ObjList<T, VL> const &list) { iter.reset(list.list); }
 
   // iterator copying; generally safe
   ObjListIter(ObjListIter const &obj)             : iter(obj.iter) {}
   ObjListIter& operator=(ObjListIter const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  ObjListIter(ObjListMutator<T> &obj)             : iter(obj.mut) {}
+  ObjListIter(ObjListMutator<T, VL> &obj)         : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -235,24 +238,24 @@ public:
 // intermediate to the above two, this allows modification of the
 // objects stored on the list, but not the identity or order of
 // the objects in the list
-template <class T>
+template <class T, class VL>
 class ObjListIterNC {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  ObjListIterNC(ObjList<T> &list) : iter(list.list) {}
-  ObjListIterNC(ObjList<T> &list, int pos) : iter(list.list, pos) {}
+  ObjListIterNC(ObjList<T, VL> &list) : iter(list.list) {}
+  ObjListIterNC(ObjList<T, VL> &list, int pos) : iter(list.list, pos) {}
   ~ObjListIterNC()                     {}
 
-  void reset(ObjList<T> &list)         { iter.reset(list.list); }
+  void reset(ObjList<T, VL> &list)     { iter.reset(list.list); }
 
   // iterator copying; generally safe
   ObjListIterNC(ObjListIterNC const &obj)             : iter(obj.iter) {}
   ObjListIterNC& operator=(ObjListIterNC const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  ObjListIterNC(ObjListMutator<T> &obj)               : iter(obj.mut) {}
+  ObjListIterNC(ObjListMutator<T, VL> &obj)           : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -265,23 +268,23 @@ public:
 
 
 // iterate over the combined elements of two or more lists
-template <class T>
+template <class T, class VL = VoidList>
 class ObjListMultiIter {
 private:
   // all the lists
-  ObjList<T> **lists;                // serf array of serf list pointers
+  ObjList<T, VL> **lists;            // serf array of serf list pointers
   int numLists;                      // length of this array
 
   // current element
   int curList;                       // which list we're working on
-  ObjListIter<T> iter;               // current element of that list
+  ObjListIter<T, VL> iter;           // current element of that list
 
   // invariant:
   //   either curList==numLists, or
   //   iter is not 'done'
 
 public:
-  ObjListMultiIter(ObjList<T> **L, int n)
+  ObjListMultiIter(ObjList<T, VL> **L, int n)
     : lists(L),
       numLists(n),
       curList(0),
@@ -311,8 +314,8 @@ public:
 
 // this was originally inline, but that was causing some strange
 // problems (compiler bug?)
-template <class T>
-void ObjListMultiIter<T>::normalize()
+template <class T, class VL>
+void ObjListMultiIter<T, VL>::normalize()
 {
   while (iter.isDone() && curList < numLists) {
     curList++;
@@ -4,16 +4,19 @@
 // for const purposes, as the values are owned, in a const table
 // the values cannot be modified
 
+// as with PtrMap, the last template argument selects the underlying
+// map
+
 #ifndef SMBASE_OBJMAP_H
 #define SMBASE_OBJMAP_H
 
 #include "ptrmap.h"           // PtrMap
 #include "xassert.h"          // xassert
 
-template <class KEY, class VALUE>
+template <class KEY, class VALUE, class VPM = VoidPtrMap>
 class ObjMap {
 private:    // data
-  PtrMap<KEY,VALUE> map;
+  PtrMap<KEY,VALUE,VPM> map;
 
 public:     // funcs
   ObjMap() {}
@@ -53,10 +56,10 @@ public:      // iterators
   class IterC {
   private:     // data
     // underlying iterator state
-    typename PtrMap<KEY,VALUE>::Iter iter;
+    typename PtrMap<KEY,VALUE,VPM>::Iter iter;
 
   public:      // fucs
-    IterC(ObjMap<KEY,VALUE> const &map)   : iter(map.map) {}
+    IterC(ObjMap<KEY,VALUE,VPM> const &map)   : iter(map.map) {}
     ~IterC()                              {}
 
     bool isDone() const                   { return iter.isDone(); }
@@ -71,10 +74,10 @@ public:      // iterators
   class Iter {
   private:     // data
     // underlying iterator state
-    typename PtrMap<KEY,VALUE>::Iter iter;
+    typename PtrMap<KEY,VALUE,VPM>::Iter iter;
 
   public:      // fucs
-    Iter(ObjMap<KEY,VALUE> &map)          : iter(map.map) {}
+    Iter(ObjMap<KEY,VALUE,VPM> &map)          : iter(map.map) {}
     ~Iter()                               {}
 
     bool isDone() const                   { return iter.isDone(); }
@@ -88,13 +91,13 @@ public:      // iterators
 };
 
 
-template <class KEY, class VALUE>
-void ObjMap<KEY,VALUE>::empty()
+template <class KEY, class VALUE, class VPM>
+void ObjMap<KEY,VALUE,VPM>::empty()
 {
   // delete the values; enclose in {} so the iterator goes
   // away before the table is modified
   {
-    typename PtrMap<KEY,VALUE>::Iter iter(map);
+    typename PtrMap<KEY,VALUE,VPM>::Iter iter(map);
     for (; !iter.isDone(); iter.adv()) {
       delete iter.value();
     }
@@ -104,8 +107,8 @@ void ObjMap<KEY,VALUE>::empty()
 }
 
 
-template <class KEY, class VALUE>
-ObjMap<KEY,VALUE>& ObjMap<KEY,VALUE>::operator=(ObjMap const &src)
+template <class KEY, class VALUE, class VPM>
+ObjMap<KEY,VALUE,VPM>& ObjMap<KEY,VALUE,VPM>::operator=(ObjMap const &src)
 {
   if (this != &src) {
     empty();
@@ -4,6 +4,10 @@
 // map from KEY* to VALUE* for arbitrary types KEY and VALUE
 // (neither are owned by the table)
 
+// the underlying map is VoidPtrMap unless another class with the same
+// interface, such as SwissVoidPtrMap, is given as the last template
+// argument; 'remove' and 'reserve' need SwissVoidPtrMap
+
 // for const purposes, I regard the mapping itself as the only
 // thing that cannot be modified in a "const" map; in particular,
 // I allow a non-const VALUE* to be extracted
@@ -11,17 +15,18 @@
 #ifndef PTRMAP_H
 #define PTRMAP_H
 
+#include "swiss-vptrmap.h" // SwissVoidPtrMap
 #include "vptrmap.h"       // VoidPtrMap
 
 #include <stddef.h>        // NULL
 
 
-template <class KEY, class VALUE>
+template <class KEY, class VALUE, class VPM = VoidPtrMap>
 class PtrMap {
 private:     // data
   // underlying map implementation, around which this class
   // is a type-safe wrapper
-  VoidPtrMap map;
+  VPM map;
 
 public:      // funcs
   PtrMap()                         : map() {}
@@ -39,6 +44,13 @@ public:      // funcs
   // mapping, if any
   void add(KEY *key, VALUE *value) { map.add((void*)key, (void*)value); }
 
+  // remove the mapping for 'key', returning its value, or NULL if
+  // there was none
+  VALUE *remove(KEY const *key)    { return (VALUE*)map.remove((void const*)key); }
+
+  // make room for 'n' mappings without further allocation
+  void reserve(int n)              { map.reserve(n); }
+
   // remove all mappings
   void empty()                     { map.empty(); }
 
@@ -47,10 +59,10 @@ public:      // iterators
   class Iter {
   private:     // data
     // underlying iterator state
-    VoidPtrMap::Iter iter;
+    typename VPM::Iter iter;
 
   public:      // fucs
-    Iter(PtrMap<KEY,VALUE> const &map)   : iter(map.map) {}
+    Iter(PtrMap<KEY,VALUE,VPM> const &map) : iter(map.map) {}
     ~Iter()                              {}
 
     bool isDone() const            { return iter.isDone(); }
@@ -65,30 +77,33 @@ public:      // iterators
 
 
 // a set based on PtrMap
-template <class KEY>
+template <class KEY, class VPM = VoidPtrMap>
   // dsw: I made the superclass public so I could iterate over it
   // using the superclass iterator
 // class PtrSet : private PtrMap<KEY, KEY> {
-class PtrSet : public PtrMap<KEY, KEY> {
+class PtrSet : public PtrMap<KEY, KEY, VPM> {
   public:
   PtrSet() {}
   ~PtrSet() {}
 
   // query # of mapped entries
-  int getNumEntries() const        { return PtrMap<KEY, KEY>::getNumEntries(); }
-  bool isEmpty() const             { return PtrMap<KEY, KEY>::isEmpty(); }
-  bool isNotEmpty() const          { return PtrMap<KEY, KEY>::isNotEmpty(); }
+  int getNumEntries() const        { return PtrMap<KEY, KEY, VPM>::getNumEntries(); }
+  bool isEmpty() const             { return PtrMap<KEY, KEY, VPM>::isEmpty(); }
+  bool isNotEmpty() const          { return PtrMap<KEY, KEY, VPM>::isNotEmpty(); }
 
   // if this key has a mapping, return it; otherwise, return NULL
-  bool contains(KEY const *key) const { return PtrMap<KEY, KEY>::get(key)!=NULL; }
+  bool contains(KEY const *key) const { return PtrMap<KEY, KEY, VPM>::get(key)!=NULL; }
 
   // add key to the set
-  void add(KEY *key) { PtrMap<KEY, KEY>::add(key, key); }
+  void add(KEY *key) { PtrMap<KEY, KEY, VPM>::add(key, key); }
+
+  // remove key from the set; return true if it was present
+  bool remove(KEY const *key) { return PtrMap<KEY, KEY, VPM>::remove(key)!=NULL; }
 
   // make the set empty; FIX: this would be better named makeEmpty(),
   // as it could be confused with the meaning of isEmpty(); however I
   // reflect the naming of PtrMap, where the same criticism applies.
-  void empty()                     { PtrMap<KEY, KEY>::empty(); }
+  void empty()                     { PtrMap<KEY, KEY, VPM>::empty(); }
 
   // dsw: I could not get this to compile; don't know why
 // public:      // iterators
@@ -5,9 +5,13 @@
 
 #include "sm-random.h"                 // sm_random
 #include "sm-test.h"                   // DIAG, EXPECT_EQ, verbose
+#include "xassert.h"                   // xassert
 
 #include <cstddef>                     // std::size_t
 #include <cstdint>                     // std::uintptr_t
+#include <cstring>                     // std::memset
+#include <thread>                      // std::thread
+#include <vector>                      // std::vector
 
 using namespace smbase;
 
@@ -71,11 +75,224 @@ static void testRandomSizes()
 }
 
 
+static bool isAligned(unsigned char const *p, std::size_t alignment)
+{
+  return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+}
+
+
+static void testAlignment()
+{
+  DIAG("---- testAlignment ----");
+
+  RackAllocator ra;
+  smbase_loopi(1000) {
+    std::size_t alignment = std::size_t(1) << sm_random(8);
+    std::size_t size = sm_random(i%10==0? 3000 : 100);
+    unsigned char *p = ra.allocate(size, alignment);
+    xassert(isAligned(p, alignment));
+    std::memset(p, 0xAA, size);
+  }
+
+  // Unaligned sizes followed by pointer-aligned allocation.
+  unsigned char *p = ra.allocate(3, 1);
+  unsigned char *q = ra.allocate(8);
+  xassert(isAligned(q, sizeof(void*)));
+  xassert(q >= p+3);
+
+  // Large alignment goes to a large block.
+  int large = ra.numLargeBlocks();
+  xassert(isAligned(ra.allocate(10, 4096), 4096));
+  EXPECT_EQ(ra.numLargeBlocks(), large+1);
+
+  ra.selfCheck();
+  printStats(ra);
+}
+
+
+static void testSavepoints()
+{
+  DIAG("---- testSavepoints ----");
+
+  RackAllocator ra;
+  ra.allocate(100);
+  RackAllocator::Savepoint outer = ra.savepoint();
+  std::size_t outerAvail = ra.availSpaceInFirstRack();
+  EXPECT_EQ(ra.curBytes(), 104u);
+
+  {
+    RackAllocator::Scope scope(ra);
+    smbase_loopi(100) {
+      ra.allocate(500);
+    }
+    ra.allocate(5000);
+    xassert(ra.numRacks() > 1);
+    EXPECT_EQ(ra.numLargeBlocks(), 1);
+
+    RackAllocator::Savepoint inner = ra.savepoint();
+    std::size_t racks = ra.numRacks();
+    std::size_t cur = ra.curBytes();
+    smbase_loopi(100) {
+      ra.allocate(500);
+    }
+    ra.rollback(inner);
+    EXPECT_EQ((std::size_t)ra.numRacks(), racks);
+    EXPECT_EQ(ra.curBytes(), cur);
+  }
+
+  // The scope released everything allocated within it.
+  EXPECT_EQ(ra.numRacks(), 1);
+  EXPECT_EQ(ra.numLargeBlocks(), 0);
+  EXPECT_EQ(ra.availSpaceInFirstRack(), outerAvail);
+  EXPECT_EQ(ra.curBytes(), 104u);
+  xassert(ra.peakBytes() > 100000);
+
+  // Rolling back to the same savepoint again is fine.
+  ra.allocate(10);
+  ra.rollback(outer);
+  EXPECT_EQ(ra.availSpaceInFirstRack(), outerAvail);
+
+  // A savepoint made while empty releases everything.
+  RackAllocator ra2;
+  RackAllocator::Savepoint empty = ra2.savepoint();
+  ra2.allocate(10);
+  ra2.allocate(2000);
+  ra2.rollback(empty);
+  EXPECT_EQ(ra2.numRacks(), 0);
+  EXPECT_EQ(ra2.numLargeBlocks(), 0);
+
+  // A savepoint from another allocator is rejected.
+  ra2.allocate(10);
+  // `xfailure` also throws `XAssert`, so it cannot be used here.
+  bool rejected = false;
+  try {
+    ra2.rollback(outer);
+  }
+  catch (XAssert &x) {
+    DIAG("as expected: " << x.what());
+    rejected = true;
+  }
+  xassert(rejected);
+
+  // A savepoint from before a `clear` is rejected, even though the
+  // rack it refers to comes back from the pool at the same address.
+  ra2.clear();
+  ra2.allocate(10);
+  RackAllocator::Savepoint beforeClear = ra2.savepoint();
+  ra2.clear();
+  ra2.allocate(10);
+  rejected = false;
+  try {
+    ra2.rollback(beforeClear);
+  }
+  catch (XAssert &x) {
+    DIAG("as expected: " << x.what());
+    rejected = true;
+  }
+  xassert(rejected);
+
+  ra.selfCheck();
+  ra2.selfCheck();
+}
+
+
+static void testRackReuse()
+{
+  DIAG("---- testRackReuse ----");
+
+  RackAllocator::releasePooledRacks();
+  EXPECT_EQ(RackAllocator::numPooledRacks(), 0);
+
+  {
+    RackAllocator ra;
+    smbase_loopi(100) {
+      ra.allocate(500);
+    }
+    EXPECT_EQ(ra.racksReused(), 0);
+    EXPECT_EQ(ra.racksCreated(), ra.numRacks());
+  }
+  int pooled = RackAllocator::numPooledRacks();
+  xassert(pooled > 1);
+
+  // A second allocator on this thread reuses the racks.
+  {
+    RackAllocator ra;
+    ra.allocate(10);
+    EXPECT_EQ(ra.racksCreated(), 0);
+    EXPECT_EQ(ra.racksReused(), 1);
+    EXPECT_EQ(RackAllocator::numPooledRacks(), pooled-1);
+
+    ra.clear();
+    EXPECT_EQ(RackAllocator::numPooledRacks(), pooled);
+    printStats(ra);
+  }
+
+  // The pool is bounded.
+  {
+    RackAllocator ra;
+    while (ra.numRacks() <= RackAllocator::MAX_POOLED_RACKS) {
+      ra.allocate(RackAllocator::LARGE_THRESHOLD - 8);
+    }
+  }
+  EXPECT_EQ(RackAllocator::numPooledRacks(),
+            (int)RackAllocator::MAX_POOLED_RACKS);
+
+  RackAllocator::releasePooledRacks();
+  EXPECT_EQ(RackAllocator::numPooledRacks(), 0);
+}
+
+
+static void testThreadLocal()
+{
+  DIAG("---- testThreadLocal ----");
+
+  RackAllocator *mainAllocator = &RackAllocator::threadLocal();
+  xassert(mainAllocator == &RackAllocator::threadLocal());
+
+  int const numThreads = 4;
+  std::vector<RackAllocator*> allocators(numThreads);
+  std::vector<std::thread> threads;
+  for (int t=0; t < numThreads; t++) {
+    threads.emplace_back([t, &allocators]() {
+      RackAllocator &ra = RackAllocator::threadLocal();
+      allocators[t] = &ra;
+
+      // Simulate requests, each of which uses scratch space.
+      for (int request=0; request < 20; request++) {
+        RackAllocator::Scope scope(ra);
+        for (int i=0; i < 200; i++) {
+          std::memset(ra.allocate(100, 16), t, 100);
+        }
+      }
+
+      // Only the first request needed new racks.
+      xassert(ra.racksCreated() <= 2);
+      xassert(ra.racksReused() >= 19);
+      ra.selfCheck();
+    });
+  }
+  for (std::thread &thr : threads) {
+    thr.join();
+  }
+
+  for (int t=0; t < numThreads; t++) {
+    xassert(allocators[t] != mainAllocator);
+    for (int u=0; u < t; u++) {
+      xassert(allocators[t] != allocators[u]);
+    }
+  }
+}
+
+
 // Called from unit-tests.cc.
 void test_rack_allocator()
 {
   testFixedSizes();
   testRandomSizes();
+  testAlignment();
+  testSavepoints();
+  testRackReuse();
+  testThreadLocal();
 }
 
 
@@ -10,12 +10,68 @@
 #include "sm-test.h"                   // PVALTO
 #include "xassert.h"                   // xassertPrecondition
 
+#include <cstdint>                     // std::uintptr_t
 #include <iostream>                    // std::ostream
 
 
 OPEN_NAMESPACE(smbase)
 
 
+// ---------------------------- RackPool -------------------------------
+// Racks available for reuse by the allocators on one thread.
+struct RackAllocator::RackPool {
+  // List of racks, linked by their `m_next`.
+  Rack * NULLABLE m_head = nullptr;
+
+  // Number of racks in the list.
+  int m_count = 0;
+
+  ~RackPool();
+
+  // Delete all of the racks.
+  void releaseAll();
+
+  // Get the calling thread's pool, or null if it has been destroyed.
+  static RackPool * NULLABLE get();
+};
+
+
+// True once the calling thread's pool has been destroyed, which can
+// happen before allocators with static storage duration are destroyed.
+// Since this is trivially destructible, it can still be read then.
+static thread_local bool s_rackPoolDestroyed = false;
+
+
+RackAllocator::RackPool::~RackPool()
+{
+  releaseAll();
+  s_rackPoolDestroyed = true;
+}
+
+
+void RackAllocator::RackPool::releaseAll()
+{
+  while (m_head != nullptr) {
+    Rack *next = m_head->m_next;
+    delete m_head;
+    m_head = next;
+  }
+  m_count = 0;
+}
+
+
+STATICDEF RackAllocator::RackPool *RackAllocator::RackPool::get()
+{
+  if (s_rackPoolDestroyed) {
+    return nullptr;
+  }
+
+  static thread_local RackPool pool;
+  return &pool;
+}
+
+
+// -------------------------- RackAllocator ----------------------------
 RackAllocator::~RackAllocator()
 {
   clear();
@@ -24,18 +80,89 @@ RackAllocator::~RackAllocator()
 
 RackAllocator::RackAllocator()
   : m_firstRack(nullptr),
-    m_firstLarge(nullptr)
+    m_firstLarge(nullptr),
+    m_curBytes(0),
+    m_peakBytes(0),
+    m_generation(0),
+    m_racksCreated(0),
+    m_racksReused(0)
 {}
 
 
+STATICDEF RackAllocator &RackAllocator::threadLocal()
+{
+  // Make the pool first, so that it is destroyed after the allocator,
+  // and can receive its racks.
+  RackPool::get();
+
+  static thread_local RackAllocator allocator;
+  return allocator;
+}
+
+
+RackAllocator::Rack *RackAllocator::obtainRack(Rack *next)
+{
+  RackPool *pool = RackPool::get();
+  if (pool && pool->m_head) {
+    Rack *rack = pool->m_head;
+    pool->m_head = rack->m_next;
+    pool->m_count--;
+
+    rack->m_next = next;
+    rack->m_usedBytes = 0;
+    m_racksReused++;
+    return rack;
+  }
+
+  m_racksCreated++;
+  return new Rack(next);
+}
+
+
+STATICDEF void RackAllocator::releaseRack(Rack *rack)
+{
+  RackPool *pool = RackPool::get();
+  if (pool && pool->m_count < MAX_POOLED_RACKS) {
+    rack->m_next = pool->m_head;
+    pool->m_head = rack;
+    pool->m_count++;
+  }
+  else {
+    delete rack;
+  }
+}
+
+
+// Number of bytes to skip after `p` to reach a multiple of `alignment`.
+static std::size_t alignmentPadding(unsigned char const *p,
+                                    std::size_t alignment)
+{
+  return (std::size_t)(-reinterpret_cast<std::uintptr_t>(p)) &
+         (alignment - 1);
+}
+
+
 unsigned char *RackAllocator::allocate(std::size_t n)
 {
-  // Round `n` up to the next pointer boundary.
+  // Round `n` up to the next pointer boundary, so the next allocation
+  // will not need padding.
   n = round_up(n, sizeof(void*));
 
-  if (n >= LARGE_THRESHOLD) {
-    // We need space for our `LargeBlock` plus the caller's `n` bytes.
-    std::size_t fullSize = n + sizeof(LargeBlock);
+  return allocate(n, sizeof(void*));
+}
+
+
+unsigned char *RackAllocator::allocate(std::size_t n,
+                                       std::size_t alignment)
+{
+  xassertPrecondition(alignment != 0 &&
+                      (alignment & (alignment-1)) == 0);
+
+  if (alignment >= LARGE_THRESHOLD ||
+      n >= LARGE_THRESHOLD - (alignment-1)) {
+    // We need space for our `LargeBlock`, then possibly some padding,
+    // then the caller's `n` bytes.
+    std::size_t fullSize = n + sizeof(LargeBlock) + (alignment-1);
 
     // If this fails, the arithmetic overflowed, so `n` was unreasonably
     // large.
@@ -49,31 +176,52 @@ unsigned char *RackAllocator::allocate(std::size_t n)
     block->m_next = m_firstLarge;
     m_firstLarge = block;
 
-    return fullData + sizeof(LargeBlock);
+    unsigned char *ret = fullData + sizeof(LargeBlock);
+    ret += alignmentPadding(ret, alignment);
+
+    m_curBytes += n;
+    if (m_curBytes > m_peakBytes) {
+      m_peakBytes = m_curBytes;
+    }
+    return ret;
+  }
+
+  std::size_t padding = 0;
+  if (m_firstRack) {
+    padding = alignmentPadding(m_firstRack->nextByte(), alignment);
   }
 
   if (m_firstRack == nullptr ||
-      m_firstRack->availBytes() < n) {
-    // Need a new rack.
-    m_firstRack = new Rack(m_firstRack);
+      m_firstRack->availBytes() < padding + n) {
+    // Need a new rack.  Since `padding + n` is less than
+    // LARGE_THRESHOLD, it will fit.
+    m_firstRack = obtainRack(m_firstRack);
+    padding = alignmentPadding(m_firstRack->nextByte(), alignment);
   }
 
   // Grab space from the first rack.
-  unsigned char *ret = m_firstRack->nextByte();
-  m_firstRack->m_usedBytes += n;
+  unsigned char *ret = m_firstRack->nextByte() + padding;
+  m_firstRack->m_usedBytes += padding + n;
+
+  m_curBytes += padding + n;
+  if (m_curBytes > m_peakBytes) {
+    m_peakBytes = m_curBytes;
+  }
   return ret;
 }
 
 
-void RackAllocator::clear()
+void RackAllocator::releaseUntil(Rack *stop, LargeBlock *stopLarge)
 {
-  while (m_firstRack != nullptr) {
+  while (m_firstRack != stop) {
+    xassert(m_firstRack != nullptr);
     Rack *next = m_firstRack->m_next;
-    delete m_firstRack;
+    releaseRack(m_firstRack);
     m_firstRack = next;
   }
 
-  while (m_firstLarge != nullptr) {
+  while (m_firstLarge != stopLarge) {
+    xassert(m_firstLarge != nullptr);
     LargeBlock *next = m_firstLarge->m_next;
     delete[] reinterpret_cast<unsigned char *>(m_firstLarge);
     m_firstLarge = next;
@@ -81,18 +229,77 @@ void RackAllocator::clear()
 }
 
 
+void RackAllocator::clear()
+{
+  releaseUntil(nullptr, nullptr);
+  m_curBytes = 0;
+  m_generation++;
+}
+
+
+RackAllocator::Savepoint RackAllocator::savepoint() const
+{
+  return Savepoint(m_firstRack,
+                   m_firstRack? m_firstRack->m_usedBytes : 0,
+                   m_firstLarge,
+                   m_curBytes,
+                   m_generation);
+}
+
+
+void RackAllocator::rollback(Savepoint const &sp)
+{
+  // The lists may have been emptied and refilled with racks at the
+  // same addresses since `sp` was made.
+  xassertPrecondition(sp.m_generation == m_generation);
+
+  // Check that the savepoint's rack and block are still in our lists
+  // before releasing anything.
+  if (sp.m_rack) {
+    Rack const *r = m_firstRack;
+    while (r && r != sp.m_rack) {
+      r = r->m_next;
+    }
+    xassertPrecondition(r == sp.m_rack);
+  }
+  if (sp.m_large) {
+    LargeBlock const *lb = m_firstLarge;
+    while (lb && lb != sp.m_large) {
+      lb = lb->m_next;
+    }
+    xassertPrecondition(lb == sp.m_large);
+  }
+
+  releaseUntil(sp.m_rack, sp.m_large);
+
+  if (m_firstRack) {
+    xassertPrecondition(m_firstRack->m_usedBytes >= sp.m_rackUsedBytes);
+    m_firstRack->m_usedBytes = sp.m_rackUsedBytes;
+  }
+  m_curBytes = sp.m_curBytes;
+}
+
+
 void RackAllocator::printStats(std::ostream &os) const
 {
   PVALTO(os, numRacks());
   PVALTO(os, numLargeBlocks());
   PVALTO(os, wastedSpace());
   PVALTO(os, availSpaceInFirstRack());
+  PVALTO(os, curBytes());
+  PVALTO(os, peakBytes());
+  PVALTO(os, racksCreated());
+  PVALTO(os, racksReused());
+  PVALTO(os, numPooledRacks());
 }
 
 
 void RackAllocator::selfCheck() const
 {
-  // Nothing to check at this time.
+  for (Rack const *r = m_firstRack; r; r = r->m_next) {
+    xassert(r->m_usedBytes <= RACK_SIZE);
+  }
+  xassert(m_curBytes <= m_peakBytes);
 }
 
 
@@ -139,6 +346,21 @@ std::size_t RackAllocator::availSpaceInFirstRack() const
 }
 
 
+STATICDEF int RackAllocator::numPooledRacks()
+{
+  RackPool *pool = RackPool::get();
+  return pool? pool->m_count : 0;
+}
+
+
+STATICDEF void RackAllocator::releasePooledRacks()
+{
+  if (RackPool *pool = RackPool::get()) {
+    pool->releaseAll();
+  }
+}
+
+
 CLOSE_NAMESPACE(smbase)
 
 
@@ -4,6 +4,12 @@
 
 // This file is in the public domain.
 
+// Racks that are no longer needed, because of `clear`, `rollback` or
+// destruction, go into a pool belonging to the calling thread, and are
+// reused by the next allocator on that thread that needs a rack.  This
+// makes short-lived allocators, such as per-request scratch space in a
+// server, cheap, since they usually do not need to call `new` at all.
+
 // The implementation is partly based on the internals of `strtable.h`.
 
 #ifndef SMBASE_RACK_ALLOCATOR_H
@@ -19,15 +25,25 @@ OPEN_NAMESPACE(smbase)
 
 
 // Allocate small objects contiguously.  Does not allow deallocation of
-// individual objects.
+// individual objects, but everything allocated after a `Savepoint`
+// can be released at once.
+//
+// A given allocator must only be used by one thread at a time.  Each
+// thread can use its own instance via `threadLocal()`.
 class RackAllocator {
   // For now.
   NO_OBJECT_COPIES(RackAllocator);
 
+private:     // types
+  struct Rack;
+  struct LargeBlock;
+  struct RackPool;
+
 public:      // types
   enum {
     RACK_SIZE = 16000,       // Size of one rack.
     LARGE_THRESHOLD = 1000,  // Minimum length of a "large" allocation.
+    MAX_POOLED_RACKS = 64,   // Max racks kept in each thread's pool.
   };
 
   // The type of object allocated.  As far as this class is concerned,
@@ -40,6 +56,63 @@ public:      // types
   // Result of pointer subtraction.
   typedef std::ptrdiff_t difference_type;
 
+  // A point in the allocation history, to which the allocator can
+  // later be rolled back.
+  class Savepoint {
+    friend class RackAllocator;
+
+  private:   // data
+    // The value of `m_firstRack` when the savepoint was made.
+    Rack * NULLABLE m_rack;
+
+    // The value of `m_rack->m_usedBytes`, or 0 if `m_rack` is null.
+    size_type m_rackUsedBytes;
+
+    // The value of `m_firstLarge`.
+    LargeBlock * NULLABLE m_large;
+
+    // The value of `m_curBytes`.
+    size_type m_curBytes;
+
+    // The value of `m_generation`.
+    unsigned long m_generation;
+
+  public:
+    Savepoint(Savepoint const &obj) = default;
+    Savepoint &operator=(Savepoint const &obj) = default;
+
+  private:
+    Savepoint(Rack *rack, size_type rackUsedBytes,
+              LargeBlock *large, size_type curBytes,
+              unsigned long generation)
+      : m_rack(rack),
+        m_rackUsedBytes(rackUsedBytes),
+        m_large(large),
+        m_curBytes(curBytes),
+        m_generation(generation)
+    {}
+  };
+
+  // Make a savepoint on construction, and roll back to it on
+  // destruction, thereby releasing everything allocated within the
+  // scope.
+  class Scope {
+    NO_OBJECT_COPIES(Scope);
+
+  private:   // data
+    RackAllocator &m_allocator;
+    Savepoint m_savepoint;
+
+  public:
+    explicit Scope(RackAllocator &allocator)
+      : m_allocator(allocator),
+        m_savepoint(allocator.savepoint())
+    {}
+
+    ~Scope()
+      { m_allocator.rollback(m_savepoint); }
+  };
+
 private:     // types
   // Holds allocated small objects.
   struct Rack {
@@ -90,16 +163,65 @@ private:     // data
   // pointer to the next-most-recent, etc.
   LargeBlock * NULLABLE m_firstLarge;
 
+  // Number of bytes currently allocated, including alignment padding,
+  // but not counting space wasted at the ends of racks.
+  size_type m_curBytes;
+
+  // Largest value `m_curBytes` has had.
+  size_type m_peakBytes;
+
+  // Number of calls to `clear`.  A savepoint records this so that
+  // `rollback` can reject one made before a `clear`, even if the rack
+  // it refers to has since been reused at the same address.
+  unsigned long m_generation;
+
+  // Number of racks obtained with `new`, and from the thread's pool.
+  int m_racksCreated;
+  int m_racksReused;
+
+private:     // methods
+  // Get a rack from the thread's pool, or make a new one.  Its
+  // `m_next` is `next`.
+  Rack *obtainRack(Rack *next);
+
+  // Put `rack` into the thread's pool, or delete it if the pool is
+  // full.
+  static void releaseRack(Rack *rack);
+
+  // Deallocate the racks before `stop` and the large blocks before
+  // `stopLarge` in their respective lists.
+  void releaseUntil(Rack *stop, LargeBlock *stopLarge);
+
 public:      // methods
   ~RackAllocator();
   RackAllocator();
 
+  // The calling thread's allocator, made on first use, and destroyed
+  // when the thread exits.
+  static RackAllocator &threadLocal();
+
   // Allocate `n` bytes, aligned to a pointer boundary.
   unsigned char *allocate(std::size_t n);
 
+  // Allocate `n` bytes, aligned to `alignment`, which must be a power
+  // of 2.  Unlike the other overload, `n` is not rounded up.
+  unsigned char *allocate(std::size_t n, std::size_t alignment);
+
   // Deallocate all objects at once.
   void clear();
 
+  // Return a savepoint for the current state.
+  Savepoint savepoint() const;
+
+  // Deallocate everything allocated since `sp` was made.  Rollbacks
+  // must respect nesting: after rolling back to `sp`, any savepoints
+  // made after it cannot be used, and neither can any savepoint after
+  // a `clear`.  Using a savepoint from before a `clear` always fails
+  // an assertion.  Using one invalidated by an earlier rollback is
+  // only caught on a best-effort basis, when its rack or large block
+  // is no longer in this allocator's lists.
+  void rollback(Savepoint const &sp);
+
   // Print test/performance stats.
   void printStats(std::ostream &os) const;
 
@@ -120,6 +242,20 @@ public:      // methods
 
   // Amount of available space in the first rack.
   std::size_t availSpaceInFirstRack() const;
+
+  // Number of bytes currently allocated, and the maximum of that.
+  std::size_t curBytes() const { return m_curBytes; }
+  std::size_t peakBytes() const { return m_peakBytes; }
+
+  // Number of racks this allocator got with `new`, and from the pool.
+  int racksCreated() const { return m_racksCreated; }
+  int racksReused() const { return m_racksReused; }
+
+  // Number of racks in the calling thread's pool.
+  static int numPooledRacks();
+
+  // Delete the racks in the calling thread's pool.
+  static void releasePooledRacks();
 };
 
 
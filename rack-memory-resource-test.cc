@@ -0,0 +1,221 @@
+// rack-memory-resource-test.cc
+// Tests for `rack-memory-resource` module.
+
+// This file is in the public domain.
+
+#include "smbase/rack-memory-resource.h"  // module under test
+
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "smbase/sm-test.h"            // DIAG, EXPECT_EQ, tout
+#include "smbase/xassert.h"            // xassert
+
+#include <atomic>                      // std::atomic
+#include <cstdint>                     // std::uintptr_t
+#include <cstdlib>                     // std::{malloc, free}
+#include <map>                         // std::pmr::map
+#include <new>                         // std::bad_alloc
+#include <string>                      // std::pmr::string
+#include <vector>                      // std::pmr::vector
+
+using namespace smbase;
+
+
+// Count calls to the global `operator new`, so the tests can check
+// that the containers do not use it.  The array and sized forms are
+// replaced too, since otherwise they might not match.
+static std::atomic<long> s_globalNewCalls(0);
+
+void *operator new(std::size_t size)
+{
+  s_globalNewCalls.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Build some containers in `mr`, returning a checksum of what they
+// contain.  No single allocation reaches LARGE_THRESHOLD.
+long useContainers(std::pmr::memory_resource *mr)
+{
+  long sum = 0;
+
+  std::pmr::vector<int> vec(mr);
+  smbase_loopi(120) {
+    vec.push_back(i);
+  }
+  for (int x : vec) {
+    sum += x;
+  }
+
+  std::pmr::map<int, std::pmr::string> m(mr);
+  smbase_loopi(100) {
+    // Long enough to not fit in the string object itself.
+    m[i] = std::pmr::string(40, (char)('a' + i%26), mr);
+    m[i] += "!";
+  }
+  m.erase(5);
+  for (auto const &kv : m) {
+    sum += kv.first + (long)kv.second.size() + kv.second[0];
+  }
+
+  std::pmr::string s(mr);
+  smbase_loopi(30) {
+    s += "twenty characters...";
+  }
+  sum += (long)s.size();
+
+  return sum;
+}
+
+
+void testMonotonic()
+{
+  DIAG("---- testMonotonic ----");
+
+  RackMemoryResource mr;
+  EXPECT_EQ(mr.mode(), RackMemoryResource::RMR_MONOTONIC);
+
+  // The first time, the allocator may need new racks.
+  long expect = useContainers(&mr);
+  xassert(mr.numAllocations() > 100);
+  xassert(mr.allocator().numLargeBlocks() == 0);
+  mr.selfCheck();
+  mr.printStats(tout);
+
+  // Its racks are now in the thread's pool.
+  mr.release();
+  EXPECT_EQ(mr.allocator().numRacks(), 0);
+
+  // The second time, no global `new` is needed.
+  long before = s_globalNewCalls;
+  EXPECT_EQ(useContainers(&mr), expect);
+  EXPECT_EQ(s_globalNewCalls - before, 0);
+
+  mr.release();
+}
+
+
+void testFreeLists()
+{
+  DIAG("---- testFreeLists ----");
+
+  RackMemoryResource mr(RackMemoryResource::RMR_FREE_LISTS);
+
+  long expect = useContainers(&mr);
+  std::size_t bytes = mr.allocator().curBytes();
+  mr.selfCheck();
+
+  // Everything was deallocated, and is reused the next time, so the
+  // allocator does not grow.
+  xassert(mr.numFreeBlocks() > 0);
+  long before = s_globalNewCalls;
+  smbase_loopi(10) {
+    EXPECT_EQ(useContainers(&mr), expect);
+  }
+  EXPECT_EQ(s_globalNewCalls - before, 0);
+  EXPECT_EQ(mr.allocator().curBytes(), bytes);
+  xassert(mr.numReused() > mr.numAllocations() / 2);
+  EXPECT_EQ(mr.numAllocations(), mr.numDeallocations());
+  mr.printStats(tout);
+
+  // Blocks are reused by size class.
+  void *p = mr.allocate(100);
+  mr.deallocate(p, 100);
+  EXPECT_EQ(mr.allocate(120), p);
+  void *q = mr.allocate(100);
+  xassert(q != p);
+
+  // Over-aligned blocks are not reused.
+  void *a = mr.allocate(64, 64);
+  xassert(reinterpret_cast<std::uintptr_t>(a) % 64 == 0);
+  int freeBlocks = mr.numFreeBlocks();
+  mr.deallocate(a, 64, 64);
+  EXPECT_EQ(mr.numFreeBlocks(), freeBlocks);
+
+  mr.release();
+  EXPECT_EQ(mr.numFreeBlocks(), 0);
+  mr.selfCheck();
+}
+
+
+void testSuppliedAllocator()
+{
+  DIAG("---- testSuppliedAllocator ----");
+
+  RackAllocator ra;
+  RackMemoryResource mr1(ra);
+  RackMemoryResource mr2(ra, RackMemoryResource::RMR_FREE_LISTS);
+  xassert(&mr1.allocator() == &ra);
+  xassert(mr1.is_equal(mr1));
+  xassert(!mr1.is_equal(mr2));
+
+  // A scope on the allocator releases what containers allocated
+  // within it.
+  ra.allocate(10);
+  std::size_t bytes = ra.curBytes();
+  {
+    RackAllocator::Scope scope(ra);
+    std::pmr::vector<std::pmr::string> v(&mr1);
+    smbase_loopi(50) {
+      v.emplace_back(50, 'x');
+    }
+    xassert(ra.curBytes() > bytes + 50*50);
+  }
+  EXPECT_EQ(ra.curBytes(), bytes);
+
+  // Alignment is honored in both modes.
+  for (std::size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+    xassert(reinterpret_cast<std::uintptr_t>(
+              mr1.allocate(3, alignment)) % alignment == 0);
+    xassert(reinterpret_cast<std::uintptr_t>(
+              mr2.allocate(3, alignment)) % alignment == 0);
+  }
+
+  mr1.selfCheck();
+  mr2.selfCheck();
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_rack_memory_resource()
+{
+  testMonotonic();
+  testFreeLists();
+  testSuppliedAllocator();
+}
+
+
+// EOF
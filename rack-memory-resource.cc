@@ -0,0 +1,166 @@
+// rack-memory-resource.cc
+// Code for `rack-memory-resource` module.
+
+// This file is in the public domain.
+
+#include "rack-memory-resource.h"      // this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/sm-test.h"            // PVALTO
+#include "smbase/xassert.h"            // xassert, xassertPrecondition
+
+#include <cstddef>                     // std::max_align_t
+#include <iostream>                    // std::ostream
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Alignment of every block in a size class.  Requests for greater
+// alignment are not reused.
+static std::size_t const CLASS_ALIGNMENT = alignof(std::max_align_t);
+
+
+RackMemoryResource::RackMemoryResource(Mode mode)
+  : RackMemoryResource(m_ownAllocator, mode)
+{}
+
+
+RackMemoryResource::RackMemoryResource(RackAllocator &allocator,
+                                       Mode mode)
+  : m_ownAllocator(),
+    m_allocator(allocator),
+    m_mode(mode),
+    m_freeLists(),
+    m_numAllocations(0),
+    m_numReused(0),
+    m_numDeallocations(0)
+{
+  xassertPrecondition(0 <= mode && mode < NUM_MODES);
+}
+
+
+RackMemoryResource::~RackMemoryResource()
+{}
+
+
+STATICDEF int RackMemoryResource::sizeClass(std::size_t bytes,
+                                            std::size_t alignment)
+{
+  if (alignment > CLASS_ALIGNMENT ||
+      bytes > (std::size_t(1) << MAX_CLASS_BITS)) {
+    return -1;
+  }
+
+  int cls = 0;
+  while ((std::size_t(1) << (cls + MIN_CLASS_BITS)) < bytes) {
+    cls++;
+  }
+  return cls;
+}
+
+
+void *RackMemoryResource::do_allocate(std::size_t bytes,
+                                      std::size_t alignment)
+{
+  m_numAllocations++;
+
+  // Give each request its own address.
+  if (bytes == 0) {
+    bytes = 1;
+  }
+
+  if (m_mode == RMR_FREE_LISTS) {
+    int cls = sizeClass(bytes, alignment);
+    if (cls >= 0) {
+      if (FreeBlock *block = m_freeLists[cls]) {
+        m_freeLists[cls] = block->m_next;
+        m_numReused++;
+        return block;
+      }
+
+      return m_allocator.allocate(std::size_t(1) << (cls + MIN_CLASS_BITS),
+                                  CLASS_ALIGNMENT);
+    }
+  }
+
+  return m_allocator.allocate(bytes, alignment);
+}
+
+
+void RackMemoryResource::do_deallocate(void *p, std::size_t bytes,
+                                       std::size_t alignment)
+{
+  m_numDeallocations++;
+
+  if (m_mode == RMR_FREE_LISTS) {
+    int cls = sizeClass(bytes==0? 1 : bytes, alignment);
+    if (cls >= 0) {
+      FreeBlock *block = static_cast<FreeBlock*>(p);
+      block->m_next = m_freeLists[cls];
+      m_freeLists[cls] = block;
+    }
+  }
+}
+
+
+bool RackMemoryResource::do_is_equal(
+  std::pmr::memory_resource const &other) const noexcept
+{
+  // Memory from one resource cannot be returned to another, since
+  // each has its own free lists.
+  return this == &other;
+}
+
+
+void RackMemoryResource::discardFreeBlocks()
+{
+  for (FreeBlock *&head : m_freeLists) {
+    head = nullptr;
+  }
+}
+
+
+void RackMemoryResource::release()
+{
+  discardFreeBlocks();
+  m_allocator.clear();
+}
+
+
+int RackMemoryResource::numFreeBlocks() const
+{
+  int ret = 0;
+  for (FreeBlock const *head : m_freeLists) {
+    for (FreeBlock const *b = head; b; b = b->m_next) {
+      ret++;
+    }
+  }
+  return ret;
+}
+
+
+void RackMemoryResource::printStats(std::ostream &os) const
+{
+  PVALTO(os, numAllocations());
+  PVALTO(os, numReused());
+  PVALTO(os, numDeallocations());
+  PVALTO(os, numFreeBlocks());
+  m_allocator.printStats(os);
+}
+
+
+void RackMemoryResource::selfCheck() const
+{
+  if (m_mode == RMR_MONOTONIC) {
+    xassert(numFreeBlocks() == 0);
+  }
+  xassert(m_numReused <= m_numAllocations);
+  m_allocator.selfCheck();
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+// EOF
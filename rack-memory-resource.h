@@ -0,0 +1,143 @@
+// rack-memory-resource.h
+// `RackMemoryResource`, a `std::pmr::memory_resource` backed by a
+// `RackAllocator`.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_RACK_MEMORY_RESOURCE_H
+#define SMBASE_RACK_MEMORY_RESOURCE_H
+
+#include "smbase/rack-allocator.h"     // RackAllocator
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, NO_OBJECT_COPIES, NULLABLE
+
+#include <cstddef>                     // std::size_t
+#include <iosfwd>                      // std::ostream
+#include <memory_resource>             // std::pmr::memory_resource
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// A memory resource that gets its memory from a `RackAllocator`, so
+// that standard containers using it, such as `std::pmr::vector`, can
+// allocate without calling the global `operator new`, and can have
+// all of their memory released at once.
+//
+// The exceptions are that the allocator uses `new` to make racks that
+// its thread's pool cannot supply, and for requests of at least
+// `RackAllocator::LARGE_THRESHOLD` bytes.
+//
+// Like `RackAllocator`, an instance must only be used by one thread at
+// a time.
+class RackMemoryResource : public std::pmr::memory_resource {
+  NO_OBJECT_COPIES(RackMemoryResource);
+
+public:      // types
+  enum Mode {
+    // Deallocation does nothing; memory is only reclaimed by `release`
+    // or by clearing or rolling back the allocator.  This is the
+    // fastest mode, and suits data that is all freed together.
+    RMR_MONOTONIC,
+
+    // Deallocated blocks are kept on free lists, one per power-of-2
+    // size class, and reused by later requests of the same class.
+    // This suits containers that grow or churn, at the cost of
+    // rounding sizes up.
+    RMR_FREE_LISTS,
+
+    NUM_MODES
+  };
+
+  enum {
+    // Smallest and largest size classes, as powers of 2.  Larger
+    // blocks are not reused.
+    MIN_CLASS_BITS = 4,      // 16 bytes
+    MAX_CLASS_BITS = 20,     // 1 MiB
+    NUM_CLASSES = MAX_CLASS_BITS - MIN_CLASS_BITS + 1,
+  };
+
+private:     // types
+  // A deallocated block on a free list.
+  struct FreeBlock {
+    FreeBlock * NULLABLE m_next;
+  };
+
+private:     // data
+  // Allocator used when the client does not supply one.
+  RackAllocator m_ownAllocator;
+
+  // The allocator that provides the memory; either `m_ownAllocator`
+  // or one supplied by the client.
+  RackAllocator &m_allocator;
+
+  // How deallocation is handled.
+  Mode const m_mode;
+
+  // Heads of the free lists, indexed by size class.  These are only
+  // used in `RMR_FREE_LISTS` mode.
+  FreeBlock * NULLABLE m_freeLists[NUM_CLASSES];
+
+  // Number of calls to `allocate`, how many of those were satisfied
+  // from a free list, and number of calls to `deallocate`.
+  long m_numAllocations;
+  long m_numReused;
+  long m_numDeallocations;
+
+private:     // methods
+  // Size class of a request in `RMR_FREE_LISTS` mode, or -1 if blocks
+  // of this size and alignment are not reused.
+  static int sizeClass(std::size_t bytes, std::size_t alignment);
+
+protected:   // methods
+  // std::pmr::memory_resource methods.
+  virtual void *do_allocate(std::size_t bytes,
+                            std::size_t alignment) override;
+  virtual void do_deallocate(void *p, std::size_t bytes,
+                             std::size_t alignment) override;
+  virtual bool do_is_equal(
+    std::pmr::memory_resource const &other) const noexcept override;
+
+public:      // methods
+  // Use an allocator owned by this object.
+  explicit RackMemoryResource(Mode mode = RMR_MONOTONIC);
+
+  // Use `allocator`, which must outlive this object.
+  explicit RackMemoryResource(RackAllocator &allocator,
+                              Mode mode = RMR_MONOTONIC);
+
+  virtual ~RackMemoryResource() override;
+
+  Mode mode() const { return m_mode; }
+
+  RackAllocator &allocator() { return m_allocator; }
+
+  // Forget all blocks on the free lists.  This must be done if the
+  // allocator is cleared or rolled back by some other means.
+  void discardFreeBlocks();
+
+  // Discard free blocks and clear the allocator, deallocating
+  // everything obtained from it, including by other clients if it was
+  // supplied.  Containers using this resource must not be used again.
+  void release();
+
+  // ---- Statistics for testing and performance evaluation
+
+  long numAllocations() const { return m_numAllocations; }
+  long numReused() const { return m_numReused; }
+  long numDeallocations() const { return m_numDeallocations; }
+
+  // Number of blocks currently on the free lists.
+  int numFreeBlocks() const;
+
+  // Print test/performance stats.
+  void printStats(std::ostream &os) const;
+
+  // Assert invariants.
+  void selfCheck() const;
+};
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_RACK_MEMORY_RESOURCE_H
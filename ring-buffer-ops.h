@@ -0,0 +1,451 @@
+// ring-buffer-ops.h
+// Operations for `ring-buffer` module.
+
+// This file is in the public domain.
+
+#ifndef SMBASE_RING_BUFFER_OPS_H
+#define SMBASE_RING_BUFFER_OPS_H
+
+#include "ring-buffer.h"               // interface for this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/xassert.h"            // xassertPrecondition
+
+#include <cstdint>                     // std::intptr_t
+#include <utility>                     // std::{forward, move}
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Smallest power of 2 that is at least `n` and at least 2.
+inline std::size_t ringBufferCapacity(std::size_t n)
+{
+  std::size_t cap = 2;
+  while (cap < n) {
+    xassertPrecondition(cap <= ~std::size_t(0) / 4);
+    cap *= 2;
+  }
+  return cap;
+}
+
+
+// -------------------------- SPSCRingBuffer ---------------------------
+template <class T>
+SPSCRingBuffer<T>::SPSCRingBuffer(std::size_t minCapacity)
+  : m_capacity(ringBufferCapacity(minCapacity)),
+    m_mask(m_capacity - 1),
+    m_slots(new T[m_capacity]),
+    m_head(0),
+    m_cachedTail(0),
+    m_tail(0),
+    m_cachedHead(0)
+{}
+
+
+template <class T>
+SPSCRingBuffer<T>::~SPSCRingBuffer()
+{}
+
+
+template <class T>
+std::size_t SPSCRingBuffer<T>::size() const
+{
+  // Read the head first so the difference cannot be negative.
+  std::size_t head = m_head.load(std::memory_order_acquire);
+  std::size_t tail = m_tail.load(std::memory_order_acquire);
+  return tail - head;
+}
+
+
+template <class T>
+template <class U>
+bool SPSCRingBuffer<T>::tryPushImpl(U &&value)
+{
+  std::size_t tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_cachedHead == m_capacity) {
+    m_cachedHead = m_head.load(std::memory_order_acquire);
+    if (tail - m_cachedHead == m_capacity) {
+      return false;
+    }
+  }
+
+  m_slots[tail & m_mask] = std::forward<U>(value);
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+
+template <class T>
+void SPSCRingBuffer<T>::push(T const &value)
+{
+  for (int spins = 0; !tryPush(value); ) {
+    ringBufferBackoff(spins);
+  }
+}
+
+
+template <class T>
+void SPSCRingBuffer<T>::push(T &&value)
+{
+  // `tryPush` only moves from `value` when it succeeds.
+  for (int spins = 0; !tryPush(std::move(value)); ) {
+    ringBufferBackoff(spins);
+  }
+}
+
+
+template <class T>
+std::size_t SPSCRingBuffer<T>::tryPushMany(T const *values, std::size_t n)
+{
+  std::size_t tail = m_tail.load(std::memory_order_relaxed);
+  if (m_capacity - (tail - m_cachedHead) < n) {
+    m_cachedHead = m_head.load(std::memory_order_acquire);
+  }
+
+  std::size_t room = m_capacity - (tail - m_cachedHead);
+  if (n > room) {
+    n = room;
+  }
+
+  for (std::size_t i=0; i < n; i++) {
+    m_slots[(tail + i) & m_mask] = values[i];
+  }
+
+  // Publish them all at once.
+  m_tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+
+template <class T>
+void SPSCRingBuffer<T>::pushMany(T const *values, std::size_t n)
+{
+  int spins = 0;
+  while (n > 0) {
+    std::size_t pushed = tryPushMany(values, n);
+    if (pushed == 0) {
+      ringBufferBackoff(spins);
+    }
+    values += pushed;
+    n -= pushed;
+  }
+}
+
+
+template <class T>
+bool SPSCRingBuffer<T>::tryPop(T &value)
+{
+  std::size_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_cachedTail) {
+    m_cachedTail = m_tail.load(std::memory_order_acquire);
+    if (head == m_cachedTail) {
+      return false;
+    }
+  }
+
+  value = std::move(m_slots[head & m_mask]);
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+
+template <class T>
+T SPSCRingBuffer<T>::pop()
+{
+  T ret;
+  for (int spins = 0; !tryPop(ret); ) {
+    ringBufferBackoff(spins);
+  }
+  return ret;
+}
+
+
+template <class T>
+std::size_t SPSCRingBuffer<T>::tryPopMany(T *values, std::size_t maxN)
+{
+  std::size_t head = m_head.load(std::memory_order_relaxed);
+  if (m_cachedTail - head < maxN) {
+    m_cachedTail = m_tail.load(std::memory_order_acquire);
+  }
+
+  std::size_t n = m_cachedTail - head;
+  if (n > maxN) {
+    n = maxN;
+  }
+
+  for (std::size_t i=0; i < n; i++) {
+    values[i] = std::move(m_slots[(head + i) & m_mask]);
+  }
+
+  m_head.store(head + n, std::memory_order_release);
+  return n;
+}
+
+
+template <class T>
+std::size_t SPSCRingBuffer<T>::popMany(T *values, std::size_t maxN)
+{
+  xassertPrecondition(maxN > 0);
+
+  for (int spins = 0; ; ) {
+    if (std::size_t n = tryPopMany(values, maxN)) {
+      return n;
+    }
+    ringBufferBackoff(spins);
+  }
+}
+
+
+// -------------------------- MPMCRingBuffer ---------------------------
+template <class T>
+MPMCRingBuffer<T>::MPMCRingBuffer(std::size_t minCapacity)
+  : m_capacity(ringBufferCapacity(minCapacity)),
+    m_mask(m_capacity - 1),
+    m_cells(new Cell[m_capacity]),
+    m_enqueuePos(0),
+    m_dequeuePos(0)
+{
+  for (std::size_t i=0; i < m_capacity; i++) {
+    m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+
+template <class T>
+MPMCRingBuffer<T>::~MPMCRingBuffer()
+{}
+
+
+template <class T>
+std::size_t MPMCRingBuffer<T>::size() const
+{
+  std::size_t head = m_dequeuePos.load(std::memory_order_acquire);
+  std::size_t tail = m_enqueuePos.load(std::memory_order_acquire);
+
+  // With concurrent pops, `head` can get ahead of the `tail` we read.
+  return tail > head? tail - head : 0;
+}
+
+
+template <class T>
+template <class U>
+bool MPMCRingBuffer<T>::tryPushImpl(U &&value)
+{
+  std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+  Cell *cell;
+  for (;;) {
+    cell = &m_cells[pos & m_mask];
+    std::size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+    std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)pos;
+    if (diff == 0) {
+      // The cell is free in this lap; try to claim the position.
+      if (m_enqueuePos.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+      // `pos` was reloaded by the failed exchange.
+    }
+    else if (diff < 0) {
+      // The cell still holds an element from the previous lap.
+      return false;
+    }
+    else {
+      // Another producer claimed `pos`.
+      pos = m_enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->m_value = std::forward<U>(value);
+  cell->m_sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+
+template <class T>
+void MPMCRingBuffer<T>::push(T const &value)
+{
+  for (int spins = 0; !tryPush(value); ) {
+    ringBufferBackoff(spins);
+  }
+}
+
+
+template <class T>
+void MPMCRingBuffer<T>::push(T &&value)
+{
+  for (int spins = 0; !tryPush(std::move(value)); ) {
+    ringBufferBackoff(spins);
+  }
+}
+
+
+template <class T>
+std::size_t MPMCRingBuffer<T>::tryPushMany(T const *values, std::size_t n)
+{
+  if (n == 0) {
+    return 0;
+  }
+
+  std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+  std::size_t k;
+  for (;;) {
+    // Count how many cells from `pos` on are free in this lap.  Once
+    // we claim them, no other thread can change that.
+    k = 0;
+    while (k < n) {
+      std::size_t seq =
+        m_cells[(pos + k) & m_mask].m_sequence.load(std::memory_order_acquire);
+      if (seq != pos + k) {
+        break;
+      }
+      k++;
+    }
+
+    if (k == 0) {
+      std::size_t seq =
+        m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire);
+      if ((std::intptr_t)seq - (std::intptr_t)pos < 0) {
+        return 0;                      // full
+      }
+      pos = m_enqueuePos.load(std::memory_order_relaxed);
+      continue;
+    }
+
+    if (m_enqueuePos.compare_exchange_weak(
+          pos, pos + k, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  for (std::size_t i=0; i < k; i++) {
+    Cell &cell = m_cells[(pos + i) & m_mask];
+    cell.m_value = values[i];
+    cell.m_sequence.store(pos + i + 1, std::memory_order_release);
+  }
+  return k;
+}
+
+
+template <class T>
+void MPMCRingBuffer<T>::pushMany(T const *values, std::size_t n)
+{
+  int spins = 0;
+  while (n > 0) {
+    std::size_t pushed = tryPushMany(values, n);
+    if (pushed == 0) {
+      ringBufferBackoff(spins);
+    }
+    values += pushed;
+    n -= pushed;
+  }
+}
+
+
+template <class T>
+bool MPMCRingBuffer<T>::tryPop(T &value)
+{
+  std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+  Cell *cell;
+  for (;;) {
+    cell = &m_cells[pos & m_mask];
+    std::size_t seq = cell->m_sequence.load(std::memory_order_acquire);
+    std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (m_dequeuePos.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      // Nothing has been written at `pos` yet.
+      return false;
+    }
+    else {
+      pos = m_dequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  value = std::move(cell->m_value);
+
+  // Free the cell for the producer of the next lap.
+  cell->m_sequence.store(pos + m_capacity, std::memory_order_release);
+  return true;
+}
+
+
+template <class T>
+T MPMCRingBuffer<T>::pop()
+{
+  T ret;
+  for (int spins = 0; !tryPop(ret); ) {
+    ringBufferBackoff(spins);
+  }
+  return ret;
+}
+
+
+template <class T>
+std::size_t MPMCRingBuffer<T>::tryPopMany(T *values, std::size_t maxN)
+{
+  if (maxN == 0) {
+    return 0;
+  }
+
+  std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+  std::size_t k;
+  for (;;) {
+    // Count how many cells from `pos` on are ready to read.
+    k = 0;
+    while (k < maxN) {
+      std::size_t seq =
+        m_cells[(pos + k) & m_mask].m_sequence.load(std::memory_order_acquire);
+      if (seq != pos + k + 1) {
+        break;
+      }
+      k++;
+    }
+
+    if (k == 0) {
+      std::size_t seq =
+        m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire);
+      if ((std::intptr_t)seq - (std::intptr_t)(pos + 1) < 0) {
+        return 0;                      // empty
+      }
+      pos = m_dequeuePos.load(std::memory_order_relaxed);
+      continue;
+    }
+
+    if (m_dequeuePos.compare_exchange_weak(
+          pos, pos + k, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  for (std::size_t i=0; i < k; i++) {
+    Cell &cell = m_cells[(pos + i) & m_mask];
+    values[i] = std::move(cell.m_value);
+    cell.m_sequence.store(pos + i + m_capacity, std::memory_order_release);
+  }
+  return k;
+}
+
+
+template <class T>
+std::size_t MPMCRingBuffer<T>::popMany(T *values, std::size_t maxN)
+{
+  xassertPrecondition(maxN > 0);
+
+  for (int spins = 0; ; ) {
+    if (std::size_t n = tryPopMany(values, maxN)) {
+      return n;
+    }
+    ringBufferBackoff(spins);
+  }
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_RING_BUFFER_OPS_H
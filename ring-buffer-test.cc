@@ -0,0 +1,342 @@
+// ring-buffer-test.cc
+// Tests for `ring-buffer` module.
+
+// This file is in the public domain.
+
+#include "smbase/ring-buffer-ops.h"    // module under test
+
+#include "smbase/arrayqueue.h"         // ArrayQueue
+#include "smbase/nonport.h"            // getMilliseconds
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "smbase/sm-test.h"            // DIAG, EXPECT_EQ
+#include "smbase/xassert.h"            // xassert
+
+#include <atomic>                      // std::atomic
+#include <cstdlib>                     // std::{getenv, atol}
+#include <iostream>                    // std::cout
+#include <mutex>                       // std::{mutex, lock_guard}
+#include <string>                      // std::string
+#include <thread>                      // std::thread
+#include <type_traits>                 // std::is_same
+#include <vector>                      // std::vector
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Single-threaded behavior common to both queues.
+template <class Queue>
+void testBasics()
+{
+  Queue q(5);
+  EXPECT_EQ(q.capacity(), 8);
+  xassert(q.empty());
+
+  std::string s;
+  xassert(!q.tryPop(s));
+
+  // Fill it; one more fails.
+  smbase_loopi(8) {
+    xassert(q.tryPush(std::to_string(i)));
+  }
+  EXPECT_EQ(q.size(), 8);
+  std::string extra("extra");
+  xassert(!q.tryPush(std::move(extra)));
+  EXPECT_EQ(extra, "extra");           // not moved from
+
+  // Pop in order.
+  smbase_loopi(3) {
+    xassert(q.tryPop(s));
+    EXPECT_EQ(s, std::to_string(i));
+  }
+
+  // Wrap around the end of the array with the batch operations.
+  std::string more[5] = { "8", "9", "10", "11", "12" };
+  EXPECT_EQ(q.tryPushMany(more, 5), 3);
+  EXPECT_EQ(q.tryPushMany(more, 5), 0);
+  EXPECT_EQ(q.size(), 8);
+
+  std::string out[10];
+  EXPECT_EQ(q.tryPopMany(out, 6), 6);
+  smbase_loopi(6) {
+    EXPECT_EQ(out[i], std::to_string(i+3));
+  }
+  EXPECT_EQ(q.popMany(out, 10), 2);
+  EXPECT_EQ(out[0], "9");
+  EXPECT_EQ(out[1], "10");
+  xassert(q.empty());
+  EXPECT_EQ(q.tryPopMany(out, 10), 0);
+
+  // Blocking operations that do not need to block.
+  q.push("a");
+  q.pushMany(more, 2);
+  EXPECT_EQ(q.pop(), "a");
+  EXPECT_EQ(q.pop(), "8");
+  EXPECT_EQ(q.pop(), "9");
+}
+
+
+// One producer sends 0..n-1 to one consumer, mixing single and batch
+// operations; the consumer checks they arrive in order.
+template <class Queue>
+void testOneToOne(long n)
+{
+  Queue q(64);
+
+  std::thread producer([&q, n]() {
+    long buf[10];
+    long i = 0;
+    while (i < n) {
+      if (i % 3 == 0 && i+10 <= n) {
+        for (int j=0; j < 10; j++) {
+          buf[j] = i+j;
+        }
+        q.pushMany(buf, 10);
+        i += 10;
+      }
+      else {
+        q.push(i++);
+      }
+    }
+  });
+
+  long expect = 0;
+  long buf[7];
+  while (expect < n) {
+    if (expect % 2 == 0) {
+      std::size_t got = q.popMany(buf, 7);
+      for (std::size_t j=0; j < got; j++) {
+        xassert(buf[j] == expect++);
+      }
+    }
+    else {
+      xassert(q.pop() == expect++);
+    }
+  }
+
+  producer.join();
+  xassert(q.empty());
+}
+
+
+// Several producers and consumers share an MPMCRingBuffer.  Each
+// element is (producer << 32) | sequence.  Every element arrives
+// exactly once, and each consumer sees each producer's elements in
+// order.
+void testManyToMany()
+{
+  enum { PRODUCERS=3, CONSUMERS=3, PER_PRODUCER=30000 };
+
+  MPMCRingBuffer<long> q(32);
+  std::atomic<long> consumed(0);
+  std::atomic<long> sum(0);
+
+  std::vector<std::thread> threads;
+  for (long p=0; p < PRODUCERS; p++) {
+    threads.emplace_back([&q, p]() {
+      long buf[4];
+      long i = 0;
+      while (i < PER_PRODUCER) {
+        if (p == 0 && i+4 <= PER_PRODUCER) {
+          for (int j=0; j < 4; j++) {
+            buf[j] = (p << 32) | (i+j);
+          }
+          q.pushMany(buf, 4);
+          i += 4;
+        }
+        else {
+          q.push((p << 32) | i);
+          i++;
+        }
+      }
+    });
+  }
+
+  for (int c=0; c < CONSUMERS; c++) {
+    threads.emplace_back([&q, &consumed, &sum, c]() {
+      long lastSeen[PRODUCERS] = { -1, -1, -1 };
+      long buf[5];
+      while (consumed.load() < (long)PRODUCERS * PER_PRODUCER) {
+        std::size_t got = c == 0? q.tryPopMany(buf, 5) :
+                                  (q.tryPop(buf[0])? 1 : 0);
+        if (got == 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (std::size_t j=0; j < got; j++) {
+          long p = buf[j] >> 32;
+          long seq = buf[j] & 0xFFFFFFFF;
+          xassert(0 <= p && p < PRODUCERS);
+          xassert(seq > lastSeen[p]);
+          lastSeen[p] = seq;
+          sum += seq;
+        }
+        consumed += (long)got;
+      }
+    });
+  }
+
+  for (std::thread &thr : threads) {
+    thr.join();
+  }
+
+  EXPECT_EQ(consumed.load(), (long)PRODUCERS * PER_PRODUCER);
+  EXPECT_EQ(sum.load(),
+            (long)PRODUCERS * PER_PRODUCER * (PER_PRODUCER-1) / 2);
+  xassert(q.empty());
+}
+
+
+// ArrayQueue behind a mutex, the arrangement the ring buffers replace.
+class MutexArrayQueue {
+private:     // data
+  std::mutex m_mutex;
+  ArrayQueue<long> m_queue;
+
+public:      // funcs
+  void push(long value)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_queue.enqueue(value);
+  }
+
+  bool tryPop(long &value)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_queue.isEmpty()) {
+      return false;
+    }
+    value = m_queue.dequeue();
+    return true;
+  }
+};
+
+
+// Send `n` items from each of `producers` threads to `consumers`
+// threads through `q`, and return the elapsed milliseconds.  With
+// `batch`, use the batch operations, 16 at a time.
+template <class Queue>
+long throughput(Queue &q, long n, int producers, int consumers, bool batch)
+{
+  std::atomic<long> consumed(0);
+  long const total = n * producers;
+
+  long start = getMilliseconds();
+  std::vector<std::thread> threads;
+  for (int p=0; p < producers; p++) {
+    threads.emplace_back([&q, n, batch]() {
+      long buf[16];
+      for (long i=0; i < n; ) {
+        if constexpr (!std::is_same<Queue, MutexArrayQueue>::value) {
+          if (batch && i+16 <= n) {
+            for (int j=0; j < 16; j++) {
+              buf[j] = i+j;
+            }
+            q.pushMany(buf, 16);
+            i += 16;
+            continue;
+          }
+        }
+        q.push(i++);
+      }
+    });
+  }
+  for (int c=0; c < consumers; c++) {
+    threads.emplace_back([&q, &consumed, total, batch]() {
+      long buf[16];
+      while (consumed.load(std::memory_order_relaxed) < total) {
+        long got = 0;
+        if constexpr (!std::is_same<Queue, MutexArrayQueue>::value) {
+          if (batch) {
+            got = (long)q.tryPopMany(buf, 16);
+          }
+        }
+        if (!batch) {
+          got = q.tryPop(buf[0])? 1 : 0;
+        }
+        if (got == 0) {
+          std::this_thread::yield();
+        }
+        else {
+          consumed.fetch_add(got, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (std::thread &thr : threads) {
+    thr.join();
+  }
+  return getMilliseconds() - start;
+}
+
+
+template <class Queue>
+void printThroughput(char const *label, Queue &q, long n,
+                     int producers, int consumers, bool batch)
+{
+  long ms = throughput(q, n, producers, consumers, batch);
+  std::cout << label << ": " << ms << " ms, "
+            << (ms? (double)n * producers / ms / 1000.0 : 0.0)
+            << " M items/s\n";
+}
+
+
+// Compare the queues' throughput.  RING_BUFFER_PERF is the number of
+// items each producer sends.
+void perfTest()
+{
+  char const *nStr = std::getenv("RING_BUFFER_PERF");
+  if (!nStr) {
+    return;
+  }
+  long n = std::atol(nStr);
+
+  {
+    MutexArrayQueue q;
+    printThroughput("mutex+ArrayQueue 1x1  ", q, n, 1, 1, false);
+  }
+  {
+    SPSCRingBuffer<long> q(1024);
+    printThroughput("SPSCRingBuffer 1x1    ", q, n, 1, 1, false);
+  }
+  {
+    SPSCRingBuffer<long> q(1024);
+    printThroughput("SPSCRingBuffer batch  ", q, n, 1, 1, true);
+  }
+  {
+    MPMCRingBuffer<long> q(1024);
+    printThroughput("MPMCRingBuffer 1x1    ", q, n, 1, 1, false);
+  }
+  {
+    MutexArrayQueue q;
+    printThroughput("mutex+ArrayQueue 2x2  ", q, n, 2, 2, false);
+  }
+  {
+    MPMCRingBuffer<long> q(1024);
+    printThroughput("MPMCRingBuffer 2x2    ", q, n, 2, 2, false);
+  }
+  {
+    MPMCRingBuffer<long> q(1024);
+    printThroughput("MPMCRingBuffer batch  ", q, n, 2, 2, true);
+  }
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_ring_buffer()
+{
+  testBasics<SPSCRingBuffer<std::string> >();
+  testBasics<MPMCRingBuffer<std::string> >();
+  testOneToOne<SPSCRingBuffer<long> >(100000);
+  testOneToOne<MPMCRingBuffer<long> >(100000);
+  testManyToMany();
+  perfTest();
+}
+
+
+// EOF
@@ -0,0 +1,208 @@
+// ring-buffer.h
+// `SPSCRingBuffer` and `MPMCRingBuffer`, bounded lock-free queues.
+
+// This file is in the public domain.
+
+// Both queues have a fixed capacity, a power of 2, chosen when they
+// are constructed.  Unlike ArrayQueue, they never grow; a push onto a
+// full queue fails (`tryPush`) or waits (`push`) until a consumer
+// makes room.
+//
+// `SPSCRingBuffer` allows one producer thread and one consumer thread
+// at a time.  Each side owns one index, and only reads the other's
+// when its cached copy says the queue looks full or empty.
+//
+// `MPMCRingBuffer` allows any number of producers and consumers.  It
+// is Dmitry Vyukov's bounded queue: each cell has a sequence number
+// saying whether it is ready to be written or read in the current lap,
+// and threads claim positions with a compare-and-swap on the shared
+// index.
+//
+// In both, the indices written by different threads are on separate
+// cache lines.
+//
+// The blocking operations spin briefly and then yield the processor;
+// they do not use condition variables, so a thread waiting on a queue
+// that stays full or empty keeps polling it.
+
+#ifndef SMBASE_RING_BUFFER_H
+#define SMBASE_RING_BUFFER_H
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, NO_OBJECT_COPIES
+
+#include <atomic>                      // std::atomic
+#include <cstddef>                     // std::size_t
+#include <memory>                      // std::unique_ptr
+#include <thread>                      // std::this_thread::yield
+#include <utility>                     // std::move
+
+
+OPEN_NAMESPACE(smbase)
+
+
+// Alignment used to keep data written by different threads on
+// different cache lines.
+enum { RING_BUFFER_CACHE_LINE = 64 };
+
+
+// Wait a little before retrying an operation that failed because the
+// queue was full or empty.  `spins` counts the retries so far.
+inline void ringBufferBackoff(int &spins)
+{
+  if (++spins > 16) {
+    std::this_thread::yield();
+  }
+}
+
+
+// Requirements on T, for both queues:
+//
+//   T::T();                 // slots are default-constructed
+//   operator=(T&&);         // values are moved in and out of slots
+//
+template <class T>
+class SPSCRingBuffer {
+  NO_OBJECT_COPIES(SPSCRingBuffer);
+
+private:     // data
+  // Number of slots, a power of 2, and that minus 1.
+  std::size_t const m_capacity;
+  std::size_t const m_mask;
+
+  // The slots.  Position `p` is stored in `m_slots[p & m_mask]`.
+  std::unique_ptr<T[]> m_slots;
+
+  // ---- Consumer's cache line.
+
+  // Position of the next element to pop.
+  alignas(RING_BUFFER_CACHE_LINE) std::atomic<std::size_t> m_head;
+
+  // Value of `m_tail` last seen by the consumer.
+  std::size_t m_cachedTail;
+
+  // ---- Producer's cache line.
+
+  // Position where the next element will be pushed.
+  alignas(RING_BUFFER_CACHE_LINE) std::atomic<std::size_t> m_tail;
+
+  // Value of `m_head` last seen by the producer.
+  std::size_t m_cachedHead;
+
+private:     // funcs
+  template <class U>
+  bool tryPushImpl(U &&value);
+
+public:      // funcs
+  // Make a queue that holds at least `minCapacity` elements.
+  explicit SPSCRingBuffer(std::size_t minCapacity);
+  ~SPSCRingBuffer();
+
+  std::size_t capacity() const { return m_capacity; }
+
+  // Number of elements in the queue.  If the other side is active,
+  // this can be out of date by the time it returns.
+  std::size_t size() const;
+  bool empty() const { return size() == 0; }
+
+  // ---- Producer.
+
+  // Add `value` at the tail and return true, or return false, leaving
+  // `value` alone, if the queue is full.
+  bool tryPush(T const &value) { return tryPushImpl(value); }
+  bool tryPush(T &&value) { return tryPushImpl(std::move(value)); }
+
+  // Add `value`, waiting for room if necessary.
+  void push(T const &value);
+  void push(T &&value);
+
+  // Add as many of the `n` elements of `values` as there is room for,
+  // in order, and return how many were added.
+  std::size_t tryPushMany(T const *values, std::size_t n);
+
+  // Add all `n` elements, waiting for room as necessary.
+  void pushMany(T const *values, std::size_t n);
+
+  // ---- Consumer.
+
+  // Remove the head element into `value` and return true, or return
+  // false if the queue is empty.
+  bool tryPop(T &value);
+
+  // Remove and return the head element, waiting for one if necessary.
+  T pop();
+
+  // Remove up to `maxN` elements into `values`, in order, and return
+  // how many were removed.
+  std::size_t tryPopMany(T *values, std::size_t maxN);
+
+  // Remove between 1 and `maxN` elements, waiting for the first if
+  // necessary.  `maxN` must be positive.
+  std::size_t popMany(T *values, std::size_t maxN);
+};
+
+
+// Same requirements on T as SPSCRingBuffer.
+template <class T>
+class MPMCRingBuffer {
+  NO_OBJECT_COPIES(MPMCRingBuffer);
+
+private:     // types
+  struct Cell {
+    // For position `p` mapping to this cell: `p` when the cell is
+    // ready to be written, `p+1` when it is ready to be read.
+    std::atomic<std::size_t> m_sequence;
+
+    T m_value;
+  };
+
+private:     // data
+  // Number of cells, a power of 2, and that minus 1.
+  std::size_t const m_capacity;
+  std::size_t const m_mask;
+
+  // The cells.
+  std::unique_ptr<Cell[]> m_cells;
+
+  // Next position to push to.
+  alignas(RING_BUFFER_CACHE_LINE) std::atomic<std::size_t> m_enqueuePos;
+
+  // Next position to pop from.
+  alignas(RING_BUFFER_CACHE_LINE) std::atomic<std::size_t> m_dequeuePos;
+
+private:     // funcs
+  template <class U>
+  bool tryPushImpl(U &&value);
+
+public:      // funcs
+  // Make a queue that holds at least `minCapacity` elements.
+  explicit MPMCRingBuffer(std::size_t minCapacity);
+  ~MPMCRingBuffer();
+
+  std::size_t capacity() const { return m_capacity; }
+
+  // Approximate number of elements in the queue.
+  std::size_t size() const;
+  bool empty() const { return size() == 0; }
+
+  // ---- Producers.  These have the same meaning as in SPSCRingBuffer.
+  // Elements pushed by one call to `pushMany` or `tryPushMany` can be
+  // interleaved with those of other producers.
+  bool tryPush(T const &value) { return tryPushImpl(value); }
+  bool tryPush(T &&value) { return tryPushImpl(std::move(value)); }
+  void push(T const &value);
+  void push(T &&value);
+  std::size_t tryPushMany(T const *values, std::size_t n);
+  void pushMany(T const *values, std::size_t n);
+
+  // ---- Consumers.
+  bool tryPop(T &value);
+  T pop();
+  std::size_t tryPopMany(T *values, std::size_t maxN);
+  std::size_t popMany(T *values, std::size_t maxN);
+};
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_RING_BUFFER_H
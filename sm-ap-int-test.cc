@@ -5,8 +5,10 @@
 
 #include "sm-ap-int.h"                 // module under test
 
+#include "double-width-type.h"         // SMBASE_HAVE_UINT128
 #include "exc.h"                       // EXN_CONTEXT_CALL
 #include "get-type-name.h"             // smbase::GetTypeName
+#include "nonport.h"                   // getMilliseconds
 #include "overflow.h"                  // addWithOverflowCheck, etc.
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
 #include "sm-random.h"                 // sm_randomPrim
@@ -14,6 +16,10 @@
 
 #include <cstdint>                     // std::uint8_t, etc.
 #include <cstdlib>                     // std::{atoi, getenv}
+#include <iostream>                    // std::cout
+#include <numeric>                     // std::gcd
+#include <optional>                    // std::optional
+#include <string>                      // std::string
 
 using namespace smbase;
 
@@ -269,6 +275,38 @@ public:      // methods
     }
   }
 
+  void testNumberTheory()
+  {
+    smbase_loopi(100) {
+      std::int64_t a = sm_randomPrim<std::int32_t>();
+      std::int64_t b = sm_randomPrim<std::int16_t>();
+      EXN_CONTEXT_EXPR(a);
+      EXN_CONTEXT_EXPR(b);
+
+      Integer apA(a), apB(b);
+      Integer g, x, y;
+      Integer::extendedGCD(g, x, y, apA, apB);
+      SC_EXPECT_EQ(g, Integer(std::gcd(a, b)));
+      SC_EXPECT_EQ(Integer::gcd(apA, apB), g);
+      EXPECT_EQ(apA*x + apB*y, g);
+
+      if (b > 1) {
+        std::optional<Integer> inv = Integer::modInverse(apA, apB);
+        EXPECT_EQ(inv.has_value(), g == Integer(1));
+        if (inv) {
+          EXPECT_EQ((apA * *inv).nonNegativeModulo(apB), Integer(1));
+        }
+
+        // With an exponent of 3 the result is easy to check.
+        EXPECT_EQ(Integer::modPow(apA, 3, apB),
+                  (apA*apA*apA).nonNegativeModulo(apB));
+      }
+    }
+
+    EXPECT_EQ(Integer::pow(-3, 3), Integer(-27));
+    EXPECT_EQ(Integer::isqrt(1000000), Integer(1000));
+  }
+
   void testAll()
   {
     try {
@@ -276,6 +314,7 @@ public:      // methods
       testDivide();
       testUnaryOps();
       testRandomArithmetic();
+      testNumberTheory();
     }
     catch (XBase &x) {
       x.prependContext(stringb(
@@ -287,6 +326,84 @@ public:      // methods
 };
 
 
+// Time some operations on large numbers using `Word` as the word type.
+// This is meant to compare the word sizes, not as a test.
+template <typename Word>
+void perfTestWordSize(int digits, int iters)
+{
+  typedef APInteger<Word, std::int32_t> Integer;
+
+  // Two numbers with `digits` and `digits/2` decimal digits.
+  std::string aDigits(digits, '7');
+  std::string bDigits(digits/2, '3');
+
+  long start = getMilliseconds();
+  Integer a, b;
+  smbase_loopi(iters) {
+    a = Integer::fromDigits(aDigits);
+    b = Integer::fromDigits(bDigits);
+  }
+  long parseMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  Integer sum;
+  smbase_loopi(iters * 100) {
+    sum = a + b;
+  }
+  long addMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  Integer prod;
+  smbase_loopi(iters) {
+    prod = a * b;
+  }
+  long mulMs = getMilliseconds() - start;
+
+  start = getMilliseconds();
+  Integer quot;
+  smbase_loopi(iters) {
+    quot = prod / b;
+  }
+  long divMs = getMilliseconds() - start;
+  xassert(quot == a);
+
+  start = getMilliseconds();
+  std::string printed;
+  smbase_loopi(iters) {
+    printed = a.toString();
+  }
+  long printMs = getMilliseconds() - start;
+  xassert(printed == aDigits);
+
+  std::cout << "Word bits=" << sizeof(Word)*8
+            << " digits=" << digits
+            << " iters=" << iters
+            << ": parse " << parseMs << " ms"
+            << ", add(x100) " << addMs << " ms"
+            << ", mul " << mulMs << " ms"
+            << ", div " << divMs << " ms"
+            << ", print " << printMs << " ms\n";
+}
+
+
+// Compare the word sizes available for `Integer`.  Enabled by setting
+// SM_AP_INT_PERF to the number of decimal digits to use.
+void perfTest()
+{
+  char const *digitsStr = std::getenv("SM_AP_INT_PERF");
+  if (!digitsStr) {
+    return;
+  }
+  int digits = std::atoi(digitsStr);
+  int iters = 10;
+
+  perfTestWordSize<std::uint32_t>(digits, iters);
+#if defined(SMBASE_HAVE_UINT128)
+  perfTestWordSize<std::uint64_t>(digits, iters);
+#endif
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
@@ -306,9 +423,14 @@ void test_sm_ap_int()
   APIntegerTest<std::uint32_t, std:: int8_t>().testAll();
   APIntegerTest<std::uint32_t, std::int16_t>().testAll();
   APIntegerTest<std::uint32_t, std::int32_t>().testAll();
+#if defined(SMBASE_HAVE_UINT128)
+  APIntegerTest<std::uint64_t, std::int32_t>().testAll();
+#endif
 
   VPVAL(overflowCount);
   VPVAL(nonOverflowCount);
+
+  perfTest();
 }
 
 
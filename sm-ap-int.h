@@ -35,7 +35,8 @@ OPEN_NAMESPACE(smbase)
    with a more convenient, non-templated interface.
 
    My nominal assumption is that, when used in production, `Word` will
-   be `uint32_t` and `EmbeddedInt` will be `int32_t`.
+   be `uint64_t` (or `uint32_t` on platforms without a 128-bit type)
+   and `EmbeddedInt` will be `int32_t`.
 */
 template <typename Word, typename EmbeddedInt>
 class APInteger {
@@ -116,63 +117,72 @@ private:     // methods
     }
   }
 
-  // Get the magnitude as an AP integer.
-  UInteger getAPMagnitude() const
+  // Get the magnitude as an AP integer.  If it is already one, return
+  // a reference to it; otherwise, put it into `tmp` and return that.
+  UInteger const &getAPMagnitude(UInteger &tmp) const
   {
     if (isEmbedded()) {
       // Note that this is safe, in part, because we do not use the
       // most-negative value representable by `EmbeddedInt`.
-      return UInteger(std::abs(m_eValue));
+      tmp = UInteger(std::abs(m_eValue));
+      return tmp;
     }
     else {
       return m_magnitude;
     }
   }
 
-  // Return sum if `isSum`, difference otherwise.
-  APInteger sumOrDifference(APInteger const &other, bool isSum) const
+  /* Set `*this` to `a+b` if `isSum`, `a-b` otherwise.
+
+     `*this` may be the same object as either operand.  When it is not
+     embedded, its magnitude storage is reused for the result, so
+     `x += y` in a loop does not allocate once `x` has grown.
+  */
+  void setSumOrDifference(APInteger const &a, APInteger const &b,
+                          bool isSum)
   {
-    if (this->isEmbedded() || other.isEmbedded()) {
-      // Convert both to AP integers (even if one already is).
-      return innerSumOrDifference(
-        this->getAPMagnitude(), this->isNegative(),
-        other.getAPMagnitude(), other.isNegative(),
-        isSum);
-    }
-    else {
-      return innerSumOrDifference(
-        this->m_magnitude, this->isNegative(),
-        other.m_magnitude, other.isNegative(),
-        isSum);
+    if (a.isEmbedded() && b.isEmbedded()) {
+      std::optional<EmbeddedInt> res = isSum?
+        addWithOverflowCheckOpt(a.m_eValue, b.m_eValue) :
+        subtractWithOverflowCheckOpt(a.m_eValue, b.m_eValue);
+      if (res.has_value()) {
+        // Note that this is not guaranteed to result in an embedded
+        // value because it could be `mostNegativeEmbeddedInt()`.
+        *this = APInteger(res.value());
+        return;
+      }
     }
-  }
 
-  // Return the sum or difference of two numbers represented as AP
-  // magnitudes and signs.
-  static APInteger innerSumOrDifference(
-    UInteger const &thisMagnitude,
-    bool thisIsNegative,
-    UInteger const &otherMagnitude,
-    bool otherIsNegative,
-    bool isSum)
-  {
-    bool sameSign = thisIsNegative == otherIsNegative;
+    // Read everything we need from the operands before writing to
+    // `*this`, since it might be one of them.
+    UInteger aTmp, bTmp;
+    UInteger const &aMag = a.getAPMagnitude(aTmp);
+    UInteger const &bMag = b.getAPMagnitude(bTmp);
+    bool aIsNegative = a.isNegative();
+    bool bIsNegative = b.isNegative();
+
+    bool negative;
+    bool sameSign = aIsNegative == bIsNegative;
     if (sameSign == isSum) {
       // Same effective signs, add magnitudes.
-      return APInteger(thisMagnitude + otherMagnitude,
-                       thisIsNegative);
+      UInteger::addTo(m_magnitude, aMag, bMag);
+      negative = aIsNegative;
     }
-    else if (thisMagnitude >= otherMagnitude) {
-      // `this` dominates.
-      return APInteger(thisMagnitude - otherMagnitude,
-                       thisIsNegative);
+    else if (aMag >= bMag) {
+      // `a` dominates.
+      UInteger::subFrom(m_magnitude, aMag, bMag);
+      negative = aIsNegative;
     }
     else {
-      // `other` dominates.  If `isSum`, we use its sign, otherwise we
-      // flip it.
-      return APInteger(otherMagnitude - thisMagnitude,
-                       otherIsNegative == isSum);
+      // `b` dominates.  If `isSum`, we use its sign, otherwise we flip
+      // it.
+      UInteger::subFrom(m_magnitude, bMag, aMag);
+      negative = (bIsNegative == isSum);
     }
+
+    m_soe = negative? SOE_NEGATIVE : SOE_POSITIVE;
+    m_eValue = 0;
+    normalize();
   }
 
   // Return the most-negative value that `EmbeddedInt` can represent.
@@ -358,6 +368,12 @@ public:      // methods
     }
   }
 
+  // True if `*this` is greater than zero.
+  bool isPositive() const
+  {
+    return !isNegative() && !isZero();
+  }
+
   // Flip the sign of `*this` unless the magnitude is zero.
   void flipSign()
   {
@@ -621,22 +637,15 @@ public:      // methods
   // ---------- Addition ----------
   APInteger &operator+=(APInteger const &other)
   {
-    return *this = *this + other;
+    setSumOrDifference(*this, other, true /*isSum*/);
+    return *this;
   }
 
   APInteger operator+(APInteger const &other) const
   {
-    if (this->isEmbedded() && other.isEmbedded()) {
-      std::optional<EmbeddedInt> res =
-        addWithOverflowCheckOpt(this->m_eValue, other.m_eValue);
-      if (res.has_value()) {
-        // Note that this is not guaranteed to result in an embedded
-        // value because it could be `mostNegativeEmbeddedInt()`.
-        return APInteger(res.value());
-      }
-    }
-
-    return sumOrDifference(other, true /*isSum*/);
+    APInteger ret;
+    ret.setSumOrDifference(*this, other, true /*isSum*/);
+    return ret;
   }
 
   APInteger const &operator+() const
@@ -647,20 +656,15 @@ public:      // methods
   // ---------- Subtraction ----------
   APInteger &operator-=(APInteger const &other)
   {
-    return *this = *this - other;
+    setSumOrDifference(*this, other, false /*isSum*/);
+    return *this;
   }
 
   APInteger operator-(APInteger const &other) const
   {
-    if (this->isEmbedded() && other.isEmbedded()) {
-      std::optional<EmbeddedInt> res =
-        subtractWithOverflowCheckOpt(this->m_eValue, other.m_eValue);
-      if (res.has_value()) {
-        return APInteger(res.value());
-      }
-    }
-
-    return sumOrDifference(other, false /*isSum*/);
+    APInteger ret;
+    ret.setSumOrDifference(*this, other, false /*isSum*/);
+    return ret;
   }
 
   APInteger operator-() const
@@ -686,7 +690,9 @@ public:      // methods
       }
     }
 
-    return APInteger(this->getAPMagnitude() * other.getAPMagnitude(),
+    UInteger thisTmp, otherTmp;
+    return APInteger(this->getAPMagnitude(thisTmp) *
+                       other.getAPMagnitude(otherTmp),
                      this->isNegative() != other.isNegative());
   }
 
@@ -760,11 +766,12 @@ public:      // methods
     UInteger magRemainder;
 
     // Compute result magnitudes without regard to sign.
+    UInteger dividendTmp, divisorTmp;
     UInteger::divide(
       magQuotient,
       magRemainder,
-      dividend.getAPMagnitude(),
-      divisor.getAPMagnitude());
+      dividend.getAPMagnitude(dividendTmp),
+      divisor.getAPMagnitude(divisorTmp));
 
     // Compute the signs of the results.
     bool negQuotient =
@@ -802,6 +809,125 @@ public:      // methods
     APInteger r = *this % divisor;
     return *this = std::move(r);
   }
+
+  // ---------- Number theory ----------
+  // Return the greatest common divisor of the magnitudes of `a` and
+  // `b`, which is never negative.  `gcd(0,0)` is 0.
+  static APInteger gcd(APInteger const &a, APInteger const &b)
+  {
+    UInteger aTmp, bTmp;
+    return APInteger(UInteger::gcd(a.getAPMagnitude(aTmp),
+                                   b.getAPMagnitude(bTmp)),
+                     false /*negative*/);
+  }
+
+  /* Set `g` to `gcd(a,b)`, and `x` and `y` to Bezout coefficients such
+     that `a*x + b*y = g`.  These are the coefficients found by the
+     extended Euclidean algorithm, so when `g` is not zero,
+     `abs(x) <= abs(b)/g` and `abs(y) <= abs(a)/g`.
+
+     The outputs must be distinct objects, but may be the same as the
+     inputs.
+  */
+  static void extendedGCD(
+    APInteger &g,
+    APInteger &x,
+    APInteger &y,
+    APInteger const &a,
+    APInteger const &b)
+  {
+    UInteger aTmp, bTmp;
+    UInteger coefficient;
+    bool coefficientNegative;
+    APInteger gRes(
+      UInteger::extendedGCD(coefficient, coefficientNegative,
+                            a.getAPMagnitude(aTmp),
+                            b.getAPMagnitude(bTmp)),
+      false /*negative*/);
+
+    // `coefficient` applies to the magnitude of `a`.
+    APInteger xRes(std::move(coefficient),
+                   coefficientNegative != a.isNegative());
+
+    // Solve for `y`.  The division is exact.
+    APInteger yRes;
+    if (!b.isZero()) {
+      yRes = (gRes - a*xRes) / b;
+    }
+
+    g = std::move(gRes);
+    x = std::move(xRes);
+    y = std::move(yRes);
+  }
+
+  // Return the `x` in `[0,modulus)` such that `a*x = 1 (mod modulus)`,
+  // or `nullopt` if there is none because `a` and `modulus` are not
+  // relatively prime.  `modulus` must be positive.
+  static std::optional<APInteger> modInverse(
+    APInteger const &a,
+    APInteger const &modulus)
+  {
+    xassertPrecondition(modulus.isPositive());
+
+    APInteger g, x, y;
+    extendedGCD(g, x, y, a, modulus);
+    if (!(g == APInteger(1))) {
+      return std::nullopt;
+    }
+    return x.nonNegativeModulo(modulus);
+  }
+
+  /* Return `base**exponent mod modulus`, in `[0,modulus)`.  `exponent`
+     must not be negative and `modulus` must be positive.
+
+     See `APUInteger::modPow` for the algorithm.
+  */
+  static APInteger modPow(
+    APInteger const &base,
+    APInteger const &exponent,
+    APInteger const &modulus)
+  {
+    xassertPrecondition(!exponent.isNegative());
+    xassertPrecondition(modulus.isPositive());
+
+    APInteger b = base.nonNegativeModulo(modulus);
+
+    UInteger bTmp, eTmp, mTmp;
+    return APInteger(UInteger::modPow(b.getAPMagnitude(bTmp),
+                                      exponent.getAPMagnitude(eTmp),
+                                      modulus.getAPMagnitude(mTmp)),
+                     false /*negative*/);
+  }
+
+  // Return `base**exponent`.  `0**0` is 1.
+  static APInteger pow(APInteger const &base, unsigned exponent)
+  {
+    UInteger tmp;
+    return APInteger(UInteger::pow(base.getAPMagnitude(tmp), exponent),
+                     base.isNegative() && (exponent & 1));
+  }
+
+  // Return the largest integer whose square is not larger than `n`,
+  // which must not be negative.
+  static APInteger isqrt(APInteger const &n)
+  {
+    xassertPrecondition(!n.isNegative());
+
+    UInteger tmp;
+    return APInteger(UInteger::isqrt(n.getAPMagnitude(tmp)),
+                     false /*negative*/);
+  }
+
+  // Return `*this` reduced modulo the positive `modulus`, in the range
+  // `[0,modulus)`.  Unlike `operator%`, the result is never negative.
+  APInteger nonNegativeModulo(APInteger const &modulus) const
+  {
+    APInteger r = *this % modulus;
+    if (r.isNegative()) {
+      r += modulus;
+    }
+    return r;
+  }
 };
 
 
@@ -5,6 +5,7 @@
 
 #include "sm-ap-uint.h"                // module under test
 
+#include "double-width-type.h"         // SMBASE_HAVE_UINT128
 #include "exc.h"                       // EXN_CONTEXT
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
 #include "sm-random.h"                 // sm_random, sm_randomPrim
@@ -804,6 +805,330 @@ public:      // methods
   }
 
 
+  // Return a random integer with `numWords` words, the top one being
+  // non-zero.  Occasionally some of the words are all zeroes or ones,
+  // since those tend to exercise carry and borrow edge cases.
+  Integer randomInteger(Index numWords)
+  {
+    Integer ret;
+    for (Index i = 0; i < numWords; ++i) {
+      Word w;
+      switch (sm_random(8)) {
+        case 0:  w = 0;                          break;
+        case 1:  w = (Word)~(Word)0;             break;
+        default: w = sm_randomPrim<Word>();      break;
+      }
+      if (i == numWords-1 && w == 0) {
+        w = 1;
+      }
+      ret.setWord(i, w);
+    }
+    return ret;
+  }
+
+
+  // Multiply using the simplest possible algorithm, as a reference for
+  // the faster one.
+  Integer naiveMultiply(Integer const &a, Integer const &b)
+  {
+    Integer acc;
+    for (Index i = 0; i < b.numWords(); ++i) {
+      Integer partial(a);
+      partial.leftShiftByWords(i);
+      partial.multiplyWord(b.getWord(i));
+      acc += partial;
+    }
+    return acc;
+  }
+
+
+  // Convert to digits by dividing by the radix once per digit, as a
+  // reference for the faster algorithm.
+  std::string naiveRadixDigits(Integer n, int radix)
+  {
+    if (n.isZero()) {
+      return "0";
+    }
+
+    std::string rev;
+    while (!n.isZero()) {
+      int d = (int)n.divideWord((Word)radix);
+      rev.push_back((char)(d < 10? '0'+d : 'A'+(d-10)));
+    }
+    return std::string(rev.rbegin(), rev.rend());
+  }
+
+
+  void testLargeMultiplyDivide()
+  {
+    smbase_loopi(20) {
+      EXN_CONTEXT_EXPR(i);
+
+      // Sizes that straddle `karatsubaThreshold`, including very
+      // unequal ones.
+      Integer a = randomInteger(sm_random(150) + 1);
+      Integer b = randomInteger(sm_random(80) + 1);
+
+      Integer prod = a * b;
+      EXPECT_EQ(prod, naiveMultiply(a, b));
+      EXPECT_EQ(prod, b * a);
+
+      // Dividing the product (plus something smaller than the divisor)
+      // must recover the factor and the addend.
+      Integer addend = a;
+      addend.divideWord(3);
+      Integer dividend = prod + addend;
+
+      Integer q, r;
+      Integer::divide(q, r, dividend, a);
+      EXPECT_EQ(q, b);
+      EXPECT_EQ(r, addend);
+
+      // And a general division must satisfy the defining equation.
+      Integer divisor = randomInteger(sm_random(60) + 1);
+      Integer::divide(q, r, a, divisor);
+      xassert(r < divisor);
+      EXPECT_EQ(q * divisor + r, a);
+    }
+  }
+
+
+  void testOneLargeRadix(Integer const &n, int radix)
+  {
+    EXN_CONTEXT_EXPR(radix);
+
+    std::string digits = n.getAsRadixDigits_noFastPath(radix);
+    EXPECT_EQ(digits, naiveRadixDigits(n, radix));
+    EXPECT_EQ(Integer::fromRadixDigits(digits, radix), n);
+  }
+
+
+  void testLargeRadixConversion()
+  {
+    smbase_loopi(10) {
+      EXN_CONTEXT_EXPR(i);
+
+      Integer n = randomInteger(sm_random(120) + 1);
+
+      // Compare the general algorithm to the hex fast path.
+      EXPECT_EQ(n.getAsRadixDigits_noFastPath(16), n.getAsHexDigits());
+
+      testOneLargeRadix(n, 10);
+      testOneLargeRadix(n, sm_random(35) + 2);
+    }
+
+    // Long runs of zero digits must be preserved when the halves are
+    // padded.
+    std::string digits = "1" + std::string(300, '0') + "7" +
+                         std::string(250, '0');
+    Integer n = Integer::fromDecimalDigits(digits);
+    EXPECT_EQ(n.getAsDecimalDigits(), digits);
+    testOneLargeRadix(n, 10);
+    testOneLargeRadix(n, 7);
+
+    // Powers of the radix are the boundary cases for the cached powers.
+    Integer p(1);
+    smbase_loopi(200) {
+      p.multiplyWord(10);
+    }
+    EXPECT_EQ(p.getAsDecimalDigits(), "1" + std::string(200, '0'));
+    p -= Integer(1);
+    EXPECT_EQ(p.getAsDecimalDigits(), std::string(200, '9'));
+
+    // Leading zeroes are accepted and dropped.
+    EXPECT_EQ(Integer::fromDecimalDigits(std::string(500, '0') + "42"),
+              Integer(42));
+  }
+
+
+  void testOneReciprocal(Index numWords)
+  {
+    EXN_CONTEXT_EXPR(numWords);
+
+    Integer d = randomInteger(numWords);
+    Integer mu = Integer::reciprocal(d);
+
+    // `mu` is the largest value such that `mu*d <= N**(2*numWords)`.
+    Integer power(1);
+    power.leftShiftByWords(2*numWords);
+    Integer prod = mu * d;
+    xassert(prod <= power);
+    xassert(power - prod < d);
+
+    // Barrett division agrees with ordinary division.
+    smbase_loopi(3) {
+      Integer x = randomInteger(sm_random(2*numWords) + 1);
+      if (x >= d*d) {
+        x = d*d - Integer(1);
+      }
+
+      Integer q1, r1, q2, r2;
+      Integer::divide(q1, r1, x, d);
+      Integer::divideByReciprocal(q2, r2, x, d, mu);
+      EXPECT_EQ(q2, q1);
+      EXPECT_EQ(r2, r1);
+    }
+  }
+
+
+  void testReciprocalDivision()
+  {
+    Index const threshold = Integer::reciprocalDivisionThreshold;
+    for (Index n : { (Index)1, (Index)2, (Index)17,
+                     threshold-1, threshold, 2*threshold+3 }) {
+      testOneReciprocal(n);
+    }
+
+    // A number large enough that radix conversion divides by
+    // reciprocals at its top levels.
+    Integer n = randomInteger(4*threshold + 5);
+    EXPECT_EQ(n.getAsRadixDigits_noFastPath(16), n.getAsHexDigits());
+    std::string digits = n.getAsDecimalDigits();
+    EXPECT_EQ(Integer::fromDecimalDigits(digits), n);
+  }
+
+
+  void testInPlaceArithmetic()
+  {
+    smbase_loopi(40) {
+      EXN_CONTEXT_EXPR(i);
+
+      // Sizes that straddle the inline capacity of the word vector for
+      // every `Word` type.
+      Integer a = randomInteger(sm_random(80) + 1);
+      Integer b = randomInteger(sm_random(80) + 1);
+      Integer sum = a + b;
+
+      // Distinct destination.
+      Integer dest(7);
+      Integer::addTo(dest, a, b);
+      EXPECT_EQ(dest, sum);
+      Integer::subFrom(dest, sum, b);
+      EXPECT_EQ(dest, a);
+
+      // Destination aliases an operand.
+      dest = a;
+      Integer::addTo(dest, dest, b);
+      EXPECT_EQ(dest, sum);
+      dest = b;
+      Integer::addTo(dest, a, dest);
+      EXPECT_EQ(dest, sum);
+      dest = sum;
+      Integer::subFrom(dest, dest, a);
+      EXPECT_EQ(dest, b);
+      dest = a;
+      Integer::subFrom(dest, sum, dest);
+      EXPECT_EQ(dest, b);
+      dest = a;
+      Integer::addTo(dest, dest, dest);
+      EXPECT_EQ(dest, a + a);
+      Integer::subFrom(dest, dest, dest);
+      EXPECT_EQ(dest, Integer(0));
+
+      // Multiply-accumulate, including across the Karatsuba threshold.
+      Integer c = randomInteger(sm_random(80) + 1);
+      Integer acc = c;
+      Integer::mulAdd(acc, a, b);
+      EXPECT_EQ(acc, c + naiveMultiply(a, b));
+
+      acc = a;
+      Integer::mulAdd(acc, acc, b);
+      EXPECT_EQ(acc, a + a*b);
+
+      acc = Integer(0);
+      Integer::mulAdd(acc, a, Integer(0));
+      EXPECT_EQ(acc, Integer(0));
+      Integer::mulAdd(acc, a, Integer(1));
+      EXPECT_EQ(acc, a);
+
+      // Shrinking back to a small value must leave a usable object.
+      acc -= a;
+      EXPECT_EQ(acc, Integer(0));
+      acc += Integer(3);
+      EXPECT_EQ(acc, Integer(3));
+    }
+  }
+
+
+  // Reference GCD using only division.
+  Integer naiveGCD(Integer a, Integer b)
+  {
+    while (!b.isZero()) {
+      Integer r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  // Reference modular exponentiation, right to left.
+  Integer naiveModPow(Integer base, Integer const &exponent,
+                      Integer const &modulus)
+  {
+    Integer acc = Integer(1) % modulus;
+    base = base % modulus;
+    for (Index i = 0; i <= exponent.maxBitIndex(); ++i) {
+      if (exponent.getBit(i)) {
+        acc = (acc * base) % modulus;
+      }
+      base = (base * base) % modulus;
+    }
+    return acc;
+  }
+
+  void testNumberTheory()
+  {
+    smbase_loopi(20) {
+      EXN_CONTEXT_EXPR(i);
+
+      // Include a shared factor so the GCD is usually not 1.
+      Integer common = randomInteger(sm_random(10) + 1);
+      Integer a = randomInteger(sm_random(50) + 1) * common;
+      Integer b = randomInteger(sm_random(50) + 1) * common;
+
+      Integer g = Integer::gcd(a, b);
+      EXPECT_EQ(g, naiveGCD(a, b));
+      EXPECT_EQ(Integer::gcd(b, a), g);
+      EXPECT_EQ(Integer::gcd(a, Integer(0)), a);
+
+      // The coefficient must satisfy `a*x = g (mod b)`.
+      Integer x;
+      bool xNeg;
+      EXPECT_EQ(Integer::extendedGCD(x, xNeg, a, b), g);
+      xassert(x <= b);
+      Integer ax = (a * x) % b;
+      Integer gm = g % b;
+      if (xNeg && !ax.isZero()) {
+        ax = b - ax;
+      }
+      EXPECT_EQ(ax, gm);
+
+      // Odd and even moduli take different paths.
+      Integer base = randomInteger(sm_random(20) + 1);
+      Integer exponent = randomInteger(sm_random(3) + 1);
+      Integer modulus = randomInteger(sm_random(20) + 1);
+      EXPECT_EQ(Integer::modPow(base, exponent, modulus),
+                naiveModPow(base, exponent, modulus));
+      modulus.setBit(0, !modulus.getBit(0));
+      if (!modulus.isZero()) {
+        EXPECT_EQ(Integer::modPow(base, exponent, modulus),
+                  naiveModPow(base, exponent, modulus));
+      }
+
+      Integer r = Integer::isqrt(a);
+      xassert(r*r <= a);
+      xassert(a < (r+Integer(1))*(r+Integer(1)));
+    }
+
+    EXPECT_EQ(Integer::pow(Integer(3), 5), Integer(243));
+    EXPECT_EQ(Integer::pow(Integer(0), 0), Integer(1));
+    EXPECT_EQ(Integer::modPow(Integer(5), Integer(0), Integer(1)),
+              Integer(0));
+    EXPECT_EQ(Integer::modPow(Integer(5), Integer(0), Integer(7)),
+              Integer(1));
+  }
+
+
   // Check that we can apply `operator+` to `input` and get back the
   // same thing.
   void testOneUnary(Integer const &input)
@@ -833,6 +1158,11 @@ public:      // methods
     testGetAsRadixDigits();
     testFromRadixPrefixedDigits();
     testDivide();
+    testLargeMultiplyDivide();
+    testLargeRadixConversion();
+    testReciprocalDivision();
+    testInPlaceArithmetic();
+    testNumberTheory();
     testUnaryOps();
   }
 }; // APUintTest
@@ -848,8 +1178,10 @@ void test_sm_ap_uint()
   APUIntegerTest<uint16_t>().testAll();
   APUIntegerTest<uint32_t>().testAll();
 
-  // Note that we cannot use `uint64_t` because I currently require a
-  // double-word type, and do not want to rely on `uint128_t` existing.
+  // `uint64_t` requires a double-word type, which is not standard.
+#if defined(SMBASE_HAVE_UINT128)
+  APUIntegerTest<uint64_t>().testAll();
+#endif
 }
 
 
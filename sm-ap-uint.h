@@ -21,13 +21,15 @@
 #include "xassert.h"                   // xassert
 #include "xoverflow.h"                 // XOverflow
 
-#include <algorithm>                   // std::max
+#include <algorithm>                   // std::{max, min, copy, copy_backward, fill}
 #include <cstddef>                     // std::ptrdiff_t
+#include <cstdint>                     // std::uint32_t
 #include <iostream>                    // std::ostream
+#include <limits>                      // std::numeric_limits
 #include <optional>                    // std::optional
 #include <string_view>                 // std::string_view
 #include <type_traits>                 // std::{is_integral, is_signed, is_unsigned}
-#include <utility>                     // std::move
+#include <utility>                     // std::{move, swap}
 #include <vector>                      // std::vector
 
 
@@ -39,9 +41,10 @@ OPEN_NAMESPACE(smbase)
 
    The main reasin this is a template with the choice of word type
    abstract is so I can easily test the code using a small word size and
-   then use a larger one in production.  I'm thinking I will wrap this
-   class with another that hides all the template stuff and fixes the
-   choice of word, presumably to `uint32_t`.
+   then use a larger one in production.  The `Integer` class (in
+   `sm-integer.h`) hides the template stuff and fixes the choice of
+   word, using `uint64_t` where a double-width type for it is available
+   (see `double-width-type.h`) and `uint32_t` otherwise.
 */
 template <typename Word>
 class APUInteger {
@@ -54,6 +57,211 @@ public:      // types
   // I currently assume I have access to a double-word type.
   typedef typename DoubleWidthType<Word>::DWT DWord;
 
+private:     // types
+  /* Growable array of words, similar to `std::vector<Word>`, except
+     that small arrays are stored inside the object rather than on the
+     heap.  Most integers in practice need only a few words, so this
+     avoids a dynamic allocation for each of them, including the
+     temporaries created by the arithmetic operators.
+
+     Copy assignment reuses the destination's storage when it is large
+     enough.
+  */
+  class WordVector {
+  private:     // data
+    // Number of words that fit in `m_inline`.  This is chosen so the
+    // inline array occupies four pointers' worth of space.
+    static constexpr std::uint32_t s_inlineCapacity =
+      4 * sizeof(void*) / sizeof(Word);
+
+    // The constructors initialize `m_heap` even though the inline array
+    // is active, only to keep the compiler from warning that it might be
+    // read uninitialized.
+    union {
+      // Heap storage, when `m_capacity > s_inlineCapacity`.
+      Word *m_heap;
+
+      // Inline storage, when `m_capacity == s_inlineCapacity`.
+      Word m_inline[s_inlineCapacity];
+    };
+
+    // Number of words in use.
+    std::uint32_t m_size;
+
+    // Number of words available.  Heap arrays are always larger than
+    // the inline array, so this also says which one is in use.
+    std::uint32_t m_capacity;
+
+  private:     // methods
+    bool isInline() const
+    {
+      return m_capacity == s_inlineCapacity;
+    }
+
+    // Replace the storage with one that has room for `newCapacity`
+    // words, preserving the first `m_size`.
+    void reallocate(Index newCapacity)
+    {
+      xassert(newCapacity > s_inlineCapacity);
+      xassert(newCapacity <= (Index)UINT32_MAX);
+
+      Word *newHeap = new Word[newCapacity];
+      std::copy(data(), data()+m_size, newHeap);
+
+      releaseStorage_keepSize();
+      m_heap = newHeap;
+      m_capacity = (std::uint32_t)newCapacity;
+    }
+
+    // Free the heap array, if any, and switch to inline storage.  The
+    // caller must fix `m_size` if it is too large.
+    void releaseStorage_keepSize()
+    {
+      if (!isInline()) {
+        delete[] m_heap;
+        m_capacity = s_inlineCapacity;
+      }
+    }
+
+  public:      // methods
+    ~WordVector()
+    {
+      releaseStorage_keepSize();
+    }
+
+    WordVector()
+      : m_heap(nullptr),
+        m_size(0),
+        m_capacity(s_inlineCapacity)
+    {}
+
+    WordVector(WordVector const &obj)
+      : m_heap(nullptr),
+        m_size(0),
+        m_capacity(s_inlineCapacity)
+    {
+      *this = obj;
+    }
+
+    WordVector(WordVector &&obj)
+      : m_heap(nullptr),
+        m_size(0),
+        m_capacity(s_inlineCapacity)
+    {
+      *this = std::move(obj);
+    }
+
+    WordVector &operator=(WordVector const &obj)
+    {
+      if (this != &obj) {
+        m_size = 0;
+        reserve(obj.m_size);
+        std::copy(obj.data(), obj.data()+obj.m_size, data());
+        m_size = obj.m_size;
+      }
+      return *this;
+    }
+
+    WordVector &operator=(WordVector &&obj)
+    {
+      if (this != &obj) {
+        if (obj.isInline()) {
+          // There is nothing to steal; just copy the words.
+          *this = static_cast<WordVector const &>(obj);
+        }
+        else {
+          releaseStorage_keepSize();
+          m_heap = obj.m_heap;
+          m_size = obj.m_size;
+          m_capacity = obj.m_capacity;
+
+          obj.m_size = 0;
+          obj.m_capacity = s_inlineCapacity;
+        }
+      }
+      return *this;
+    }
+
+    Index size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    Word       *data()       { return isInline()? m_inline : m_heap; }
+    Word const *data() const { return isInline()? m_inline : m_heap; }
+
+    Word       &operator[](Index i)       { return data()[i]; }
+    Word const &operator[](Index i) const { return data()[i]; }
+
+    Word       *begin()       { return data(); }
+    Word       *end()         { return data() + m_size; }
+
+    Word back() const
+    {
+      xassert(m_size > 0);
+      return data()[m_size-1];
+    }
+
+    // Ensure there is room for at least `n` words.  Growth is
+    // geometric so repeated `push_back` is amortized constant time.
+    void reserve(Index n)
+    {
+      if (n > m_capacity) {
+        reallocate(std::max(n, (Index)m_capacity * 2));
+      }
+    }
+
+    // Set the size to `n`, filling any new words with zero.
+    void resize(Index n)
+    {
+      reserve(n);
+      if (n > m_size) {
+        std::fill(data()+m_size, data()+n, (Word)0);
+      }
+      m_size = (std::uint32_t)n;
+    }
+
+    // Set the size to `n`, and all words to zero.
+    void assignZeroes(Index n)
+    {
+      m_size = 0;
+      resize(n);
+    }
+
+    void push_back(Word w)
+    {
+      reserve(m_size + 1);
+      data()[m_size++] = w;
+    }
+
+    void pop_back()
+    {
+      xassert(m_size > 0);
+      --m_size;
+    }
+
+    // Remove all words but retain the storage.
+    void clear()
+    {
+      m_size = 0;
+    }
+
+    // Remove all words and free any heap storage.
+    void releaseStorage()
+    {
+      releaseStorage_keepSize();
+      m_size = 0;
+    }
+
+    // Insert `n` zero words at the start.
+    void insertZeroesAtFront(Index n)
+    {
+      Index oldSize = m_size;
+      reserve(oldSize + n);
+      std::copy_backward(data(), data()+oldSize, data()+oldSize+n);
+      std::fill(data(), data()+n, (Word)0);
+      m_size = (std::uint32_t)(oldSize + n);
+    }
+  };
+
 private:     // data
   /* The magnitude of the integer, from least significant to most
      significant (similar to "little endian").  That is, the represented
@@ -66,7 +274,7 @@ private:     // data
      This is normalized: the Word with the highest index is not zero.
      If the value being represented is zero, then the vector is empty.
   */
-  std::vector<Word> m_vec;
+  WordVector m_vec;
 
 private:     // methods
   // Trim zero words from the end of the vector.
@@ -78,10 +286,11 @@ private:     // methods
       }
 
       if (m_vec.empty()) {
-        // Try to deallocate the vector's storage.  The algorithms built
-        // on top of this class somewhat frequently populate the
-        // APUInteger and then zero it, but the object remains.
-        m_vec.shrink_to_fit();
+        // Deallocate the vector's storage, if it is on the heap.  The
+        // algorithms built on top of this class somewhat frequently
+        // populate the APUInteger and then zero it, but the object
+        // remains.
+        m_vec.releaseStorage();
       }
     }
   }
@@ -124,68 +333,714 @@ private:     // methods
     highProd = (Word)(prod >> bitsPerWord());
   }
 
-  // ---------- Arithmetic helpers ----------
-  // Add `other` into `this`.
-  void add(APUInteger const &other)
+  // Return the number of zero bits above the highest one bit in `w`,
+  // which must not be zero.
+  static int countLeadingZeroes(Word w)
   {
-    // Carry value from the previous word.
-    Word carry = 0;
+    xassertPrecondition(w != 0);
 
-    // Process all of the words in `other`, then keep going as long as
-    // we have a carry to propagate.
-    Index i = 0;
-    for (; i < other.numWords() || carry != 0; ++i) {
-      // Get current word.
-      Word d = this->getWord(i);
+    Word const highBit = (Word)((Word)1 << (bitsPerWord()-1));
 
-      // Add the carry and the other number's word.
-      Word carry1 = addWithCarry(d, carry);
-      Word carry2 = addWithCarry(d, other.getWord(i));
+    int ret = 0;
+    while (!(w & highBit)) {
+      w = (Word)(w << 1);
+      ++ret;
+    }
+    return ret;
+  }
 
-      // Update the word.
-      this->setWord(i, d);
+  // ---------- Word array helpers ----------
+  // These operate on little-endian arrays of words that, unlike
+  // `m_vec`, need not be normalized.  They are the building blocks of
+  // the multiplication and division algorithms below.
 
-      // Compute the carry to use in the next iteration.
-      carry = carry1 + carry2;
+  // Add `a[0,n)` into `r[0,n)`, returning the carry out of the top.
+  static Word addArrayInto(Word *r, Word const *a, Index n)
+  {
+    Word carry = 0;
+    for (Index i = 0; i < n; ++i) {
+      Word d = r[i];
+      Word carry1 = addWithCarry(d, carry);
+      Word carry2 = addWithCarry(d, a[i]);
+      r[i] = d;
 
-      // It is not possible for both additions to yield a carry because
-      // if the first does, then the resulting `d` is zero, so the
-      // second addition yields `other.getWord(i)` with no carry.
-      xassert(carry <= 1);
+      // As in `add`, at most one of these can be 1.
+      carry = carry1 + carry2;
     }
+    return carry;
+  }
 
-    normalize();
+  // Add `carry` into `r[0,n)`, returning whatever carries out.
+  static Word propagateCarry(Word *r, Index n, Word carry)
+  {
+    for (Index i = 0; i < n && carry != 0; ++i) {
+      carry = addWithCarry(r[i], carry);
+    }
+    return carry;
   }
 
-  // Subtract `other` from `this`.  `this` must be at least as large.
-  void subtract(APUInteger const &other)
+  // Subtract `a[0,n)` from `r[0,n)`, returning the borrow out of the
+  // top.
+  static Word subtractArrayFrom(Word *r, Word const *a, Index n)
   {
-    // Amount to borrow from the current word in order to supply the
-    // previous iteration's word.
     Word borrow = 0;
+    for (Index i = 0; i < n; ++i) {
+      Word d = r[i];
+      Word borrow1 = subtractWithBorrow(d, borrow);
+      Word borrow2 = subtractWithBorrow(d, a[i]);
+      r[i] = d;
 
-    for (Index i = 0; i < other.numWords() ||
-                      (i < this->numWords() && borrow != 0); ++i) {
-      Word d = this->getWord(i);
+      // As in `subtract`, at most one of these can be 1.
+      borrow = borrow1 + borrow2;
+    }
+    return borrow;
+  }
 
-      Word borrow1 = subtractWithBorrow(d, borrow);
-      Word borrow2 = subtractWithBorrow(d, other.getWord(i));
+  // Subtract `borrow` from `r[0,n)`, returning whatever borrows out.
+  static Word propagateBorrow(Word *r, Index n, Word borrow)
+  {
+    for (Index i = 0; i < n && borrow != 0; ++i) {
+      borrow = subtractWithBorrow(r[i], borrow);
+    }
+    return borrow;
+  }
 
-      this->setWord(i, d);
+  // Set `r[0,n)` to `a[0,n)` shifted left by `shift` bits, which must
+  // be less than the word size.  Return the bits shifted out of the
+  // top.  `r` may be the same as `a`.
+  static Word shiftLeftArray(Word *r, Word const *a, Index n, int shift)
+  {
+    if (shift == 0) {
+      std::copy(a, a+n, r);
+      return 0;
+    }
 
-      borrow = borrow1 + borrow2;
+    Word outBits = 0;
+    for (Index i = 0; i < n; ++i) {
+      Word w = a[i];
+      r[i] = (Word)((w << shift) | outBits);
+      outBits = (Word)(w >> (bitsPerWord() - shift));
+    }
+    return outBits;
+  }
 
-      // It is not possible for both operations to yield a borrow
-      // because if the first does, then it leaves `d` as the maximum
-      // value of a Word, so the second subtraction cannot require a
-      // borrow.
-      xassert(borrow <= 1);
+  // Set `r[0,n)` to `a[0,n)` shifted right by `shift` bits, which must
+  // be less than the word size.  Bits shifted out of the bottom are
+  // discarded.  `r` may be the same as `a`.
+  static void shiftRightArray(Word *r, Word const *a, Index n, int shift)
+  {
+    if (shift == 0) {
+      std::copy(a, a+n, r);
+      return;
+    }
+
+    for (Index i = 0; i < n; ++i) {
+      Word next = (i+1 < n? a[i+1] : 0);
+      r[i] = (Word)((a[i] >> shift) |
+                    (next << (bitsPerWord() - shift)));
+    }
+  }
+
+  // Add `a[0,n) * w` into `r[0,n)`, returning the word that carries
+  // out of the top.
+  static Word multiplyAddRow(Word *r, Word const *a, Index n, Word w)
+  {
+    Word carry = 0;
+    for (Index i = 0; i < n; ++i) {
+      // This cannot overflow: (N-1)*(N-1) + 2*(N-1) = N*N - 1.
+      DWord t = (DWord)((DWord)a[i] * w + r[i] + carry);
+      r[i] = (Word)t;
+      carry = (Word)(t >> bitsPerWord());
+    }
+    return carry;
+  }
+
+  // Set `r[0,an+bn)` to `a[0,an) * b[0,bn)` using the schoolbook
+  // method.  `r` must not overlap either input.
+  static void schoolbookMultiply(
+    Word *r,
+    Word const *a, Index an,
+    Word const *b, Index bn)
+  {
+    std::fill(r, r+an+bn, (Word)0);
+
+    for (Index j = 0; j < bn; ++j) {
+      Word bj = b[j];
+      if (bj == 0) {
+        // `r[j+an]` is already zero.
+        continue;
+      }
+
+      r[j+an] = multiplyAddRow(r+j, a, an, bj);
+    }
+  }
+
+  // Operand size, in words, below which `multiplyArrays` uses the
+  // schoolbook method rather than Karatsuba's.
+  static constexpr Index karatsubaThreshold = 32;
+
+  // Set `r[0,an+bn)` to `a[0,an) * b[0,bn)`.  `r` must not overlap
+  // either input.
+  //
+  // When both operands are large, this uses Karatsuba's method, which
+  // takes time proportional to about n**1.58 rather than n**2.
+  static void multiplyArrays(
+    Word *r,
+    Word const *a, Index an,
+    Word const *b, Index bn)
+  {
+    // Arrange for `a` to be the longer operand.
+    if (an < bn) {
+      std::swap(a, b);
+      std::swap(an, bn);
+    }
+
+    if (bn < karatsubaThreshold) {
+      schoolbookMultiply(r, a, an, b, bn);
+      return;
     }
 
-    // Otherwise, `other` was larger.
+    if (2*bn <= an) {
+      // The operands are very unequal in size, so splitting both in
+      // the middle would not work.  Instead, multiply `b` by
+      // successive `bn`-sized pieces of `a`.
+      std::fill(r, r+an+bn, (Word)0);
+      std::vector<Word> partial(2*bn);
+      for (Index i = 0; i < an; i += bn) {
+        Index len = std::min(bn, an-i);
+        multiplyArrays(partial.data(), a+i, len, b, bn);
+
+        Word carry = addArrayInto(r+i, partial.data(), len+bn);
+        carry = propagateCarry(r+i+len+bn, an-i-len, carry);
+        xassert(carry == 0);
+      }
+      return;
+    }
+
+    // Split both operands at `m` words:
+    //
+    //   a = a1*N**m + a0
+    //   b = b1*N**m + b0
+    //
+    // Since `bn > an/2`, `b1` is not empty.
+    Index m = an / 2;
+    Word const *a0 = a;
+    Word const *a1 = a+m;
+    Word const *b0 = b;
+    Word const *b1 = b+m;
+    Index a1n = an - m;
+    Index b1n = bn - m;
+
+    // z0 = a0*b0 goes in the low part of `r`, and z2 = a1*b1 in the
+    // high part.  Together they exactly fill `r`.
+    multiplyArrays(r,     a0, m,   b0, m);
+    multiplyArrays(r+2*m, a1, a1n, b1, b1n);
+
+    // sa = a0+a1.  Since `a1n >= m`, `a1` is at least as long.
+    Index san = a1n + 1;
+    std::vector<Word> sa(san);
+    std::copy(a1, a1+a1n, sa.data());
+    sa[a1n] = propagateCarry(sa.data()+m, a1n-m,
+                             addArrayInto(sa.data(), a0, m));
+
+    // sb = b0+b1.  Either piece could be longer.
+    Index sbn = std::max(m, b1n) + 1;
+    std::vector<Word> sb(sbn);
+    if (b1n >= m) {
+      std::copy(b1, b1+b1n, sb.data());
+      sb[sbn-1] = propagateCarry(sb.data()+m, b1n-m,
+                                 addArrayInto(sb.data(), b0, m));
+    }
+    else {
+      std::copy(b0, b0+m, sb.data());
+      sb[sbn-1] = propagateCarry(sb.data()+b1n, m-b1n,
+                                 addArrayInto(sb.data(), b1, b1n));
+    }
+
+    // z1 = sa*sb - z0 - z2 = a0*b1 + a1*b0.
+    Index z1n = san + sbn;
+    std::vector<Word> z1(z1n);
+    multiplyArrays(z1.data(), sa.data(), san, sb.data(), sbn);
+
+    Index z0n = 2*m;
+    Word borrow = subtractArrayFrom(z1.data(), r, z0n);
+    borrow = propagateBorrow(z1.data()+z0n, z1n-z0n, borrow);
     xassert(borrow == 0);
 
-    normalize();
+    Index z2n = an + bn - 2*m;
+    borrow = subtractArrayFrom(z1.data(), r+2*m, z2n);
+    borrow = propagateBorrow(z1.data()+z2n, z1n-z2n, borrow);
+    xassert(borrow == 0);
+
+    // Add z1*N**m into `r`.  The true value of `z1` fits in the space
+    // above `m`, so any words of it beyond that are zero.
+    Index addLen = std::min(z1n, an+bn-m);
+    for (Index i = addLen; i < z1n; ++i) {
+      xassert(z1[i] == 0);
+    }
+    Word carry = addArrayInto(r+m, z1.data(), addLen);
+    carry = propagateCarry(r+m+addLen, an+bn-m-addLen, carry);
+    xassert(carry == 0);
+  }
+
+  // ---------- Arithmetic helpers ----------
+  /* Divide `dividend` by `divisor`, which must have at least two
+     words and be no larger than `dividend`, using Knuth's Algorithm D
+     (TAOCP Vol. 2, Section 4.3.1).  That produces one quotient word per
+     step, rather than one bit, by estimating each word from the top
+     two words of the remainder and the top word of the divisor.
+
+     The preconditions on object identity are those of `divide`.
+  */
+  static void divideMultiWord(
+    APUInteger &quotient,
+    APUInteger &remainder,
+    APUInteger const &dividend,
+    APUInteger const &divisor)
+  {
+    Index n = divisor.numWords();
+    Index m = dividend.numWords() - n;
+    xassert(n >= 2 && m >= 0);
+
+    // Shift both operands so the high bit of the divisor is set.  That
+    // ensures each quotient word estimate is at most two too large.
+    int shift = countLeadingZeroes(divisor.m_vec[n-1]);
+
+    // For small operands, these use inline storage.
+    WordVector vn;
+    vn.resize(n);
+    shiftLeftArray(vn.data(), divisor.m_vec.data(), n, shift);
+
+    WordVector un;
+    un.resize(m+n+1);
+    un[m+n] = shiftLeftArray(un.data(), dividend.m_vec.data(), m+n, shift);
+
+    WordVector &q = quotient.m_vec;
+    q.assignZeroes(m+1);
+
+    DWord const base = (DWord)((DWord)1 << bitsPerWord());
+    Word const vTop = vn[n-1];
+    Word const vNext = vn[n-2];
+
+    for (Index j = m; j >= 0; --j) {
+      // Estimate the quotient word from the top two words of what
+      // remains, then refine the estimate using the next word.
+      DWord num = (DWord)(((DWord)un[j+n] << bitsPerWord()) | un[j+n-1]);
+      DWord qhat = (DWord)(num / vTop);
+      DWord rhat = (DWord)(num % vTop);
+      while (qhat >= base ||
+             (DWord)(qhat * vNext) >
+               (DWord)((rhat << bitsPerWord()) | un[j+n-2])) {
+        --qhat;
+        rhat = (DWord)(rhat + vTop);
+        if (rhat >= base) {
+          break;
+        }
+      }
+
+      // Subtract `qhat * vn` from the relevant part of `un`.
+      Word carry = 0;
+      Word borrow = 0;
+      for (Index i = 0; i < n; ++i) {
+        DWord p = (DWord)(qhat * vn[i] + carry);
+        carry = (Word)(p >> bitsPerWord());
+
+        Word d = un[i+j];
+        Word borrow1 = subtractWithBorrow(d, (Word)p);
+        Word borrow2 = subtractWithBorrow(d, borrow);
+        un[i+j] = d;
+        borrow = borrow1 + borrow2;
+      }
+      Word d = un[j+n];
+      Word borrow1 = subtractWithBorrow(d, carry);
+      Word borrow2 = subtractWithBorrow(d, borrow);
+      un[j+n] = d;
+
+      if (borrow1 + borrow2 != 0) {
+        // The estimate was still one too large (this is rare), so add
+        // one divisor back.  The carry out cancels the borrow.
+        --qhat;
+        Word c = addArrayInto(un.data()+j, vn.data(), n);
+        un[j+n] = (Word)(un[j+n] + c);
+      }
+
+      q[j] = (Word)qhat;
+    }
+
+    // The remainder is in the low `n` words of `un`, still shifted.
+    remainder.m_vec.resize(n);
+    shiftRightArray(remainder.m_vec.data(), un.data(), n, shift);
+
+    quotient.normalize();
+    remainder.normalize();
+  }
+
+  // ---------- Number theory helpers ----------
+  // Return <0 if a<b, 0 if a==b, >0 if a>b, comparing `a[0,n)` and
+  // `b[0,n)`.
+  static int compareArrays(Word const *a, Word const *b, Index n)
+  {
+    for (Index i = n-1; i >= 0; --i) {
+      RET_IF_COMPARE(a[i], b[i]);
+    }
+    return 0;
+  }
+
+  /* Computes `p*u + q*v` or `p*u - q*v`, where `p` and `q` are words
+     and `u` and `v` are word arrays, one word at a time starting with
+     the least significant.  The two products are formed separately,
+     each with its own carry, so neither can overflow a double word.
+  */
+  class LinearCombination {
+  private:     // data
+    Word m_p;
+    Word m_q;
+    bool m_subtract;
+
+    // High words of the products so far.
+    Word m_pCarry;
+    Word m_qCarry;
+
+    // Carry or borrow from combining the low words.
+    Word m_bit;
+
+  public:      // methods
+    LinearCombination(Word p, Word q, bool subtract)
+      : m_p(p),
+        m_q(q),
+        m_subtract(subtract),
+        m_pCarry(0),
+        m_qCarry(0),
+        m_bit(0)
+    {}
+
+    // Consume the next words of `u` and `v`, returning the next word
+    // of the result.
+    Word next(Word u, Word v)
+    {
+      DWord pu = (DWord)((DWord)m_p * u + m_pCarry);
+      DWord qv = (DWord)((DWord)m_q * v + m_qCarry);
+      m_pCarry = (Word)(pu >> bitsPerWord());
+      m_qCarry = (Word)(qv >> bitsPerWord());
+
+      // As in `addTo` and `subFrom`, at most one of the two steps can
+      // carry or borrow.
+      Word d = (Word)pu;
+      if (m_subtract) {
+        Word b1 = subtractWithBorrow(d, (Word)qv);
+        Word b2 = subtractWithBorrow(d, m_bit);
+        m_bit = b1 + b2;
+      }
+      else {
+        Word c1 = addWithCarry(d, (Word)qv);
+        Word c2 = addWithCarry(d, m_bit);
+        m_bit = c1 + c2;
+      }
+      return d;
+    }
+
+    // True if nothing is left over after the last word, meaning the
+    // result fit.
+    bool fits() const
+    {
+      if (m_subtract) {
+        return m_pCarry == (Word)(m_qCarry + m_bit);
+      }
+      else {
+        return m_pCarry == 0 && m_qCarry == 0 && m_bit == 0;
+      }
+    }
+  };
+
+  /* Run the single-precision part of Lehmer's algorithm (Knuth, TAOCP
+     Vol. 2, Section 4.5.2, Algorithm L, with the stopping rule used by
+     CPython's `math.gcd`) on `x` and `y`, the leading bits of `a` and
+     `b` taken from the same bit positions.
+
+     Set the cofactors `A`, `B`, `C`, and `D` such that, with `k` the
+     return value, the remainders `k` steps further along the Euclidean
+     sequence for `a` and `b` are:
+
+       k even:  A*a - B*b  and  D*b - C*a
+       k odd:   A*b - B*a  and  D*a - C*b
+
+     If this returns 0, no step could be determined from the leading
+     bits alone.
+  */
+  static int lehmerCofactors(Word x, Word y,
+                             Word &A, Word &B, Word &C, Word &D)
+  {
+    A = 1;
+    B = 0;
+    C = 0;
+    D = 1;
+
+    int k = 0;
+    for (;; ++k) {
+      // The loop maintains `C <= y`.
+      if (y == C) {
+        break;
+      }
+      DWord q = (DWord)(((DWord)x + A - 1) / (Word)(y - C));
+      if (q > x) {
+        // Then `x - q*y` would be negative.
+        break;
+      }
+      DWord qy = (DWord)(q * y);
+      if (qy > x) {
+        break;
+      }
+      DWord s = (DWord)(B + q * D);
+      DWord t = (DWord)(x - qy);
+      if (s > t) {
+        break;
+      }
+      DWord newD = (DWord)(A + q * C);
+      if (newD > std::numeric_limits<Word>::max()) {
+        // Stop before the cofactors stop fitting in a word.
+        break;
+      }
+
+      x = y;
+      y = (Word)t;
+      A = D;
+      B = C;
+      C = (Word)s;
+      D = (Word)newD;
+    }
+
+    return k;
+  }
+
+  /* Reduce the pair `a`, `b` along the Euclidean remainder sequence,
+     using Lehmer's algorithm where possible, until `b` is zero or `a`
+     has fewer than `minWords` words.  If `b` becomes zero then `a` is
+     the GCD of the original pair.
+
+     If `u0` and `u1` are not null, they must start as 1 and 0.  They
+     are then kept as the magnitudes of the coefficients of the
+     original `a` in the current `a` and `b`, modulo the original `b`.
+     The coefficient signs alternate, the one for `a` being negative
+     when `oddSteps` is true.
+
+     The scratch objects are reused across steps so that, once they
+     have grown, the loop does not allocate except within division.
+  */
+  static void reduceEuclidean(
+    APUInteger &a,
+    APUInteger &b,
+    APUInteger *u0,
+    APUInteger *u1,
+    bool &oddSteps,
+    Index minWords)
+  {
+    APUInteger q, r;
+
+    while (!b.isZero() && a.numWords() >= minWords) {
+      Index n = a.numWords();
+      int k = 0;
+      Word A, B, C, D;
+
+      if (n >= 2 && a >= b) {
+        // Take the top word's worth of bits of `a`, and the same bits
+        // of `b`.
+        int s = countLeadingZeroes(a.m_vec[n-1]);
+        auto topBits = [n, s](APUInteger const &v) -> Word {
+          Word hi = (Word)(v.getWord(n-1) << s);
+          Word lo = s == 0? (Word)0 :
+                      (Word)(v.getWord(n-2) >> (bitsPerWord() - s));
+          return (Word)(hi | lo);
+        };
+        k = lehmerCofactors(topBits(a), topBits(b), A, B, C, D);
+      }
+
+      if (k == 0) {
+        // No progress from the leading bits; do one Euclidean step.
+        divide(q, r, a, b);
+        std::swap(a, b);
+        std::swap(b, r);
+
+        if (u0) {
+          mulAdd(*u0, q, *u1);
+          std::swap(*u0, *u1);
+        }
+        oddSteps = !oddSteps;
+        continue;
+      }
+
+      bool odd = (k & 1) != 0;
+
+      // Apply the cofactors to the remainders.
+      {
+        b.m_vec.resize(n);
+        Word *ap = a.m_vec.data();
+        Word *bp = b.m_vec.data();
+        LinearCombination na(A, B, true /*subtract*/);
+        LinearCombination nb(D, C, true /*subtract*/);
+        for (Index i = 0; i < n; ++i) {
+          Word ai = ap[i];
+          Word bi = bp[i];
+          ap[i] = odd? na.next(bi, ai) : na.next(ai, bi);
+          bp[i] = odd? nb.next(ai, bi) : nb.next(bi, ai);
+        }
+        xassert(na.fits() && nb.fits());
+        a.normalize();
+        b.normalize();
+      }
+
+      // Apply them to the coefficients too.  Since the coefficient
+      // signs alternate, differences of coefficients are sums of
+      // their magnitudes.
+      if (u0) {
+        Index un = std::max(u0->numWords(), u1->numWords()) + 1;
+        u0->m_vec.resize(un);
+        u1->m_vec.resize(un);
+        Word *p0 = u0->m_vec.data();
+        Word *p1 = u1->m_vec.data();
+        LinearCombination n0(A, B, false /*subtract*/);
+        LinearCombination n1(D, C, false /*subtract*/);
+        for (Index i = 0; i < un; ++i) {
+          Word w0 = p0[i];
+          Word w1 = p1[i];
+          p0[i] = odd? n0.next(w1, w0) : n0.next(w0, w1);
+          p1[i] = odd? n1.next(w0, w1) : n1.next(w1, w0);
+        }
+        xassert(n0.fits() && n1.fits());
+        u0->normalize();
+        u1->normalize();
+      }
+
+      oddSteps = oddSteps != odd;
+    }
+  }
+
+  // Return `-m**(-1) mod N` for odd `m`.
+  static Word negatedWordInverse(Word m)
+  {
+    xassert(m & 1);
+
+    // Newton's iteration doubles the number of correct low bits each
+    // time, and `m` is its own inverse modulo 8.
+    Word inv = m;
+    for (Index bits = 3; bits < bitsPerWord(); bits *= 2) {
+      Word mi = (Word)((DWord)m * inv);
+      inv = (Word)((DWord)inv * (Word)(2 - mi));
+    }
+    return (Word)(0 - inv);
+  }
+
+  /* Montgomery reduction: given `t[0,2n+1)` less than `m*N**n`, with
+     `t[2n]` zero, set `r[0,n)` to `t * N**(-n) mod m`.  `m` is odd and
+     `mInv` is `negatedWordInverse(m[0])`.  `t` is destroyed.
+  */
+  static void montgomeryReduce(
+    Word *r,
+    Word *t,
+    Word const *m,
+    Index n,
+    Word mInv)
+  {
+    // Add a multiple of `m` that clears each low word in turn.
+    for (Index i = 0; i < n; ++i) {
+      Word u = (Word)((DWord)t[i] * mInv);
+      Word carry = multiplyAddRow(t+i, m, n, u);
+      carry = propagateCarry(t+i+n, n+1-i, carry);
+      xassert(carry == 0);
+    }
+
+    // What remains is less than `2*m`.
+    Word *res = t+n;
+    if (res[n] != 0 || compareArrays(res, m, n) >= 0) {
+      Word borrow = subtractArrayFrom(res, m, n);
+      res[n] = (Word)(res[n] - borrow);
+      xassert(res[n] == 0);
+    }
+    std::copy(res, res+n, r);
+  }
+
+  // Set `r[0,n)` to `a * b * N**(-n) mod m`, where `a` and `b` are less
+  // than `m`.  `r` may be the same as `a` or `b`.  `t` is scratch space
+  // of at least `2n+1` words.
+  static void montgomeryMultiply(
+    Word *r,
+    Word const *a,
+    Word const *b,
+    Word const *m,
+    Index n,
+    Word mInv,
+    Word *t)
+  {
+    multiplyArrays(t, a, n, b, n);
+    t[2*n] = 0;
+    montgomeryReduce(r, t, m, n, mInv);
+  }
+
+  // Number of exponent bits consumed per multiplication in `modPow`.
+  static constexpr int modPowWindowBits = 4;
+
+  // `modPow` for odd `modulus`, using Montgomery multiplication so
+  // that no step requires a division.
+  static APUInteger montgomeryModPow(
+    APUInteger const &base,
+    APUInteger const &exponent,
+    APUInteger const &modulus)
+  {
+    Index n = modulus.numWords();
+    Word const *m = modulus.m_vec.data();
+    Word mInv = negatedWordInverse(m[0]);
+
+    // Convert 1 and `base` into Montgomery form, `x*N**n mod m`.
+    APUInteger q, oneM, baseM;
+    {
+      APUInteger tmp(1);
+      tmp.leftShiftByWords(n);
+      divide(q, oneM, tmp, modulus);
+
+      tmp = base;
+      tmp.leftShiftByWords(n);
+      divide(q, baseM, tmp, modulus);
+    }
+    oneM.m_vec.resize(n);
+    baseM.m_vec.resize(n);
+
+    WordVector scratch;
+    scratch.resize(2*n+1);
+
+    // table[i] is `base**i` in Montgomery form.
+    Index const tableSize = (Index)1 << modPowWindowBits;
+    WordVector table;
+    table.resize(tableSize * n);
+    std::copy(oneM.m_vec.data(), oneM.m_vec.data()+n, table.data());
+    for (Index i = 1; i < tableSize; ++i) {
+      montgomeryMultiply(table.data() + i*n, table.data() + (i-1)*n,
+                         baseM.m_vec.data(), m, n, mInv, scratch.data());
+    }
+
+    // Process the exponent a window at a time, starting at the top.
+    WordVector acc(oneM.m_vec);
+    Index windows = div_up(exponent.maxBitIndex()+1,
+                           (Index)modPowWindowBits);
+    for (Index w = windows-1; w >= 0; --w) {
+      Index digit = 0;
+      for (int j = modPowWindowBits-1; j >= 0; --j) {
+        montgomeryMultiply(acc.data(), acc.data(), acc.data(),
+                           m, n, mInv, scratch.data());
+        digit = digit*2 + exponent.getBit(w*modPowWindowBits + j);
+      }
+      if (digit != 0) {
+        montgomeryMultiply(acc.data(), acc.data(), table.data() + digit*n,
+                           m, n, mInv, scratch.data());
+      }
+    }
+
+    // Convert out of Montgomery form.
+    scratch.assignZeroes(2*n+1);
+    std::copy(acc.data(), acc.data()+n, scratch.data());
+    APUInteger ret;
+    ret.m_vec.resize(n);
+    montgomeryReduce(ret.m_vec.data(), scratch.data(), m, n, mInv);
+    ret.normalize();
+    return ret;
   }
 
   // ---------- Serialization helpers ----------
@@ -291,6 +1146,199 @@ private:     // methods
     return (Word)dv;
   }
 
+  // Number of words at or below which radix conversion stops dividing
+  // the problem in half and switches to single-word arithmetic.
+  static constexpr Index radixConversionLeafWords = 16;
+
+  // Return the largest power of `radix` that fits in a `Word`, and set
+  // `chunkDigits` to its exponent.  Radix conversion handles digits in
+  // chunks of that many, using one `Word` operation per chunk.
+  static Word getRadixChunk(int radix, Index &chunkDigits)
+  {
+    Word const maxWord = std::numeric_limits<Word>::max();
+
+    Word chunk = (Word)radix;
+    chunkDigits = 1;
+    while (chunk <= maxWord / (Word)radix) {
+      chunk = (Word)(chunk * radix);
+      ++chunkDigits;
+    }
+    return chunk;
+  }
+
+  // Append to `dest` the digits of `n` in `radix`, using exactly
+  // `padDigits` digits if it is positive, and the minimal number
+  // otherwise.  Each chunk is obtained with one `divideWord`.
+  static void appendRadixDigitsLeaf(
+    std::string &dest,
+    APUInteger n,
+    int radix,
+    Word chunk,
+    Index chunkDigits,
+    Index padDigits)
+  {
+    // Digits, least significant first.
+    std::string rev;
+
+    while (!n.isZero()) {
+      Word w = n.divideWord(chunk);
+      for (Index i = 0; i < chunkDigits; ++i) {
+        rev.push_back(getAsRadixDigit((int)(w % (Word)radix), radix));
+        w = (Word)(w / (Word)radix);
+      }
+    }
+
+    // The final chunk may have contributed excess zeroes.
+    while (!rev.empty() && rev.back() == '0') {
+      rev.pop_back();
+    }
+
+    if (padDigits > 0) {
+      xassert((Index)rev.size() <= padDigits);
+      rev.resize(padDigits, '0');
+    }
+    else if (rev.empty()) {
+      rev.push_back('0');
+    }
+
+    dest.append(rev.rbegin(), rev.rend());
+  }
+
+  // Return `n` divided by `N ** amount`, rounded down.
+  static APUInteger rightShiftedByWords(APUInteger const &n, Index amount)
+  {
+    xassertPrecondition(amount >= 0);
+
+    APUInteger ret;
+    Index nw = n.numWords();
+    if (amount < nw) {
+      ret.m_vec.resize(nw - amount);
+      std::copy(n.m_vec.data() + amount, n.m_vec.data() + nw,
+                ret.m_vec.data());
+    }
+    return ret;
+  }
+
+  /* Append to `dest` the digits of `n` in `radix`, using exactly
+     `padDigits` digits if it is positive, and the minimal number
+     otherwise.
+
+     `powers[j]` is `chunk ** (2 ** j)`.  If `level` is non-negative,
+     then `n` must be less than `powers[level+1]`, i.e., the square of
+     `powers[level]`.  Dividing by the latter therefore splits `n` into
+     two halves of `chunkDigits * 2**level` digits each, which are
+     converted recursively.
+
+     `reciprocals[j]` is either zero or `reciprocal(powers[j])`.  Each
+     large power is used as a divisor many times, so dividing by it
+     with two multiplications, which are subquadratic, rather than with
+     `divide`, which is quadratic, makes the whole conversion
+     subquadratic.  Repeatedly dividing by the radix instead would take
+     time cubic in the number of digits.
+  */
+  static void appendRadixDigits(
+    std::string &dest,
+    APUInteger const &n,
+    int radix,
+    Word chunk,
+    Index chunkDigits,
+    std::vector<APUInteger> const &powers,
+    std::vector<APUInteger> const &reciprocals,
+    Index level,
+    Index padDigits)
+  {
+    if (level < 0 || n.numWords() <= radixConversionLeafWords) {
+      appendRadixDigitsLeaf(dest, n, radix, chunk, chunkDigits, padDigits);
+      return;
+    }
+
+    APUInteger const &divisor = powers[level];
+    if (padDigits == 0 && n < divisor) {
+      // There are no digits for the high half.
+      appendRadixDigits(dest, n, radix, chunk, chunkDigits,
+                        powers, reciprocals, level-1, 0);
+      return;
+    }
+
+    Index lowDigits = chunkDigits << level;
+
+    APUInteger high, low;
+    if (reciprocals[level].isZero()) {
+      divide(high, low, n, divisor);
+    }
+    else {
+      divideByReciprocal(high, low, n, divisor, reciprocals[level]);
+    }
+
+    appendRadixDigits(dest, high, radix, chunk, chunkDigits,
+                      powers, reciprocals, level-1,
+                      padDigits == 0? 0 : padDigits - lowDigits);
+    appendRadixDigits(dest, low, radix, chunk, chunkDigits,
+                      powers, reciprocals, level-1, lowDigits);
+  }
+
+  // Interpret `digits` as a number in `radix`, processing them in
+  // chunks of `chunkDigits` with single-word arithmetic.
+  static APUInteger fromRadixDigitsLeaf(
+    std::string_view digits,
+    int radix,
+    Index chunkDigits)
+  {
+    APUInteger ret;
+
+    Index numDigits = digits.size();
+
+    // Make the first chunk short if necessary so the rest are full.
+    Index len = numDigits % chunkDigits;
+    if (len == 0) {
+      len = chunkDigits;
+    }
+
+    for (Index i = 0; i < numDigits; i += len, len = chunkDigits) {
+      Word value = 0;
+      Word scale = 1;
+      for (Index k = 0; k < len; ++k) {
+        value = (Word)(value * radix +
+                       wordFromRadixDigit(digits[i+k], radix));
+        scale = (Word)(scale * radix);
+      }
+
+      ret.multiplyWord(scale);
+      ret.addWord(value);
+    }
+
+    return ret;
+  }
+
+  // Interpret `digits` as a number in `radix`.  This splits `digits`
+  // so the low part has `chunkDigits * 2**j` digits for some `j`, then
+  // combines the recursively computed halves as `high*powers[j]+low`.
+  static APUInteger fromRadixDigitsRec(
+    std::string_view digits,
+    int radix,
+    Index chunkDigits,
+    std::vector<APUInteger> const &powers)
+  {
+    Index numDigits = digits.size();
+    if (numDigits <= chunkDigits * radixConversionLeafWords) {
+      return fromRadixDigitsLeaf(digits, radix, chunkDigits);
+    }
+
+    // Find the largest power that leaves some digits for the high part.
+    Index level = (Index)powers.size() - 1;
+    while ((chunkDigits << level) >= numDigits) {
+      --level;
+    }
+    Index lowDigits = chunkDigits << level;
+
+    APUInteger ret = fromRadixDigitsRec(
+      digits.substr(0, numDigits - lowDigits), radix, chunkDigits, powers);
+    ret *= powers[level];
+    ret += fromRadixDigitsRec(
+      digits.substr(numDigits - lowDigits), radix, chunkDigits, powers);
+    return ret;
+  }
+
 public:      // methods
   ~APUInteger()
   {}
@@ -424,7 +1472,7 @@ public:      // methods
       Word w = this->getWord(0);
 
       if (sizeof(Word) > sizeof(PRIM)) {
-        Word primMask = (1 << bitsPerPrim) - 1;
+        Word primMask = (Word)(((Word)1 << bitsPerPrim) - 1);
         Word masked = w & primMask;
 
         if (masked != w) {
@@ -547,7 +1595,7 @@ public:      // methods
   void leftShiftByWords(Index amount)
   {
     xassertPrecondition(amount >= 0);
-    m_vec.insert(m_vec.begin(), amount, 0);
+    m_vec.insertZeroesAtFront(amount);
   }
 
   // ---------- Treat as a sequence of bits ----------
@@ -776,8 +1824,10 @@ public:      // methods
   /* Return a string containing the digits of `*this` using `radix`,
      which must be in [2,36].  No indicator of the radix is returned.
 
-     This is a fairly slow procedure since it uses repeated division,
-     although the case of `radix==16` is comparatively fast.
+     The case of `radix==16` is fast since it only requires splitting
+     words into digits.  Other radixes require division, which is
+     organized so the work is dominated by multiplications (see
+     `appendRadixDigits`), making it subquadratic.
   */
   std::string getAsRadixDigits(int radix) const
   {
@@ -789,7 +1839,7 @@ public:      // methods
     }
   }
 
-  // Slow case.  This is exposed just so I can compare it to
+  // General case.  This is exposed just so I can compare it to
   // `getAsHexDigits()` in the unit tests.
   std::string getAsRadixDigits_noFastPath(int radix) const
   {
@@ -799,30 +1849,33 @@ public:      // methods
       return "0";
     }
 
-    // Accumulate the digits, least significant first.
-    std::vector<char> digits;
-
-    APUInteger apRadix(radix);
-
-    // Remaining value to print.
-    APUInteger n(*this);
-    while (!n.isZero()) {
-      // Divide by the radix.
-      APUInteger quotient, remainder;
-      divide(quotient, remainder, n, apRadix);
-
-      // The remainder is the digit to print this time.
-      digits.push_back(
-        getAsRadixDigit(remainder.template getAs<int>(), radix));
-
-      // The quotient is what remains to be printed.
-      n = std::move(quotient);
+    Index chunkDigits;
+    Word chunk = getRadixChunk(radix, chunkDigits);
+
+    // Compute `powers[j] = chunk ** (2 ** j)` until one exceeds
+    // `*this`, but only if the number is large enough to be split.
+    std::vector<APUInteger> powers;
+    if (numWords() > radixConversionLeafWords) {
+      powers.push_back(APUInteger(chunk));
+      while (powers.back() <= *this) {
+        APUInteger square = powers.back() * powers.back();
+        powers.push_back(std::move(square));
+      }
     }
 
-    // Reverse the digits to get the most significant first.
-    std::vector revDigits = vecReverseOf(digits);
+    // The last power is only a bound; the others are divisors.
+    std::vector<APUInteger> reciprocals(powers.size());
+    for (Index j = 0; j+1 < (Index)powers.size(); ++j) {
+      if (powers[j].numWords() >= reciprocalDivisionThreshold) {
+        reciprocals[j] = reciprocal(powers[j]);
+      }
+    }
 
-    return std::string(revDigits.begin(), revDigits.end());
+    std::string ret;
+    appendRadixDigits(ret, *this, radix, chunk, chunkDigits,
+                      powers, reciprocals, (Index)powers.size() - 2,
+                      0 /*padDigits*/);
+    return ret;
   }
 
   // Return `*this` as a string of decimal rights.
@@ -866,27 +1919,23 @@ public:      // methods
   {
     xassertPrecondition(2 <= radix && radix <= 36);
 
-    APUInteger ret;
-
-    Word radixWord = (Word)radix;
-
-    // Make sure the conversion to `Word` did not lose information.
-    xassert((int)radixWord == radix);
-
-    // Object into which I store successive digit values in order to add
-    // them into `ret`.  This avoids creating and destroying an object
-    // for each digit.
-    APUInteger apDigit;
-
-    // Work left to right.
-    for (char digit : digits) {
-      apDigit.setWord(0, wordFromRadixDigit(digit, radix));
+    Index chunkDigits;
+    Word chunk = getRadixChunk(radix, chunkDigits);
 
-      ret.multiplyWord(radixWord);
-      ret.add(apDigit);
+    // Compute `powers[j] = chunk ** (2 ** j)` until one has at least
+    // half as many digits as `digits`, but only if there are enough
+    // digits to split.
+    std::vector<APUInteger> powers;
+    Index numDigits = digits.size();
+    if (numDigits > chunkDigits * radixConversionLeafWords) {
+      powers.push_back(APUInteger(chunk));
+      while ((chunkDigits << powers.size()) < numDigits) {
+        APUInteger square = powers.back() * powers.back();
+        powers.push_back(std::move(square));
+      }
     }
 
-    return ret;
+    return fromRadixDigitsRec(digits, radix, chunkDigits, powers);
   }
 
   static APUInteger fromDecimalDigits(std::string_view digits)
@@ -954,17 +2003,70 @@ public:      // methods
   // else should parse, then hand this class a string (view).
 
   // ---------- Addition ----------
+  /* Set `sum` to `a + b`.
+
+     `sum` may be the same object as either operand.  Its existing
+     storage is reused if it is large enough, so accumulating into an
+     object repeatedly does not allocate once the object has grown.
+  */
+  static void addTo(
+    APUInteger &sum,
+    APUInteger const &a,
+    APUInteger const &b)
+  {
+    // Let `a` be the longer operand.
+    APUInteger const *longer = &a;
+    APUInteger const *shorter = &b;
+    if (longer->numWords() < shorter->numWords()) {
+      std::swap(longer, shorter);
+    }
+    Index ln = longer->numWords();
+    Index sn = shorter->numWords();
+
+    // If `sum` is one of the operands, this can change that operand's
+    // size and location, so only access the operands via `data()`
+    // afterward, and using the saved sizes.
+    sum.m_vec.resize(ln + 1);
+
+    Word *r = sum.m_vec.data();
+    Word const *lp = longer->m_vec.data();
+    Word const *sp = shorter->m_vec.data();
+
+    // Each word is read before it is written, so aliasing is harmless.
+    Word carry = 0;
+    for (Index i = 0; i < sn; ++i) {
+      Word d = lp[i];
+      Word carry1 = addWithCarry(d, carry);
+      Word carry2 = addWithCarry(d, sp[i]);
+      r[i] = d;
+
+      // It is not possible for both additions to yield a carry because
+      // if the first does, then the resulting `d` is zero, so the
+      // second addition yields `sp[i]` with no carry.
+      carry = carry1 + carry2;
+    }
+    for (Index i = sn; i < ln; ++i) {
+      Word d = lp[i];
+      carry = addWithCarry(d, carry);
+      r[i] = d;
+    }
+    r[ln] = carry;
+
+    sum.normalize();
+  }
+
   // Add `other` to `*this`.
   APUInteger &operator+=(APUInteger const &other)
   {
-    this->add(other);
+    addTo(*this, *this, other);
     return *this;
   }
 
   APUInteger operator+(APUInteger const &other) const
   {
-    APUInteger ret(*this);
-    return ret += other;
+    APUInteger ret;
+    addTo(ret, *this, other);
+    return ret;
   }
 
   // One place this can potentially be used is EXPECT_EQ_NUMBERS.
@@ -973,13 +2075,68 @@ public:      // methods
     return *this;
   }
 
+  // Add `w` to `*this`.
+  void addWord(Word w)
+  {
+    Word carry = propagateCarry(m_vec.data(), numWords(), w);
+    if (carry != 0) {
+      m_vec.push_back(carry);
+    }
+  }
+
   // ---------- Subtraction ----------
+  /* Set `difference` to `a - b`.  `a` must be at least as large as `b`.
+
+     As with `addTo`, `difference` may be the same object as either
+     operand, and its storage is reused if possible.
+  */
+  static void subFrom(
+    APUInteger &difference,
+    APUInteger const &a,
+    APUInteger const &b)
+  {
+    Index an = a.numWords();
+    Index bn = b.numWords();
+    xassertPrecondition(an >= bn);
+
+    // See the comments in `addTo` regarding aliasing.
+    difference.m_vec.resize(an);
+
+    Word *r = difference.m_vec.data();
+    Word const *ap = a.m_vec.data();
+    Word const *bp = b.m_vec.data();
+
+    Word borrow = 0;
+    for (Index i = 0; i < bn; ++i) {
+      Word d = ap[i];
+      Word borrow1 = subtractWithBorrow(d, borrow);
+      Word borrow2 = subtractWithBorrow(d, bp[i]);
+      r[i] = d;
+
+      // It is not possible for both operations to yield a borrow
+      // because if the first does, then it leaves `d` as the maximum
+      // value of a Word, so the second subtraction cannot require a
+      // borrow.
+      borrow = borrow1 + borrow2;
+    }
+    for (Index i = bn; i < an; ++i) {
+      Word d = ap[i];
+      borrow = subtractWithBorrow(d, borrow);
+      r[i] = d;
+    }
+
+    // Otherwise, `b` was larger.
+    xassertPrecondition(borrow == 0);
+
+    difference.normalize();
+  }
+
   // Subtract `other` from `*this`.  If `other` is larger, then set
   // `*this` to zero.
   APUInteger &operator-=(APUInteger const &other)
   {
     if (*this >= other) {
-      this->subtract(other);
+      subFrom(*this, *this, other);
     }
     else {
       this->setZero();
@@ -989,8 +2146,11 @@ public:      // methods
 
   APUInteger operator-(APUInteger const &other) const
   {
-    APUInteger ret(*this);
-    return ret -= other;
+    APUInteger ret;
+    if (*this >= other) {
+      subFrom(ret, *this, other);
+    }
+    return ret;
   }
 
   // There is no unary `operator-` because that would not make sense for
@@ -1003,48 +2163,78 @@ public:      // methods
     // Amount to add from the previous iteration.
     Word carry = 0;
 
-    for (Index i = 0; i < numWords() || carry; ++i) {
-      Word d = this->getWord(i);
+    for (Word &d : m_vec) {
+      // This cannot overflow: (N-1)*(N-1) + (N-1) < N*N.
+      DWord prod = (DWord)((DWord)d * w + carry);
 
-      Word lowProd, highProd;
-      multiplyWords(lowProd, highProd, d, w);
-
-      // The low word of the product goes into the `i`th slot.
-      d = lowProd;
+      // The low word of the product goes into this slot, and the high
+      // word carries to the next.
+      d = (Word)prod;
+      carry = (Word)(prod >> bitsPerWord());
+    }
 
-      // Plus whatever carries from the previous word.
-      Word carry1 = addWithCarry(d, carry);
-      this->setWord(i, d);
+    if (carry != 0) {
+      m_vec.push_back(carry);
+    }
 
-      // Then that carry combines with the high word.
-      Word carry2 = addWithCarry(highProd, carry1);
+    // If `w` was zero, the result must be too.
+    normalize();
+  }
 
-      // It should not be possible for the second addition to overflow.
-      xassert(carry2 == 0);
+  // Return the product of `*this` and `other`.
+  APUInteger operator*(APUInteger const &other) const
+  {
+    APUInteger ret;
 
-      // What is in `highProd` is what carries to the next word.
-      carry = highProd;
+    if (!this->isZero() && !other.isZero()) {
+      ret.m_vec.resize(this->numWords() + other.numWords());
+      multiplyArrays(ret.m_vec.data(),
+                     this->m_vec.data(), this->numWords(),
+                     other.m_vec.data(), other.numWords());
+      ret.normalize();
     }
 
-    selfCheck();
+    return ret;
   }
 
-  // Return the product of `*this` and `other`.
-  APUInteger operator*(APUInteger const &other) const
+  /* Add `a * b` to `acc`.
+
+     When the operands are small, the partial products are added
+     directly into `acc`, reusing its storage, rather than forming the
+     product in a temporary.  `acc` may be the same object as an
+     operand, but then a temporary is required.
+  */
+  static void mulAdd(
+    APUInteger &acc,
+    APUInteger const &a,
+    APUInteger const &b)
   {
-    APUInteger acc;
+    Index an = a.numWords();
+    Index bn = b.numWords();
+    if (an == 0 || bn == 0) {
+      return;
+    }
 
-    for (Index i = 0; i < other.numWords(); ++i) {
-      // Compute `*this * (N**i) * other[i]`.
-      APUInteger partialSum(*this);
-      partialSum.leftShiftByWords(i);
-      partialSum.multiplyWord(other.getWord(i));
+    if (&acc == &a || &acc == &b ||
+        std::min(an, bn) >= karatsubaThreshold) {
+      addTo(acc, acc, a * b);
+      return;
+    }
 
-      // Add it to the running total.
-      acc += partialSum;
+    // Make room for the product plus a final carry.
+    Index rn = std::max(acc.numWords(), an+bn) + 1;
+    acc.m_vec.resize(rn);
+
+    Word *r = acc.m_vec.data();
+    Word const *ap = a.m_vec.data();
+    Word const *bp = b.m_vec.data();
+    for (Index j = 0; j < bn; ++j) {
+      Word carry = multiplyAddRow(r+j, ap, an, bp[j]);
+      carry = propagateCarry(r+j+an, rn-j-an, carry);
+      xassert(carry == 0);
     }
 
-    return acc;
+    acc.normalize();
   }
 
   APUInteger &operator*=(APUInteger const &other)
@@ -1081,44 +2271,126 @@ public:      // methods
       THROW(XDivideByZero(stringb(dividend)));
     }
 
-    // We will set bits in the quotient as we go.
-    quotient.setZero();
-
-    // Work with the dividend as it will exist after the divisor takes
-    // chunks out of it.
-    remainder = dividend;
+    if (dividend < divisor) {
+      quotient.setZero();
+      remainder = dividend;
+      return;
+    }
 
-    if (dividend.isZero()) {
+    if (divisor.numWords() == 1) {
+      quotient = dividend;
+      Word r = quotient.divideWord(divisor.getWord(0));
+      remainder.setZero();
+      remainder.setWord(0, r);
       return;
     }
 
-    // We will work one bit at a time.  This is slow but simple.
-    Index s = dividend.maxBitIndex();
+    divideMultiWord(quotient, remainder, dividend, divisor);
+  }
 
-    // Work with a divisor shifted left by `s` bits.
-    APUInteger shiftedDivisor(divisor);
-    shiftedDivisor.leftShiftByBits(s);
+  // Divisor size, in words, at or above which radix conversion divides
+  // using a precomputed `reciprocal` rather than `divide`.  Below this,
+  // computing the reciprocal costs more than it saves.
+  static constexpr Index reciprocalDivisionThreshold = 768;
 
-    while (s >= 0) {
-      // Can `shiftedDivisor` go into what remains?
-      if (shiftedDivisor <= remainder) {
-        // Yes, take another chunk out of it.
-        remainder -= shiftedDivisor;
-        quotient.setBit(s, true);
-      }
-      else {
-        // No, remainder stays.
-        //
-        // We do not actually need to call `setBit(false)` since the
-        // quotient started as all zeroes.
-        //quotient.setBit(s, false);
-      }
+  /* Return `N ** (2*m) / d`, rounded down, where `d` has `m` words.
 
-      // Move on to the next smaller divisor and a correspondingly less
-      // significant quotient bit.
-      shiftedDivisor.rightShiftOneBit();
-      --s;
+     For large `d`, this takes the reciprocal of the top half of `d`,
+     recursively, which is correct to about `m/2` words, then does one
+     Newton iteration, which doubles the number of correct words, and
+     finally fixes the last few units.  That takes time proportional to
+     a few multiplications of size `m` rather than a long division.
+  */
+  static APUInteger reciprocal(APUInteger const &d)
+  {
+    Index m = d.numWords();
+    xassertPrecondition(m > 0);
+
+    APUInteger power(1);
+    power.leftShiftByWords(2*m);
+
+    if (m < reciprocalDivisionThreshold) {
+      APUInteger q, r;
+      divide(q, r, power, d);
+      return q;
+    }
+
+    // `x0 * N**t` approximates the result.  Its relative error is about
+    // `N ** -(m-t)`, from discarding the low words of `d`.
+    Index t = m - (m/2 + 2);
+    APUInteger x0 = reciprocal(rightShiftedByWords(d, t));
+
+    // Newton step: x = x0*N**t * (2 - d*x0*N**t / N**(2m)), written so
+    // the error term, `power - d*x0*N**t`, is never negative.
+    APUInteger dx = d * x0;
+    dx.leftShiftByWords(t);
+    APUInteger x = x0;
+    x.leftShiftByWords(t);
+    if (dx <= power) {
+      x += rightShiftedByWords(x0 * (power - dx), 2*m - t);
+    }
+    else {
+      x -= rightShiftedByWords(x0 * (dx - power), 2*m - t);
+    }
+
+    // Now `x` is within a few units of the answer.
+    dx = d * x;
+    while (dx > power) {
+      x -= APUInteger(1);
+      dx -= d;
+    }
+    APUInteger rem = power - dx;
+    while (rem >= d) {
+      x.addWord(1);
+      rem -= d;
     }
+
+    return x;
+  }
+
+  /* Divide `x` by `d`, where `x < d*d` and `mu` is `reciprocal(d)`,
+     setting `quotient` and `remainder` as `divide` does.
+
+     This is Barrett reduction (HAC 14.42): two multiplications produce
+     a quotient at most two less than the true one, and the remainder
+     is then adjusted.
+  */
+  static void divideByReciprocal(
+    APUInteger &quotient,
+    APUInteger &remainder,
+    APUInteger const &x,
+    APUInteger const &d,
+    APUInteger const &mu)
+  {
+    Index m = d.numWords();
+    quotient = rightShiftedByWords(rightShiftedByWords(x, m-1) * mu, m+1);
+    remainder = x - quotient * d;
+    while (remainder >= d) {
+      remainder -= d;
+      quotient.addWord(1);
+    }
+  }
+
+  // Divide `*this` by `divisor`, replacing `*this` with the quotient,
+  // and return the remainder.  This takes time linear in the size of
+  // `*this`.  Throws `XDivideByZero` if `divisor` is zero.
+  Word divideWord(Word divisor)
+  {
+    if (divisor == 0) {
+      THROW(XDivideByZero(toString()));
+    }
+
+    // Work from most to least significant, carrying the remainder of
+    // each step into the next.
+    Word rem = 0;
+    for (Index i = maxWordIndex(); i >= 0; --i) {
+      DWord cur = (DWord)(((DWord)rem << bitsPerWord()) | m_vec[i]);
+      m_vec[i] = (Word)(cur / divisor);
+      rem = (Word)(cur % divisor);
+    }
+
+    normalize();
+    return rem;
   }
 
   APUInteger operator/(APUInteger const &divisor) const
@@ -1146,6 +2418,137 @@ public:      // methods
     APUInteger r = *this % divisor;
     return *this = std::move(r);
   }
+
+  // ---------- Number theory ----------
+  // Return the greatest common divisor of `a` and `b`.  `gcd(0,0)` is
+  // 0.
+  static APUInteger gcd(APUInteger a, APUInteger b)
+  {
+    if (a < b) {
+      std::swap(a, b);
+    }
+
+    // Use Lehmer's algorithm while the operands are large.
+    bool oddSteps = false;
+    reduceEuclidean(a, b, nullptr, nullptr, oddSteps, 3 /*minWords*/);
+    if (b.isZero()) {
+      return a;
+    }
+
+    // Both now fit in a double word, so finish with native arithmetic.
+    auto toDWord = [](APUInteger const &v) -> DWord {
+      return (DWord)(((DWord)v.getWord(1) << bitsPerWord()) |
+                     v.getWord(0));
+    };
+    DWord x = toDWord(a);
+    DWord y = toDWord(b);
+    while (y != 0) {
+      DWord t = (DWord)(x % y);
+      x = y;
+      y = t;
+    }
+
+    APUInteger ret;
+    ret.setWord(0, (Word)x);
+    ret.setWord(1, (Word)(x >> bitsPerWord()));
+    return ret;
+  }
+
+  /* Return `g = gcd(a,b)`, and set `coefficient` and
+     `coefficientNegative` to the magnitude and sign of an `x` such that
+     `a*x = g (mod b)`.  `x` is the Bezout coefficient of `a` found by
+     the extended Euclidean algorithm, so `abs(x) <= b/g` when `b` is
+     not zero.
+  */
+  static APUInteger extendedGCD(
+    APUInteger &coefficient,
+    bool &coefficientNegative,
+    APUInteger a,
+    APUInteger b)
+  {
+    APUInteger u0(1), u1;
+    bool oddSteps = false;
+    reduceEuclidean(a, b, &u0, &u1, oddSteps, 0 /*minWords*/);
+
+    coefficientNegative = oddSteps && !u0.isZero();
+    coefficient = std::move(u0);
+    return a;
+  }
+
+  /* Return `base**exponent mod modulus`.  Throw `XDivideByZero` if
+     `modulus` is zero.
+
+     For odd moduli, which include the usual cryptographic and hashing
+     ones, this uses Montgomery multiplication, so the cost of each
+     step is a multiplication and a reduction that is about as cheap
+     as another multiplication.  Even moduli fall back to dividing
+     after each multiplication.
+  */
+  static APUInteger modPow(
+    APUInteger const &base,
+    APUInteger const &exponent,
+    APUInteger const &modulus)
+  {
+    if (modulus.isZero()) {
+      THROW(XDivideByZero(stringb(base)));
+    }
+    if (modulus == APUInteger(1)) {
+      return APUInteger();
+    }
+    if (modulus.getWord(0) & 1) {
+      return montgomeryModPow(base, exponent, modulus);
+    }
+
+    APUInteger q, b, acc(1), prod;
+    divide(q, b, base, modulus);
+    for (Index i = exponent.maxBitIndex(); i >= 0; --i) {
+      prod = acc * acc;
+      divide(q, acc, prod, modulus);
+      if (exponent.getBit(i)) {
+        prod = acc * b;
+        divide(q, acc, prod, modulus);
+      }
+    }
+    return acc;
+  }
+
+  // Return `base**exponent`.  `0**0` is 1.
+  static APUInteger pow(APUInteger const &base, unsigned exponent)
+  {
+    APUInteger acc(1);
+    for (int i = std::numeric_limits<unsigned>::digits-1; i >= 0; --i) {
+      acc = acc * acc;
+      if ((exponent >> i) & 1) {
+        acc = acc * base;
+      }
+    }
+    return acc;
+  }
+
+  // Return the largest integer whose square is not larger than `n`.
+  static APUInteger isqrt(APUInteger const &n)
+  {
+    if (n.isZero()) {
+      return n;
+    }
+
+    // Start from a power of two that is at least `sqrt(n)`.  Newton's
+    // iteration then decreases monotonically until it reaches the
+    // answer.
+    APUInteger x(1);
+    x.leftShiftByBits(n.maxBitIndex()/2 + 1);
+
+    APUInteger q, r, y;
+    while (true) {
+      divide(q, r, n, x);
+      addTo(y, x, q);
+      y.rightShiftOneBit();
+      if (y >= x) {
+        return x;
+      }
+      std::swap(x, y);
+    }
+  }
 };
 
 
@@ -326,6 +326,63 @@ void testGetAs()
 }
 
 
+// Make an `Integer` from decimal digits.
+Integer dec(char const *digits)
+{
+  return Integer::fromDigits(digits);
+}
+
+
+void testNumberTheory()
+{
+  EXPECT_EQ(Integer::gcd(12, -18), Integer(6));
+  EXPECT_EQ(Integer::gcd(0, 0), Integer(0));
+  EXPECT_EQ(Integer::gcd(0, -5), Integer(5));
+  EXPECT_EQ(Integer::gcd(Integer::pow(2, 200) * 3,
+                         Integer::pow(2, 150) * 9),
+            Integer::pow(2, 150) * 3);
+
+  Integer g, x, y;
+  Integer::extendedGCD(g, x, y, 240, 46);
+  EXPECT_EQ(g, Integer(2));
+  EXPECT_EQ(Integer(240)*x + Integer(46)*y, g);
+
+  Integer a = dec("123456789012345678901234567890");
+  Integer b = dec("-987654321098765432109876543210");
+  Integer::extendedGCD(g, x, y, a, b);
+  EXPECT_EQ(g, Integer::gcd(a, b));
+  EXPECT_EQ(a*x + b*y, g);
+
+  EXPECT_EQ(Integer::modInverse(3, 11).value(), Integer(4));
+  EXPECT_EQ(Integer::modInverse(-3, 11).value(), Integer(7));
+  xassert(!Integer::modInverse(6, 9).has_value());
+
+  EXPECT_EQ(Integer::modPow(4, 13, 497), Integer(445));
+  EXPECT_EQ(Integer::modPow(-2, 3, 5), Integer(2));
+  EXPECT_EQ(Integer::modPow(7, 222, 1000), Integer(49));
+  EXPECT_EQ(Integer::modPow(123456789, 987654321,
+                            Integer::pow(2, 64)),
+            dec("2707128288486860373"));
+
+  // 2**127-1 is prime.
+  Integer m127 = Integer::pow(2, 127) - 1;
+  EXPECT_EQ(Integer::modPow(3, Integer::pow(10, 20), m127),
+            dec("12025050231696925086731743046088503371"));
+  EXPECT_EQ(Integer::modPow(5, m127-1, m127), Integer(1));
+
+  EXPECT_EQ(Integer::pow(-2, 5), Integer(-32));
+  EXPECT_EQ(Integer::pow(-2, 0), Integer(1));
+  EXPECT_EQ(Integer::pow(10, 30), dec("1000000000000000000000000000000"));
+
+  EXPECT_EQ(Integer::isqrt(0), Integer(0));
+  EXPECT_EQ(Integer::isqrt(15), Integer(3));
+  EXPECT_EQ(Integer::isqrt(16), Integer(4));
+  EXPECT_EQ(Integer::isqrt(Integer::pow(10, 40)), Integer::pow(10, 20));
+  EXPECT_EQ(Integer::isqrt(Integer::pow(10, 40) - 1),
+            Integer::pow(10, 20) - 1);
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
@@ -337,6 +394,7 @@ void test_sm_integer()
   testUnaryOps();
   testGetAs();
   testRandomArithmetic();
+  testNumberTheory();
 
   VPVAL(overflowCount);
   VPVAL(nonOverflowCount);
@@ -6,12 +6,13 @@
 #include "sm-integer.h"                // this module
 
 #include "compare-util.h"              // compare
+#include "double-width-type.h"         // SMBASE_HAVE_UINT128
 #include "sm-ap-int.h"                 // APInteger
 #include "sm-macros.h"                 // OPEN_NAMESPACE, STATICDEF
 
-#include <cstdint>                     // std::uint32_t
+#include <cstdint>                     // std::{uint32_t, uint64_t}
 #include <new>                         // placement `new`
-#include <optional>                    // std::optional
+#include <optional>                    // std::{optional, nullopt}
 #include <string>                      // std::string
 #include <string_view>                 // std::string_view
 #include <utility>                     // std::move
@@ -21,7 +22,18 @@ OPEN_NAMESPACE(smbase)
 
 
 // The underlying implementation type.
-typedef APInteger<std::uint32_t, std::int32_t> UnderInteger;
+//
+// When the compiler has a 128-bit type to hold the product of two
+// 64-bit words, use 64-bit words, since then each word operation does
+// twice as much work.  Otherwise, fall back to 32-bit words.
+//
+// The embedded value stays `int32_t` either way so the object still
+// fits in `Integer::m_storage`.
+#if defined(SMBASE_HAVE_UINT128)
+  typedef APInteger<std::uint64_t, std::int32_t> UnderInteger;
+#else
+  typedef APInteger<std::uint32_t, std::int32_t> UnderInteger;
+#endif
 
 // The underlying integer as a `const` pseudo-member of `Integer` `obj`.
 #define M_UNDER_OF_CONST(obj) \
@@ -319,6 +331,68 @@ Integer &Integer::operator%=(Integer const &divisor)
 }
 
 
+STATICDEF Integer Integer::gcd(Integer const &a, Integer const &b)
+{
+  return underToInteger(
+    UnderInteger::gcd(M_UNDER_OF_CONST(a), M_UNDER_OF_CONST(b)));
+}
+
+
+STATICDEF void Integer::extendedGCD(
+  Integer &g,
+  Integer &x,
+  Integer &y,
+  Integer const &a,
+  Integer const &b)
+{
+  UnderInteger::extendedGCD(
+    M_UNDER_OF(g),
+    M_UNDER_OF(x),
+    M_UNDER_OF(y),
+    M_UNDER_OF_CONST(a),
+    M_UNDER_OF_CONST(b));
+}
+
+
+STATICDEF std::optional<Integer> Integer::modInverse(
+  Integer const &a,
+  Integer const &modulus)
+{
+  std::optional<UnderInteger> res =
+    UnderInteger::modInverse(M_UNDER_OF_CONST(a),
+                             M_UNDER_OF_CONST(modulus));
+  if (!res.has_value()) {
+    return std::nullopt;
+  }
+  return underToInteger(std::move(res.value()));
+}
+
+
+STATICDEF Integer Integer::modPow(
+  Integer const &base,
+  Integer const &exponent,
+  Integer const &modulus)
+{
+  return underToInteger(
+    UnderInteger::modPow(M_UNDER_OF_CONST(base),
+                         M_UNDER_OF_CONST(exponent),
+                         M_UNDER_OF_CONST(modulus)));
+}
+
+
+STATICDEF Integer Integer::pow(Integer const &base, unsigned exponent)
+{
+  return underToInteger(
+    UnderInteger::pow(M_UNDER_OF_CONST(base), exponent));
+}
+
+
+STATICDEF Integer Integer::isqrt(Integer const &n)
+{
+  return underToInteger(UnderInteger::isqrt(M_UNDER_OF_CONST(n)));
+}
+
+
 // Explicit instantiation definition for the Integer method templates.
 #define DEFINE_INTEGER_METHOD_SPECIALIZATIONS(PRIM) \
   template                                          \
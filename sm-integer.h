@@ -30,18 +30,18 @@ class Integer {
 private:     // data
   // An APInteger has:
   //   - APUInteger, which has:
-  //     - std::vector, which has:
-  //       - start pointer
-  //       - end pointer
-  //       - end-of-storage pointer
+  //     - WordVector, which has:
+  //       - inline storage or heap pointer: four `void*` words
+  //       - size: uint32_t
+  //       - capacity: uint32_t
   //   - SignOrEmbed: uint8_t
   //   - EmbeddedInt: int32_t
   //
-  // With padding, that is four or five `void*` words.  I declare this
+  // With padding, that is six or eight `void*` words.  I declare this
   // as an array of `void*` rather than `unsigned char` to (hopefully?)
   // ensure proper alignment.  The implementation has a `static_assert`
   // that checks that this is enough space.
-  void *m_storage[sizeof(void*) >= 8? 4 : 5];
+  void *m_storage[sizeof(void*) >= 8? 6 : 8];
 
 private:     // methods
   // Special constructor that accepts a pointer to an underlying integer
@@ -228,6 +228,42 @@ public:      // methods
 
   Integer &operator/=(Integer const &divisor);
   Integer &operator%=(Integer const &divisor);
+
+  // ---------- Number theory ----------
+  // Return the greatest common divisor of the magnitudes of `a` and
+  // `b`, which is never negative.  `gcd(0,0)` is 0.
+  static Integer gcd(Integer const &a, Integer const &b);
+
+  // Set `g` to `gcd(a,b)`, and `x` and `y` to Bezout coefficients such
+  // that `a*x + b*y = g`.  The outputs must be distinct objects, but
+  // may be the same as the inputs.
+  static void extendedGCD(
+    Integer &g,
+    Integer &x,
+    Integer &y,
+    Integer const &a,
+    Integer const &b);
+
+  // Return the `x` in `[0,modulus)` such that `a*x = 1 (mod modulus)`,
+  // or `nullopt` if there is none.  `modulus` must be positive.
+  static std::optional<Integer> modInverse(
+    Integer const &a,
+    Integer const &modulus);
+
+  // Return `base**exponent mod modulus`, in `[0,modulus)`.  `exponent`
+  // must not be negative and `modulus` must be positive.  Odd moduli
+  // use Montgomery multiplication.
+  static Integer modPow(
+    Integer const &base,
+    Integer const &exponent,
+    Integer const &modulus);
+
+  // Return `base**exponent`.  `0**0` is 1.
+  static Integer pow(Integer const &base, unsigned exponent);
+
+  // Return the largest integer whose square is not larger than `n`,
+  // which must not be negative.
+  static Integer isqrt(Integer const &n);
 };
 
 
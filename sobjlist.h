@@ -12,22 +12,25 @@
 
 // forward declarations of template classes, so we can befriend them in SObjList
 // (not required by Borland C++ 4.5, but GNU wants it...)
-template <class T> class SObjListIter;
-template <class T> class SObjListMutator;
-template <class T> class SObjListIterNC;
+template <class T, class VL = VoidList> class SObjListIter;
+template <class T, class VL = VoidList> class SObjListMutator;
+template <class T, class VL = VoidList> class SObjListIterNC;
 
 
 // the list is considered to not own any of the items; it's ok to
 // insert items multiple times or into multiple lists
-template <class T>
+//
+// 'VL' is the underlying list of void*, either VoidList or
+// UnrolledVoidList (unrolled-voidlist.h); they have the same interface
+template <class T, class VL = VoidList>
 class SObjList {
 private:
-  friend class SObjListIter<T>;
-  friend class SObjListMutator<T>;
-  friend class SObjListIterNC<T>;
+  friend class SObjListIter<T, VL>;
+  friend class SObjListMutator<T, VL>;
+  friend class SObjListIterNC<T, VL>;
 
 protected:
-  VoidList list;                        // list itself
+  VL list;                              // list itself
 
 public:
   // make shallow copies
@@ -134,15 +137,15 @@ public:
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists, and only one such iterator should exist for
 //       any given list
-template <class T>
+template <class T, class VL>
 class SObjListMutator {
-  friend class SObjListIter<T>;
+  friend class SObjListIter<T, VL>;
 
 protected:
-  VoidListMutator mut;       // underlying mutator
+  typename VL::Mutator mut;  // underlying mutator
 
 public:
-  SObjListMutator(SObjList<T> &lst)     : mut(lst.list) { reset(); }
+  SObjListMutator(SObjList<T, VL> &lst)     : mut(lst.list) { reset(); }
   ~SObjListMutator()                    {}
 
   void reset()                          { mut.reset(); }
@@ -190,24 +193,24 @@ public:
 // for traversing the list without modifying it (neither nodes nor structure)
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists
-template <class T>
+template <class T, class VL>
 class SObjListIter {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  SObjListIter(SObjList<T> const &list) : iter(list.list) {}
-  SObjListIter(SObjList<T> const &list, int pos) : iter(list.list, pos) {}
+  SObjListIter(SObjList<T, VL> const &list) : iter(list.list) {}
+  SObjListIter(SObjList<T, VL> const &list, int pos) : iter(list.list, pos) {}
   ~SObjListIter()                       {}
 
-  void reset(SObjList<T> const &list)   { iter.reset(list.list); }
+  void reset(SObjList<T, VL> const &list) { iter.reset(list.list); }
 
   // iterator copying; generally safe
   SObjListIter(SObjListIter const &obj)             : iter(obj.iter) {}
   SObjListIter& operator=(SObjListIter const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  SObjListIter(SObjListMutator<T> &obj)             : iter(obj.mut) {}
+  SObjListIter(SObjListMutator<T, VL> &obj)         : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -222,24 +225,24 @@ public:
 // intermediate to the above two, this allows modification of the
 // objects stored on the list, but not the identity or order of
 // the objects in the list
-template <class T>
+template <class T, class VL>
 class SObjListIterNC {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  SObjListIterNC(SObjList<T> &list) : iter(list.list) {}
-  SObjListIterNC(SObjList<T> &list, int pos) : iter(list.list, pos) {}
+  SObjListIterNC(SObjList<T, VL> &list) : iter(list.list) {}
+  SObjListIterNC(SObjList<T, VL> &list, int pos) : iter(list.list, pos) {}
   ~SObjListIterNC()                     {}
 
-  void reset(SObjList<T> &list)         { iter.reset(list.list); }
+  void reset(SObjList<T, VL> &list)     { iter.reset(list.list); }
 
   // iterator copying; generally safe
   SObjListIterNC(SObjListIterNC const &obj)             : iter(obj.iter) {}
   SObjListIterNC& operator=(SObjListIterNC const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  SObjListIterNC(SObjListMutator<T> &obj)               : iter(obj.mut) {}
+  SObjListIterNC(SObjListMutator<T, VL> &obj)           : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -252,23 +255,23 @@ public:
 
 
 // iterate over the combined elements of two or more lists
-template <class T>
+template <class T, class VL = VoidList>
 class SObjListMultiIter {
 private:
   // all the lists
-  SObjList<T> **lists;               // serf array of serf list pointers
+  SObjList<T, VL> **lists;           // serf array of serf list pointers
   int numLists;                      // length of this array
 
   // current element
   int curList;                       // which list we're working on
-  SObjListIter<T> iter;              // current element of that list
+  SObjListIter<T, VL> iter;          // current element of that list
 
   // invariant:
   //   either curList==numLists, or
   //   iter is not 'done'
 
 public:
-  SObjListMultiIter(SObjList<T> **L, int n)
+  SObjListMultiIter(SObjList<T, VL> **L, int n)
     : lists(L),
       numLists(n),
       curList(0),
@@ -298,8 +301,8 @@ public:
 
 // this was originally inline, but that was causing some strange
 // problems (compiler bug?)
-template <class T>
-void SObjListMultiIter<T>::normalize()
+template <class T, class VL>
+void SObjListMultiIter<T, VL>::normalize()
 {
   while (iter.isDone() && curList < numLists) {
     curList++;
@@ -24,7 +24,7 @@ inline bool strcmpRevCompare(char const *a, char const *b)
 // Comparison object for STL algorithms and containers.
 class StrcmpCompare {
 public:
-  bool operator() (char const *a, char const *b) {
+  bool operator() (char const *a, char const *b) const {
     return strcmpCompare(a, b);
   }
 };
@@ -32,7 +32,7 @@ public:
 
 class StrcmpRevCompare {
 public:
-  bool operator() (char const *a, char const *b) {
+  bool operator() (char const *a, char const *b) const {
     return strcmpRevCompare(a, b);
   }
 };
@@ -3,9 +3,15 @@
 
 #include "strdict.h"                   // module under test
 
+#include "array.h"                     // ArrayStack
+#include "nonport.h"                   // getMilliseconds
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
+#include "sm-test.h"                   // EXPECT_EQ
 
-#include <stdlib.h>                    // rand
+#include <stdio.h>                     // printf
+#include <stdlib.h>                    // rand, atoi, getenv
+
+#include <set>                         // std::set
 
 #define myrandom(n) (rand()%(n))
 
@@ -44,12 +50,143 @@ string randKey(StringDict const &dict)
   return entry.key();
 }
 
+
+// Iteration order does not depend on insertion order, and is
+// (despite what strdict.h says) reverse alphabetical.
+void testOrder()
+{
+  StringDict dict;
+  dict.add("b", "1");
+  dict.add("a", "2");
+  dict.add("c", "3");
+  dict.add("ab", "4");
+  EXPECT_EQ(dict.toString(), string("{ c=\"3\", b=\"1\", ab=\"4\", a=\"2\" }"));
+
+  // Removal and re-adding after iteration.
+  dict.remove("b");
+  dict.add("bb", "5");
+  dict.remove("c");
+  dict.remove("a");
+  EXPECT_EQ(dict.toString(), string("{ bb=\"5\", ab=\"4\" }"));
+  EXPECT_EQ(dict.size(), 2);
+
+  StringDict::Iter it = dict.find("ab");
+  xassert(!it.isDone());
+  EXPECT_EQ(it.value(), string("4"));
+  xassert(dict.find("b").isDone());
+
+  dict.empty();
+  xassert(dict.isEmpty());
+  dict.add("x", "6");
+  EXPECT_EQ(dict.queryf("x"), string("6"));
+
+  // Removing every key before the list has been sorted leaves an
+  // empty, iterable dictionary.
+  StringDict d2;
+  d2.add("b", "1");
+  d2.add("a", "2");
+  d2.remove("a");
+  d2.remove("b");
+  xassert(d2.getIter().isDone());
+  xassert(d2 == StringDict());
+  EXPECT_EQ(d2.toString(), string("{ }"));
+}
+
+
+// Interleave insertions, removals and traversals, and compare the
+// order to std::set.
+void testRandomOrder()
+{
+  StringDict dict;
+  std::set<string> keys;
+
+  smbase_loopi(200) {
+    smbase_loopj(myrandom(20)) {
+      string k = randStringRandLen(5);
+      if (keys.insert(k).second) {
+        dict.add(k.c_str(), "v");
+      }
+    }
+    smbase_loopj(myrandom(10)) {
+      if (!keys.empty() && myrandom(2)) {
+        string k = randKey(dict);
+        keys.erase(k);
+        dict.remove(k.c_str());
+      }
+    }
+
+    // Greatest first.
+    std::set<string>::reverse_iterator it = keys.rbegin();
+    for (StringDict::IterC entry(dict); !entry.isDone(); entry.next()) {
+      xassert(it != keys.rend());
+      xassert(entry.key() == *it);
+      ++it;
+    }
+    xassert(it == keys.rend());
+  }
+}
+
+
+// Time building, querying and iterating dictionaries of increasing
+// size, up to the number of entries in STRDICT_PERF.  With hashed
+// lookup, the time per operation should stay roughly constant.
+void perfTest()
+{
+  char const *maxStr = getenv("STRDICT_PERF");
+  if (!maxStr) {
+    return;
+  }
+  int maxSize = atoi(maxStr);
+
+  printf("    size   add ms  query ms   iter ms   ns/op\n");
+  for (int size = 1000; size <= maxSize; size *= 2) {
+    ArrayStack<string> keys;
+    smbase_loopi(size) {
+      keys.push(stringb("key" << (i * 7919 % size) << "/" << i));
+    }
+
+    StringDict dict;
+    long start = getMilliseconds();
+    smbase_loopi(size) {
+      dict.add(keys[i].c_str(), "value");
+    }
+    long addMs = getMilliseconds() - start;
+
+    start = getMilliseconds();
+    int found = 0;
+    smbase_loopj(4) {
+      smbase_loopi(size) {
+        found += dict.isMapped(keys[i].c_str());
+      }
+    }
+    long queryMs = getMilliseconds() - start;
+    xassert(found == size*4);
+
+    start = getMilliseconds();
+    int ct = 0;
+    for (StringDict::IterC entry(dict); !entry.isDone(); entry.next()) {
+      ct++;
+    }
+    long iterMs = getMilliseconds() - start;
+    xassert(ct == size);
+
+    printf("%8d %8ld %9ld %9ld %7.0f\n",
+      size, addMs, queryMs, iterMs,
+      (double)(addMs + queryMs + iterMs) * 1e6 / (size * 6));
+  }
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
 // Called from unit-tests.cc.
 void test_strdict()
 {
+  testOrder();
+  testRandomOrder();
+  perfTest();
+
   StringDict dict;
   int size=0, collisions=0;
 
@@ -1,9 +1,9 @@
 // strdict.h            see license.txt for copyright and terms of use
 // StringDict, a case-sensitive map from strings to strings.
-// Currently, this is implemented with a linked list and consequently
-// not efficient.  But it will work when efficiency does not matter,
-// and could be reimplemented (preserving the interface) with something
-// better.
+//
+// This is a StringVoidDict whose values are owned strings, so it has
+// the same hashed lookup and the same incrementally sorted iteration
+// order.
 
 #ifndef SMBASE_STRDICT_H
 #define SMBASE_STRDICT_H
@@ -11,48 +11,36 @@
 #include "sm-iostream.h"// ostream
 #include "sm-macros.h"  // DMEMB
 #include "str.h"        // string
+#include "svdict.h"     // StringVoidDict
 #include "xassert.h"    // xassert
 
 class StringDict {
-private:    // types
-  class Node {
-  public:
-    Node *next;
-    string key, value;
-
-  public:
-    Node(char const *k, char const *v, Node *n = NULL)
-      : next(n), key(k), value(v) {}
-    ~Node() {}
-  };
-
 public:     // types
   // Note: some care must be taken when dealing with Iters, because
   //       they can be invalidated when held across modifications to
   //       structure of the underlying dictionary
   class Iter {
   private:
-    Node *current;
+    StringVoidDict::Iter iter;
 
   public:
-    Iter(Node *n) : current(n) {}
-    Iter(StringDict &dict) { operator=(dict.getIter()); }
-    Iter(Iter const &obj) : DMEMB(current) {}
-    Iter& operator= (Iter const &obj) { CMEMB(current); return *this; }
+    Iter(StringVoidDict::Iter const &i) : iter(i) {}
+    Iter(StringDict &dict) : iter(dict.getIter().iter) {}
+    Iter(Iter const &obj) : DMEMB(iter) {}
+    Iter& operator= (Iter const &obj) { CMEMB(iter); return *this; }
 
-    bool isDone() const { return current == NULL; }
-    Iter& next() { xassert(current); current = current->next; return *this; }
+    bool isDone() const { return iter.isDone(); }
+    Iter& next() { iter.next(); return *this; }
       // 'next' returns a value primarily to allow use in for-loop comma exprs
 
-    string& key() const { return current->key; }
-    string& value() const { return current->value; }
+    string& key() const { return iter.key(); }
+    string& value() const { return *(string*)iter.value(); }
   };
   friend class Iter;
 
   // iterator that can't modify the dictionary entries
   class IterC : protected Iter {
   public:
-    IterC(Node const *n) : Iter(const_cast<Node*>(n)) {}
     IterC(StringDict const &dict) : Iter(const_cast<StringDict&>(dict)) {}
     IterC(IterC const &obj) : Iter(obj) {}
     IterC& operator= (IterC const &obj) { Iter::operator=(obj); return *this; }
@@ -67,18 +55,11 @@ public:     // types
   };
 
 private:    // data
-  Node *top;             // first list node (possibly NULL)
-
-protected:  // funcs
-  void selfCheck() const;      // throw exception if invariants violated
-
-  void verifySorted() const;   // throw exception if list isn't sorted
-
-  void /*mutable*/ sort();     // arrange nodes in alphabetically sorted order
-    // (mutable because this isn't supposed to be visible from the outside)
+  // maps each key to an owned 'string*' holding its value
+  StringVoidDict dict;
 
-  // invariants:
-  //   list is well-formed structurally
+private:    // funcs
+  static void deleteValue(void *value);
 
 public:
   StringDict();          // initializes to empty dictionary
@@ -296,6 +296,10 @@ void test_strhash()
         cout << "hash function 2: word-rotate/final-mix" << endl;
         break;
 
+      case 3:
+        cout << "hash function 3: seeded 64-bit" << endl;
+        break;
+
       default:
         cout << "invalid hash function code!" << endl;
         break;
@@ -2,6 +2,7 @@
 // code for strhash.h
 
 #include "strhash.h"     // this module
+#include "string-hash.h" // smbase::stringHashSeededNulTerm
 #include "xassert.h"     // xassert
 
 #include <string.h>      // strcmp
@@ -98,11 +99,21 @@ STATICDEF unsigned StringHash::coreHash(char const *key)
 
   // pick a default STRHASH_ALG
   #ifndef STRHASH_ALG
-    #define STRHASH_ALG 1
+    #define STRHASH_ALG 3
   #endif // STRHASH_ALG
 
 
-  #if STRHASH_ALG == 1
+  #if STRHASH_ALG == 3
+  #ifdef SAY_STRHASH_ALG
+    #warning hash function 3: seeded 64-bit
+  #endif // SAY_STRHASH_ALG
+  // Word-at-a-time, and seeded with the process-wide seed; see
+  // string-hash.h.  HashTable scrambles the result again, so keeping
+  // only the low 32 bits is fine.
+  return (unsigned)smbase::stringHashSeededNulTerm(key);
+
+
+  #elif STRHASH_ALG == 1
   #ifdef SAY_STRHASH_ALG
     #warning hash function 1: Nelson
   #endif // SAY_STRHASH_ALG
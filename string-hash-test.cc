@@ -3,13 +3,43 @@
 
 #include "string-hash.h"               // module under test
 
+#include "nonport.h"                   // getMilliseconds
+#include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE, TABLESIZE
+#include "sm-random.h"                 // sm_random
 #include "sm-test.h"                   // VPVAL, EXPECT_EQ
+#include "xassert.h"                   // xassert
+
+#include <bitset>                      // std::bitset
+#include <cstdint>                     // std::uint64_t
+#include <cstdio>                      // std::printf
+#include <cstdlib>                     // std::{atoi, getenv}
+#include <set>                         // std::set
+#include <string>                      // std::string
+#include <vector>                      // std::vector
 
 using namespace smbase;
 
 
-// Called from unit-tests.cc.
-void test_string_hash()
+OPEN_ANONYMOUS_NAMESPACE
+
+
+std::string randomString(std::size_t len)
+{
+  std::string s(len, '\0');
+  for (char &c : s) {
+    c = (char)sm_random(256);
+  }
+  return s;
+}
+
+
+int popcount(std::uint64_t x)
+{
+  return (int)std::bitset<64>(x).count();
+}
+
+
+void testX31()
 {
   // I don't really have anything in mind to do with this besides
   // eyeballing the output.
@@ -19,6 +49,10 @@ void test_string_hash()
   VPVAL(stringHashNulTerm("abc"));
   VPVAL(stringHashNulTerm("abcdwioqdoqidwqdwiqdw"));
 
+  // This hash must not change since its values may be persisted.
+  EXPECT_EQ(stringHashNulTerm(""), 0u);
+  EXPECT_EQ(stringHashNulTerm("abc"), 96354u);
+
   // I suppose it's worth verifying that we get the same hash for two
   // strings at different locations.
   //
@@ -29,4 +63,139 @@ void test_string_hash()
 }
 
 
+void testHash64()
+{
+  // Test vectors from the wyhash distribution, which uses the index
+  // of each string as the seed.
+  struct Vector {
+    char const *m_str;
+    std::uint64_t m_hash;
+  } const vectors[] = {
+    { "", UINT64_C(0x93228a4de0eec5a2) },
+    { "a", UINT64_C(0xc5bac3db178713c4) },
+    { "abc", UINT64_C(0xa97f2f7b1d9b3314) },
+    { "message digest", UINT64_C(0x786d1f1df3801df4) },
+    { "abcdefghijklmnopqrstuvwxyz", UINT64_C(0xdca5a8138ad37c87) },
+    { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+      UINT64_C(0xb9e734f117cfaf70) },
+    { "1234567890123456789012345678901234567890"
+      "1234567890123456789012345678901234567890",
+      UINT64_C(0x6cc5eab49a92d617) },
+  };
+  for (std::size_t i=0; i < TABLESIZE(vectors); i++) {
+    std::string s(vectors[i].m_str);
+    EXPECT_EQ(stringHash64(s.data(), s.size(), i), vectors[i].m_hash);
+  }
+
+  // Independent of alignment.
+  std::string s = randomString(100);
+  for (std::size_t len=0; len <= 90; len++) {
+    std::string copy = " " + s.substr(0, len);
+    EXPECT_EQ(stringHash64(s.data(), len),
+              stringHash64(copy.data()+1, len));
+  }
+
+  // Every prefix of a string, at each length that exercises a
+  // different code path, hashes differently, with and without a seed.
+  std::set<std::uint64_t> seen;
+  for (std::size_t len=0; len <= s.size(); len++) {
+    xassert(seen.insert(stringHash64(s.data(), len)).second);
+    xassert(seen.insert(stringHash64(s.data(), len, 1)).second);
+  }
+
+  // Flipping any one input bit flips about half of the output bits.
+  for (std::size_t len : {1, 3, 4, 8, 15, 16, 17, 48, 49, 100}) {
+    std::string in = randomString(len);
+    std::uint64_t h = stringHash64(in.data(), len);
+    long total = 0;
+    for (std::size_t bit=0; bit < len*8; bit++) {
+      std::string flipped = in;
+      flipped[bit/8] ^= (char)(1 << (bit%8));
+      int changed = popcount(h ^ stringHash64(flipped.data(), len));
+      xassert(changed > 0);
+      total += changed;
+    }
+    double avg = (double)total / (len*8);
+    DIAG("len " << len << ": average bits changed: " << avg);
+    xassert(24 < avg && avg < 40);
+  }
+}
+
+
+void testSeed()
+{
+  std::uint64_t orig = getStringHashSeed();
+  EXPECT_EQ(orig, 0u);
+  EXPECT_EQ(stringHashSeeded("hello", 5), stringHash64("hello", 5));
+  EXPECT_EQ(stringHashSeededNulTerm("hello"), stringHash64("hello", 5));
+
+  setStringHashSeed(42);
+  EXPECT_EQ(stringHashSeeded("hello", 5), stringHash64("hello", 5, 42));
+  xassert(stringHashSeeded("hello", 5) != stringHash64("hello", 5));
+
+  std::uint64_t r = setRandomStringHashSeed();
+  EXPECT_EQ(getStringHashSeed(), r);
+
+  setStringHashSeed(orig);
+}
+
+
+// Compare the speed of the hashes over various key lengths, if
+// STRING_HASH_PERF is set to a number of megabytes to hash per length.
+void perfTest()
+{
+  char const *mbStr = std::getenv("STRING_HASH_PERF");
+  if (!mbStr) {
+    return;
+  }
+  std::size_t total = (std::size_t)std::atoi(mbStr) << 20;
+
+  std::printf("  len     x31 MB/s   hash64 MB/s\n");
+  for (std::size_t len : {4, 8, 16, 32, 64, 256, 4096}) {
+    // Many distinct keys, to defeat branch prediction on content.
+    std::vector<std::string> keys;
+    for (int i=0; i < 64; i++) {
+      keys.push_back(randomString(len));
+    }
+    std::size_t iters = total / len;
+
+    unsigned x31 = 0;
+    long start = getMilliseconds();
+    for (std::size_t i=0; i < iters; i++) {
+      std::string const &k = keys[i & 63];
+      x31 += stringHash(k.data(), len);
+    }
+    long x31Ms = getMilliseconds() - start;
+
+    std::uint64_t h64 = 0;
+    start = getMilliseconds();
+    for (std::size_t i=0; i < iters; i++) {
+      std::string const &k = keys[i & 63];
+      h64 += stringHash64(k.data(), len);
+    }
+    long h64Ms = getMilliseconds() - start;
+
+    double mb = (double)(iters * len) / (1 << 20);
+    std::printf("%5d  %11.0f  %12.0f   (%x %x)\n",
+      (int)len,
+      mb * 1000 / (x31Ms? x31Ms : 1),
+      mb * 1000 / (h64Ms? h64Ms : 1),
+      x31, (unsigned)h64);
+  }
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_string_hash()
+{
+  testX31();
+  testHash64();
+  testSeed();
+  perfTest();
+}
+
+
 // EOF
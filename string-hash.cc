@@ -11,9 +11,12 @@
 
 #include "string-hash.h"               // this module
 
-#include "sm-macros.h"                 // OPEN_NAMESPACE
+#include "double-width-type.h"         // DoubleWidthType, SMBASE_HAVE_UINT128
+#include "sm-macros.h"                 // OPEN_NAMESPACE, OPEN_ANONYMOUS_NAMESPACE
 
+#include <atomic>                      // std::atomic
 #include <cstring>                     // std::strlen
+#include <random>                      // std::random_device
 
 
 OPEN_NAMESPACE(smbase)
@@ -47,6 +50,176 @@ unsigned stringHashNulTerm(char const *cstr)
 }
 
 
+// ---------------------------- stringHash64 ---------------------------
+// This is wyhash (final version 4) by Wang Yi, which is in the public
+// domain, with the default secret.  Reads are explicitly little-endian
+// so the results are portable.
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Odd constants with well-mixed bits.
+std::uint64_t const secret[4] = {
+  0x2d358dccaa6c78a5ull,
+  0x8bb84b93962eacc9ull,
+  0x4b33a62ed433d4a3ull,
+  0x4d5a2da51de1aa47ull,
+};
+
+
+// Replace `a` and `b` with the low and high halves of their product.
+inline void mul128(std::uint64_t &a, std::uint64_t &b)
+{
+#if SMBASE_HAVE_UINT128
+  typedef DoubleWidthType<std::uint64_t>::DWT U128;
+  U128 r = (U128)a * b;
+  a = (std::uint64_t)r;
+  b = (std::uint64_t)(r >> 64);
+#else
+  std::uint64_t ha = a >> 32, la = (std::uint32_t)a;
+  std::uint64_t hb = b >> 32, lb = (std::uint32_t)b;
+  std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  std::uint64_t t = rl + (rm0 << 32);
+  std::uint64_t c = t < rl;
+  std::uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  a = lo;
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+
+// Multiply and fold the halves together.
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b)
+{
+  mul128(a, b);
+  return a ^ b;
+}
+
+
+inline std::uint64_t read8(unsigned char const *p)
+{
+  // GCC and Clang compile this to a single load on little-endian
+  // targets.
+  return  (std::uint64_t)p[0]        | ((std::uint64_t)p[1] << 8)  |
+         ((std::uint64_t)p[2] << 16) | ((std::uint64_t)p[3] << 24) |
+         ((std::uint64_t)p[4] << 32) | ((std::uint64_t)p[5] << 40) |
+         ((std::uint64_t)p[6] << 48) | ((std::uint64_t)p[7] << 56);
+}
+
+
+inline std::uint64_t read4(unsigned char const *p)
+{
+  return  (std::uint64_t)p[0]        | ((std::uint64_t)p[1] << 8)  |
+         ((std::uint64_t)p[2] << 16) | ((std::uint64_t)p[3] << 24);
+}
+
+
+// Combine the first, middle and last of `k` bytes, 1 <= k <= 3.
+inline std::uint64_t read3(unsigned char const *p, std::size_t k)
+{
+  return ((std::uint64_t)p[0] << 16) |
+         ((std::uint64_t)p[k >> 1] << 8) |
+         p[k - 1];
+}
+
+
+// Seed for `stringHashSeeded`.
+std::atomic<std::uint64_t> processSeed(0);
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+std::uint64_t stringHash64(char const *data, std::size_t size,
+                           std::uint64_t seed)
+{
+  unsigned char const *p =
+    reinterpret_cast<unsigned char const *>(data);
+  seed ^= mix(seed ^ secret[0], secret[1]);
+
+  std::uint64_t a, b;
+  if (size <= 16) {
+    if (size >= 4) {
+      // Two possibly overlapping 4-byte reads from each end.
+      std::size_t const off = (size >> 3) << 2;
+      a = (read4(p) << 32) | read4(p + off);
+      b = (read4(p + size - 4) << 32) | read4(p + size - 4 - off);
+    }
+    else if (size > 0) {
+      a = read3(p, size);
+      b = 0;
+    }
+    else {
+      a = b = 0;
+    }
+  }
+  else {
+    std::size_t i = size;
+    if (i > 48) {
+      // Three independent lanes, so the multiplies can overlap.
+      std::uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = mix(read8(p)      ^ secret[1], read8(p + 8)  ^ seed);
+        see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+        see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+
+    // The last 16 bytes, which may overlap bytes already consumed.
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= seed;
+  mul128(a, b);
+  return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+
+std::uint64_t stringHashSeeded(char const *data, std::size_t size)
+{
+  return stringHash64(data, size,
+                      processSeed.load(std::memory_order_relaxed));
+}
+
+
+std::uint64_t stringHashSeededNulTerm(char const *cstr)
+{
+  return stringHashSeeded(cstr, std::strlen(cstr));
+}
+
+
+std::uint64_t getStringHashSeed()
+{
+  return processSeed.load(std::memory_order_relaxed);
+}
+
+
+void setStringHashSeed(std::uint64_t seed)
+{
+  processSeed.store(seed, std::memory_order_relaxed);
+}
+
+
+std::uint64_t setRandomStringHashSeed()
+{
+  std::random_device rd;
+  std::uint64_t seed = ((std::uint64_t)rd() << 32) ^ rd();
+  setStringHashSeed(seed);
+  return seed;
+}
+
+
 CLOSE_NAMESPACE(smbase)
 
 
@@ -9,12 +9,17 @@
 #include "sm-macros.h"                 // OPEN_NAMESPACE
 
 #include <cstddef>                     // std::size_t
+#include <cstdint>                     // std::uint64_t
 
 
 OPEN_NAMESPACE(smbase)
 
 
 // Compute the hash of the `size` bytes at `data`.
+//
+// This is the classic "h*31 + c" hash.  It is slow and weak, but its
+// values never change, so it is suitable for hashes that are stored
+// persistently.  In-memory tables should use `stringHashSeeded`.
 unsigned stringHash(char const *data, std::size_t size);
 
 
@@ -22,6 +27,42 @@ unsigned stringHash(char const *data, std::size_t size);
 unsigned stringHashNulTerm(char const *cstr);
 
 
+// Compute a 64-bit hash of the `size` bytes at `data`, starting from
+// `seed`.
+//
+// This is wyhash (final version 4): input is consumed 16 bytes at a
+// time, each step being a 64x64->128 bit multiply whose halves are
+// folded together, so every output bit depends on every input bit.
+// The result depends only on the bytes, size and seed, not on the
+// platform's endianness or word size.
+std::uint64_t stringHash64(char const *data, std::size_t size,
+                           std::uint64_t seed = 0);
+
+
+// `stringHash64` using the process-wide seed.  Hash tables that live
+// only in memory should use this.
+std::uint64_t stringHashSeeded(char const *data, std::size_t size);
+
+
+// NUL-terminated variant.
+std::uint64_t stringHashSeededNulTerm(char const *cstr);
+
+
+// Get or set the seed used by `stringHashSeeded`.  It is initially 0,
+// making hash values, and hence table iteration orders, the same from
+// run to run.  Changing it while any table that uses it is populated
+// will corrupt that table, so it should be set early, before other
+// threads start.
+std::uint64_t getStringHashSeed();
+void setStringHashSeed(std::uint64_t seed);
+
+
+// Set the process-wide seed to a random value.  A program that hashes
+// untrusted input can call this at startup so that an adversary
+// cannot choose keys that all collide.  Returns the new seed.
+std::uint64_t setRandomStringHashSeed();
+
+
 CLOSE_NAMESPACE(smbase)
 
 
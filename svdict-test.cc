@@ -3,10 +3,15 @@
 
 #include "svdict.h"                    // module under test
 
+#include "array.h"                     // ArrayStack
+#include "nonport.h"                   // getMilliseconds
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
 #include "sm-stdint.h"                 // intptr_t
 
-#include <stdlib.h>                    // rand
+#include <stdio.h>                     // printf
+#include <stdlib.h>                    // rand, atoi, getenv
+
+#include <set>                         // std::set
 
 #define myrandom(n) (rand()%(n))
 
@@ -50,12 +55,107 @@ void *randVoidPtr()
   return (void*)(intptr_t)(myrandom(100) * 8);
 }
 
+
+// Interleave insertions, removals and ordered traversals, checking
+// that the traversal order is always reverse alphabetical.
+void testSortedOrder()
+{
+  StringVoidDict dict;
+  std::set<string> ref;
+
+  smbase_loopi(300) {
+    // a batch of insertions, some in order, some not
+    int n = myrandom(20);
+    bool ascending = myrandom(2);
+    smbase_loopj(n) {
+      string key = ascending?
+        string(stringb("k" << (char)('a' + i%26) << j)) :
+        randStringRandLen(6);
+      if (!dict.isMapped(key.c_str())) {
+        dict.add(key, NULL);
+        ref.insert(key);
+      }
+    }
+
+    // remove a few, which may be sorted or not
+    smbase_loopj(myrandom(5)) {
+      if (ref.empty()) {
+        break;
+      }
+      string key = *ref.begin();
+      if (myrandom(2)) {
+        key = dict.getIter().key();
+      }
+      dict.remove(key.c_str());
+      ref.erase(key);
+    }
+
+    // sometimes traverse
+    if (myrandom(3) == 0) {
+      std::set<string>::reverse_iterator expect = ref.rbegin();
+      for (StringVoidDict::IterC it(dict); !it.isDone(); it.next()) {
+        xassert(expect != ref.rend());
+        xassert(it.key() == *expect);
+        ++expect;
+      }
+      xassert(expect == ref.rend());
+    }
+  }
+}
+
+
+// Alternate bulk insertions with ordered traversals of a dictionary
+// that grows to SVDICT_PERF entries, reporting the time spent
+// traversing.
+void perfTest()
+{
+  char const *maxStr = getenv("SVDICT_PERF");
+  if (!maxStr) {
+    return;
+  }
+  int maxSize = atoi(maxStr);
+
+  printf("    size   add ms   iter ms\n");
+  StringVoidDict dict;
+  int batch = maxSize / 100;
+  int next = 0;
+  long addMs = 0, iterMs = 0;
+  while (next < maxSize) {
+    ArrayStack<string> keys;
+    smbase_loopi(batch) {
+      keys.push(stringb("key" << (next * 7919 % maxSize) << "/" << next));
+      next++;
+    }
+
+    long start = getMilliseconds();
+    for (int i=0; i < keys.length(); i++) {
+      dict.add(keys[i], NULL);
+    }
+    addMs += getMilliseconds() - start;
+
+    start = getMilliseconds();
+    int ct = 0;
+    for (StringVoidDict::IterC it(dict); !it.isDone(); it.next()) {
+      ct++;
+    }
+    iterMs += getMilliseconds() - start;
+    xassert(ct == next);
+
+    if (next % (maxSize/10) == 0) {
+      printf("%8d %8ld %9ld\n", next, addMs, iterMs);
+    }
+  }
+}
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
 // Called from unit-tests.cc.
 void test_svdict()
 {
+  testSortedOrder();
+  perfTest();
+
   StringVoidDict dict;
   int size=0, collisions=0;
 
@@ -7,6 +7,9 @@
 
 #include <string.h>                    // strcmp
 
+#include <algorithm>                   // std::sort
+#include <vector>                      // std::vector
+
 
 #define FOREACH_NODE(itervar) \
   for(Node *itervar = top; itervar != NULL; itervar = itervar->next)
@@ -28,12 +31,14 @@ STATICDEF char const *StringVoidDict::Node::getKey(StringVoidDict::Node const *n
 
 StringVoidDict::StringVoidDict()
   : top(NULL),
+    sortedTop(NULL),
     hash((StringHash::GetKeyFn)Node::getKey)
 {}
 
 
 StringVoidDict::StringVoidDict(StringVoidDict const &obj)
   : top(NULL),
+    sortedTop(NULL),
     hash((StringHash::GetKeyFn)Node::getKey)
 {
   *this = obj;
@@ -70,10 +75,12 @@ StringVoidDict& StringVoidDict::operator= (StringVoidDict const &obj)
     }
     else {
       // adding to end of nonempty list
+      newnode->prev = end;
       end = end->next = newnode;
     }
     hash.add(newnode->key.c_str(), newnode);
   }
+  sortedTop = top;         // since 'obj' was iterated in order
 
   SELFCHECK();
   return *this;
@@ -157,15 +164,30 @@ bool StringVoidDict::isMapped(char const *key) const
 }
 
 
+// The mutators do not call SELFCHECK, since it takes linear time.
+void StringVoidDict::addNode(Node *n)
+{
+  // Just prepend; we'll sort later (when an iterator is retrieved).
+  // The list stays sorted if keys are added in order.
+  bool inOrder = (top == sortedTop) &&
+                 (!top || nodeBefore(n, top));
+  n->next = top;
+  if (top) {
+    top->prev = n;
+  }
+  top = n;
+  if (inOrder) {
+    sortedTop = top;
+  }
+  hash.add(n->key.c_str(), n);
+}
+
+
 void StringVoidDict::add(char const *key, void *value)
 {
   xassert(!isMapped(key));
 
-  // just prepend; we'll sort later (when an iterator is retrieved)
-  top = new Node(key, value, top);
-  hash.add(key, top);
-
-  SELFCHECK();
+  addNode(new Node(key, value));
 }
 
 // Another version of add() which takes a 'string const &'.  If we are using a
@@ -176,11 +198,7 @@ void StringVoidDict::add(string const &key, void *value)
 {
   xassert(!isMapped(key.c_str()));
 
-  // just prepend; we'll sort later (when an iterator is retrieved)
-  top = new Node(key, value, top);
-  hash.add(key.c_str(), top);
-
-  SELFCHECK();
+  addNode(new Node(key, value));
 }
 
 
@@ -192,7 +210,6 @@ void *StringVoidDict::modify(char const *key, void *newValue)
   void *ret = entry.value();
   entry.value() = newValue;
 
-  SELFCHECK();
   return ret;
 }
 
@@ -206,39 +223,28 @@ StringVoidDict::Iter StringVoidDict::find(char const *key)
 
 void *StringVoidDict::remove(char const *key)
 {
-  void *ret;     // will be previous value
-  xassert(top);
-
-  // check for removal of top element
-  if (0==strcmp(top->key, key)) {
-    Node *temp = top;
-    top = top->next;
-    ret = temp->value;
-    hash.remove(temp->key.c_str());
-    delete temp;
+  Node *n = (Node*)hash.get(key);
+  if (!n) {
+    xfailure("failed to find key");
   }
+  hash.remove(n->key.c_str());
 
-  // find node to remove in tail of list
+  // unlink 'n'; removal does not disturb the order of the others
+  if (n == sortedTop) {
+    sortedTop = n->next;
+  }
+  if (n->prev) {
+    n->prev->next = n->next;
+  }
   else {
-    Node *p = top;
-    while (p->next && 0!=strcmp(p->next->key, key)) {
-      p = p->next;
-    }
-
-    if (!p->next) {
-      // reached the end of the list without finding the key
-      xfailure("failed to find key");
-    }
-
-    // remove p->next from the list
-    Node *temp = p->next;
-    p->next = p->next->next;
-    ret = temp->value;
-    hash.remove(temp->key.c_str());
-    delete temp;
+    top = n->next;
+  }
+  if (n->next) {
+    n->next->prev = n->prev;
   }
 
-  SELFCHECK();
+  void *ret = n->value;     // previous value
+  delete n;
   return ret;
 }
 
@@ -260,6 +266,7 @@ void StringVoidDict::emptyAndDel(DelFn func)
     // hash.remove(temp->key.c_str());
     delete temp;
   }
+  sortedTop = NULL;
   hash.empty();
 
   SELFCHECK();
@@ -293,51 +300,49 @@ void StringVoidDict::foreach(ForeachFn func, void *extra) const
 }
 
 
-// use simple insertion sort for now
-/*mutable*/ void StringVoidDict::sort()
+// Greater keys go first.
+STATICDEF bool StringVoidDict::nodeBefore(Node const *a, Node const *b)
 {
-  if (!top) {
-    return;
-  }
+  return strcmp(a->key, b->key) > 0;
+}
 
-  // invariant: sequence of nodes from 'top' to 'walker', inclusive,
-  //            is always sorted
-  Node *walker = top;
-  while (walker->next != NULL) {
-    // see if walker->next is out of order
-    if (0 <= strcmp(walker->key, walker->next->key)) {
-      // it's in order
-      walker = walker->next;
-      continue;
-    }
 
-    // remove walker->next from where it is (note that this has
-    // the effect of advancing walker, so below here we won't
-    // have another movement of walker)
-    Node *mover = walker->next;
-    walker->next = walker->next->next;
-    mover->next = NULL;       // (redundant because of (**) lines)
-
-    // insert at head?
-    if (0 < strcmp(mover->key, top->key)) {
-      mover->next = top;            // (**)
-      top = mover;
-      continue;
-    }
+/*mutable*/ void StringVoidDict::sort()
+{
+  if (top == sortedTop) {
+    return;          // nothing added since the last sort
+  }
 
-    // must find correct place to insert mover (will find the place
-    // where we can insert mover just before searcher->next)
-    Node *searcher = top;
-    while (0 < strcmp(searcher->next->key, mover->key)) {
-      searcher = searcher->next;
-      xassert(searcher != walker);
-        // otherwise how could mover have been out of order to begin with?
+  // sort the nodes added since then
+  std::vector<Node*> added;
+  for (Node *n = top; n != sortedTop; n = n->next) {
+    added.push_back(n);
+  }
+  std::sort(added.begin(), added.end(), nodeBefore);
+
+  // Merge them into the sorted part.  That part is only walked up to
+  // the position of the last added node.
+  Node *rest = sortedTop;
+  Node *prev = NULL;
+  Node **tail = &top;
+  for (Node *n : added) {
+    while (rest && nodeBefore(rest, n)) {
+      *tail = rest;
+      rest->prev = prev;
+      prev = rest;
+      tail = &(rest->next);
+      rest = rest->next;
     }
-
-    // insert mover before searcher->next
-    mover->next = searcher->next;   // (**)
-    searcher->next = mover;
+    *tail = n;
+    n->prev = prev;
+    prev = n;
+    tail = &(n->next);
+  }
+  *tail = rest;
+  if (rest) {
+    rest->prev = prev;
   }
+  sortedTop = top;
 
   SELFCHECK();
 
@@ -375,12 +380,22 @@ void StringVoidDict::selfCheck() const
     }
   }
 
-  // check counts, mappings
+  // check links, counts, mappings, and the order of the sorted part
   int ct=0;
-  for (Node *n = top; n != NULL; n = n->next, ct++) {
+  bool inSorted = false;
+  Node const *prev = NULL;
+  for (Node *n = top; n != NULL; prev = n, n = n->next, ct++) {
+    xassert(n->prev == prev);
     xassert(hash.get(n->key.c_str()) == n);
+    if (n == sortedTop) {
+      inSorted = true;
+    }
+    if (inSorted && n->next) {
+      xassert(nodeBefore(n, n->next));
+    }
   }
   xassert(hash.getNumEntries() == ct);
+  xassert(inSorted || sortedTop == NULL);
 }
 
 
@@ -2,8 +2,7 @@
 // StringVoidDict, a case-sensitive map from strings to void* pointers.
 // Built on top of StringHash.
 
-// created by modifying strdict; at some point strdict should
-// be rewritten to use this module
+// created by modifying strdict; StringDict is now built on this module
 
 #ifndef SMBASE_SVDICT_H
 #define SMBASE_SVDICT_H
@@ -24,17 +23,24 @@ private:    // types
   // 3/16/03: I believe the reason I stored the information both in a
   // hash table and in a linked list is to be able to support efficient
   // alphabetical iteration
+  //
+  // The list is kept as a sorted suffix, starting at 'sortedTop',
+  // preceded by the nodes added since the last sort.  Retrieving an
+  // iterator sorts just those and merges them into the suffix, so
+  // alternating insertions with ordered traversals costs amortized
+  // O(n) per traversal rather than a full sort.
   class Node {
   public:
     Node *next;
+    Node *prev;          // so removal need not search the list
     string key;
     void *value;
 
   public:
     Node(char const *k, void *v, Node *n = NULL)
-      : next(n), key(k), value(v) {}
+      : next(n), prev(NULL), key(k), value(v) {}
     Node(string const &k, void *v, Node *n = NULL)
-      : next(n), key(k), value(v) {}
+      : next(n), prev(NULL), key(k), value(v) {}
     ~Node() {}
 
     static char const *getKey(Node const *n);
@@ -95,12 +101,17 @@ private:    // data
   // first list node (possibly NULL)
   Node *top;
 
+  // first node of the sorted part of the list; equal to 'top' if the
+  // entire list is sorted, and NULL if no part of it is
+  Node *sortedTop;
+
   // hash table to improve lookup performance
   StringHash hash;
 
   // invariants:
-  //   list is well-formed structurally
+  //   list is well-formed structurally, and 'prev' is the inverse of 'next'
   //   every node is in the hash table, and vice versa
+  //   'sortedTop' is NULL or in the list, and the list from it is sorted
 
 protected:  // funcs
   void selfCheck() const;      // throw exception if invariants violated
@@ -110,6 +121,12 @@ protected:  // funcs
   void /*mutable*/ sort();     // arrange nodes in alphabetically sorted order
     // (mutable because this isn't supposed to be visible from the outside)
 
+  // true if 'a' belongs before 'b' in the sorted list
+  static bool nodeBefore(Node const *a, Node const *b);
+
+  // put 'n' at the front of the list and into the hash table
+  void addNode(Node *n);
+
 public:
   StringVoidDict();          // initializes to empty dictionary
   StringVoidDict(StringVoidDict const &obj);
@@ -0,0 +1,400 @@
+// swiss-vptrmap.cc
+// code for swiss-vptrmap.h
+
+#include "swiss-vptrmap.h"             // this module
+
+#include "pointer-util.h"              // pointerToInteger
+#include "xassert.h"                   // xassert, xfailure
+
+#include <stddef.h>                    // NULL
+#include <string.h>                    // memset
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SWISS_VPTRMAP_USE_SSE2 1
+#  include <emmintrin.h>               // _mm_*
+#else
+#  define SWISS_VPTRMAP_USE_SSE2 0
+#endif
+
+
+// ------------------ SwissVoidPtrMap -------------------
+int SwissVoidPtrMap::lookups = 0;
+int SwissVoidPtrMap::probes = 0;
+
+
+SwissVoidPtrMap::SwissVoidPtrMap()
+  : hashTable(NULL),
+    ctrl(NULL),
+    tableSize(0),
+    tableSizeBits(0),
+    numEntries(0),
+    numDeleted(0),
+    iterators(0)
+{
+  alloc(4);    // 16 entries initially
+}
+
+SwissVoidPtrMap::~SwissVoidPtrMap()
+{
+  delete[] hashTable;
+  delete[] ctrl;
+}
+
+
+void SwissVoidPtrMap::alloc(int bits)
+{
+  xassert(bits >= 4 && bits < 31);
+  tableSizeBits = bits;
+  tableSize = 1 << bits;
+  hashTable = new Entry[tableSize];
+  ctrl = new unsigned char[tableSize + GROUP_SIZE-1];
+  memset(ctrl, CTRL_EMPTY, tableSize + GROUP_SIZE-1);
+  numEntries = 0;
+  numDeleted = 0;
+}
+
+
+inline uint64_t SwissVoidPtrMap::hashKey(void const *key)
+{
+  // Multiply by 2^64 divided by the golden ratio (see Knuth, TAOCP
+  // vol. 3, section 6.4).  The high bits of the product depend on all
+  // of the lower bits of the key, which is where pointers differ, so
+  // only the high bits are used below.
+  return (uint64_t)pointerToInteger(key) * 0x9E3779B97F4A7C15ULL;
+}
+
+
+// 7 bits stored in the control byte of a full slot.
+static inline unsigned char hashTag(uint64_t h)
+{
+  return (unsigned char)(h >> 57);
+}
+
+
+inline uint32_t SwissVoidPtrMap::matchByte(int pos, unsigned char c) const
+{
+  unsigned char const *g = ctrl + pos;
+#if SWISS_VPTRMAP_USE_SSE2
+  __m128i bytes = _mm_loadu_si128((__m128i const*)g);
+  return (uint32_t)_mm_movemask_epi8(
+    _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)c)));
+#else
+  uint32_t mask = 0;
+  for (int i=0; i < GROUP_SIZE; i++) {
+    mask |= (uint32_t)(g[i] == c) << i;
+  }
+  return mask;
+#endif
+}
+
+
+inline uint32_t SwissVoidPtrMap::matchEmpty(int pos, bool orDeleted) const
+{
+  if (!orDeleted) {
+    return matchByte(pos, CTRL_EMPTY);
+  }
+
+  // Empty and deleted are the control bytes with the top bit set.
+  unsigned char const *g = ctrl + pos;
+#if SWISS_VPTRMAP_USE_SSE2
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)g));
+#else
+  uint32_t mask = 0;
+  for (int i=0; i < GROUP_SIZE; i++) {
+    mask |= (uint32_t)(g[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+
+inline void SwissVoidPtrMap::setCtrl(int i, unsigned char c)
+{
+  ctrl[i] = c;
+  if (i < GROUP_SIZE-1) {
+    ctrl[tableSize + i] = c;
+  }
+}
+
+
+// Index of the lowest set bit in 'mask', which is not 0.
+static inline int lowestBit(uint32_t mask)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  int i = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+
+// Number of zero bits above the highest set bit of the 16-bit 'mask',
+// which is not 0.
+static inline int leadingZeros16(uint32_t mask)
+{
+#if defined(__GNUC__)
+  return __builtin_clz(mask << 16);
+#else
+  int n = 0;
+  while (!(mask & 0x8000)) {
+    mask <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+
+// Home slot for a key whose hash is 'h'.
+static inline int homeSlot(uint64_t h, int tableSizeBits)
+{
+  // Use the bits just below those of the tag.
+  return (int)((h << 7) >> (64 - tableSizeBits));
+}
+
+
+int SwissVoidPtrMap::findIndex(void const *key) const
+{
+  xassert(key != NULL);
+  lookups++;
+
+  uint64_t h = hashKey(key);
+  unsigned char tag = hashTag(h);
+  int mask = tableSize - 1;
+  int pos = homeSlot(h, tableSizeBits);
+
+#if defined(__GNUC__)
+  // Start fetching the likely entry while the control bytes arrive.
+  __builtin_prefetch(&hashTable[pos]);
+#endif
+
+  // There is always an empty slot somewhere, so this terminates.
+  for (int stride = GROUP_SIZE; ; stride += GROUP_SIZE) {
+    probes++;
+
+    for (uint32_t m = matchByte(pos, tag); m; m &= m-1) {
+      int i = (pos + lowestBit(m)) & mask;
+      if (hashTable[i].key == key) {
+        return i;
+      }
+    }
+
+    if (matchEmpty(pos, false /*orDeleted*/)) {
+      return -1;
+    }
+
+    pos = (pos + stride) & mask;
+  }
+}
+
+
+int SwissVoidPtrMap::findInsertSlot(uint64_t h) const
+{
+  int mask = tableSize - 1;
+  int pos = homeSlot(h, tableSizeBits);
+
+  for (int stride = GROUP_SIZE; ; stride += GROUP_SIZE) {
+    uint32_t m = matchEmpty(pos, true /*orDeleted*/);
+    if (m) {
+      return (pos + lowestBit(m)) & mask;
+    }
+    pos = (pos + stride) & mask;
+  }
+}
+
+
+bool SwissVoidPtrMap::wasNeverFull(int i) const
+{
+  // Look at the windows ending just before and starting at 'i'.  If
+  // the run of non-empty slots around 'i' is shorter than a window,
+  // then no window containing 'i' was ever entirely non-empty, so no
+  // probe sequence has passed over 'i' (it would have stopped at the
+  // empty slot), and 'i' can become empty.
+  uint32_t before = matchEmpty((i - GROUP_SIZE) & (tableSize-1), false);
+  uint32_t after = matchEmpty(i, false);
+  if (!before || !after) {
+    return false;
+  }
+
+  // Number of non-empty slots just before 'i', and at and after 'i'.
+  int leading = leadingZeros16(before);
+  int trailing = lowestBit(after);
+  return leading + trailing < GROUP_SIZE;
+}
+
+
+void *SwissVoidPtrMap::get(void const *key) const
+{
+  int i = findIndex(key);
+  return i < 0? NULL : hashTable[i].value;
+}
+
+
+void SwissVoidPtrMap::add(void *key, void *value)
+{
+  xassert(iterators == 0);
+
+  int i = findIndex(key);
+  if (i >= 0) {
+    hashTable[i].value = value;     // update existing mapping
+    return;
+  }
+
+  // Keep at least 1/8 of the slots empty so lookups terminate quickly.
+  // If that would be violated, grow, unless there are enough deleted
+  // slots that just rebuilding at the same size suffices.
+  if (numEntries + numDeleted + 1 > maxLoad()) {
+    rehash(numEntries+1 > maxLoad()/2? tableSizeBits+1 : tableSizeBits);
+  }
+
+  uint64_t h = hashKey(key);
+  i = findInsertSlot(h);
+  if (ctrl[i] == CTRL_DELETED) {
+    numDeleted--;
+  }
+  setCtrl(i, hashTag(h));
+  hashTable[i].key = key;
+  hashTable[i].value = value;
+  numEntries++;
+}
+
+
+void *SwissVoidPtrMap::remove(void const *key)
+{
+  xassert(iterators == 0);
+
+  int i = findIndex(key);
+  if (i < 0) {
+    return NULL;
+  }
+  void *ret = hashTable[i].value;
+
+  // Unless it is safe to empty the slot, leave a marker so that
+  // lookups continue past it.
+  if (wasNeverFull(i)) {
+    setCtrl(i, CTRL_EMPTY);
+  }
+  else {
+    setCtrl(i, CTRL_DELETED);
+    numDeleted++;
+  }
+  numEntries--;
+  return ret;
+}
+
+
+void SwissVoidPtrMap::rehash(int bits)
+{
+  Entry *oldHashTable = hashTable;
+  unsigned char *oldCtrl = ctrl;
+  int oldTableSize = tableSize;
+
+  alloc(bits);
+
+  // re-insert all of the old elements; they are all distinct
+  for (int i=0; i < oldTableSize; i++) {
+    if (!(oldCtrl[i] & 0x80)) {
+      Entry &e = oldHashTable[i];
+      uint64_t h = hashKey(e.key);
+      int j = findInsertSlot(h);
+      setCtrl(j, hashTag(h));
+      hashTable[j] = e;
+      numEntries++;
+    }
+  }
+
+  delete[] oldHashTable;
+  delete[] oldCtrl;
+}
+
+
+void SwissVoidPtrMap::reserve(int n)
+{
+  xassert(iterators == 0);
+
+  int bits = tableSizeBits;
+  while (n > (1 << bits) - (1 << bits)/8) {
+    bits++;
+  }
+  if (bits > tableSizeBits) {
+    rehash(bits);
+  }
+}
+
+
+void SwissVoidPtrMap::empty()
+{
+  xassert(iterators == 0);
+
+  memset(ctrl, CTRL_EMPTY, tableSize + GROUP_SIZE-1);
+  numEntries = 0;
+  numDeleted = 0;
+}
+
+
+void SwissVoidPtrMap::selfCheck() const
+{
+  xassert(tableSize == (1 << tableSizeBits));
+  xassert(numEntries + numDeleted <= maxLoad());
+
+  int full = 0;
+  int deleted = 0;
+  for (int i=0; i < tableSize; i++) {
+    if (ctrl[i] & 0x80) {
+      if (ctrl[i] == CTRL_DELETED) {
+        deleted++;
+      }
+      else {
+        xassert(ctrl[i] == CTRL_EMPTY);
+      }
+      continue;
+    }
+
+    full++;
+    void const *key = hashTable[i].key;
+    xassert(key != NULL);
+    xassert(ctrl[i] == hashTag(hashKey(key)));
+    xassert(findIndex(key) == i);
+  }
+  xassert(full == numEntries);
+  xassert(deleted == numDeleted);
+
+  for (int i=0; i < GROUP_SIZE-1; i++) {
+    xassert(ctrl[tableSize + i] == ctrl[i]);
+  }
+}
+
+
+// ------------------- SwissVoidPtrMap::Iter ------------------
+SwissVoidPtrMap::Iter::Iter(SwissVoidPtrMap const &m)
+  : map(m),
+    index(map.tableSize)
+{
+  map.iterators++;
+  adv();
+}
+
+SwissVoidPtrMap::Iter::~Iter()
+{
+  map.iterators--;
+}
+
+
+void SwissVoidPtrMap::Iter::adv()
+{
+  xassert(index >= 0);
+  index--;
+  while (index >= 0 &&
+         (map.ctrl[index] & 0x80)) {
+    index--;
+  }
+}
+
+
+// EOF
@@ -0,0 +1,191 @@
+// swiss-vptrmap.h
+// SwissVoidPtrMap, a VoidPtrMap variant that supports removal.
+
+// SwissVoidPtrMap has the interface of VoidPtrMap, plus 'remove' and
+// 'reserve'.  PtrMap, PtrSet and ObjMap use it when it is given as
+// their last template argument, for example:
+//
+//   typedef PtrMap<Node, Info, SwissVoidPtrMap> NodeInfoMap;
+//
+// Design considerations:
+//
+// Keys are pointers to objects.  They are likely to have the same
+// high bits (page) and low bits (alignment), and thus be
+// distinguished primarily by the bits in the middle.  No key is NULL.
+//
+// No adversary is present; hash function is fixed in advance.
+//
+// The table is organized like the "Swiss tables" of Abseil: besides
+// the array of entries, there is one control byte per slot, which
+// says whether the slot is empty, deleted, or full, and in the last
+// case holds 7 bits of the key's hash.  A lookup examines the 16
+// control bytes starting at the key's home slot at once (with SSE2
+// where available), only looking at the entries whose hash bits
+// match.  Further windows of 16 are probed at triangular multiples of
+// 16 slots, which covers every slot since the table size is a power
+// of 2.  While the control bytes are examined, the entry at the home
+// slot is prefetched, since that is usually where the key is.
+//
+// Deleted slots become empty when no probe window through them was
+// ever full, and otherwise are marked deleted; the table is rebuilt
+// when deleted slots use up the spare capacity.
+//
+// Lookups are faster than VoidPtrMap's while the table fits in cache.
+// Once it does not, the access to the control bytes is an extra cache
+// miss, so for large tables VoidPtrMap is faster.
+
+
+#ifndef SMBASE_SWISS_VPTRMAP_H
+#define SMBASE_SWISS_VPTRMAP_H
+
+#include <stdint.h>                    // uint32_t, uint64_t
+
+
+class SwissVoidPtrMap {
+private:     // types
+  // single entry in the hash table
+  struct Entry {
+    void *key;               // meaningful only if the slot is full
+    void *value;
+  };
+
+  // Control byte values.  Full slots have the top bit clear.
+  enum {
+    CTRL_EMPTY   = 0x80,
+    CTRL_DELETED = 0xFE,
+  };
+
+  // Number of slots in a group.
+  enum { GROUP_SIZE = 16 };
+
+private:     // data
+  // hash table entries; 'tableSize' of them
+  Entry *hashTable;
+
+  // control bytes, one per entry, followed by copies of the first
+  // GROUP_SIZE-1 of them so that a window can start at any slot
+  unsigned char *ctrl;
+
+  // number of (allocated) slots in the hash table; this is always a
+  // power of 2, and at least GROUP_SIZE
+  int tableSize;
+
+  // tableSize always equals 1 << tableSizeBits
+  int tableSizeBits;
+
+  // number of mappings, i.e., full slots
+  int numEntries;
+
+  // number of deleted slots
+  int numDeleted;
+
+  // number of outstanding iterators; used to check that we don't
+  // modify the table while one is active (experimental)
+  mutable int iterators;
+
+public:      // data
+  // total # of lookups
+  static int lookups;
+
+  // total # of groups examined during lookups; perfect hashing
+  // would yield lookups==probes
+  static int probes;
+
+private:     // funcs
+  // 'bits' becomes tableSizeBits; also set hashTable, ctrl and
+  // tableSize, and mark all slots empty
+  void alloc(int bits);
+
+  // 64-bit hash of 'key'
+  static inline uint64_t hashKey(void const *key);
+
+  // bit mask of the GROUP_SIZE slots starting at 'pos' whose control
+  // byte equals 'c'
+  inline uint32_t matchByte(int pos, unsigned char c) const;
+
+  // bit mask of the GROUP_SIZE slots starting at 'pos' that are empty,
+  // or (if 'orDeleted') deleted
+  inline uint32_t matchEmpty(int pos, bool orDeleted) const;
+
+  // set the control byte for slot 'i', and its copy if any
+  inline void setCtrl(int i, unsigned char c);
+
+  // return the index of the slot holding 'key', or -1
+  int findIndex(void const *key) const;
+
+  // return the index of the first empty or deleted slot in the probe
+  // sequence for a key whose hash is 'h'
+  int findInsertSlot(uint64_t h) const;
+
+  // true if no probe window has been entirely non-empty while
+  // including slot 'i', so it can become empty rather than deleted
+  bool wasNeverFull(int i) const;
+
+  // rebuild the table with 1 << 'bits' slots, dropping deleted slots
+  void rehash(int bits);
+
+  // number of entries the table can hold before rehashing
+  int maxLoad() const { return tableSize - tableSize/8; }
+
+  // disallowed
+  SwissVoidPtrMap(SwissVoidPtrMap &obj);
+  void operator=(SwissVoidPtrMap &obj);
+  void operator==(SwissVoidPtrMap &obj);
+
+public:      // funcs
+  SwissVoidPtrMap();              // empty map
+  ~SwissVoidPtrMap();
+
+  // return # of mapped entries
+  int getNumEntries() const { return numEntries; }
+
+  // if this key has a mapping, return it; otherwise, return NULL
+  void *get(void const *key) const;
+
+  // add a mapping from 'key' to 'value'; replaces existing
+  // mapping, if any
+  void add(void *key, void *value);
+
+  // remove the mapping for 'key', returning its value, or NULL if
+  // there was none
+  void *remove(void const *key);
+
+  // make room for 'n' mappings without further allocation
+  void reserve(int n);
+
+  // remove all mappings; this keeps the allocated size
+  void empty();
+
+  // number of slots, for testing
+  int getTableSize() const { return tableSize; }
+
+  // check invariants, throwing an exception if one is violated
+  void selfCheck() const;
+
+
+public:      // iterators
+  // iterate over all stored values in a SwissVoidPtrMap
+  // NOTE: you can't change the table while an iter exists
+  class Iter {
+  private:      // data
+    SwissVoidPtrMap const &map;       // table we're iterating over
+    int index;                   // current slot to return in adv(); -1 when done
+
+  public:       // funcs
+    Iter(SwissVoidPtrMap const &map);
+    ~Iter();
+
+    bool isDone() const { return index < 0; }
+    void adv();            // must not be isDone()
+
+    // return information about the currently-referenced table entry
+    void *key() const      // key (never NULL)
+      { return map.hashTable[index].key; }
+    void *value() const    // associated value
+      { return map.hashTable[index].value; }
+  };
+  friend class Iter;
+};
+
+
+#endif // SMBASE_SWISS_VPTRMAP_H
@@ -1,10 +1,12 @@
 // thashtbl.h            see license.txt for copyright and terms of use
-// Template class built on top of HashTable.  Maps KEY* to VALUE*.
+// Template class built on top of FlatHashMap.  Maps KEY* to VALUE*.
 
 #ifndef SMBASE_THASHTBL_H
 #define SMBASE_THASHTBL_H
 
-#include "hashtbl.h"     // HashTable, HashTableIter
+#include "flat-hash-map-ops.h"   // smbase::FlatHashMap, FunctionPointerHash, FunctionPointerEqual
+#include "hashtbl.h"             // HashTable::defaultSize
+#include "xassert.h"             // xassert
 
 template <class KEY, class DATA> class THashTableIter;
 
@@ -25,9 +27,19 @@ public:     // types
   // in the hash function; return true if they are equal
   typedef bool (*EqualKeyFn)(KEY const *key1, KEY const *key2);
 
+private:    // types
+  // The keys stored in the map are those obtained from the data, so
+  // they live as long as the data does.
+  typedef smbase::FlatHashMap<KEY const*, DATA*,
+                              smbase::FunctionPointerHash<KEY>,
+                              smbase::FunctionPointerEqual<KEY> > Map;
+
 private:    // data
+  // map from key to the data it was obtained from
+  GetKeyFn getKeyFn;
+
   // underlying table
-  HashTable table;
+  Map map;
 
 private:    // funcs
   // disallowed
@@ -36,43 +48,61 @@ private:    // funcs
   void operator==(THashTable&);
 
 public:     // funcs
+  // 'initSize' is accepted for compatibility with HashTable; the
+  // underlying map allocates on first insertion and grows as needed
   THashTable(GetKeyFn gk, HashFn hf, EqualKeyFn ek,
              int initSize = HashTable::defaultSize)
-    : table((HashTable::GetKeyFn)gk,
-            (HashTable::HashFn)hf,
-            (HashTable::EqualKeyFn)ek,
-            initSize)
-  {}
+    : getKeyFn(gk),
+      map(smbase::FunctionPointerHash<KEY>(hf),
+          smbase::FunctionPointerEqual<KEY>(ek))
+  { (void)initSize; }
   ~THashTable() {}
 
   // return # of mapped entries
-  int getNumEntries() const                 { return table.getNumEntries(); }
+  int getNumEntries() const                 { return (int)map.size(); }
 
   // if this hash value has a mapping, return it; otherwise,
   // return NULL
-  DATA *get(KEY const *key) const           { return (DATA*)table.get(key); }
+  DATA *get(KEY const *key) const
+  {
+    DATA * const *d = map.getOrNull(key);
+    return d? *d : NULL;
+  }
 
   // add a mapping from 'key' to 'value'; there must not already
   // be a mapping for this key
-  void add(KEY const *key, DATA *value)     { table.add(key, value); }
+  void add(KEY const *key, DATA *value)
+  {
+    xassert(value != NULL);
+    (void)key;      // same as getKeyFn(value)
+    bool inserted = map.insert(std::make_pair(getKeyFn(value), value)).second;
+    xassert(inserted);
+  }
 
   // remove the mapping for 'key' -- it must exist;
   // returns the removed item
-  DATA *remove(KEY const *key)              { return (DATA*)table.remove(key); }
+  DATA *remove(KEY const *key)
+  {
+    DATA *ret = get(key);
+    xassert(ret);
+    map.erase(key);
+    return ret;
+  }
 
   // remove all mappings
-  void empty(int initSize = HashTable::defaultSize)   { table.empty(initSize); }
+  void empty(int initSize = HashTable::defaultSize)
+    { (void)initSize; map.clearAndShrink(); }
 
-  // set whether shrinkage is allowed; it's useful to be able to
-  // disable this to avoid any allocation in certain situations
-  void setEnableShrink(bool en)             { table.setEnableShrink(en); }
+  // set whether shrinkage is allowed; the underlying map never
+  // shrinks except in 'empty', so this has no effect
+  void setEnableShrink(bool en)             { (void)en; }
 
   // allow external access to an accessor function
-  KEY const *callGetKeyFn(DATA *data)       { return (KEY const*)table.getKey(data); }
+  KEY const *callGetKeyFn(DATA *data)       { return getKeyFn(data); }
 
   // check the data structure's invariants, and throw an exception
   // if there is a problem
-  void selfCheck() const                    { table.selfCheck(); }
+  void selfCheck() const                    { map.selfCheck(); }
 };
 
 
@@ -81,14 +111,16 @@ public:     // funcs
 template <class KEY, class DATA>
 class THashTableIter {
 private:      // data
-  HashTableIter iter;            // underlying iter
+  // underlying iterator and its end
+  typename THashTable<KEY,DATA>::Map::iterator iter, end;
 
 public:       // funcs
-  THashTableIter(THashTable<KEY,DATA> &table) : iter(table.table) {}
+  THashTableIter(THashTable<KEY,DATA> &table)
+    : iter(table.map.begin()), end(table.map.end()) {}
 
-  bool isDone() const          { return iter.isDone(); }
-  void adv()                   { return iter.adv(); }
-  DATA *data() const           { return (DATA*)iter.data(); }
+  bool isDone() const          { return iter == end; }
+  void adv()                   { ++iter; }
+  DATA *data() const           { return iter->second; }
 };
 
 
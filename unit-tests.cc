@@ -87,13 +87,17 @@ static void entry(int argc, char **argv)
   RUN_TEST(autofile);
   RUN_TEST(bdffont);
   RUN_TEST(bflatten);
+  RUN_TEST(binary_lookup);
   RUN_TEST(bit2d);
   RUN_TEST(bitarray);
   RUN_TEST(boxprint);
   RUN_TEST(c_string_reader);
   RUN_TEST(codepoint);
+  RUN_TEST(compressed_bitmap);
+  RUN_TEST(concurrent_object_pool);
   RUN_TEST(counting_ostream);
   RUN_TEST(crc);
+  RUN_TEST(crc_file);
   RUN_TEST_NO_DECL(cycles);
   RUN_TEST_NO_DECL(d2vector);
   RUN_TEST(datablok);
@@ -102,6 +106,7 @@ static void entry(int argc, char **argv)
   RUN_TEST(distinct_number);
   RUN_TEST(dni_vector);
   RUN_TEST(exc);
+  RUN_TEST(flat_hash_map);
   RUN_TEST(functional_set);
   RUN_TEST(gcc_options);
   RUN_TEST(gdvalue);
@@ -111,6 +116,7 @@ static void entry(int argc, char **argv)
   RUN_TEST_NO_DECL(gprintf);
   RUN_TEST(growbuf);
   RUN_TEST(hashline);
+  RUN_TEST(hashtbl);
   RUN_TEST(indexed_string_table);
   RUN_TEST(map_util);
   RUN_TEST_NO_DECL(mypopen);
@@ -125,8 +131,10 @@ static void entry(int argc, char **argv)
   RUN_TEST(parsestring);
   RUN_TEST(pprint);
   RUN_TEST(rack_allocator);
+  RUN_TEST(rack_memory_resource);
   RUN_TEST(reader);
   RUN_TEST(refct_serf);
+  RUN_TEST(ring_buffer);
   RUN_TEST(run_process);
   RUN_TEST(save_restore);
   RUN_TEST(set_util);
@@ -165,6 +173,7 @@ static void entry(int argc, char **argv)
   RUN_TEST(temporary_file);
   RUN_TEST(trdelete);
   RUN_TEST(tree_print);
+  RUN_TEST(unrolled_voidlist);
   RUN_TEST(utf8);
   RUN_TEST(vdtllist);
   RUN_TEST(vector_push_pop);
@@ -0,0 +1,353 @@
+// unrolled-voidlist-test.cc
+// Tests for `unrolled-voidlist` module.
+
+// This file is in the public domain.
+
+// The VoidList interface itself is tested against both backings by
+// voidlist-test.cc.  This file checks that UnrolledVoidList behaves
+// exactly like VoidList across chunk boundaries.
+
+#include "smbase/unrolled-voidlist.h"  // module under test
+
+#include "smbase/nonport.h"            // getMilliseconds
+#include "smbase/sm-macros.h"          // OPEN_ANONYMOUS_NAMESPACE, smbase_loopi
+#include "smbase/sm-random.h"          // sm_random
+#include "smbase/sm-stdint.h"          // intptr_t
+#include "smbase/sm-test.h"            // DIAG, EXPECT_EQ
+#include "smbase/voidlist.h"           // VoidList
+#include "smbase/xassert.h"            // xassert
+
+#include <cstdlib>                     // std::{getenv, atoi}
+#include <iostream>                    // std::cout
+
+using namespace smbase;
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+typedef UnrolledVoidList UList;
+
+
+void *item(int n)
+{
+  return (void*)(intptr_t)(n * 4);
+}
+
+
+// Order by value divided by 64, so there are many ties, which exposes
+// any difference in how the two lists order equivalent elements.
+int coarseDiff(void *left, void *right, void *)
+{
+  return (int)((intptr_t)left / 64 - (intptr_t)right / 64);
+}
+
+
+// Check that `u` and `v` hold the same sequence.
+void checkSame(UList const &u, VoidList const &v)
+{
+  u.selfCheck();
+  EXPECT_EQ(u.count(), v.count());
+
+  UList::Iter ui(u);
+  VoidListIter vi(v);
+  for (; !vi.isDone(); ui.adv(), vi.adv()) {
+    xassert(!ui.isDone());
+    xassert(ui.data() == vi.data());
+  }
+  xassert(ui.isDone());
+
+  if (v.isNotEmpty()) {
+    xassert(u.last() == v.last());
+    int pos = sm_random(v.count() + 1);
+    UList::Iter up(u, pos);
+    VoidListIter vp(v, pos);
+    xassert(up.isDone() == vp.isDone());
+    if (!vp.isDone()) {
+      xassert(up.data() == vp.data());
+      xassert(u.nth(pos) == v.nth(pos));
+    }
+  }
+}
+
+
+// Walk both lists with mutators, making the same random changes.
+void randomMutation(UList &u, VoidList &v, int &next)
+{
+  UList::Mutator um(u);
+  VoidListMutator vm(v);
+  while (!vm.isDone()) {
+    xassert(!um.isDone());
+    xassert(um.data() == vm.data());
+
+    switch (sm_random(8)) {
+      case 0:
+        um.insertBefore(item(next));
+        vm.insertBefore(item(next));
+        next++;
+        break;
+
+      case 1:
+        um.insertAfter(item(next));
+        vm.insertAfter(item(next));
+        next++;
+        break;
+
+      case 2:
+      case 3:
+        xassert(um.remove() == vm.remove());
+        continue;
+
+      default:
+        break;
+    }
+
+    um.selfCheck();
+    um.adv();
+    vm.adv();
+  }
+  xassert(um.isDone());
+
+  if (sm_random(2)) {
+    um.append(item(next));
+    vm.append(item(next));
+    next++;
+  }
+}
+
+
+// Apply the same random operations to both kinds of list.
+void testAgainstVoidList()
+{
+  DIAG("---- testAgainstVoidList ----");
+
+  UList u, u2;
+  VoidList v, v2;
+  int next = 0;
+
+  smbase_loopi(3000) {
+    // Keep the lists from growing without bound.
+    int op = sm_random(v.count() > 300? 10 : 16);
+    int n = v.count();
+
+    switch (op) {
+      case 0:
+        // Remove from random positions.
+        for (int k = sm_random(40); k > 0 && v.isNotEmpty(); k--) {
+          int index = sm_random(v.count());
+          xassert(u.removeAt(index) == v.removeAt(index));
+        }
+        break;
+
+      case 1: {
+        void *x = item(sm_random(next+1));
+        xassert(u.removeIfPresent(x) == v.removeIfPresent(x));
+        xassert(u.indexOf(x) == v.indexOf(x));
+        break;
+      }
+
+      case 2:
+        randomMutation(u, v, next);
+        break;
+
+      case 3:
+        u.reverse();
+        v.reverse();
+        break;
+
+      case 4:
+        u.mergeSort(coarseDiff);
+        v.mergeSort(coarseDiff);
+        xassert(u.isSorted(coarseDiff));
+        break;
+
+      case 5:
+        if (n < 200) {
+          u.insertionSort(coarseDiff);
+          v.insertionSort(coarseDiff);
+        }
+        break;
+
+      case 6: {
+        // Move a tail to the other list and back.
+        int index = sm_random(n+1);
+        u2.stealTailAt(index, u);
+        v2.stealTailAt(index, v);
+        checkSame(u, v);
+        checkSame(u2, v2);
+        if (sm_random(2)) {
+          u.concat(u2);
+          v.concat(v2);
+        }
+        else {
+          u2.prependAll(u);
+          v2.prependAll(v);
+          u.removeAll();
+          v.removeAll();
+          u.concat(u2);
+          v.concat(v2);
+        }
+        checkSame(u2, v2);
+        break;
+      }
+
+      case 7:
+        u.removeDuplicatesAsMultiset(coarseDiff);
+        v.removeDuplicatesAsMultiset(coarseDiff);
+        break;
+
+      case 8:
+      case 9: {
+        void *x = item(sm_random(next+1));
+        xassert(u.appendUnique(x) == v.appendUnique(x));
+        break;
+      }
+
+      default:
+        // Insert in various ways.
+        for (int k = sm_random(60); k > 0; k--) {
+          void *x = item(next++);
+          switch (sm_random(4)) {
+            case 0:
+              u.prepend(x);
+              v.prepend(x);
+              break;
+
+            case 1:
+              u.append(x);
+              v.append(x);
+              break;
+
+            case 2: {
+              int index = sm_random(v.count()+1);
+              u.insertAt(x, index);
+              v.insertAt(x, index);
+              break;
+            }
+
+            case 3:
+              u.insertSorted(x, coarseDiff);
+              v.insertSorted(x, coarseDiff);
+              break;
+          }
+        }
+        break;
+    }
+
+    checkSame(u, v);
+  }
+
+  // Copies.
+  UList copy(u);
+  checkSame(copy, v);
+  xassert(copy.equalAsPointerLists(u));
+  copy = u2;
+  checkSame(copy, v2);
+}
+
+
+// Chunks fill before a new one is added, and removals merge them.
+void testChunks()
+{
+  DIAG("---- testChunks ----");
+
+  int const cap = UList::CHUNK_CAPACITY;
+
+  UList u;
+  EXPECT_EQ(u.numChunks(), 0);
+  for (int i=0; i < cap*10; i++) {
+    u.append(item(i));
+  }
+  EXPECT_EQ(u.numChunks(), 10);
+  EXPECT_EQ(u.count(), cap*10);
+  EXPECT_EQ(u.last(), item(cap*10 - 1));
+
+  // Inserting into a full chunk splits it.
+  u.insertAt(item(-1), 5);
+  EXPECT_EQ(u.numChunks(), 11);
+  xassert(u.nth(5) == item(-1));
+  xassert(u.nth(6) == item(5));
+  u.selfCheck();
+
+  // Removing most of the elements merges chunks.
+  for (int i=0; i < cap*10; i += 2) {
+    u.removeItem(item(i));
+  }
+  u.selfCheck();
+  EXPECT_EQ(u.count(), cap*5 + 1);
+  xassert(u.numChunks() <= 10);
+
+  // Emptying the list leaves no chunks.
+  while (u.isNotEmpty()) {
+    u.removeAt(u.count() - 1);
+  }
+  u.selfCheck();
+  EXPECT_EQ(u.numChunks(), 0);
+}
+
+
+// Time common operations on both kinds of list.
+// UNROLLED_VOIDLIST_PERF is the number of elements.
+template <class List>
+void timeList(char const *label, int n)
+{
+  long start = getMilliseconds();
+
+  List list;
+  for (int i=0; i < n; i++) {
+    list.prepend(item(i));
+  }
+  long built = getMilliseconds();
+
+  intptr_t sum = 0;
+  smbase_loopi(100) {
+    for (typename List::Iter iter(list); !iter.isDone(); iter.adv()) {
+      sum += (intptr_t)iter.data();
+    }
+  }
+  long traversed = getMilliseconds();
+
+  long counted = 0;
+  smbase_loopi(100) {
+    counted += list.count();
+  }
+  long countTime = getMilliseconds();
+
+  list.mergeSort(VoidList::pointerAddressDiff);
+  long sorted = getMilliseconds();
+
+  std::cout << label
+            << ": build " << (built - start)
+            << " ms, 100 traversals " << (traversed - built)
+            << " ms, 100 counts " << (countTime - traversed)
+            << " ms, mergeSort " << (sorted - countTime)
+            << " ms (checksum " << (sum + counted) % 1000 << ")\n";
+}
+
+
+void perfTest()
+{
+  char const *nStr = std::getenv("UNROLLED_VOIDLIST_PERF");
+  if (!nStr) {
+    return;
+  }
+  int n = std::atoi(nStr);
+
+  timeList<VoidList>("VoidList        ", n);
+  timeList<UList>("UnrolledVoidList", n);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// Called from unit-tests.cc.
+void test_unrolled_voidlist()
+{
+  testAgainstVoidList();
+  testChunks();
+  perfTest();
+}
+
+
+// EOF
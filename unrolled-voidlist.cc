@@ -0,0 +1,798 @@
+// unrolled-voidlist.cc
+// Code for `unrolled-voidlist` module.
+
+// This file is in the public domain.
+
+#include "unrolled-voidlist.h"         // this module
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE, OPEN_ANONYMOUS_NAMESPACE
+#include "smbase/str.h"                // stringbc
+#include "smbase/xassert.h"            // xassert, xfailure
+
+#include <algorithm>                   // std::{copy, reverse}
+#include <cstring>                     // std::{memcpy, memmove}
+#include <vector>                      // std::vector
+
+#include <stdio.h>                     // printf
+
+
+OPEN_NAMESPACE(smbase)
+
+
+OPEN_ANONYMOUS_NAMESPACE
+
+
+// Sort the `n` elements of `a` the way VoidList::mergeSort sorts its
+// nodes: the left half gets the extra element, and ties are resolved
+// in favor of the right half.  `tmp` has room for `n` elements.
+void mergeSortRange(void **a, void **tmp, int n, VoidDiff diff, void *extra)
+{
+  if (n < 2) {
+    return;
+  }
+
+  int leftLen = (n+1) / 2;
+  mergeSortRange(a, tmp, leftLen, diff, extra);
+  mergeSortRange(a+leftLen, tmp, n-leftLen, diff, extra);
+
+  int left = 0;
+  int right = leftLen;
+  int out = 0;
+  while (left < leftLen && right < n) {
+    if (diff(a[left], a[right], extra) < 0) {
+      tmp[out++] = a[left++];
+    }
+    else {
+      tmp[out++] = a[right++];
+    }
+  }
+  while (left < leftLen) {
+    tmp[out++] = a[left++];
+  }
+  while (right < n) {
+    tmp[out++] = a[right++];
+  }
+
+  std::copy(tmp, tmp+n, a);
+}
+
+
+CLOSE_ANONYMOUS_NAMESPACE
+
+
+// ------------------------- UnrolledVoidList --------------------------
+UnrolledVoidList::UnrolledVoidList(UnrolledVoidList const &obj)
+  : m_head(nullptr),
+    m_tail(nullptr),
+    m_count(0)
+{
+  appendAll(obj);
+}
+
+
+STATICDEF UnrolledVoidList::Chunk *UnrolledVoidList::newChunk(Chunk *next)
+{
+  Chunk *c = new Chunk;
+  c->m_next = next;
+  c->m_count = 0;
+  return c;
+}
+
+
+UnrolledVoidList::Chunk *UnrolledVoidList::locate(int &index, Chunk **prev) const
+{
+  xassert(0 <= index && index < m_count);
+
+  if (!prev && index >= m_count - m_tail->m_count) {
+    // It is in the last chunk.
+    index -= m_count - m_tail->m_count;
+    return m_tail;
+  }
+
+  Chunk *p = nullptr;
+  Chunk *c = m_head;
+  while (index >= c->m_count) {
+    index -= c->m_count;
+    p = c;
+    c = c->m_next;
+  }
+
+  if (prev) {
+    *prev = p;
+  }
+  return c;
+}
+
+
+void UnrolledVoidList::insertInChunk(Chunk *&c, int &index, void *item)
+{
+  xassert(0 <= index && index <= c->m_count);
+
+  if (c->m_count == CHUNK_CAPACITY) {
+    // Move the upper half into a new chunk after `c`.
+    int const half = CHUNK_CAPACITY / 2;
+    Chunk *d = newChunk(c->m_next);
+    std::memcpy(d->m_items, c->m_items + half,
+                (CHUNK_CAPACITY - half) * sizeof(void*));
+    d->m_count = CHUNK_CAPACITY - half;
+    c->m_count = half;
+    c->m_next = d;
+    if (m_tail == c) {
+      m_tail = d;
+    }
+
+    if (index > half) {
+      c = d;
+      index -= half;
+    }
+  }
+
+  std::memmove(c->m_items + index + 1, c->m_items + index,
+               (c->m_count - index) * sizeof(void*));
+  c->m_items[index] = item;
+  c->m_count++;
+  m_count++;
+}
+
+
+UnrolledVoidList::Chunk *UnrolledVoidList::appendChunkItem(void *item)
+{
+  if (!m_tail) {
+    m_head = m_tail = newChunk(nullptr);
+  }
+  else if (m_tail->m_count == CHUNK_CAPACITY) {
+    m_tail = m_tail->m_next = newChunk(nullptr);
+  }
+
+  m_tail->m_items[m_tail->m_count++] = item;
+  m_count++;
+  return m_tail;
+}
+
+
+void *UnrolledVoidList::removeFromChunk(Chunk *&c, int index)
+{
+  void *ret = c->m_items[index];
+  std::memmove(c->m_items + index, c->m_items + index + 1,
+               (c->m_count - index - 1) * sizeof(void*));
+  c->m_count--;
+  m_count--;
+
+  Chunk *next = c->m_next;
+  if (next &&
+      (c->m_count == 0 || c->m_count + next->m_count <= MERGE_LIMIT)) {
+    // Absorb `next`.  This keeps (`c`, `index`) pointing at the
+    // element after the removed one.
+    std::memcpy(c->m_items + c->m_count, next->m_items,
+                next->m_count * sizeof(void*));
+    c->m_count += next->m_count;
+    c->m_next = next->m_next;
+    if (m_tail == next) {
+      m_tail = c;
+    }
+    delete next;
+  }
+
+  else if (c->m_count == 0) {
+    // `c` is the last chunk, and now empty.  Unlink it.
+    Chunk *prev = nullptr;
+    if (c != m_head) {
+      for (prev = m_head; prev->m_next != c; prev = prev->m_next)
+        {}
+      prev->m_next = nullptr;
+    }
+    else {
+      m_head = nullptr;
+    }
+    m_tail = prev;
+    delete c;
+    c = nullptr;
+  }
+
+  return ret;
+}
+
+
+void UnrolledVoidList::takeFrom(UnrolledVoidList &obj)
+{
+  xassert(isEmpty());
+
+  m_head = obj.m_head;
+  m_tail = obj.m_tail;
+  m_count = obj.m_count;
+
+  obj.m_head = obj.m_tail = nullptr;
+  obj.m_count = 0;
+}
+
+
+void UnrolledVoidList::copyOut(void **dest) const
+{
+  for (Chunk const *c = m_head; c; c = c->m_next) {
+    dest = std::copy(c->m_items, c->m_items + c->m_count, dest);
+  }
+}
+
+
+void UnrolledVoidList::copyIn(void * const *src)
+{
+  for (Chunk *c = m_head; c; c = c->m_next) {
+    std::copy(src, src + c->m_count, c->m_items);
+    src += c->m_count;
+  }
+}
+
+
+void *UnrolledVoidList::nth(int which) const
+{
+  return const_cast<UnrolledVoidList*>(this)->nthRef(which);
+}
+
+
+void *&UnrolledVoidList::nthRef(int which)
+{
+  xassert(which>=0);
+  if (which >= m_count) {
+    xfailure(stringbc("asked for list element "
+                      << which << " (0-based) but list only has "
+                      << m_count << " elements"));
+  }
+
+  Chunk *c = locate(which);
+  return c->m_items[which];
+}
+
+
+void *UnrolledVoidList::last() const
+{
+  xassert(isNotEmpty());
+  return m_tail->m_items[m_tail->m_count - 1];
+}
+
+
+void UnrolledVoidList::prepend(void *newitem)
+{
+  if (m_head && m_head->m_count < CHUNK_CAPACITY) {
+    Chunk *c = m_head;
+    int index = 0;
+    insertInChunk(c, index, newitem);
+  }
+  else {
+    m_head = newChunk(m_head);
+    if (!m_tail) {
+      m_tail = m_head;
+    }
+    m_head->m_items[0] = newitem;
+    m_head->m_count = 1;
+    m_count++;
+  }
+}
+
+
+void UnrolledVoidList::append(void *newitem)
+{
+  appendChunkItem(newitem);
+}
+
+
+void UnrolledVoidList::insertAt(void *newitem, int index)
+{
+  xassert(0 <= index && index <= m_count);
+
+  if (index == m_count) {
+    append(newitem);
+  }
+  else {
+    Chunk *c = locate(index);
+    insertInChunk(c, index, newitem);
+  }
+}
+
+
+void UnrolledVoidList::insertSorted(void *newitem, VoidDiff diff, void *extra)
+{
+  // put it first?
+  if (isEmpty() ||
+      diff(newitem, m_head->m_items[0], extra) <= 0) {
+    prepend(newitem);
+    return;
+  }
+
+  // Insert before the first later element that is not less than
+  // `newitem`.
+  for (Chunk *c = m_head; c; c = c->m_next) {
+    for (int i = (c == m_head? 1 : 0); i < c->m_count; i++) {
+      if (diff(c->m_items[i], newitem, extra) >= 0) {
+        insertInChunk(c, i, newitem);
+        return;
+      }
+    }
+  }
+
+  append(newitem);
+}
+
+
+void *UnrolledVoidList::removeAt(int index)
+{
+  if (index < 0 || index >= m_count) {
+    xfailure("Tried to remove an element not on the list");
+  }
+
+  Chunk *c = locate(index);
+  return removeFromChunk(c, index);
+}
+
+
+void UnrolledVoidList::removeAll()
+{
+  while (m_head) {
+    Chunk *temp = m_head;
+    m_head = m_head->m_next;
+    delete temp;
+  }
+  m_tail = nullptr;
+  m_count = 0;
+}
+
+
+int UnrolledVoidList::indexOf(void *item) const
+{
+  int base = 0;
+  for (Chunk const *c = m_head; c; c = c->m_next) {
+    for (int i=0; i < c->m_count; i++) {
+      if (c->m_items[i] == item) {
+        return base + i;
+      }
+    }
+    base += c->m_count;
+  }
+  return -1;
+}
+
+
+int UnrolledVoidList::indexOfF(void *item) const
+{
+  int ret = indexOf(item);
+  xassert(ret >= 0);
+  return ret;
+}
+
+
+bool UnrolledVoidList::prependUnique(void *newitem)
+{
+  if (!contains(newitem)) {
+    prepend(newitem);
+    return true;
+  }
+  else {
+    return false;
+  }
+}
+
+
+bool UnrolledVoidList::appendUnique(void *newitem)
+{
+  if (!contains(newitem)) {
+    append(newitem);
+    return true;
+  }
+  else {
+    return false;
+  }
+}
+
+
+void UnrolledVoidList::removeItem(void *item)
+{
+  bool wasThere = removeIfPresent(item);
+  xassert(wasThere);
+}
+
+
+bool UnrolledVoidList::removeIfPresent(void *item)
+{
+  for (Chunk *c = m_head; c; c = c->m_next) {
+    for (int i=0; i < c->m_count; i++) {
+      if (c->m_items[i] == item) {
+        removeFromChunk(c, i);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+
+void UnrolledVoidList::reverse()
+{
+  Chunk *reversed = nullptr;
+  Chunk *c = m_head;
+  while (c) {
+    Chunk *next = c->m_next;
+    std::reverse(c->m_items, c->m_items + c->m_count);
+    c->m_next = reversed;
+    reversed = c;
+    c = next;
+  }
+
+  m_tail = m_head;
+  m_head = reversed;
+}
+
+
+// This performs the same comparisons and moves as
+// VoidList::insertionSort, but on an array of the pointers.
+void UnrolledVoidList::insertionSort(VoidDiff diff, void *extra)
+{
+  std::vector<void*> a(m_count);
+  copyOut(a.data());
+
+  for (int primary=0; primary+1 < m_count; primary++) {
+    if (diff(a[primary], a[primary+1], extra) > 0) {
+      void *tomove = a[primary+1];
+
+      int dest = 0;
+      if (diff(tomove, a[0], extra) >= 0) {
+        dest = 1;
+        while (dest < primary && diff(tomove, a[dest], extra) > 0) {
+          dest++;
+        }
+      }
+
+      // Shift [dest,primary] up by one; `a[primary]` ends up at
+      // `primary+1`, so the loop increment keeps tracking it.
+      std::memmove(&a[dest+1], &a[dest], (primary+1-dest) * sizeof(void*));
+      a[dest] = tomove;
+    }
+  }
+
+  copyIn(a.data());
+}
+
+
+void UnrolledVoidList::mergeSort(VoidDiff diff, void *extra)
+{
+  if (m_count < 2) {
+    return;
+  }
+
+  std::vector<void*> a(m_count);
+  std::vector<void*> tmp(m_count);
+  copyOut(a.data());
+  mergeSortRange(a.data(), tmp.data(), m_count, diff, extra);
+  copyIn(a.data());
+}
+
+
+bool UnrolledVoidList::isSorted(VoidDiff diff, void *extra) const
+{
+  if (isEmpty()) {
+    return true;
+  }
+
+  UnrolledVoidListIter iter(*this);
+  void *prev = iter.data();
+  for (iter.adv(); !iter.isDone(); iter.adv()) {
+    void *current = iter.data();
+    if (diff(prev, current, extra) > 0) {
+      return false;
+    }
+    prev = current;
+  }
+
+  return true;
+}
+
+
+void UnrolledVoidList::concat(UnrolledVoidList &tail)
+{
+  if (tail.isEmpty()) {
+    return;
+  }
+  if (isEmpty()) {
+    takeFrom(tail);
+    return;
+  }
+
+  m_tail->m_next = tail.m_head;
+  m_tail = tail.m_tail;
+  m_count += tail.m_count;
+
+  tail.m_head = tail.m_tail = nullptr;
+  tail.m_count = 0;
+}
+
+
+void UnrolledVoidList::appendAll(UnrolledVoidList const &tail)
+{
+  // Bound the loop by the original count in case `tail` is `*this`.
+  int n = tail.m_count;
+  for (UnrolledVoidListIter iter(tail); n > 0; iter.adv(), n--) {
+    append(iter.data());
+  }
+}
+
+
+void UnrolledVoidList::prependAll(UnrolledVoidList const &head)
+{
+  UnrolledVoidList combined(head);
+  combined.concat(*this);
+  takeFrom(combined);
+}
+
+
+UnrolledVoidList& UnrolledVoidList::operator= (UnrolledVoidList const &src)
+{
+  if (this != &src) {
+    removeAll();
+    appendAll(src);
+  }
+  return *this;
+}
+
+
+void UnrolledVoidList::stealTailAt(int index, UnrolledVoidList &source)
+{
+  if (index == 0) {
+    concat(source);
+    return;
+  }
+
+  xassert(0 < index && index <= source.m_count);
+  if (index == source.m_count) {
+    return;                            // nothing to steal
+  }
+
+  // Break `source` into two lists at `index`.
+  UnrolledVoidList stolen;
+  Chunk *prev;
+  int i = index;
+  Chunk *c = source.locate(i, &prev);
+  if (i == 0) {
+    // The break is between chunks.  Since `index` is not 0, `c` is
+    // not the first.
+    stolen.m_head = c;
+    stolen.m_tail = source.m_tail;
+    prev->m_next = nullptr;
+    source.m_tail = prev;
+  }
+  else {
+    // Split `c`.
+    Chunk *d = newChunk(c->m_next);
+    d->m_count = c->m_count - i;
+    std::memcpy(d->m_items, c->m_items + i, d->m_count * sizeof(void*));
+    c->m_count = i;
+    c->m_next = nullptr;
+    stolen.m_head = d;
+    stolen.m_tail = (source.m_tail == c? d : source.m_tail);
+    source.m_tail = c;
+  }
+  stolen.m_count = source.m_count - index;
+  source.m_count = index;
+
+  concat(stolen);
+}
+
+
+bool UnrolledVoidList::equalAsLists(UnrolledVoidList const &otherList,
+                                    VoidDiff diff, void *extra) const
+{
+  return m_count == otherList.m_count &&
+         0==compareAsLists(otherList, diff, extra);
+}
+
+
+int UnrolledVoidList::compareAsLists(UnrolledVoidList const &otherList,
+                                     VoidDiff diff, void *extra) const
+{
+  UnrolledVoidListIter mine(*this);
+  UnrolledVoidListIter his(otherList);
+
+  while (!mine.isDone() && !his.isDone()) {
+    int cmp = diff(mine.data(), his.data(), extra);
+    if (cmp != 0) {
+      return cmp;
+    }
+
+    mine.adv();
+    his.adv();
+  }
+
+  if (!mine.isDone() || !his.isDone()) {
+    // unequal lengths: shorter compares as less
+    return mine.isDone()? -1 : +1;
+  }
+
+  return 0;
+}
+
+
+bool UnrolledVoidList::equalAsSets(UnrolledVoidList const &otherList,
+                                   VoidDiff diff, void *extra) const
+{
+  return this->isSubsetOf(otherList, diff, extra) &&
+         otherList.isSubsetOf(*this, diff, extra);
+}
+
+
+bool UnrolledVoidList::isSubsetOf(UnrolledVoidList const &otherList,
+                                  VoidDiff diff, void *extra) const
+{
+  for (UnrolledVoidListIter iter(*this); !iter.isDone(); iter.adv()) {
+    if (!otherList.containsByDiff(iter.data(), diff, extra)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool UnrolledVoidList::containsByDiff(void *item, VoidDiff diff, void *extra) const
+{
+  for (UnrolledVoidListIter iter(*this); !iter.isDone(); iter.adv()) {
+    if (0==diff(item, iter.data(), extra)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void UnrolledVoidList::removeDuplicatesAsMultiset(VoidDiff diff, void *extra)
+{
+  if (isEmpty()) {
+    return;
+  }
+
+  mergeSort(diff, extra);
+
+  UnrolledVoidListMutator mut(*this);
+
+  void *prevItem = mut.data();
+  mut.adv();
+
+  while (!mut.isDone()) {
+    if (0==diff(prevItem, mut.data(), extra)) {
+      mut.remove();
+    }
+    else {
+      prevItem = mut.data();
+      mut.adv();
+    }
+  }
+}
+
+
+void UnrolledVoidList::selfCheck() const
+{
+  int total = 0;
+  Chunk const *last = nullptr;
+  for (Chunk const *c = m_head; c; c = c->m_next) {
+    xassert(1 <= c->m_count && c->m_count <= CHUNK_CAPACITY);
+    total += c->m_count;
+
+    // Since no chunk is empty, this also rules out cycles.
+    xassert(total <= m_count);
+
+    last = c;
+  }
+  xassert(total == m_count);
+  xassert(last == m_tail);
+}
+
+
+void UnrolledVoidList::debugPrint() const
+{
+  printf("{ ");
+  for (UnrolledVoidListIter iter(*this); !iter.isDone(); iter.adv()) {
+    printf("%p ", iter.data());
+  }
+  printf("}");
+}
+
+
+void UnrolledVoidList::checkUniqueDataPtrs() const
+{
+  std::vector<void*> a(m_count);
+  copyOut(a.data());
+  for (int i=0; i < m_count; i++) {
+    for (int j=0; j < i; j++) {
+      if (a[i] == a[j]) {
+        xfailure("linked list with duplicate element");
+      }
+    }
+  }
+}
+
+
+int UnrolledVoidList::numChunks() const
+{
+  int ct = 0;
+  for (Chunk const *c = m_head; c; c = c->m_next) {
+    ct++;
+  }
+  return ct;
+}
+
+
+// ---------------------- UnrolledVoidListMutator ----------------------
+UnrolledVoidListMutator&
+  UnrolledVoidListMutator::operator=(UnrolledVoidListMutator const &obj)
+{
+  xassert(&m_list == &obj.m_list);
+
+  m_chunk = obj.m_chunk;
+  m_index = obj.m_index;
+
+  return *this;
+}
+
+
+void UnrolledVoidListMutator::insertBefore(void *item)
+{
+  if (isDone()) {
+    m_chunk = m_list.appendChunkItem(item);
+    m_index = m_chunk->m_count - 1;
+  }
+  else {
+    m_list.insertInChunk(m_chunk, m_index, item);
+  }
+}
+
+
+void UnrolledVoidListMutator::insertAfter(void *item)
+{
+  xassert(!isDone());
+
+  // If the insertion splits the chunk, the current element may move to
+  // the new one, but it is always just before `item`, which cannot be
+  // first in its chunk.
+  Chunk *c = m_chunk;
+  int index = m_index + 1;
+  m_list.insertInChunk(c, index, item);
+  m_chunk = c;
+  m_index = index - 1;
+}
+
+
+void UnrolledVoidListMutator::append(void *item)
+{
+  xassert(isDone());
+  m_list.appendChunkItem(item);
+}
+
+
+void *UnrolledVoidListMutator::remove()
+{
+  xassert(!isDone());
+
+  void *ret = m_list.removeFromChunk(m_chunk, m_index);
+  if (m_chunk && m_index == m_chunk->m_count) {
+    m_chunk = m_chunk->m_next;
+    m_index = 0;
+  }
+  return ret;
+}
+
+
+// ----------------------- UnrolledVoidListIter ------------------------
+UnrolledVoidListIter::UnrolledVoidListIter(UnrolledVoidList const &list, int pos)
+{
+  xassert(0 <= pos && pos <= list.m_count);
+
+  if (pos == list.m_count) {
+    m_chunk = nullptr;
+    m_index = 0;
+  }
+  else {
+    m_chunk = list.locate(pos);
+    m_index = pos;
+  }
+}
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+// EOF
@@ -0,0 +1,288 @@
+// unrolled-voidlist.h
+// `UnrolledVoidList`, a list of void* stored in chunked nodes.
+
+// This file is in the public domain.
+
+// UnrolledVoidList has the same interface and iterator semantics as
+// VoidList, but instead of one heap node per element, it stores the
+// pointers in nodes ("chunks") of up to CHUNK_CAPACITY entries, and
+// keeps the element count and the last chunk.  Consequently:
+//
+//   * `count`, `append`, `last` and `concat` take constant time.
+//
+//   * Traversal touches one cache line per several elements rather
+//     than chasing a pointer per element, and there are far fewer
+//     allocations.
+//
+//   * Operations that reorder elements (`reverse` and the sorts) work
+//     on the pointers, so they produce exactly the same order as the
+//     VoidList versions, including among equivalent elements.
+//
+// It can be used as the backing list of ObjList and SObjList via their
+// second template parameter, e.g. `SObjList<Foo, UnrolledVoidList>`.
+//
+// The iterator rules are the same as for VoidList: while a mutator
+// exists, the list may only be changed through that one mutator, and
+// copies of a mutator are only valid until the list is changed.
+
+#ifndef SMBASE_UNROLLED_VOIDLIST_H
+#define SMBASE_UNROLLED_VOIDLIST_H
+
+#include "smbase/sm-macros.h"          // OPEN_NAMESPACE
+#include "smbase/voidlist.h"           // VoidDiff, VoidList
+#include "smbase/xassert.h"            // xassert
+
+
+OPEN_NAMESPACE(smbase)
+
+
+class UnrolledVoidListIter;
+class UnrolledVoidListMutator;
+
+
+class UnrolledVoidList {
+  friend class UnrolledVoidListIter;
+  friend class UnrolledVoidListMutator;
+
+public:      // types
+  typedef UnrolledVoidListIter Iter;
+  typedef UnrolledVoidListMutator Mutator;
+
+  // Capacity of one chunk.  On 64-bit platforms, this makes a chunk
+  // 256 bytes.
+  enum { CHUNK_CAPACITY = 30 };
+
+private:     // types
+  struct Chunk {
+    // (owner) Next chunk, or nullptr if this is the last.
+    Chunk *m_next;
+
+    // Number of entries of `m_items` in use, in [1,CHUNK_CAPACITY].
+    // Empty chunks are removed from the list.
+    int m_count;
+
+    void *m_items[CHUNK_CAPACITY];
+  };
+
+  // After a removal, a chunk absorbs its successor if the two have at
+  // most this many elements between them.  Leaving some slack below
+  // CHUNK_CAPACITY keeps alternating insertions and removals from
+  // repeatedly splitting and merging the same chunk.
+  enum { MERGE_LIMIT = CHUNK_CAPACITY - CHUNK_CAPACITY/4 };
+
+private:     // data
+  // (owner) First chunk, or nullptr if the list is empty.
+  Chunk *m_head;
+
+  // (serf) Last chunk, or nullptr if the list is empty.
+  Chunk *m_tail;
+
+  // Number of elements.
+  int m_count;
+
+private:     // funcs
+  static Chunk *newChunk(Chunk *next);
+
+  // Find the chunk and index of element `index`, which must be in
+  // [0,count()).  If `prev` is not null, set it to the chunk before
+  // the one returned.
+  Chunk *locate(int &index, Chunk **prev = nullptr) const;
+
+  // Insert `item` into `c` at `index`, which is in [0,c->m_count],
+  // splitting `c` if it is full.  Set `c` and `index` to where `item`
+  // ended up.
+  void insertInChunk(Chunk *&c, int &index, void *item);
+
+  // Add `item` at the end, and return the chunk it is in.
+  Chunk *appendChunkItem(void *item);
+
+  // Remove element `index` of `c`, and return it.  If `c` becomes
+  // empty it may be deallocated, and in that case `c` is set to
+  // nullptr; otherwise, position (`c`, `index`) is the element that
+  // followed the removed one, or `index` is `c->m_count` if there is
+  // none in `c`.
+  void *removeFromChunk(Chunk *&c, int index);
+
+  // Take all of the elements of `obj`, leaving it empty.  'this' must
+  // be empty.
+  void takeFrom(UnrolledVoidList &obj);
+
+  // Copy the elements into `dest`, which has room for `count()`.
+  void copyOut(void **dest) const;
+
+  // Replace the elements with those of `src`, in order; there are
+  // `count()` of them.
+  void copyIn(void * const *src);
+
+public:      // funcs
+  UnrolledVoidList()                 : m_head(nullptr), m_tail(nullptr), m_count(0) {}
+  UnrolledVoidList(UnrolledVoidList const &obj);
+  ~UnrolledVoidList()                { removeAll(); }
+
+  // selectors
+  int count() const                  { return m_count; }
+  bool isEmpty() const               { return m_head == nullptr; }
+  bool isNotEmpty() const            { return m_head != nullptr; }
+  void *nth(int which) const;
+  void *&nthRef(int which);
+  void *first() const                { return nth(0); }
+  void *last() const;
+
+  // insertion
+  void prepend(void *newitem);
+  void append(void *newitem);
+  void insertAt(void *newitem, int index);
+  void insertSorted(void *newitem, VoidDiff diff, void *extra=nullptr);
+
+  // removal
+  void *removeAt(int index);
+  void *removeFirst()                { return removeAt(0); }
+  void removeAll();
+
+  // list-as-set: selectors
+  int indexOf(void *item) const;
+  int indexOfF(void *item) const;
+  bool contains(void *item) const    { return indexOf(item) >= 0; }
+
+  // list-as-set: mutators
+  bool prependUnique(void *newitem);
+  bool appendUnique(void *newitem);
+  void removeItem(void *item);
+  bool removeIfPresent(void *item);
+
+  // complex modifiers
+  void reverse();
+  void insertionSort(VoidDiff diff, void *extra=nullptr);
+  void mergeSort(VoidDiff diff, void *extra=nullptr);
+
+  // and a related test
+  bool isSorted(VoidDiff diff, void *extra=nullptr) const;
+
+  // multiple lists
+  void concat(UnrolledVoidList &tail);
+  void appendAll(UnrolledVoidList const &tail);
+  void prependAll(UnrolledVoidList const &head);
+  UnrolledVoidList& operator= (UnrolledVoidList const &src);
+  void stealTailAt(int index, UnrolledVoidList &source);
+
+  // comparisons
+  bool equalAsLists(UnrolledVoidList const &otherList, VoidDiff diff, void *extra=nullptr) const;
+  int compareAsLists(UnrolledVoidList const &otherList, VoidDiff diff, void *extra=nullptr) const;
+  bool equalAsSets(UnrolledVoidList const &otherList, VoidDiff diff, void *extra=nullptr) const;
+  bool isSubsetOf(UnrolledVoidList const &otherList, VoidDiff diff, void *extra=nullptr) const;
+  bool containsByDiff(void *item, VoidDiff diff, void *extra=nullptr) const;
+
+  void removeDuplicatesAsMultiset(VoidDiff diff, void *extra=nullptr);
+
+  // treating the pointer values themselves as the basis for comparison
+  bool equalAsPointerLists(UnrolledVoidList const &otherList) const
+    { return equalAsLists(otherList, VoidList::pointerAddressDiff); }
+  bool equalAsPointerSets(UnrolledVoidList const &otherList) const
+    { return equalAsSets(otherList, VoidList::pointerAddressDiff); }
+  void removeDuplicatesAsPointerMultiset()
+    { removeDuplicatesAsMultiset(VoidList::pointerAddressDiff); }
+
+  // debugging
+  void selfCheck() const;
+  void debugPrint() const;
+  void checkHeapDataPtrs() const     {}
+  void checkUniqueDataPtrs() const;
+
+  // Number of chunks, for tests.
+  int numChunks() const;
+};
+
+
+// Counterpart of VoidListMutator.
+class UnrolledVoidListMutator {
+  friend class UnrolledVoidListIter;
+
+private:     // types
+  typedef UnrolledVoidList::Chunk Chunk;
+
+protected:   // data
+  UnrolledVoidList &m_list;
+
+  // (serf) Chunk holding the current element, or nullptr if the
+  // iteration is done.
+  Chunk *m_chunk;
+
+  // Index of the current element in `m_chunk`.
+  int m_index;
+
+public:      // funcs
+  UnrolledVoidListMutator(UnrolledVoidList &lst) : m_list(lst) { reset(); }
+  ~UnrolledVoidListMutator()         {}
+
+  void reset()                       { m_chunk = m_list.m_head;  m_index = 0; }
+
+  UnrolledVoidListMutator(UnrolledVoidListMutator const &obj)
+    : m_list(obj.m_list), m_chunk(obj.m_chunk), m_index(obj.m_index) {}
+  UnrolledVoidListMutator& operator=(UnrolledVoidListMutator const &obj);
+
+  bool isDone() const                { return m_chunk == nullptr; }
+  void adv()
+  {
+    if (++m_index == m_chunk->m_count) {
+      m_chunk = m_chunk->m_next;
+      m_index = 0;
+    }
+  }
+  void *data()                       { return m_chunk->m_items[m_index]; }
+  void *&dataRef()                   { return m_chunk->m_items[m_index]; }
+
+  void insertBefore(void *item);
+  void insertAfter(void *item);
+  void append(void *item);
+  void *remove();
+
+  void selfCheck() const
+    { xassert(m_chunk == nullptr ||
+              (0 <= m_index && m_index < m_chunk->m_count)); }
+};
+
+
+// Counterpart of VoidListIter.
+class UnrolledVoidListIter {
+private:     // types
+  typedef UnrolledVoidList::Chunk Chunk;
+
+protected:   // data
+  // (serf) Chunk holding the current element, or nullptr if done.
+  Chunk const *m_chunk;
+
+  // Index of the current element in `m_chunk`.
+  int m_index;
+
+public:      // funcs
+  UnrolledVoidListIter(UnrolledVoidList const &list) { reset(list); }
+  UnrolledVoidListIter(UnrolledVoidList const &list, int pos);
+  ~UnrolledVoidListIter()            {}
+
+  void reset(UnrolledVoidList const &list)
+    { m_chunk = list.m_head;  m_index = 0; }
+
+  UnrolledVoidListIter(UnrolledVoidListIter const &obj)
+    : m_chunk(obj.m_chunk), m_index(obj.m_index) {}
+  UnrolledVoidListIter& operator=(UnrolledVoidListIter const &obj)
+    { m_chunk = obj.m_chunk;  m_index = obj.m_index;  return *this; }
+
+  UnrolledVoidListIter(UnrolledVoidListMutator &obj)
+    : m_chunk(obj.m_chunk), m_index(obj.m_index) {}
+
+  bool isDone() const                { return m_chunk == nullptr; }
+  void adv()
+  {
+    if (++m_index == m_chunk->m_count) {
+      m_chunk = m_chunk->m_next;
+      m_index = 0;
+    }
+  }
+  void *data() const                 { return m_chunk->m_items[m_index]; }
+};
+
+
+CLOSE_NAMESPACE(smbase)
+
+
+#endif // SMBASE_UNROLLED_VOIDLIST_H
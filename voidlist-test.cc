@@ -1,9 +1,10 @@
 // voidlist-test.cc
-// Tests for voidlist.
+// Tests for voidlist, run against both VoidList and UnrolledVoidList.
 
 #include "voidlist.h"                  // module under test
 
 #include "sm-stdint.h"                 // intptr_t
+#include "unrolled-voidlist.h"         // smbase::UnrolledVoidList
 #include "sm-test.h"                   // dummy_printf
 
 #include <stdio.h>                     // printf
@@ -18,10 +19,11 @@
 // assumes we're using pointerAddressDiff as the comparison fn
 // (I don't use isSorted because this fn will throw at the disequality,
 // whereas isSorted would forget that info)
-static void verifySorted(VoidList const &list)
+template <class VList>
+static void verifySorted(VList const &list)
 {
   const void* prev = 0;
-  VoidListIter iter(list);
+  typename VList::Iter iter(list);
   for (; !iter.isDone(); iter.adv()) {
     const void *current = (const void *)iter.data();
     xassert(prev <= current);    // numeric address test
@@ -30,14 +32,15 @@ static void verifySorted(VoidList const &list)
 }
 
 
+template <class VList>
 static void testSorting()
 {
   enum { ITERS=100, ITEMS=20 };
 
   smbase_loopi(ITERS) {
     // construct a list (and do it again if it ends up already sorted)
-    VoidList list1;
-    VoidList list3;     // this one will be constructed sorted one at a time
+    VList list1;
+    VList list3;     // this one will be constructed sorted one at a time
     int numItems;
     do {
       list1.removeAll();    // clear them in case we have to build it more than once
@@ -55,7 +58,7 @@ static void testSorting()
     verifySorted(list3);
 
     // duplicate it for use with other algorithm
-    VoidList list2;
+    VList list2;
     list2 = list1;
 
     // sort them
@@ -89,15 +92,18 @@ static void testSorting()
 }
 
 
-// Called from unit-tests.cc.
-void test_voidlist()
+template <class VList>
+static void testOneBacking()
 {
+  typedef typename VList::Iter Iter;
+  typedef typename VList::Mutator Mutator;
+
   // first set of tests
   {
     // some sample items
     void *a=(void*)4, *b=(void*)8, *c=(void*)12, *d=(void*)16;
 
-    VoidList list;
+    VList list;
 
     // test simple modifiers and info
     list.append(c);     PRINT(list);   // c
@@ -120,7 +126,7 @@ void test_voidlist()
 
     // test mutator s
     {
-      VoidListMutator mut(list);
+      Mutator mut(list);
       mut.adv();
 	// now it's pointing at b
       mut.insertAfter(c);
@@ -131,12 +137,12 @@ void test_voidlist()
       xassert(mut.data() == c);
 
       // copy the mutator
-      VoidListMutator mut2(mut);
+      Mutator mut2(mut);
       mut2.adv();
       xassert(mut.data() == c  &&  mut2.data() == d);
 
       // copy to a normal iterator
-      VoidListIter iter(mut);
+      Iter iter(mut);
       iter.adv();
       xassert(iter.data() == d);
       iter.adv();
@@ -166,7 +172,7 @@ void test_voidlist()
     PRINT(list);
 
     // test stealTailAt
-    VoidList thief;
+    VList thief;
     thief.stealTailAt(1, list);
       // list is now (d)
       // thief is now (c b)
@@ -207,7 +213,15 @@ void test_voidlist()
 
   // this hits most of the remaining code
   // (a decent code coverage tool for C++ would be nice!)
-  testSorting();
+  testSorting<VList>();
+}
+
+
+// Called from unit-tests.cc.
+void test_voidlist()
+{
+  testOneBacking<VoidList>();
+  testOneBacking<smbase::UnrolledVoidList>();
 }
 
 
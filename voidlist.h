@@ -50,6 +50,11 @@ protected:
   VoidNode *getTop() const { return top; } // for iterator, below
 
 public:
+  // iterator types, for code that can use either this or
+  // UnrolledVoidList (see unrolled-voidlist.h)
+  typedef VoidListIter Iter;
+  typedef VoidListMutator Mutator;
+
   VoidList()                         { top=NULL; }
   VoidList(VoidList const &obj);     // makes a (shallow) copy of the contents
   ~VoidList()                        { removeAll(); }
@@ -1,16 +1,21 @@
 // vptrmap-test.cc
-// Tests for vptrmap.
+// Tests for vptrmap and swiss-vptrmap.
 
 #include "vptrmap.h"                   // module under test
+#include "swiss-vptrmap.h"             // module under test
 
 #include "array.h"                     // ObjArrayStack
+#include "nonport.h"                   // getMilliseconds
 #include "ptrmap.h"                    // PtrMap
 #include "sm-macros.h"                 // OPEN_ANONYMOUS_NAMESPACE
 #include "sm-test.h"                   // dummy_printf
 
-#include <stdlib.h>                    // rand, qsort
+#include <stdlib.h>                    // rand, qsort, getenv, atol
 #include <stdio.h>                     // printf
 
+#include <map>                         // std::map
+#include <vector>                      // std::vector
+
 
 // Silence the output when I'm not actively working on this test.
 #define printf dummy_printf
@@ -45,6 +50,7 @@ int doubleCompar(void const *dp1, void const *dp2)
 }
 
 
+template <class VPM>
 void test1()
 {
   printf("test1: testing PtrMap\n");
@@ -64,7 +70,7 @@ void test1()
     //#define CAST(something) (something)
     #define CAST(something) /*nothing*/
 
-    PtrMap<Node,int> map;
+    PtrMap<Node,int,VPM> map;
     ObjArrayStack<Node> stack;
 
     int iters2 = rand() % ITERS2MAX;
@@ -109,7 +115,7 @@ void test1()
         // walk via map; should find each one exactly once
         int numFound = 0;
         //VoidPtrMap::Iter iter(map);
-        PtrMap<Node,int>::Iter iter(map);
+        typename PtrMap<Node,int,VPM>::Iter iter(map);
         for (; !iter.isDone(); iter.adv()) {
           Node *n = CAST(Node*)iter.key();
           int *v = CAST(int*)iter.value();
@@ -129,20 +135,20 @@ void test1()
     }
 
     xassert(map.getNumEntries() == stack.length());
-    xassert(VoidPtrMap::lookups > 0);  // Otherwise divbyzero.
+    xassert(VPM::lookups > 0);  // Otherwise divbyzero.
 
     //     "  iter  iters  entries  lookups  probes  avgprobes"
-    avgprobes[i] = ((double)VoidPtrMap::probes) / ((double)VoidPtrMap::lookups);
+    avgprobes[i] = ((double)VPM::probes) / ((double)VPM::lookups);
     printf("  %4d  %5d  %7d  %7d  %6d    %g\n",
            i,
            iters2,
            map.getNumEntries(),
-           VoidPtrMap::lookups,
-           VoidPtrMap::probes,
+           VPM::lookups,
+           VPM::probes,
            avgprobes[i]);
 
-    VoidPtrMap::probes = 0;
-    VoidPtrMap::lookups = 0;
+    VPM::probes = 0;
+    VPM::lookups = 0;
   }
 
   // compute median of avgprobes
@@ -156,11 +162,12 @@ struct A {
   A(int x0) : x(x0) {}
 };
 
+template <class VPM>
 void test2()
 {
   printf("test2: testing PtrSet\n");
 
-  PtrSet<A> s;
+  PtrSet<A,VPM> s;
   xassert(s.isEmpty());
   xassert(s.getNumEntries() == 0);
 
@@ -195,6 +202,128 @@ void test2()
 }
 
 
+// Random adds and removes on SwissVoidPtrMap, checked against
+// std::map.
+void test3()
+{
+  printf("test3: testing remove and reserve\n");
+
+  enum { NUM_KEYS=2000 };
+  static int keys[NUM_KEYS];
+  std::map<void*, void*> ref;
+
+  SwissVoidPtrMap map;
+  for (int i=0; i < 20000; i++) {
+    void *key = &keys[rand() % NUM_KEYS];
+    void *value = &keys[rand() % NUM_KEYS];
+    switch (rand() % 3) {
+      case 0:
+        map.add(key, value);
+        ref[key] = value;
+        break;
+
+      case 1: {
+        auto it = ref.find(key);
+        void *expect = it==ref.end()? NULL : it->second;
+        xassert(map.remove(key) == expect);
+        if (it != ref.end()) {
+          ref.erase(it);
+        }
+        break;
+      }
+
+      case 2: {
+        auto it = ref.find(key);
+        xassert(map.get(key) == (it==ref.end()? NULL : it->second));
+        break;
+      }
+    }
+
+    xassert(map.getNumEntries() == (int)ref.size());
+    if (i % 1000 == 0) {
+      map.selfCheck();
+    }
+  }
+  map.selfCheck();
+
+  int ct = 0;
+  for (SwissVoidPtrMap::Iter iter(map); !iter.isDone(); iter.adv()) {
+    xassert(ref.at(iter.key()) == iter.value());
+    ct++;
+  }
+  xassert(ct == (int)ref.size());
+
+  // Repeatedly adding and removing does not grow the table.
+  SwissVoidPtrMap churn;
+  int size = churn.getTableSize();
+  for (int i=0; i < 10000; i++) {
+    churn.add(&keys[i % NUM_KEYS], &keys[0]);
+    xassert(churn.remove(&keys[i % NUM_KEYS]) == &keys[0]);
+  }
+  churn.selfCheck();
+  xassert(churn.getTableSize() == size);
+  xassert(churn.getNumEntries() == 0);
+
+  // Reserving avoids growth.
+  PtrMap<int,int,SwissVoidPtrMap> pm;
+  pm.reserve(NUM_KEYS);
+  for (int i=0; i < NUM_KEYS; i++) {
+    pm.add(&keys[i], &keys[i]);
+  }
+  xassert(pm.getNumEntries() == NUM_KEYS);
+  xassert(pm.remove(&keys[5]) == &keys[5]);
+  xassert(pm.remove(&keys[5]) == NULL);
+  xassert(pm.get(&keys[5]) == NULL);
+  xassert(pm.get(&keys[6]) == &keys[6]);
+
+  PtrSet<int,SwissVoidPtrMap> ps;
+  ps.add(&keys[1]);
+  xassert(ps.remove(&keys[1]));
+  xassert(!ps.remove(&keys[1]));
+  xassert(ps.isEmpty());
+}
+
+
+template <class VPM>
+void timeLookups(char const *label, int size, long lookups)
+{
+  std::vector<double> objs(size);
+  VPM map;
+  for (int i=0; i < size; i++) {
+    map.add(&objs[i], &objs[i]);
+  }
+
+  long start = getMilliseconds();
+  unsigned i = 0;
+  long found = 0;
+  for (long n=0; n < lookups; n++) {
+    i = i*1664525 + 1013904223;
+    found += map.get(&objs[i % size]) != NULL;
+  }
+  long ms = getMilliseconds() - start;
+  xassert(found == lookups);
+  fprintf(stdout, "%s size %7d: %ld M lookups in %ld ms\n",
+          label, size, lookups/1000000, ms);
+}
+
+
+// Measure lookup speed, if VPTRMAP_PERF is set to a number of
+// millions of lookups.
+void perfTest()
+{
+  char const *str = getenv("VPTRMAP_PERF");
+  if (!str) {
+    return;
+  }
+  long lookups = atol(str) * 1000000;
+
+  for (int size : {100, 10000, 1000000}) {
+    timeLookups<VoidPtrMap>("VoidPtrMap     ", size, lookups);
+    timeLookups<SwissVoidPtrMap>("SwissVoidPtrMap", size, lookups);
+  }
+}
+
+
 CLOSE_ANONYMOUS_NAMESPACE
 
 
@@ -202,8 +331,12 @@ CLOSE_ANONYMOUS_NAMESPACE
 void test_vptrmap()
 {
   printf("testing vptrmap\n");
-  test1();
-  test2();
+  test1<VoidPtrMap>();
+  test1<SwissVoidPtrMap>();
+  test2<VoidPtrMap>();
+  test2<SwissVoidPtrMap>();
+  test3();
+  perfTest();
   printf("vptrmap is ok\n");
 }
 
@@ -40,9 +40,9 @@ outputCond([[[]]],[[[m4_dnl
 
 // forward declarations of template classes, so we can befriend them in className
 // (not required by Borland C++ 4.5, but GNU wants it...)
-template <class T> class iterName;
-template <class T> class mutatorName;
-template <class T> class iterNameNC;
+template <class T, class VL = VoidList> class iterName;
+template <class T, class VL = VoidList> class mutatorName;
+template <class T, class VL = VoidList> class iterNameNC;
 
 
 outputCond([[[m4_dnl      // sobjlist
@@ -53,15 +53,18 @@ outputCond([[[m4_dnl      // sobjlist
 // an item into more than one such list, or to insert an item more than once
 // into any such list
 ]]])m4_dnl
-template <class T>
+//
+// 'VL' is the underlying list of void*, either VoidList or
+// UnrolledVoidList (unrolled-voidlist.h); they have the same interface
+template <class T, class VL = VoidList>
 class className {
 private:
-  friend class iterName<T>;
-  friend class mutatorName<T>;
-  friend class iterNameNC<T>;
+  friend class iterName<T, VL>;
+  friend class mutatorName<T, VL>;
+  friend class iterNameNC<T, VL>;
 
 protected:
-  VoidList list;                        // list itself
+  VL list;                              // list itself
 
 outputCond([[[m4_dnl    // sobjlist
 public:
@@ -199,8 +202,8 @@ outputCond([[[m4_dnl    // sobjlist
 
 
 outputCond(, [[[m4_dnl      // objlist
-template <class T>
-void ObjList<T>::deleteAll()
+template <class T, class VL>
+void ObjList<T, VL>::deleteAll()
 {
   while (!list.isEmpty()) {
     deleteAt(0);
@@ -213,15 +216,15 @@ void ObjList<T>::deleteAll()
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists, and only one such iterator should exist for
 //       any given list
-template <class T>
+template <class T, class VL>
 class mutatorName {
-  friend class iterName<T>;
+  friend class iterName<T, VL>;
 
 protected:
-  VoidListMutator mut;       // underlying mutator
+  typename VL::Mutator mut;  // underlying mutator
 
 public:
-  mutatorName[[[]]](className<T> &lst)     : mut(lst.list) { reset(); }
+  mutatorName[[[]]](className<T, VL> &lst)     : mut(lst.list) { reset(); }
   ~mutatorName[[[]]]()                    {}
 
   void reset()                          { mut.reset(); }
@@ -274,24 +277,24 @@ outputCond(, [[[m4_dnl    // sobjlist
 // for traversing the list without modifying it (neither nodes nor structure)
 // NOTE: no list-modification fns should be called on 'list' while this
 //       iterator exists
-template <class T>
+template <class T, class VL>
 class iterName {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  iterName[[[]]](className<T> const &list) : iter(list.list) {}
-  iterName[[[]]](className<T> const &list, int pos) : iter(list.list, pos) {}
+  iterName[[[]]](className<T, VL> const &list) : iter(list.list) {}
+  iterName[[[]]](className<T, VL> const &list, int pos) : iter(list.list, pos) {}
   ~iterName[[[]]]()                       {}
 
-  void reset(className<T> const &list)   { iter.reset(list.list); }
+  void reset(className<T, VL> const &list) { iter.reset(list.list); }
 
   // iterator copying; generally safe
   iterName[[[]]](iterName const &obj)             : iter(obj.iter) {}
   iterName& operator=(iterName const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  iterName[[[]]](mutatorName<T> &obj)             : iter(obj.mut) {}
+  iterName[[[]]](mutatorName<T, VL> &obj)         : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -306,24 +309,24 @@ public:
 // intermediate to the above two, this allows modification of the
 // objects stored on the list, but not the identity or order of
 // the objects in the list
-template <class T>
+template <class T, class VL>
 class iterNameNC {
 protected:
-  VoidListIter iter;      // underlying iterator
+  typename VL::Iter iter; // underlying iterator
 
 public:
-  iterNameNC[[[]]](className<T> &list) : iter(list.list) {}
-  iterNameNC[[[]]](className<T> &list, int pos) : iter(list.list, pos) {}
+  iterNameNC[[[]]](className<T, VL> &list) : iter(list.list) {}
+  iterNameNC[[[]]](className<T, VL> &list, int pos) : iter(list.list, pos) {}
   ~iterNameNC[[[]]]()                     {}
 
-  void reset(className<T> &list)         { iter.reset(list.list); }
+  void reset(className<T, VL> &list)     { iter.reset(list.list); }
 
   // iterator copying; generally safe
   iterNameNC[[[]]](iterNameNC const &obj)             : iter(obj.iter) {}
   iterNameNC& operator=(iterNameNC const &obj)  { iter = obj.iter;  return *this; }
 
   // but copying from a mutator is less safe; see above
-  iterNameNC[[[]]](mutatorName<T> &obj)               : iter(obj.mut) {}
+  iterNameNC[[[]]](mutatorName<T, VL> &obj)           : iter(obj.mut) {}
 
   // iterator actions
   bool isDone() const                   { return iter.isDone(); }
@@ -336,23 +339,23 @@ public:
 
 
 // iterate over the combined elements of two or more lists
-template <class T>
+template <class T, class VL = VoidList>
 class multiIterName {
 private:
   // all the lists
-  className<T> **lists;               SPC// serf array of serf list pointers
+  className<T, VL> **lists;           SPC// serf array of serf list pointers
   int numLists;                      // length of this array
 
   // current element
   int curList;                       // which list we're working on
-  iterName<T> iter;              SPC// current element of that list
+  iterName<T, VL> iter;          SPC// current element of that list
 
   // invariant:
   //   either curList==numLists, or
   //   iter is not 'done'
 
 public:
-  multiIterName[[[]]](className<T> **L, int n)
+  multiIterName[[[]]](className<T, VL> **L, int n)
     : lists(L),
       numLists(n),
       curList(0),
@@ -382,8 +385,8 @@ public:
 
 // this was originally inline, but that was causing some strange
 // problems (compiler bug?)
-template <class T>
-void multiIterName<T>::normalize()
+template <class T, class VL>
+void multiIterName<T, VL>::normalize()
 {
   while (iter.isDone() && curList < numLists) {
     curList++;